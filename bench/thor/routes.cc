@@ -383,6 +383,59 @@ static void BM_Sif_Allowed(benchmark::State& state) {
 
 BENCHMARK(BM_Sif_Allowed)->Unit(benchmark::kNanosecond);
 
+// What a search asks of the costing per edge, as separate virtual calls (0) or as one call (1)
+static void BM_Sif_AllowedEdgeCost(benchmark::State& state) {
+
+  const auto config = build_config("sif-allowed.tar");
+  auto tgt_edge_id = baldr::GraphId(3196, 0, 3221);
+  auto tgt_speed = 100;
+  customize_traffic(config, tgt_edge_id, tgt_speed);
+
+  auto clean_reader = test::make_clean_graphreader(config.get_child("mjolnir"));
+
+  Options options;
+  create_costing_options(options);
+  sif::TravelMode mode;
+  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
+  auto cost = costs[static_cast<size_t>(mode)];
+
+  auto tile = clean_reader->GetGraphTile(baldr::GraphId(tgt_edge_id));
+  if (tile == nullptr) {
+    throw std::runtime_error("Target tile not found");
+  }
+  auto edge = tile->directededge(tgt_edge_id);
+  if (edge == nullptr) {
+    throw std::runtime_error("Target edge not found");
+  }
+  auto node_tile = clean_reader->GetGraphTile(edge->endnode());
+  if (node_tile == nullptr) {
+    throw std::runtime_error("End node tile not found");
+  }
+  auto node = node_tile->node(edge->endnode());
+
+  auto pred = sif::EdgeLabel();
+  uint8_t restriction_idx, flow_sources;
+  sif::Cost transition_cost, edge_cost;
+
+  if (state.range(0) == 0) {
+    for (auto _ : state) {
+      if (cost->Allowed(edge, false, pred, tile, tgt_edge_id, 0, 0, restriction_idx)) {
+        transition_cost = cost->TransitionCost(edge, node, pred);
+        edge_cost = cost->EdgeCost(edge, tile, 0, flow_sources);
+      }
+      benchmark::DoNotOptimize(edge_cost);
+    }
+  } else {
+    for (auto _ : state) {
+      cost->AllowedEdgeCost(edge, false, pred, tile, tgt_edge_id, node, 0, 0, 0, restriction_idx,
+                            transition_cost, edge_cost, flow_sources);
+      benchmark::DoNotOptimize(edge_cost);
+    }
+  }
+}
+
+BENCHMARK(BM_Sif_AllowedEdgeCost)->Arg(0)->Arg(1)->Unit(benchmark::kNanosecond);
+
 } // namespace
 
 int main(int argc, char** argv) {
@@ -0,0 +1,102 @@
+#include "baldr/contraction.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Identifies the file and the layout of its contents
+constexpr char kContractionMagic[8] = {'V', 'A', 'L', 'H', 'C', 'H', '0', '1'};
+
+struct ContractionHeader {
+  char magic[8];
+  uint32_t tile_count;
+  uint32_t vertex_count;
+  uint32_t forward_count;
+  uint32_t backward_count;
+};
+
+// flattens arcs per vertex into compressed sparse rows
+void flatten(const std::vector<std::vector<valhalla::baldr::ContractionArc>>& arcs,
+             std::vector<uint32_t>& offsets,
+             std::vector<valhalla::baldr::ContractionArc>& flat) {
+  offsets.reserve(arcs.size() + 1);
+  offsets.push_back(0);
+  for (const auto& a : arcs) {
+    flat.insert(flat.end(), a.begin(), a.end());
+    offsets.push_back(static_cast<uint32_t>(flat.size()));
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+std::shared_ptr<const ContractionOverlay> ContractionOverlay::Load(const std::string& tile_dir) {
+  auto file_name = tile_dir + filesystem::path::preferred_separator + kContractionFile;
+  std::ifstream file(file_name, std::ios::binary);
+  if (!file.is_open()) {
+    return nullptr;
+  }
+
+  ContractionHeader header;
+  if (!read_header(file, header, kContractionMagic)) {
+    LOG_WARN("Ignoring contraction hierarchy with unknown format: " + file_name);
+    return nullptr;
+  }
+
+  std::shared_ptr<ContractionOverlay> overlay(new ContractionOverlay());
+  overlay->tiles_.read(file, header.tile_count, header.vertex_count);
+  read_records(file, overlay->forward_offsets_, header.vertex_count + 1);
+  read_records(file, overlay->forward_arcs_, header.forward_count);
+  read_records(file, overlay->backward_offsets_, header.vertex_count + 1);
+  read_records(file, overlay->backward_arcs_, header.backward_count);
+  if (!file || overlay->forward_offsets_.back() != header.forward_count ||
+      overlay->backward_offsets_.back() != header.backward_count) {
+    LOG_WARN("Ignoring truncated contraction hierarchy: " + file_name);
+    return nullptr;
+  }
+
+  LOG_INFO("Loaded contraction hierarchy with " + std::to_string(header.vertex_count) +
+           " vertices and " + std::to_string(header.forward_count + header.backward_count) +
+           " arcs");
+  return overlay;
+}
+
+void ContractionOverlay::Write(const std::string& tile_dir,
+                               const std::vector<std::pair<GraphId, uint32_t>>& tiles,
+                               const std::vector<std::vector<ContractionArc>>& forward,
+                               const std::vector<std::vector<ContractionArc>>& backward) {
+  ContractionOverlay overlay;
+  overlay.tiles_ = TileOffsets(tiles);
+  uint32_t vertex_count = overlay.tiles_.record_count();
+  if (forward.size() != vertex_count || backward.size() != vertex_count) {
+    throw std::logic_error("Contraction arcs do not match the number of vertices");
+  }
+  flatten(forward, overlay.forward_offsets_, overlay.forward_arcs_);
+  flatten(backward, overlay.backward_offsets_, overlay.backward_arcs_);
+
+  ContractionHeader header;
+  header.tile_count = overlay.tiles_.tile_count();
+  header.vertex_count = vertex_count;
+  header.forward_count = static_cast<uint32_t>(overlay.forward_arcs_.size());
+  header.backward_count = static_cast<uint32_t>(overlay.backward_arcs_.size());
+
+  auto file_name = tile_dir + filesystem::path::preferred_separator + kContractionFile;
+  std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+  write_header(file, header, kContractionMagic);
+  overlay.tiles_.write(file);
+  write_records(file, overlay.forward_offsets_);
+  write_records(file, overlay.forward_arcs_);
+  write_records(file, overlay.backward_offsets_);
+  write_records(file, overlay.backward_arcs_);
+  if (!file) {
+    throw std::runtime_error("Failed to write contraction hierarchy: " + file_name);
+  }
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -1,5 +1,7 @@
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <string>
 #include <sys/stat.h>
 #include <utility>
@@ -11,6 +13,8 @@
 #include "incident_singleton.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "midgard/metrics.h"
+#include "midgard/util.h"
 #include "shortcut_recovery.h"
 
 using namespace valhalla::midgard;
@@ -21,6 +25,17 @@ constexpr size_t DEFAULT_MAX_CACHE_SIZE = 1073741824; // 1 gig
 constexpr size_t AVERAGE_TILE_SIZE = 2097152;         // 2 megs
 constexpr size_t AVERAGE_MM_TILE_SIZE = 1024;         // 1k
 
+// How often a wait for a prefetched tile checks for an interrupt and when it gives up on it
+constexpr std::chrono::milliseconds PREFETCH_WAIT_INTERVAL{100};
+constexpr std::chrono::seconds PREFETCH_WAIT_TIMEOUT{30};
+
+// Count the tiles a cache let go of
+void count_evictions(const uint64_t count) {
+  if (count > 0) {
+    valhalla::midgard::metrics::counter("valhalla_tile_cache_evictions_total").add(count);
+  }
+}
+
 } // namespace
 
 namespace valhalla {
@@ -35,25 +50,60 @@ tile_gone_error_t::tile_gone_error_t(std::string prefix, baldr::GraphId edgeid)
                          std::to_string(edgeid.Tile_Base())) {
 }
 
+void GraphReader::tile_extract_t::tile_index_t::load(const std::string& archive_file,
+                                                     std::shared_ptr<midgard::tar>& archive) {
+  // an index at the front of the archive lets us skip reading the rest of it
+  archive.reset(new midgard::tar(archive_file, true, false));
+  auto index = archive->contents.find(kTileExtractIndex);
+  if (index != archive->contents.cend()) {
+    const char* data = index->second.first;
+    size_t size = index->second.second;
+    begin_ = reinterpret_cast<const tile_index_entry_t*>(data);
+    end_ = begin_ + size / sizeof(tile_index_entry_t);
+    // make sure the index is sane before trusting it with pointers into the archive
+    bool valid = size % sizeof(tile_index_entry_t) == 0 &&
+                 reinterpret_cast<uintptr_t>(data) % alignof(tile_index_entry_t) == 0;
+    for (auto entry = begin_; valid && entry != end_; ++entry) {
+      valid = entry->offset + entry->size <= archive->mm.size() &&
+              (entry == begin_ || (entry - 1)->tile_id < entry->tile_id);
+    }
+    if (valid) {
+      return;
+    }
+    LOG_WARN("Ignoring invalid index of " + archive_file);
+  }
+
+  // otherwise we have to look at every file in the archive
+  archive.reset(new midgard::tar(archive_file));
+  scanned_.clear();
+  scanned_.reserve(archive->contents.size());
+  for (auto& c : archive->contents) {
+    try {
+      auto id = GraphTile::GetTileId(c.first);
+      scanned_.push_back({static_cast<uint64_t>(c.second.first - archive->mm.get()),
+                          static_cast<uint32_t>(id.value), static_cast<uint32_t>(c.second.second)});
+    } catch (...) {
+      // It's possible to put non-tile files inside the tarfile.  As we're only
+      // parsing the file *name* as a GraphId here, we will just silently skip
+      // any file paths that can't be parsed by GraphId::GetTileId()
+      // If we end up with *no* recognizable tile files in the tarball at all,
+      // checks lower down will warn on that.
+    }
+  }
+  std::sort(scanned_.begin(), scanned_.end(),
+            [](const tile_index_entry_t& a, const tile_index_entry_t& b) {
+              return a.tile_id < b.tile_id;
+            });
+  begin_ = scanned_.data();
+  end_ = begin_ + scanned_.size();
+}
+
 GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& pt) {
   // if you really meant to load it
   if (pt.get_optional<std::string>("tile_extract")) {
     try {
-      // load the tar
-      archive.reset(new midgard::tar(pt.get<std::string>("tile_extract")));
-      // map files to graph ids
-      for (auto& c : archive->contents) {
-        try {
-          auto id = GraphTile::GetTileId(c.first);
-          tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
-        } catch (...) {
-          // It's possible to put non-tile files inside the tarfile.  As we're only
-          // parsing the file *name* as a GraphId here, we will just silently skip
-          // any file paths that can't be parsed by GraphId::GetTileId()
-          // If we end up with *no* recognizable tile files in the tarball at all,
-          // checks lower down will warn on that.
-        }
-      }
+      // load the tar and map files to graph ids
+      tiles.load(pt.get<std::string>("tile_extract"), archive);
       // couldn't load it
       if (tiles.empty()) {
         LOG_WARN("Tile extract contained no usuable tiles");
@@ -72,21 +122,8 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
 
   if (pt.get_optional<std::string>("traffic_extract")) {
     try {
-      // load the tar
-      traffic_archive.reset(new midgard::tar(pt.get<std::string>("traffic_extract")));
-      // map files to graph ids
-      for (auto& c : traffic_archive->contents) {
-        try {
-          auto id = GraphTile::GetTileId(c.first);
-          traffic_tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
-        } catch (...) {
-          // It's possible to put non-tile files inside the tarfile.  As we're only
-          // parsing the file *name* as a GraphId here, we will just silently skip
-          // any file paths that can't be parsed by GraphId::GetTileId()
-          // If we end up with *no* recognizable tile files in the tarball at all,
-          // checks lower down will warn on that.
-        }
-      }
+      // load the tar and map files to graph ids
+      traffic_tiles.load(pt.get<std::string>("traffic_extract"), traffic_archive);
       // couldn't load it
       if (traffic_tiles.empty()) {
         LOG_WARN("Traffic tile extract contained no usuable tiles");
@@ -106,11 +143,108 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
   }
 }
 
+namespace {
+// Bumped every time the tile extract is reloaded so readers can cheaply tell they are out of date
+std::atomic<uint64_t> extract_generation{0};
+// The newest generation that a cache shared by all readers was cleared for
+std::atomic<uint64_t> shared_cache_generation{0};
+} // namespace
+
+struct GraphReader::extract_generations_t {
+  std::mutex mutex;
+  // The current and the previous generation are held here so that requests started on the
+  // previous one can finish on it, older ones stay mapped only while a reader or tile uses them
+  std::shared_ptr<const tile_extract_t> current;
+  std::shared_ptr<const tile_extract_t> previous;
+  std::map<uint64_t, std::weak_ptr<const tile_extract_t>> mapped;
+};
+
+GraphReader::extract_generations_t& GraphReader::extract_generations() {
+  static extract_generations_t generations;
+  return generations;
+}
+
 std::shared_ptr<const GraphReader::tile_extract_t>
-GraphReader::get_extract_instance(const boost::property_tree::ptree& pt) {
-  static std::shared_ptr<const GraphReader::tile_extract_t> tile_extract(
-      new GraphReader::tile_extract_t(pt));
-  return tile_extract;
+GraphReader::get_extract_instance(const boost::property_tree::ptree& pt,
+                                  uint64_t& generation,
+                                  std::shared_ptr<const tile_extract_t> replacement) {
+  auto& generations = extract_generations();
+  std::lock_guard<std::mutex> lock(generations.mutex);
+  if (replacement) {
+    generations.previous = std::move(generations.current);
+    generations.current = std::move(replacement);
+    generations.mapped[++extract_generation] = generations.current;
+    // forget the generations that were unmapped
+    for (auto itr = generations.mapped.begin(); itr != generations.mapped.end();) {
+      itr = itr->second.expired() ? generations.mapped.erase(itr) : std::next(itr);
+    }
+  } else if (!generations.current) {
+    generations.current.reset(new GraphReader::tile_extract_t(pt));
+    generations.mapped[extract_generation] = generations.current;
+  }
+  generation = extract_generation;
+  return generations.current;
+}
+
+std::shared_ptr<const GraphReader::tile_extract_t>
+GraphReader::get_extract_generation(uint64_t generation) {
+  auto& generations = extract_generations();
+  std::lock_guard<std::mutex> lock(generations.mutex);
+  auto found = generations.mapped.find(generation);
+  return found == generations.mapped.cend() ? nullptr : found->second.lock();
+}
+
+bool GraphReader::ReloadTileExtract(const boost::property_tree::ptree& pt) {
+  // map the new one before taking the lock so readers are not held up while it loads
+  std::shared_ptr<const tile_extract_t> extract(new tile_extract_t(pt));
+  if (extract->tiles.empty() && pt.get_optional<std::string>("tile_extract")) {
+    LOG_WARN("Keeping the current tile extract as the new one could not be used");
+    return false;
+  }
+  uint64_t generation;
+  get_extract_instance(pt, generation, std::move(extract));
+  LOG_INFO("Tile extract generation " + std::to_string(generation) + " is now available");
+  return true;
+}
+
+bool GraphReader::UpdateTileExtract() {
+  if (extract_generation == tile_extract_generation_) {
+    return false;
+  }
+  uint64_t generation;
+  auto extract = get_extract_instance({}, generation);
+  SwitchTileExtract(std::move(extract), generation);
+  return true;
+}
+
+bool GraphReader::UseTileExtract(uint64_t generation) {
+  if (generation == tile_extract_generation_) {
+    return true;
+  }
+  auto extract = get_extract_generation(generation);
+  if (!extract) {
+    return false;
+  }
+  SwitchTileExtract(std::move(extract), generation);
+  return true;
+}
+
+void GraphReader::SwitchTileExtract(std::shared_ptr<const tile_extract_t> extract,
+                                    uint64_t generation) {
+  tile_extract_ = std::move(extract);
+  tile_extract_generation_ = generation;
+  // the tiles we have cached hold on to the old extract so we let go of those too
+  if (!shared_cache_) {
+    cache_->Clear();
+    return;
+  }
+  auto cleared = shared_cache_generation.load();
+  while (generation > cleared) {
+    if (shared_cache_generation.compare_exchange_weak(cleared, generation)) {
+      cache_->Clear();
+      return;
+    }
+  }
 }
 
 // ----------------------------------------------------------------------------
@@ -171,6 +305,7 @@ graph_tile_ptr FlatTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, s
 }
 
 void FlatTileCache::Trim() {
+  count_evictions(cache_.size());
   Clear();
 }
 
@@ -219,6 +354,7 @@ graph_tile_ptr SimpleTileCache::Put(const GraphId& graphid, graph_tile_ptr tile,
 }
 
 void SimpleTileCache::Trim() {
+  count_evictions(cache_.size());
   Clear();
 }
 
@@ -270,6 +406,7 @@ graph_tile_ptr TileCacheLRU::Get(const GraphId& graphid) const {
 
 size_t TileCacheLRU::TrimToFit(const size_t required_size) {
   size_t freed_space = 0;
+  uint64_t evicted = 0;
   while ((OverCommitted() || (max_cache_size_ - cache_size_) < required_size) &&
          !key_val_lru_list_.empty()) {
     const KeyValue& entry_to_evict = key_val_lru_list_.back();
@@ -278,7 +415,9 @@ size_t TileCacheLRU::TrimToFit(const size_t required_size) {
     freed_space += tile_size;
     cache_.erase(entry_to_evict.id);
     key_val_lru_list_.pop_back();
+    ++evicted;
   }
+  count_evictions(evicted);
   return freed_space;
 }
 
@@ -377,6 +516,115 @@ graph_tile_ptr SynchronizedTileCache::Put(const GraphId& graphid, graph_tile_ptr
   return cache_.Put(graphid, std::move(tile), size);
 }
 
+// ----------------------------------------------------------------------------
+// ConcurrentTileCache implementation
+// ----------------------------------------------------------------------------
+
+constexpr size_t ConcurrentTileCache::kShardCount;
+
+// Constructor.
+ConcurrentTileCache::ConcurrentTileCache(size_t max_size) : state_(new State(max_size)) {
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void ConcurrentTileCache::Reserve(size_t tile_size) {
+  for (auto& shard : state_->shards) {
+    std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+    shard.tiles.reserve(state_->max_cache_size / tile_size / kShardCount + 1);
+  }
+}
+
+// Checks if tile exists in the cache.
+bool ConcurrentTileCache::Contains(const GraphId& graphid) const {
+  const auto& shard = GetShard(graphid);
+  std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+  return shard.tiles.find(graphid) != shard.tiles.cend();
+}
+
+// Lets you know if the cache is too large.
+bool ConcurrentTileCache::OverCommitted() const {
+  return state_->cache_size > state_->max_cache_size;
+}
+
+// Clears the cache.
+void ConcurrentTileCache::Clear() {
+  for (auto& shard : state_->shards) {
+    std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+    for (const auto& entry : shard.tiles) {
+      state_->cache_size -= entry.second.size;
+    }
+    shard.tiles.clear();
+  }
+}
+
+void ConcurrentTileCache::Trim() {
+  std::lock_guard<std::mutex> lock(state_->eviction_mutex);
+  Evict();
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+graph_tile_ptr ConcurrentTileCache::Get(const GraphId& graphid) const {
+  const auto& shard = GetShard(graphid);
+  std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+  auto cached = shard.tiles.find(graphid);
+  if (cached == shard.tiles.cend()) {
+    return nullptr;
+  }
+  cached->second.used.store(true, std::memory_order_relaxed);
+  return cached->second.tile;
+}
+
+// Puts a copy of a tile of into the cache.
+graph_tile_ptr ConcurrentTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
+  graph_tile_ptr cached;
+  {
+    auto& shard = GetShard(graphid);
+    std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+    auto inserted = shard.tiles.emplace(std::piecewise_construct, std::forward_as_tuple(graphid),
+                                        std::forward_as_tuple(std::move(tile), size));
+    if (inserted.second) {
+      state_->cache_size += size;
+    }
+    cached = inserted.first->second.tile;
+  }
+
+  // Keep within the limit, if another thread is already sweeping it will take care of it
+  if (OverCommitted()) {
+    std::unique_lock<std::mutex> lock(state_->eviction_mutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+      Evict();
+    }
+  }
+  return cached;
+}
+
+// Get the shard holding the given tile.
+ConcurrentTileCache::Shard& ConcurrentTileCache::GetShard(const GraphId& graphid) const {
+  // neighbouring tiles are used together so spread them over the shards
+  return state_->shards[(graphid.tileid() * 31 + graphid.level()) % kShardCount];
+}
+
+// Sweep the shards evicting tiles that were not used since the last sweep.
+void ConcurrentTileCache::Evict() {
+  // after two full rotations every tile has lost its second chance
+  uint64_t evicted = 0;
+  for (size_t i = 0; i < kShardCount * 2 && OverCommitted(); ++i) {
+    auto& shard = state_->shards[state_->hand];
+    state_->hand = (state_->hand + 1) % kShardCount;
+    std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+    for (auto entry = shard.tiles.begin(); entry != shard.tiles.end() && OverCommitted();) {
+      if (entry->second.used.exchange(false, std::memory_order_relaxed)) {
+        ++entry;
+      } else {
+        state_->cache_size -= entry->second.size;
+        entry = shard.tiles.erase(entry);
+        ++evicted;
+      }
+    }
+  }
+  count_evictions(evicted);
+}
+
 // Constructs tile cache.
 TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree& pt) {
   size_t max_cache_size = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE);
@@ -407,6 +655,21 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
     return new SynchronizedTileCache(*globalTileCache_, globalCacheMutex_);
   }
 
+  // or share one cache among all readers without serializing access to it
+  if (pt.get<bool>("global_concurrent_cache", false)) {
+    static std::unique_ptr<ConcurrentTileCache> globalConcurrentCache_;
+    static std::mutex factoryMutex;
+    std::lock_guard<std::mutex> lock(factoryMutex);
+    if (!globalConcurrentCache_) {
+#ifndef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+      LOG_WARN("global_concurrent_cache shares tiles between threads and should be used with "
+               "ENABLE_THREAD_SAFE_TILE_REF_COUNT");
+#endif
+      globalConcurrentCache_.reset(new ConcurrentTileCache(max_cache_size));
+    }
+    return new ConcurrentTileCache(*globalConcurrentCache_);
+  }
+
   // or do you want to use an LRU cache
   if (use_lru_cache) {
     return new TileCacheLRU(max_cache_size, lru_mem_control);
@@ -424,16 +687,21 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
 // Constructor using separate tile files
 GraphReader::GraphReader(const boost::property_tree::ptree& pt,
                          std::unique_ptr<tile_getter_t>&& tile_getter)
-    : tile_extract_(get_extract_instance(pt)), tile_dir_(pt.get<std::string>("tile_dir", "")),
+    : tile_extract_(get_extract_instance(pt, tile_extract_generation_)),
+      tile_dir_(pt.get<std::string>("tile_dir", "")),
       tile_getter_(std::move(tile_getter)),
       max_concurrent_users_(pt.get<size_t>("max_concurrent_reader_users", 1)),
-      tile_url_(pt.get<std::string>("tile_url", "")), cache_(TileCacheFactory::createTileCache(pt)) {
+      tile_url_(pt.get<std::string>("tile_url", "")), cache_(TileCacheFactory::createTileCache(pt)),
+      shared_cache_(pt.get<bool>("global_synchronized_cache", false) ||
+                    pt.get<bool>("global_concurrent_cache", false)) {
 
   // Make a tile fetcher if we havent passed one in from somewhere else
   if (!tile_getter_ && !tile_url_.empty()) {
-    tile_getter_ = std::make_unique<curl_tile_getter_t>(max_concurrent_users_,
-                                                        pt.get<std::string>("user_agent", ""),
-                                                        pt.get<bool>("tile_url_gz", false));
+    tile_getter_ =
+        std::make_unique<curl_tile_getter_t>(max_concurrent_users_,
+                                             pt.get<std::string>("user_agent", ""),
+                                             pt.get<bool>("tile_url_gz", false),
+                                             pt.get<size_t>("tile_url_prefetch_concurrency", 4));
   }
 
   // validate tile url
@@ -461,6 +729,11 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
   }
 }
 
+GraphReader::~GraphReader() {
+  // Stop the background downloads while the prefetch state they call back into is still around
+  tile_getter_.reset();
+}
+
 // Method to test if tile exists
 bool GraphReader::DoesTileExist(const GraphId& graphid) const {
   if (!graphid.Is_Valid() || graphid.level() > TileHierarchy::get_max_level()) {
@@ -468,7 +741,7 @@ bool GraphReader::DoesTileExist(const GraphId& graphid) const {
   }
   // if you are using an extract only check that
   if (!tile_extract_->tiles.empty()) {
-    return tile_extract_->tiles.find(graphid) != tile_extract_->tiles.cend();
+    return tile_extract_->tiles.find(graphid) != nullptr;
   }
   // otherwise check memory or disk
   if (cache_->Contains(graphid)) {
@@ -507,26 +780,37 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
 
   // Check if the level/tileid combination is in the cache
   auto base = graphid.Tile_Base();
-  if (const auto& cached = cache_->Get(base)) {
+  static thread_local auto& hits = metrics::counter("valhalla_tile_cache_hits_total");
+  static thread_local auto& misses = metrics::counter("valhalla_tile_cache_misses_total");
+  // a cache shared with readers still on an older extract may hand back tiles from it
+  auto cached = cache_->Get(base);
+  if (cached && (tile_extract_->tiles.empty() || tile_extract_->contains(*cached))) {
     // LOG_DEBUG("Memory cache hit " + GraphTile::FileSuffix(base));
+    hits.add();
     return cached;
   }
+  misses.add();
 
   // Try getting it from the memmapped tar extract
   if (!tile_extract_->tiles.empty()) {
     // Do we have this tile
     auto t = tile_extract_->tiles.find(base);
-    if (t == tile_extract_->tiles.cend()) {
+    if (t == nullptr) {
       // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
       return nullptr;
     }
-    auto memory = std::make_unique<TarballGraphMemory>(tile_extract_->archive, t->second);
+    auto memory =
+        std::make_unique<TarballGraphMemory>(tile_extract_->archive,
+                                             tile_extract_t::data(*tile_extract_->archive, *t));
 
+    const auto& traffic_archive = tile_extract_->traffic_archive;
     auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
-    auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
-                              ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
-                                                                     traffic_ptr->second)
-                              : nullptr;
+    auto traffic_memory =
+        traffic_ptr != nullptr
+            ? std::make_unique<TarballGraphMemory>(traffic_archive,
+                                                   tile_extract_t::data(*traffic_archive,
+                                                                        *traffic_ptr))
+            : nullptr;
 
     // This initializes the tile from mmap
     auto tile = GraphTile::Create(base, std::move(memory), std::move(traffic_memory));
@@ -536,16 +820,20 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
     }
     // LOG_DEBUG("Memory map cache hit " + GraphTile::FileSuffix(base));
 
-    // Keep a copy in the cache and return it
+    // Keep a copy in the cache and return it, unless the cache kept one from an older extract
     const size_t size = AVERAGE_MM_TILE_SIZE; // tile.end_offset();  // TODO what size??
-    return cache_->Put(base, std::move(tile), size);
+    auto put = cache_->Put(base, tile, size);
+    return tile_extract_->contains(*put) ? put : tile;
   } // Try getting it from flat file
   else {
+    const auto& traffic_archive = tile_extract_->traffic_archive;
     auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
-    auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
-                              ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
-                                                                     traffic_ptr->second)
-                              : nullptr;
+    auto traffic_memory =
+        traffic_ptr != nullptr
+            ? std::make_unique<TarballGraphMemory>(traffic_archive,
+                                                   tile_extract_t::data(*traffic_archive,
+                                                                        *traffic_ptr))
+            : nullptr;
 
     // Try to get it from disk and if we cant..
     graph_tile_ptr tile = GraphTile::Create(tile_dir_, base, std::move(traffic_memory));
@@ -554,7 +842,35 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
         return nullptr;
       }
 
+      // If its already on its way wait for it and take it once its here. The wait can be
+      // interrupted and if the download takes too long we get the tile ourselves below
+      graph_tile_ptr prefetched;
       {
+        std::unique_lock<std::mutex> lock(prefetch_lock_);
+        const auto arrived = [this, &base]() {
+          return prefetching_.find(base) == prefetching_.end();
+        };
+        const auto give_up = std::chrono::steady_clock::now() + PREFETCH_WAIT_TIMEOUT;
+        while (!prefetch_cond_.wait_for(lock, PREFETCH_WAIT_INTERVAL, arrived)) {
+          if (std::chrono::steady_clock::now() >= give_up) {
+            LOG_WARN("Gave up waiting for the prefetch of " + GraphTile::FileSuffix(base));
+            break;
+          }
+          // dont hold up the background thread while checking, the check throws if interrupted
+          if (interrupt_) {
+            lock.unlock();
+            (*interrupt_)();
+            lock.lock();
+          }
+        }
+        auto found = prefetched_.find(base);
+        if (found != prefetched_.end()) {
+          prefetched = std::move(found->second);
+          prefetched_.erase(found);
+        }
+      }
+
+      if (!prefetched) {
         std::lock_guard<std::mutex> lock(_404s_lock);
         if (_404s.find(base) != _404s.end()) {
           // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
@@ -562,8 +878,9 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
         }
       }
 
-      // Get it from the url and cache it to disk if you can
-      tile = GraphTile::CacheTileURL(tile_url_, base, tile_getter_.get(), tile_dir_);
+      // Otherwise get it from the url and cache it to disk if you can
+      tile = prefetched ? std::move(prefetched)
+                        : GraphTile::CacheTileURL(tile_url_, base, tile_getter_.get(), tile_dir_);
       if (!tile) {
         std::lock_guard<std::mutex> lock(_404s_lock);
         _404s.insert(base);
@@ -581,6 +898,105 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
   }
 }
 
+void GraphReader::FinishPrefetch(const GraphId& base,
+                                 const bool gzipped,
+                                 tile_getter_t::response_t&& response) {
+  // A failed download is not a missing tile, whoever asks for it will download it again and find
+  // out. Nothing may throw on the background thread
+  graph_tile_ptr tile;
+  if (response.status_ == tile_getter_t::status_code_t::SUCCESS) {
+    try {
+      tile = GraphTile::CacheTileBytes(base, std::move(response.bytes_), gzipped, tile_dir_);
+    } catch (const std::exception& e) {
+      LOG_WARN("Failed to prefetch " + GraphTile::FileSuffix(base) + ": " + e.what());
+    }
+  }
+
+  // The cache belongs to the thread using this reader so the tile waits here to be taken
+  std::lock_guard<std::mutex> lock(prefetch_lock_);
+  prefetching_.erase(base);
+  if (tile && tile->header()) {
+    prefetched_.emplace(base, std::move(tile));
+  }
+  prefetch_cond_.notify_all();
+}
+
+void GraphReader::PrefetchTiles(const std::vector<midgard::PointLL>& locations,
+                                const bool corridor) {
+  // Prefetching only helps if the tiles come from far away
+  if (!tile_getter_ || !tile_extract_->tiles.empty() || locations.empty()) {
+    return;
+  }
+
+  // Any margin around a location will do as long as it catches the neighbouring tiles of locations
+  // close to the edge of their tiles
+  constexpr float kPrefetchMargin = 5000.f;
+  // Never have more than this many tiles on their way
+  constexpr size_t kMaxPrefetchedTiles = 512;
+
+  // Find the tiles on every level around and between the locations
+  std::vector<GraphId> tile_ids;
+  for (const auto& level : TileHierarchy::levels()) {
+    std::unordered_set<int32_t> level_tiles;
+    for (const auto& location : locations) {
+      auto box = midgard::ExpandMeters(location, kPrefetchMargin);
+      for (const auto& tile : level.tiles.Intersect(box)) {
+        level_tiles.insert(tile.first);
+      }
+    }
+    if (corridor && locations.size() > 1) {
+      for (const auto& tile : level.tiles.Intersect(locations)) {
+        level_tiles.insert(tile.first);
+      }
+    }
+    for (auto tile : level_tiles) {
+      tile_ids.emplace_back(tile, level.level, 0);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(prefetch_lock_);
+
+  // Cache whatever arrived since last time so that tiles nobody asked for dont pile up
+  for (auto& prefetched : prefetched_) {
+    const size_t size = prefetched.second->header()->end_offset();
+    cache_->Put(prefetched.first, std::move(prefetched.second), size);
+  }
+  prefetched_.clear();
+
+  // Start downloading the ones we dont have yet
+  const bool gzipped = tile_getter_->gzipped();
+  for (const auto& base : tile_ids) {
+    if (prefetching_.size() >= kMaxPrefetchedTiles) {
+      break;
+    }
+    if (prefetching_.find(base) != prefetching_.end() || cache_->Contains(base)) {
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      if (_404s.find(base) != _404s.end()) {
+        continue;
+      }
+    }
+    auto file_location = tile_dir_ + filesystem::path::preferred_separator +
+                         GraphTile::FileSuffix(base);
+    if (!tile_dir_.empty() &&
+        (filesystem::exists(file_location) || filesystem::exists(file_location + ".gz"))) {
+      continue;
+    }
+    // Stop once the getter can not take any more in the background, anything it would only
+    // download once asked for is no better than not prefetching at all
+    prefetching_.insert(base);
+    if (!tile_getter_->get_async(GraphTile::MakeTileURL(tile_url_, base),
+                                 [this, base, gzipped](tile_getter_t::response_t&& response) {
+                                   FinishPrefetch(base, gzipped, std::move(response));
+                                 })) {
+      prefetching_.erase(base);
+      break;
+    }
+  }
+}
+
 // Convenience method to get an opposing directed edge graph Id.
 GraphId GraphReader::GetOpposingEdgeId(const GraphId& edgeid, graph_tile_ptr& opp_tile) {
   // If you cant get the tile you get an invalid id
@@ -814,7 +1230,7 @@ std::unordered_set<GraphId> GraphReader::GetTileSet() const {
   std::unordered_set<GraphId> tiles;
   if (tile_extract_->tiles.size()) {
     for (const auto& t : tile_extract_->tiles) {
-      tiles.emplace(t.first);
+      tiles.emplace(t.tile_id);
     }
   } // or individually on disk
   else if (!tile_dir_.empty()) {
@@ -847,8 +1263,8 @@ std::unordered_set<GraphId> GraphReader::GetTileSet(const uint8_t level) const {
   std::unordered_set<GraphId> tiles;
   if (tile_extract_->tiles.size()) {
     for (const auto& t : tile_extract_->tiles) {
-      if (static_cast<GraphId>(t.first).level() == level) {
-        tiles.emplace(t.first);
+      if (GraphId(t.tile_id).level() == level) {
+        tiles.emplace(t.tile_id);
       }
     } // or individually on disk
   } else if (!tile_dir_.empty()) {
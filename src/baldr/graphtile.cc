@@ -219,22 +219,32 @@ graph_tile_ptr GraphTile::CacheTileURL(const std::string& tile_url,
   if (result.status_ != tile_getter_t::status_code_t::SUCCESS) {
     return nullptr;
   }
+  return CacheTileBytes(graphid, std::move(result.bytes_), tile_getter->gzipped(), cache_location);
+}
+
+graph_tile_ptr GraphTile::CacheTileBytes(const GraphId& graphid,
+                                         std::vector<char>&& tile_data,
+                                         bool gzipped,
+                                         const std::string& cache_location) {
   // try to cache it on disk so we dont have to keep fetching it from url
   if (!cache_location.empty()) {
-    auto suffix = FileSuffix(graphid.Tile_Base(),
-                             (tile_getter->gzipped() ? valhalla::baldr::SUFFIX_COMPRESSED
-                                                     : valhalla::baldr::SUFFIX_NON_COMPRESSED));
+    auto suffix = FileSuffix(graphid.Tile_Base(), gzipped ? valhalla::baldr::SUFFIX_COMPRESSED
+                                                          : valhalla::baldr::SUFFIX_NON_COMPRESSED);
     auto disk_location = cache_location + filesystem::path::preferred_separator + suffix;
-    SaveTileToFile(result.bytes_, disk_location);
+    SaveTileToFile(tile_data, disk_location);
   }
 
   // turn the memory into a tile
-  if (tile_getter->gzipped()) {
-    return DecompressTile(graphid, result.bytes_);
+  if (gzipped) {
+    return DecompressTile(graphid, tile_data);
   }
 
   return graph_tile_ptr{
-      new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(result.bytes_)))};
+      new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(tile_data)))};
+}
+
+std::string GraphTile::MakeTileURL(const std::string& tile_url, const GraphId& graphid) {
+  return MakeSingleTileUrl(tile_url, graphid);
 }
 
 GraphTile::~GraphTile() = default;
@@ -349,6 +359,7 @@ void GraphTile::Initialize(const GraphId& graphid) {
     char* ptr2 = ptr1 + (header_->directededgecount() * sizeof(int32_t));
     predictedspeeds_.set_offset(reinterpret_cast<uint32_t*>(ptr1));
     predictedspeeds_.set_profiles(reinterpret_cast<int16_t*>(ptr2));
+    predictedspeeds_.set_cache_size(header_->directededgecount());
 
     lane_connectivity_size_ = header_->predictedspeeds_offset() - header_->lane_connectivity_offset();
   } else {
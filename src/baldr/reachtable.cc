@@ -0,0 +1,92 @@
+#include "baldr/reachtable.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Identifies the file and the layout of its contents
+constexpr char kReachMagic[8] = {'V', 'A', 'L', 'H', 'R', 'C', '0', '1'};
+
+struct ReachHeader {
+  char magic[8];
+  uint32_t max_reach;
+  uint32_t tile_count;
+  uint64_t reach_count;
+};
+
+std::string file_name(const std::string& tile_dir, const std::string& costing) {
+  return tile_dir + filesystem::path::preferred_separator + "reach_" + costing + ".bin";
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+std::shared_ptr<const ReachTable> ReachTable::Load(const std::string& tile_dir,
+                                                   const std::string& costing) {
+  auto name = file_name(tile_dir, costing);
+  std::ifstream file(name, std::ios::binary);
+  if (!file.is_open()) {
+    return nullptr;
+  }
+
+  ReachHeader header;
+  if (!read_header(file, header, kReachMagic)) {
+    LOG_WARN("Ignoring reach table with unknown format: " + name);
+    return nullptr;
+  }
+
+  std::shared_ptr<ReachTable> table(new ReachTable());
+  table->max_reach_ = header.max_reach;
+  table->tiles_.read(file, header.tile_count, static_cast<uint32_t>(header.reach_count));
+  read_records(file, table->reaches_, header.reach_count);
+  if (!file) {
+    LOG_WARN("Ignoring truncated reach table: " + name);
+    return nullptr;
+  }
+
+  LOG_INFO("Loaded " + costing + " reach of " + std::to_string(header.reach_count) +
+           " edges up to " + std::to_string(header.max_reach));
+  return table;
+}
+
+void ReachTable::Write(const std::string& tile_dir,
+                       const std::string& costing,
+                       const uint32_t max_reach,
+                       const std::vector<std::pair<GraphId, uint32_t>>& tiles,
+                       const std::vector<EdgeReach>& reaches) {
+  if (max_reach > kMaxStoredReach) {
+    throw std::logic_error("Reach tables can not hold a reach of more than " +
+                           std::to_string(kMaxStoredReach));
+  }
+  TileOffsets offsets(tiles);
+  if (reaches.size() != offsets.record_count()) {
+    throw std::logic_error("Reaches do not match the number of edges");
+  }
+
+  ReachHeader header;
+  header.max_reach = max_reach;
+  header.tile_count = offsets.tile_count();
+  header.reach_count = offsets.record_count();
+
+  auto name = file_name(tile_dir, costing);
+  std::ofstream file(name, std::ios::binary | std::ios::trunc);
+  write_header(file, header, kReachMagic);
+  offsets.write(file);
+  write_records(file, reaches);
+  if (!file) {
+    throw std::runtime_error("Failed to write reach table: " + name);
+  }
+}
+
+const EdgeReach* ReachTable::reach(const GraphId& edgeid) const {
+  auto record = tiles_.record(edgeid);
+  return record == kInvalidRecord ? nullptr : &reaches_[record];
+}
+
+} // namespace baldr
+} // namespace valhalla
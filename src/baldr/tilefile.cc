@@ -0,0 +1,54 @@
+#include "baldr/tilefile.h"
+
+#include <algorithm>
+
+namespace valhalla {
+namespace baldr {
+
+TileOffsets::TileOffsets(const std::vector<std::pair<GraphId, uint32_t>>& tiles) {
+  offsets_.reserve(tiles.size());
+  for (const auto& tile : tiles) {
+    offsets_.emplace_back(tile.first.tile_value(), record_count_);
+    record_count_ += tile.second;
+  }
+}
+
+uint32_t TileOffsets::record(const GraphId& id) const {
+  auto tile = id.tile_value();
+  auto found = std::lower_bound(offsets_.begin(), offsets_.end(), tile,
+                                [](const std::pair<uint32_t, uint32_t>& t, const uint32_t value) {
+                                  return t.first < value;
+                                });
+  if (found == offsets_.end() || found->first != tile) {
+    return kInvalidRecord;
+  }
+  // make sure the id is within the records of its tile
+  auto record = found->second + static_cast<uint32_t>(id.id());
+  auto next = found + 1 == offsets_.end() ? record_count_ : (found + 1)->second;
+  return record < next ? record : kInvalidRecord;
+}
+
+GraphId TileOffsets::graphid(const uint32_t record) const {
+  auto found = std::upper_bound(offsets_.begin(), offsets_.end(), record,
+                                [](const uint32_t value, const std::pair<uint32_t, uint32_t>& t) {
+                                  return value < t.second;
+                                }) -
+               1;
+  GraphId id(found->first);
+  id.set_id(record - found->second);
+  return id;
+}
+
+void TileOffsets::read(std::ifstream& file,
+                       const uint32_t tile_count,
+                       const uint32_t record_count) {
+  read_records(file, offsets_, tile_count);
+  record_count_ = record_count;
+}
+
+void TileOffsets::write(std::ofstream& file) const {
+  write_records(file, offsets_);
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -1,4 +1,5 @@
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 #include "baldr/rapidjson_utils.h"
 #include <boost/make_shared.hpp>
@@ -6,13 +7,23 @@
 #include <boost/optional.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "baldr/rapidjson_utils.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
 #include "tyr/actor.h"
+#include "worker.h"
 
 namespace {
 
@@ -57,71 +68,163 @@ namespace py = pybind11;
 
 struct simplified_actor_t : public valhalla::tyr::actor_t {
   simplified_actor_t(const boost::property_tree::ptree& config)
-      : valhalla::tyr::actor_t::actor_t(config, true) {
+      : valhalla::tyr::actor_t::actor_t(config, true), config_(config) {
   }
 
   std::string route(const std::string& request_str) {
-    return valhalla::tyr::actor_t::route(request_str, nullptr, nullptr);
+    return act(&valhalla::tyr::actor_t::route, request_str);
   };
   std::string locate(const std::string& request_str) {
-    return valhalla::tyr::actor_t::locate(request_str, nullptr, nullptr);
+    return act(&valhalla::tyr::actor_t::locate, request_str);
   };
   std::string optimized_route(const std::string& request_str) {
-    return valhalla::tyr::actor_t::optimized_route(request_str, nullptr, nullptr);
+    return act(&valhalla::tyr::actor_t::optimized_route, request_str);
   };
   std::string matrix(const std::string& request_str) {
-    return valhalla::tyr::actor_t::matrix(request_str, nullptr, nullptr);
+    return act(&valhalla::tyr::actor_t::matrix, request_str);
   };
   std::string isochrone(const std::string& request_str) {
-    return valhalla::tyr::actor_t::isochrone(request_str, nullptr, nullptr);
+    return act(&valhalla::tyr::actor_t::isochrone, request_str);
   };
   std::string trace_route(const std::string& request_str) {
-    return valhalla::tyr::actor_t::trace_route(request_str, nullptr, nullptr);
+    return act(&valhalla::tyr::actor_t::trace_route, request_str);
   };
   std::string trace_attributes(const std::string& request_str) {
-    return valhalla::tyr::actor_t::trace_attributes(request_str, nullptr, nullptr);
+    return act(&valhalla::tyr::actor_t::trace_attributes, request_str);
   };
   std::string height(const std::string& request_str) {
-    return valhalla::tyr::actor_t::height(request_str, nullptr, nullptr);
+    return act(&valhalla::tyr::actor_t::height, request_str);
   };
   std::string transit_available(const std::string& request_str) {
-    return valhalla::tyr::actor_t::transit_available(request_str, nullptr, nullptr);
+    return act(&valhalla::tyr::actor_t::transit_available, request_str);
   };
   std::string expansion(const std::string& request_str) {
-    return valhalla::tyr::actor_t::expansion(request_str, nullptr, nullptr);
+    return act(&valhalla::tyr::actor_t::expansion, request_str);
   };
   std::string centroid(const std::string& request_str) {
-    return valhalla::tyr::actor_t::centroid(request_str, nullptr, nullptr);
+    return act(&valhalla::tyr::actor_t::centroid, request_str);
   };
+
+  /**
+   * Answers a batch of requests of the same action on a pool of actors, one per thread. The pool is
+   * kept for the next batch. Each actor has its own tile cache unless the config shares one between
+   * readers, the tile extract is always shared.
+   * @param action    name of the action, ie the snake case name of the method to call
+   * @param requests  the json requests
+   * @param threads   how many requests to answer at once, 0 to use every core
+   * @return the json responses in the order of the requests, a failed request gets an error json
+   */
+  std::vector<std::string>
+  batch(const std::string& action, const std::vector<std::string>& requests, size_t threads) {
+    static const std::unordered_map<std::string, action_t> actions{
+        {"route", &valhalla::tyr::actor_t::route},
+        {"locate", &valhalla::tyr::actor_t::locate},
+        {"optimized_route", &valhalla::tyr::actor_t::optimized_route},
+        {"sources_to_targets", &valhalla::tyr::actor_t::matrix},
+        {"matrix", &valhalla::tyr::actor_t::matrix},
+        {"isochrone", &valhalla::tyr::actor_t::isochrone},
+        {"trace_route", &valhalla::tyr::actor_t::trace_route},
+        {"trace_attributes", &valhalla::tyr::actor_t::trace_attributes},
+        {"height", &valhalla::tyr::actor_t::height},
+        {"transit_available", &valhalla::tyr::actor_t::transit_available},
+        {"expansion", &valhalla::tyr::actor_t::expansion},
+        {"centroid", &valhalla::tyr::actor_t::centroid},
+    };
+    auto found = actions.find(action);
+    if (found == actions.cend()) {
+      throw std::invalid_argument("Unknown action: " + action);
+    }
+
+    // only one batch at a time gets the pool
+    std::lock_guard<std::mutex> lock(pool_lock_);
+    if (threads == 0) {
+      threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threads = std::min(threads, requests.size());
+    while (pool_.size() < threads) {
+      pool_.emplace_back(new valhalla::tyr::actor_t(config_, true));
+    }
+
+    // each thread takes the next request until there are none left
+    std::vector<std::string> responses(requests.size());
+    std::atomic<size_t> next(0);
+    auto answer = [&](valhalla::tyr::actor_t& actor) {
+      for (size_t i = next++; i < requests.size(); i = next++) {
+        valhalla::Api api;
+        try {
+          responses[i] = (actor.*found->second)(requests[i], nullptr, &api);
+        } catch (const valhalla::valhalla_exception_t& e) {
+          responses[i] = valhalla::jsonify_error(e, api);
+        } catch (const std::exception& e) {
+          responses[i] = valhalla::jsonify_error({599, std::string(e.what())}, api);
+        }
+      }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i) {
+      workers.emplace_back(answer, std::ref(*pool_[i]));
+    }
+    if (threads > 0) {
+      answer(*pool_.front());
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    return responses;
+  }
+
+protected:
+  using action_t = std::string (valhalla::tyr::actor_t::*)(const std::string&,
+                                                           const std::function<void()>*,
+                                                           valhalla::Api*);
+
+  // python threads sharing an actor take turns, python threads with their own actors dont have to
+  std::string act(action_t action, const std::string& request_str) {
+    std::lock_guard<std::mutex> lock(lock_);
+    return (this->*action)(request_str, nullptr, nullptr);
+  }
+
+  boost::property_tree::ptree config_;
+  std::mutex lock_;
+  std::mutex pool_lock_;
+  std::vector<std::unique_ptr<valhalla::tyr::actor_t>> pool_;
 };
 
 PYBIND11_MODULE(python_valhalla, m) {
   m.def("Configure", py_configure);
 
+  // none of the actions need the GIL so python threads with their own actors run in parallel
+  using release_gil = py::call_guard<py::gil_scoped_release>;
   py::class_<simplified_actor_t, std::shared_ptr<simplified_actor_t>>(m, "Actor")
       .def(py::init<>([]() { return std::make_shared<simplified_actor_t>(configure()); }))
-      .def("Route", &simplified_actor_t::route, "Calculates a route.")
-      .def("Locate", &simplified_actor_t::locate, "Provides information about nodes and edges.")
-      .def("OptimizedRoute", &simplified_actor_t::optimized_route,
+      .def("Route", &simplified_actor_t::route, release_gil(), "Calculates a route.")
+      .def("Locate", &simplified_actor_t::locate, release_gil(),
+           "Provides information about nodes and edges.")
+      .def("OptimizedRoute", &simplified_actor_t::optimized_route, release_gil(),
            "Optimizes the order of a set of waypoints by time.")
       .def(
-          "Matrix", &simplified_actor_t::matrix,
+          "Matrix", &simplified_actor_t::matrix, release_gil(),
           "Computes the time and distance between a set of locations and returns them as a matrix table.")
-      .def("Isochrone", &simplified_actor_t::isochrone, "Calculates isochrones and isodistances.")
-      .def("TraceRoute", &simplified_actor_t::trace_route,
+      .def("Isochrone", &simplified_actor_t::isochrone, release_gil(),
+           "Calculates isochrones and isodistances.")
+      .def("TraceRoute", &simplified_actor_t::trace_route, release_gil(),
            "Map-matching for a set of input locations, e.g. from a GPS.")
       .def(
-          "TraceAttributes", &simplified_actor_t::trace_attributes,
+          "TraceAttributes", &simplified_actor_t::trace_attributes, release_gil(),
           "Returns detailed attribution along each portion of a route calculated from a set of input locations, e.g. from a GPS trace.")
-      .def("Height", &simplified_actor_t::height,
+      .def("Height", &simplified_actor_t::height, release_gil(),
            "Provides elevation data for a set of input geometries.")
       .def(
-          "TransitAvailable", &simplified_actor_t::transit_available,
+          "TransitAvailable", &simplified_actor_t::transit_available, release_gil(),
           "Lookup if transit stops are available in a defined radius around a set of input locations.")
       .def(
-          "Expansion", &simplified_actor_t::expansion,
+          "Expansion", &simplified_actor_t::expansion, release_gil(),
           "Returns all road segments which were touched by the routing algorithm during the graph traversal.")
       .def(
-          "Centroid", &simplified_actor_t::centroid,
-          "Returns routes from all the input locations to the minimum cost meeting point of those paths.");
+          "Centroid", &simplified_actor_t::centroid, release_gil(),
+          "Returns routes from all the input locations to the minimum cost meeting point of those paths.")
+      .def(
+          "Batch", &simplified_actor_t::batch, release_gil(),
+          "Answers a list of json requests of one action, e.g. 'route', on a pool of actors and returns their json responses in order.",
+          py::arg("action"), py::arg("requests"), py::arg("threads") = 0);
 }
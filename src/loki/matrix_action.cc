@@ -116,7 +116,14 @@ void loki_worker_t::matrix(Api& request) {
   // correlate the various locations to the underlying graph
   std::unordered_map<size_t, size_t> color_counts;
   try {
-    const auto searched = loki::Search(sources_targets, *reader, costing);
+    const auto searched = loki::Search(sources_targets, *reader, costing, reach_table);
+    // get the tiles around the locations on their way before thor asks for them, every location
+    // is paired with every other so there is no single corridor between them
+    std::vector<midgard::PointLL> lls;
+    for (const auto& location : sources_targets) {
+      lls.push_back(location.latlng_);
+    }
+    reader->PrefetchTiles(lls, false);
     for (size_t i = 0; i < sources_targets.size(); ++i) {
       const auto& l = sources_targets[i];
       const auto& projection = searched.at(l);
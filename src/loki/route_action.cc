@@ -97,7 +97,13 @@ void loki_worker_t::route(Api& request) {
   std::unordered_map<size_t, size_t> color_counts;
   try {
     auto locations = PathLocation::fromPBF(options.locations(), true);
-    const auto projections = loki::Search(locations, *reader, costing);
+    const auto projections = loki::Search(locations, *reader, costing, reach_table);
+    // get the tiles thor will route over on their way before it asks for them
+    std::vector<midgard::PointLL> lls;
+    for (const auto& location : locations) {
+      lls.push_back(location.latlng_);
+    }
+    reader->PrefetchTiles(lls);
     for (size_t i = 0; i < locations.size(); ++i) {
       const auto& correlated = projections.at(locations[i]);
       PathLocation::toPBF(correlated, options.mutable_locations(i), *reader);
@@ -1,5 +1,6 @@
 #include "loki/search.h"
 #include "baldr/graphconstants.h"
+#include "baldr/reachtable.h"
 #include "baldr/tilehierarchy.h"
 #include "loki/reach.h"
 #include "midgard/distanceapproximator.h"
@@ -240,15 +241,27 @@ struct bin_handler_t {
   std::vector<candidate_t> bin_candidates;
   std::unordered_set<uint64_t> correlated_edges;
   Reach reach_finder;
+  // reach computed when the tiles were built, if there is any for this costing
+  const ReachTable* reach_table;
 
   // keep track of edges whose reachability we've already computed
   // TODO: dont use pointers as keys, its safe for now but fancy caching one day could be bad
   std::unordered_map<const DirectedEdge*, directed_reach> directed_reaches;
 
+  // nearby locations visit the same bins in different rounds of the search so we keep the decoded
+  // shape of every edge we have seen, keyed by its tile and edge info offset. the tile is kept so
+  // the edge info stays valid as long as we do
+  struct edge_shape_t {
+    graph_tile_ptr tile;
+    std::shared_ptr<const EdgeInfo> edge_info;
+  };
+  std::unordered_map<uint64_t, edge_shape_t> edge_shapes;
+
   bin_handler_t(const std::vector<valhalla::baldr::Location>& locations,
                 valhalla::baldr::GraphReader& reader,
-                const std::shared_ptr<DynamicCost>& costing)
-      : reader(reader), costing(costing) {
+                const std::shared_ptr<DynamicCost>& costing,
+                const ReachTable* reach_table)
+      : reader(reader), costing(costing), reach_table(reach_table) {
     // get the unique set of input locations and the max reachability of them all
     std::unordered_set<Location> uniq_locations(locations.begin(), locations.end());
     pps.reserve(uniq_locations.size());
@@ -261,6 +274,9 @@ struct bin_handler_t {
     // very annoying but it saves a lot of time to preallocate this instead of doing it in the loop
     // in handle_bins
     bin_candidates.resize(pps.size());
+    // the stored reach is no good if a location wants more than it was capped at
+    if (reach_table && max_reach_limit > reach_table->max_reach())
+      this->reach_table = nullptr;
     // TODO: make space for reach check in a more empirical way
     auto reservation = std::max(max_reach_limit, static_cast<decltype(max_reach_limit)>(1));
     directed_reaches.reserve(reservation * 1024);
@@ -422,14 +438,29 @@ struct bin_handler_t {
     }
   }
 
+  // look up the reach computed when the tiles were built
+  bool stored_reach(const GraphId edge_id, directed_reach& reach) const {
+    const EdgeReach* stored = reach_table ? reach_table->reach(edge_id) : nullptr;
+    if (!stored)
+      return false;
+    reach.outbound = std::min(static_cast<unsigned int>(stored->outbound), max_reach_limit);
+    reach.inbound = std::min(static_cast<unsigned int>(stored->inbound), max_reach_limit);
+    return true;
+  }
+
   directed_reach get_reach(const GraphId edge_id, const DirectedEdge* edge) {
     // if its in cache return it
     auto itr = directed_reaches.find(edge);
     if (itr != directed_reaches.cend())
       return itr->second;
 
+    // if it was computed ahead of time we dont need to search for it
+    directed_reach reach{};
+    if (stored_reach(edge_id, reach))
+      return reach;
+
     // notice we do both directions here because in the end we use this reach for all input locations
-    auto reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
+    reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
     directed_reaches[edge] = reach;
     return reach;
   }
@@ -449,6 +480,11 @@ struct bin_handler_t {
     if (found != directed_reaches.cend())
       return found->second;
 
+    // if it was computed ahead of time we dont need to search for it
+    directed_reach reach{};
+    if (stored_reach(edge_id, reach))
+      return reach;
+
     // we only want to waste time checking if this could become the best reachable option for a
     // given location
     bool check = false;
@@ -463,7 +499,7 @@ struct bin_handler_t {
       return {max_reach_limit, max_reach_limit};
 
     // notice we do both directions here because in the end we use this reach for all input locations
-    auto reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
+    reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
     directed_reaches[edge] = reach;
 
     // if the inbound reach is not 0 and the outbound reach is not 0 and the opposing edge is not
@@ -477,6 +513,20 @@ struct bin_handler_t {
     return reach;
   }
 
+  // get the edge info of an edge with its shape decoded, from the cache if we've seen it before
+  const std::shared_ptr<const EdgeInfo>& get_edge_info(const graph_tile_ptr& tile,
+                                                       const DirectedEdge* edge) {
+    auto key = (static_cast<uint64_t>(tile->id().tile_value()) << 32) | edge->edgeinfo_offset();
+    auto inserted = edge_shapes.emplace(key, edge_shape_t{});
+    auto& cached = inserted.first->second;
+    if (inserted.second) {
+      cached.tile = tile;
+      cached.edge_info = std::make_shared<const EdgeInfo>(tile->edgeinfo(edge));
+      cached.edge_info->shape();
+    }
+    return cached.edge_info;
+  }
+
   // handle a bin for the range of candidates that share it
   void handle_bin(std::vector<projector_wrapper>::iterator begin,
                   std::vector<projector_wrapper>::iterator end) {
@@ -526,33 +576,28 @@ struct bin_handler_t {
       // of the shape which are on the same side of h that p is. to make this fast we would need a
       // a trivial half plane test as maybe a single dot product and comparison?
 
-      // get some shape of the edge
-      auto edge_info = std::make_shared<const EdgeInfo>(tile->edgeinfo(edge));
-      auto shape = edge_info->lazy_shape();
-      PointLL v;
-      if (!shape.empty()) {
-        v = shape.pop();
-      }
+      // get the shape of the edge, decoding it only the first time any location sees it
+      const auto& edge_info = get_edge_info(tile, edge);
+      const auto& shape = edge_info->shape();
 
-      // iterate along this edges segments projecting each of the points
-      for (size_t i = 0; !shape.empty(); ++i) {
-        auto u = v;
-        v = shape.pop();
-        // for each input point
-        c_itr = bin_candidates.begin();
-        for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
-          // skip updating this candidate because it was prefiltered
-          if (c_itr->prefiltered) {
-            continue;
-          }
+      // for each input point iterate along this edges segments projecting the point onto each,
+      // keeping one point in registers while we stream through the contiguous shape
+      c_itr = bin_candidates.begin();
+      for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
+        // skip updating this candidate because it was prefiltered
+        if (c_itr->prefiltered) {
+          continue;
+        }
+        const auto& project = p_itr->project;
+        for (size_t i = 1; i < shape.size(); ++i) {
           // how close is the input to this segment
-          auto point = p_itr->project(u, v);
-          auto sq_distance = p_itr->project.approx.DistanceSquared(point);
+          auto point = project(shape[i - 1], shape[i]);
+          auto sq_distance = project.approx.DistanceSquared(point);
           // do we want to keep it
           if (sq_distance < c_itr->sq_distance) {
             c_itr->sq_distance = sq_distance;
-            c_itr->point = std::move(point);
-            c_itr->index = i;
+            c_itr->point = point;
+            c_itr->index = i - 1;
           }
         }
       }
@@ -644,32 +689,20 @@ struct bin_handler_t {
     }
   }
 
-  // Find the best range to do.  The given vector should be sorted for
-  // interesting grouping.  Returns the greatest range of non empty
-  // equal bins.
-  std::pair<std::vector<projector_wrapper>::iterator, std::vector<projector_wrapper>::iterator>
-  find_best_range(std::vector<projector_wrapper>& pps) const {
-    auto best = std::make_pair(pps.begin(), pps.begin());
-    auto cur = best;
-    while (cur.second != pps.end()) {
-      cur.first = cur.second;
-      cur.second = std::find_if_not(cur.first, pps.end(), [&cur](const projector_wrapper& pp) {
-        return cur.first->has_same_bin(pp);
-      });
-      if (cur.first->has_bin() && cur.second - cur.first > best.second - best.first) {
-        best = cur;
-      }
-    }
-    return best;
-  }
-
-  // we keep the points sorted at each round such that unfinished ones
-  // are at the front of the sorted list
+  // we keep the points sorted at each round such that unfinished ones are at the front of the
+  // sorted list and the ones in the same bin are next to each other. each round handles every bin
+  // that some points are in once for all of them, rather than just the biggest group and then
+  // sorting all over again, so large batches of locations take far fewer rounds and sorts
   void search() {
     std::sort(pps.begin(), pps.end());
     while (pps.front().has_bin()) {
-      auto range = find_best_range(pps);
-      handle_bin(range.first, range.second);
+      for (auto first = pps.begin(); first != pps.end() && first->has_bin();) {
+        auto last = std::find_if_not(first, pps.end(), [&first](const projector_wrapper& pp) {
+          return first->has_same_bin(pp);
+        });
+        handle_bin(first, last);
+        first = last;
+      }
       std::sort(pps.begin(), pps.end());
     }
   }
@@ -784,7 +817,8 @@ namespace loki {
 std::unordered_map<valhalla::baldr::Location, PathLocation>
 Search(const std::vector<valhalla::baldr::Location>& locations,
        GraphReader& reader,
-       const std::shared_ptr<DynamicCost>& costing) {
+       const std::shared_ptr<DynamicCost>& costing,
+       const ReachTable* reach_table) {
   // we cannot continue without costing
   if (!costing)
     throw std::runtime_error("No costing was provided for edge candidate search");
@@ -794,7 +828,7 @@ Search(const std::vector<valhalla::baldr::Location>& locations,
     return std::unordered_map<valhalla::baldr::Location, PathLocation>{};
 
   // setup the unique list of locations
-  bin_handler_t handler(locations, reader, costing);
+  bin_handler_t handler(locations, reader, costing, reach_table);
   // search over the bins doing multiple locations per bin
   handler.search();
   // turn each locations candidate set into path locations
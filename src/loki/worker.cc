@@ -9,7 +9,9 @@
 
 #include "baldr/json.h"
 #include "baldr/rapidjson_utils.h"
+#include "baldr/tilefile.h"
 #include "midgard/logging.h"
+#include "midgard/metrics.h"
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/motorcyclecost.h"
@@ -28,6 +30,19 @@ using namespace valhalla::baldr;
 using namespace valhalla::sif;
 using namespace valhalla::loki;
 
+namespace {
+
+// The costings mjolnir::ReachBuilder can compute the reach for
+const Costing kReachCostings[] = {Costing::auto_, Costing::bicycle, Costing::pedestrian};
+
+// The reach does not depend on the speeds the costing uses so we leave them out when comparing
+std::string reach_costing_options(CostingOptions options) {
+  options.clear_flow_mask();
+  return options.SerializeAsString();
+}
+
+} // namespace
+
 namespace valhalla {
 namespace loki {
 void loki_worker_t::parse_locations(google::protobuf::RepeatedPtrField<valhalla::Location>* locations,
@@ -84,6 +99,17 @@ void loki_worker_t::parse_costing(Api& api, bool allow_none) {
     }
   } catch (const std::runtime_error&) { throw valhalla_exception_t{125, "'" + costing_str + "'"}; }
 
+  // We can use the reach computed when the tiles were built if the costing is the one it was built
+  // for, the exclusions below are not part of the costing we search with so they do not matter
+  auto searched_costing =
+      options.costing() == Costing::multimodal ? Costing::pedestrian : options.costing();
+  auto reach = precomputed_reach.find(searched_costing);
+  reach_table = reach != precomputed_reach.end() &&
+                        reach_costing_options(options.costing_options(searched_costing)) ==
+                            reach->second.costing_options
+                    ? reach->second.table.get()
+                    : nullptr;
+
   if (options.exclude_polygons_size()) {
     const auto edges =
         edges_in_rings(options.exclude_polygons(), *reader, costing, max_exclude_polygons_length);
@@ -104,7 +130,7 @@ void loki_worker_t::parse_costing(Api& api, bool allow_none) {
     }
     try {
       auto exclude_locations = PathLocation::fromPBF(options.exclude_locations());
-      auto results = loki::Search(exclude_locations, *reader, costing);
+      auto results = loki::Search(exclude_locations, *reader, costing, reach_table);
       std::unordered_set<uint64_t> avoids;
       auto* co = options.mutable_costing_options(options.costing());
       for (const auto& result : results) {
@@ -242,9 +268,39 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
   max_best_paths = config.get<unsigned int>("service_limits.trace.max_best_paths");
   max_best_paths_shape = config.get<size_t>("service_limits.trace.max_best_paths_shape");
   max_alternates = config.get<unsigned int>("service_limits.max_alternates");
+
+  // Use the reach computed when the tiles were built if there is any
+  reach_table = nullptr;
+  reach_generation = reader->TileExtractGeneration();
+  auto tile_dir = config.get<std::string>("mjolnir.tile_dir", "");
+  if (config.get<bool>("loki.precomputed_reach", true) && !tile_dir.empty()) {
+    for (const auto costing : kReachCostings) {
+      // the reach tables are read only so all the workers of a process share them
+      const auto& name = Costing_Enum_Name(costing);
+      auto table = load_shared<ReachTable>(tile_dir + '/' + name,
+                                           [&]() { return ReachTable::Load(tile_dir, name); });
+      if (table) {
+        rapidjson::Document doc;
+        doc.SetObject();
+        Options defaults;
+        defaults.set_costing(costing);
+        ParseCostingOptions(doc, "/costing_options", defaults);
+        precomputed_reach[costing] = {table,
+                                      reach_costing_options(defaults.costing_options(costing))};
+      }
+    }
+  }
 }
 
 void loki_worker_t::cleanup() {
+  // switch to a reloaded tile extract now that we are between requests, the reach was computed
+  // for the tiles we started with so we stop using it once they change
+  reader->UpdateTileExtract();
+  if (!precomputed_reach.empty() && reader->TileExtractGeneration() != reach_generation) {
+    LOG_WARN("Not using the precomputed reach with the reloaded tile extract");
+    precomputed_reach.clear();
+  }
+  reach_table = nullptr;
   if (reader->OverCommitted()) {
     reader->Trim();
   }
@@ -272,6 +328,8 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
                                                   job.front().size());
     ParseApi(http_request, request);
     const auto& options = request.options();
+    // Let thor know which tile extract the request was started on in case it was reloaded since
+    request.mutable_info()->set_tile_extract_generation(reader->TileExtractGeneration());
 
     // check there is a valid action
     if (!options.has_action() || actions.find(options.action()) == actions.cend()) {
@@ -321,6 +379,9 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
         status(request);
         result.messages.emplace_back(request.SerializeAsString());
         break;
+      case Options::metrics:
+        result = to_response(midgard::metrics::render(), info, request, worker::TEXT_MIME);
+        break;
       default:
         // apparently you wanted something that we figured we'd support but havent written yet
         return jsonify_error({107}, info, request);
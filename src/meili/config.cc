@@ -37,6 +37,7 @@ void Config::Read(const boost::property_tree::ptree& params) {
   transition_cost.Read(params);
   emission_cost.Read(params);
   routing.Read(params);
+  online.Read(params);
 }
 
 void Config::CandidateSearch::Read(const boost::property_tree::ptree& params) {
@@ -108,5 +109,11 @@ void Config::Routing::Read(const boost::property_tree::ptree& params) {
   }
 }
 
+void Config::Online::Read(const boost::property_tree::ptree& params) {
+  ReadParamOptional(idle_timeout_seconds, params, "default.idle_timeout");
+  CHECK_THROWS(idle_timeout_seconds > 0.f,
+               POSITIVE_VALUE_MSG(idle_timeout_seconds, "idle_timeout"));
+}
+
 } // namespace meili
 } // namespace valhalla
\ No newline at end of file
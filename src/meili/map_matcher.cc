@@ -17,6 +17,10 @@ using namespace valhalla::meili;
 
 constexpr float MAX_ACCUMULATED_COST = 99999999.f;
 
+// Once this many matches of an online match were handed back, and they outnumber the ones that are
+// still pending, the states behind them are dropped
+constexpr StateId::Time kOnlineRebaseTime = 64;
+
 inline float GreatCircleDistanceSquared(const Measurement& left, const Measurement& right) {
   return left.lnglat().DistanceSquared(right.lnglat());
 }
@@ -492,7 +496,8 @@ MapMatcher::MapMatcher(const Config& config,
                        baldr::GraphReader& graphreader,
                        CandidateQuery& candidatequery,
                        const sif::mode_costing_t& mode_costing,
-                       sif::TravelMode travelmode)
+                       sif::TravelMode travelmode,
+                       const std::shared_ptr<LabelStatus>& label_status)
     : config_(config), graphreader_(graphreader), candidatequery_(candidatequery),
       mode_costing_(mode_costing), travelmode_(travelmode), interrupt_(nullptr), vs_(), ts_(vs_),
       container_(), emission_cost_model_(graphreader_, container_, config_.emission_cost),
@@ -502,7 +507,9 @@ MapMatcher::MapMatcher(const Config& config,
                              container_,
                              mode_costing_,
                              travelmode_,
-                             config_.transition_cost) {
+                             config_.transition_cost,
+                             label_status),
+      online_emitted_(0), online_last_(), online_epoch_time_(-1) {
   vs_.set_emission_cost_model(emission_cost_model_);
   vs_.set_transition_cost_model(transition_cost_model_);
 }
@@ -517,6 +524,11 @@ void MapMatcher::Clear() {
   vs_.set_transition_cost_model(transition_cost_model_);
   ts_.Clear();
   container_.Clear();
+  online_path_.clear();
+  online_emitted_ = 0;
+  online_last_ = {};
+  online_interpolated_.clear();
+  online_epoch_time_ = -1;
 }
 
 void MapMatcher::RemoveRedundancies(const std::vector<StateId>& result,
@@ -820,6 +832,222 @@ std::vector<MatchResults> MapMatcher::OfflineMatch(const std::vector<Measurement
   return best_paths;
 }
 
+MatchResults MapMatcher::OnlineMatch(const Measurement& measurement) {
+  // The trace went quiet for too long so we finish it and begin a new one with this measurement,
+  // which can't be final on its own so only the finished matches are handed back
+  if (IsOnlineMatchIdle(measurement.epoch_time())) {
+    auto finished = FinishOnlineMatch();
+    AppendOnlineMeasurement(measurement);
+    return finished;
+  }
+
+  // This one is so close to the last match that we will just interpolate it once that is final
+  if (container_.size()) {
+    const auto time = container_.size() - 1;
+    const float sq_interpolation_distance = config_.routing.interpolation_distance_meters *
+                                            config_.routing.interpolation_distance_meters;
+    if (GreatCircleDistanceSquared(container_.measurement(time), measurement) <=
+        sq_interpolation_distance) {
+      online_interpolated_[time].push_back(measurement);
+      online_epoch_time_ = measurement.epoch_time();
+      return {{}, {}, 0.f};
+    }
+  }
+
+  // Extend the search to the new measurement, it continues from where the last one left off
+  const auto time = AppendOnlineMeasurement(measurement);
+  vs_.SearchWinner(time);
+
+  // See how much more of the path can no longer change
+  StateId converged;
+  const auto final_time = vs_.FinalTime(converged);
+  if (final_time != kInvalidTime) {
+    ExtendOnlinePath(final_time, converged.IsValid() ? converged : vs_.SearchWinner(final_time));
+  }
+
+  // The match at a time depends on the path to the next time so the latest final one has to wait
+  auto results = EmitOnlineMatches(online_path_.empty() ? 0 : online_path_.size() - 1);
+
+  // Drop the states we are done with once there are enough of them to make it worth the while
+  if (online_emitted_ >= kOnlineRebaseTime &&
+      online_emitted_ > 2 * (container_.size() - online_emitted_)) {
+    RebaseOnlineMatch();
+  }
+
+  return results;
+}
+
+MatchResults MapMatcher::FinishOnlineMatch() {
+  if (!container_.size()) {
+    return {{}, {}, 0.f};
+  }
+
+  // Like the offline match we always match the last measurement rather than interpolate it
+  auto time = container_.size() - 1;
+  const auto it = online_interpolated_.find(time);
+  if (it != online_interpolated_.end()) {
+    const auto last = it->second.back();
+    it->second.pop_back();
+    if (it->second.empty()) {
+      online_interpolated_.erase(it);
+    }
+    time = AppendOnlineMeasurement(last);
+  }
+
+  // With nothing more to come the winner at the last time ends the path
+  ExtendOnlinePath(time, vs_.SearchWinner(time));
+  auto results = EmitOnlineMatches(container_.size());
+
+  Clear();
+  return results;
+}
+
+bool MapMatcher::IsOnlineMatchIdle(double epoch_time) const {
+  return container_.size() && online_epoch_time_ >= 0 && epoch_time >= 0 &&
+         epoch_time - online_epoch_time_ > config_.online.idle_timeout_seconds;
+}
+
+StateId::Time MapMatcher::AppendOnlineMeasurement(const Measurement& measurement) {
+  online_epoch_time_ = measurement.epoch_time();
+
+  // If there were interpolated points between the last match point and this one with time
+  // information, see if the trace lingered like AppendMeasurements does
+  if (container_.size()) {
+    const auto time = container_.size() - 1;
+    const auto it = online_interpolated_.find(time);
+    if (it != online_interpolated_.end() && it->second.back().epoch_time() != -1) {
+      const auto& last = container_.measurement(time);
+      auto p = it->second.back().lnglat().Project(last.lnglat(), measurement.lnglat());
+      if (p.Distance(last.lnglat()) / last.lnglat().Distance(measurement.lnglat()) < .2f) {
+        container_.SetMeasurementLeaveTime(time, it->second.back().epoch_time());
+      }
+    }
+  }
+
+  const float sq_max_search_radius = config_.candidate_search.max_search_radius_meters *
+                                     config_.candidate_search.max_search_radius_meters;
+  return AppendMeasurement(measurement, sq_max_search_radius);
+}
+
+void MapMatcher::ExtendOnlinePath(StateId::Time time, StateId stateid) {
+  if (time < online_path_.size()) {
+    return;
+  }
+
+  // Follow the predecessors back to where the path was final already. Where the path breaks the
+  // search started over and the winner before the break ends the path there, as in OfflineMatch
+  const StateId::Time begin = online_path_.size();
+  online_path_.resize(time + 1);
+  while (true) {
+    online_path_[time] = stateid;
+    if (time == begin) {
+      break;
+    }
+    const auto predecessor = stateid.IsValid() ? vs_.Predecessor(stateid) : StateId();
+    --time;
+    stateid = predecessor.IsValid() ? predecessor : vs_.SearchWinner(time);
+  }
+}
+
+MatchResults MapMatcher::EmitOnlineMatches(StateId::Time end) {
+  if (end <= online_emitted_) {
+    return {{}, {}, 0.f};
+  }
+
+  // Start from the last match we handed back so that the route connects to it
+  std::vector<MatchResult> results;
+  const bool connect = online_emitted_ > 0;
+  if (connect) {
+    results.push_back(online_last_);
+  }
+
+  double score = 0.;
+  auto result = FindMatchResult(*this, online_path_, online_emitted_, graphreader_);
+  for (auto time = online_emitted_; time < end; ++time) {
+    const auto& stateid = online_path_[time];
+    results.push_back(result);
+    online_last_ = result;
+
+    // The cost it took to get here from the previous state or the penalty for not getting here
+    if (stateid.IsValid()) {
+      const auto predecessor = vs_.Predecessor(stateid);
+      score += vs_.AccumulatedCost(stateid) -
+               (predecessor.IsValid() ? vs_.AccumulatedCost(predecessor) : 0.);
+    } else {
+      score += MAX_ACCUMULATED_COST;
+    }
+
+    // The next match is also needed to interpolate the points in between
+    const auto next_stateid = time + 1 < online_path_.size() ? online_path_[time + 1] : StateId();
+    if (time + 1 < online_path_.size()) {
+      result = FindMatchResult(*this, online_path_, time + 1, graphreader_);
+    }
+
+    const auto it = online_interpolated_.find(time);
+    if (it == online_interpolated_.end()) {
+      continue;
+    }
+    const auto interpolated_results =
+        InterpolateMeasurements(*this, it->second, stateid, next_stateid, online_last_, result);
+    results.insert(results.cend(), interpolated_results.cbegin(), interpolated_results.cend());
+    online_interpolated_.erase(it);
+  }
+  online_emitted_ = end;
+
+  // Construct the route and make its match indices relative to the new matches
+  auto segments = ConstructRoute(*this, results);
+  if (connect) {
+    results.erase(results.begin());
+    for (auto& segment : segments) {
+      segment.first_match_idx -= segment.first_match_idx >= 0;
+      segment.last_match_idx -= segment.last_match_idx >= 0;
+    }
+  }
+
+  return {std::move(results), std::move(segments), static_cast<float>(score)};
+}
+
+void MapMatcher::RebaseOnlineMatch() {
+  // Keep the last match we handed back, so the next ones can be connected to it, and everything
+  // after it. Only the final state is kept where the path is final
+  const auto first = online_emitted_ - 1;
+  StateContainer container;
+  std::vector<StateId> path;
+  for (auto time = first; time < container_.size(); ++time) {
+    const auto rebased = container.AppendMeasurement(container_.measurement(time));
+    container.SetMeasurementLeaveTime(rebased, container_.leave_time(time));
+    if (time < online_path_.size()) {
+      const auto& stateid = online_path_[time];
+      path.push_back(stateid.IsValid()
+                         ? container.AppendCandidate(container_.state(stateid).candidate())
+                         : StateId());
+    } else {
+      for (const auto& state : container_.column(time)) {
+        container.AppendCandidate(state.candidate());
+      }
+    }
+  }
+
+  std::unordered_map<StateId::Time, std::vector<Measurement>> interpolated;
+  for (auto& measurements : online_interpolated_) {
+    interpolated.emplace(measurements.first - first, std::move(measurements.second));
+  }
+
+  // Redo the search over what is left, the cost models refer to the container so we swap it in
+  container_ = std::move(container);
+  vs_.Clear();
+  for (StateId::Time time = 0; time < container_.size(); ++time) {
+    for (const auto& state : container_.column(time)) {
+      vs_.AddStateId(state.stateid());
+    }
+  }
+  vs_.SearchWinner(container_.size() - 1);
+  online_path_ = std::move(path);
+  online_emitted_ = 1;
+  online_last_.stateid = online_path_.front();
+  online_interpolated_ = std::move(interpolated);
+}
+
 std::unordered_map<StateId::Time, std::vector<Measurement>>
 MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements) {
   const float sq_max_search_radius = config_.candidate_search.max_search_radius_meters *
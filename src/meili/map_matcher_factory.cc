@@ -27,7 +27,8 @@ namespace meili {
 
 MapMatcherFactory::MapMatcherFactory(const boost::property_tree::ptree& root,
                                      const std::shared_ptr<baldr::GraphReader>& graph_reader)
-    : config_(root.get_child("meili")), graphreader_(graph_reader) {
+    : config_(root.get_child("meili")), graphreader_(graph_reader),
+      label_status_(std::make_shared<LabelStatus>()) {
   if (!graphreader_)
     graphreader_.reset(new baldr::GraphReader(root.get_child("mjolnir")));
   candidatequery_.reset(
@@ -48,7 +49,8 @@ MapMatcher* MapMatcherFactory::Create(const Options& options) {
   mode_costing_[static_cast<uint32_t>(mode)] = cost;
 
   // TODO investigate exception safety
-  return new MapMatcher(config, *graphreader_, *candidatequery_, mode_costing_, mode);
+  return new MapMatcher(config, *graphreader_, *candidatequery_, mode_costing_, mode,
+                        label_status_);
 }
 
 Config MapMatcherFactory::MergeConfig(const Options& options) const {
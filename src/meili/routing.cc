@@ -15,8 +15,15 @@
 namespace valhalla {
 namespace meili {
 
-LabelSet::LabelSet(const float max_cost, const float bucket_size)
-    : queue_(0.0f, max_cost, bucket_size, &labels_) {
+LabelSet::LabelSet(const float max_cost,
+                   const float bucket_size,
+                   std::shared_ptr<LabelStatus> status)
+    : queue_(0.0f, max_cost, bucket_size, &labels_), status_(std::move(status)) {
+  if (!status_) {
+    status_ = std::make_shared<LabelStatus>();
+  }
+  // a previous search may have bailed out before clearing up after itself
+  status_->clear();
 }
 
 void LabelSet::put(const baldr::GraphId& nodeid,
@@ -36,24 +43,23 @@ void LabelSet::put(const baldr::GraphId& nodeid,
 
   // Find the node Id. If not found, create a new label and push
   // it to the queue
-  const auto it = node_status_.find(nodeid);
-  if (it == node_status_.end()) {
+  const auto* status = status_->find(nodeid);
+  if (!status) {
     const uint32_t idx = labels_.size();
     labels_.emplace_back(nodeid, kInvalidDestination, edgeid, source, target, cost, turn_cost,
                          sortcost, predecessor, edge, mode, restriction_idx);
     queue_.add(idx);
-    node_status_.emplace(nodeid, idx);
+    status_->emplace(nodeid, idx);
   } else {
     // Node has been found. Check if there is a lower sortcost than the
     // existing label - if so update priority queue and Label
-    const auto& status = it->second;
-    if (!status.permanent && sortcost < labels_[status.label_idx].sortcost()) {
+    if (!status->permanent && sortcost < labels_[status->label_idx].sortcost()) {
       // Update queue first since it uses the label cost within the decrease
       // method to determine the current bucket.
-      queue_.decrease(status.label_idx, sortcost);
-      labels_[status.label_idx] = {nodeid, kInvalidDestination, edgeid,   source,      target,
-                                   cost,   turn_cost,           sortcost, predecessor, edge,
-                                   mode,   restriction_idx};
+      queue_.decrease(status->label_idx, sortcost);
+      labels_[status->label_idx] = {nodeid, kInvalidDestination, edgeid,   source,      target,
+                                    cost,   turn_cost,           sortcost, predecessor, edge,
+                                    mode,   restriction_idx};
     }
   }
 }
@@ -76,23 +82,22 @@ void LabelSet::put(const uint16_t dest,
   // Find the destination. If not count, create a new label and push it
   // to the queue
   baldr::GraphId inv;
-  const auto it = dest_status_.find(dest);
-  if (it == dest_status_.end()) {
+  const auto* status = status_->find(dest);
+  if (!status) {
     const uint32_t idx = labels_.size();
     labels_.emplace_back(inv, dest, edgeid, source, target, cost, turn_cost, sortcost, predecessor,
                          edge, travelmode, restriction_idx);
     queue_.add(idx);
-    dest_status_.emplace(dest, idx);
+    status_->emplace(dest, idx);
   } else {
     // Decrease cost of the existing label
-    const auto& status = it->second;
-    if (!status.permanent && sortcost < labels_[status.label_idx].sortcost()) {
+    if (!status->permanent && sortcost < labels_[status->label_idx].sortcost()) {
       // Update queue first since it uses the label cost within the decrease
       // method to determine the current bucket.
-      queue_.decrease(status.label_idx, sortcost);
-      labels_[status.label_idx] = {inv,         dest, edgeid,     source,
-                                   target,      cost, turn_cost,  sortcost,
-                                   predecessor, edge, travelmode, restriction_idx};
+      queue_.decrease(status->label_idx, sortcost);
+      labels_[status->label_idx] = {inv,         dest, edgeid,     source,
+                                    target,      cost, turn_cost,  sortcost,
+                                    predecessor, edge, travelmode, restriction_idx};
     }
   }
 }
@@ -106,21 +111,20 @@ uint32_t LabelSet::pop() {
   if (idx != baldr::kInvalidLabel) {
     const auto& label = labels_[idx];
     if (label.nodeid().Is_Valid()) {
-      const auto it = node_status_.find(label.nodeid());
+      auto* status = status_->find(label.nodeid());
 
       // When these logic errors happen, go check LabelSet::put
-      if (it == node_status_.end()) {
+      if (!status) {
         // No exception, unless BucketQueue::put was wrong: it said it
         // added but actually failed
         throw std::logic_error("all nodes in the queue should have its status");
       }
-      auto& status = it->second;
-      if (status.label_idx != idx) {
+      if (status->label_idx != idx) {
         throw std::logic_error(
-            "the index stored in the node status " + std::to_string(status.label_idx) +
+            "the index stored in the node status " + std::to_string(status->label_idx) +
             " is not synced up with the index popped from the queue idx = " + std::to_string(idx));
       }
-      if (status.permanent) {
+      if (status->permanent) {
         // For example, if the queue has popped up an index 2, and
         // marked the label at this index as permanent (optimal), then
         // some time later the queue pops up another index 2
@@ -129,25 +133,24 @@ uint32_t LabelSet::pop() {
                                " probably negative costs occurred");
       }
 
-      status.permanent = true;
+      status->permanent = true;
     } else { // assert(label.dest != kInvalidDestination)
-      const auto it = dest_status_.find(label.dest());
+      auto* status = status_->find(label.dest());
 
-      if (it == dest_status_.end()) {
+      if (!status) {
         throw std::logic_error("all dests in the queue should have its status");
       }
-      auto& status = it->second;
-      if (status.label_idx != idx) {
+      if (status->label_idx != idx) {
         throw std::logic_error(
-            "the index stored in the dest status " + std::to_string(status.label_idx) +
+            "the index stored in the dest status " + std::to_string(status->label_idx) +
             " is not synced up with the index popped from the queue idx = " + std::to_string(idx));
       }
-      if (status.permanent) {
+      if (status->permanent) {
         throw std::logic_error("the principle of optimality is violated during routing,"
                                " probably negative costs occurred");
       }
 
-      status.permanent = true;
+      status->permanent = true;
     }
   }
   return idx;
@@ -611,7 +614,7 @@ find_shortest_path(baldr::GraphReader& reader,
       }
     }
   }
-  // TODO - do we need to clear since it is constructed prior to each call??
+  // The status is pooled across searches so leave it cleared for the next one
   labelset->clear_queue();
   labelset->clear_status();
   return results;
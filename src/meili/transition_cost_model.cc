@@ -21,12 +21,14 @@ TransitionCostModel::TransitionCostModel(baldr::GraphReader& graphreader,
                                          float breakage_distance,
                                          float max_route_distance_factor,
                                          float max_route_time_factor,
-                                         float turn_penalty_factor)
+                                         float turn_penalty_factor,
+                                         std::shared_ptr<LabelStatus> label_status)
     : graphreader_(graphreader), vs_(vs), ts_(ts), container_(container), mode_costing_(mode_costing),
       travelmode_(travelmode), beta_(beta), inv_beta_(1.f / beta_),
       breakage_distance_(breakage_distance), max_route_distance_factor_(max_route_distance_factor),
       max_route_time_factor_(max_route_time_factor),
-      turn_penalty_factor_(turn_penalty_factor), turn_cost_table_{0.f} {
+      turn_penalty_factor_(turn_penalty_factor), turn_cost_table_{0.f},
+      label_status_(label_status ? std::move(label_status) : std::make_shared<LabelStatus>()) {
   if (beta_ <= 0.f) {
     throw std::invalid_argument("Expect beta to be positive");
   }
@@ -48,7 +50,8 @@ TransitionCostModel::TransitionCostModel(baldr::GraphReader& graphreader,
                                          const StateContainer& container,
                                          const sif::mode_costing_t& mode_costing,
                                          const sif::TravelMode travelmode,
-                                         const Config::TransitionCost& config)
+                                         const Config::TransitionCost& config,
+                                         std::shared_ptr<LabelStatus> label_status)
     : TransitionCostModel(graphreader,
                           vs,
                           ts,
@@ -59,7 +62,8 @@ TransitionCostModel::TransitionCostModel(baldr::GraphReader& graphreader,
                           config.breakage_distance_meters,
                           config.max_route_distance_factor,
                           config.max_route_time_factor,
-                          config.turn_penalty_factor) {
+                          config.turn_penalty_factor,
+                          std::move(label_status)) {
 }
 
 float TransitionCostModel::operator()(const StateId& lhs, const StateId& rhs) const {
@@ -149,7 +153,7 @@ void TransitionCostModel::UpdateRoute(const StateId& lhs, const StateId& rhs) co
     max_route_time = std::ceil(max_route_time);
   }
 
-  labelset_ptr_t labelset = std::make_shared<LabelSet>(max_route_distance);
+  labelset_ptr_t labelset = std::make_shared<LabelSet>(max_route_distance, 1.0f, label_status_);
   const auto& results = find_shortest_path(graphreader_, locations, 0, labelset, approximator,
                                            right_measurement.search_radius(),
                                            mode_costing_[static_cast<size_t>(travelmode_)], edgelabel,
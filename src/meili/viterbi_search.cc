@@ -1,6 +1,7 @@
 #include "meili/viterbi_search.h"
 
 #include <algorithm>
+#include <map>
 #include <string>
 
 namespace valhalla {
@@ -392,6 +393,9 @@ bool ViterbiSearch::RemoveStateId(const StateId& stateid) {
     throw std::logic_error("the state must exist in the column");
   }
   column.erase(it);
+  // the paths may have met in the state
+  final_time_ = kInvalidTime;
+  final_state_ = {};
   return true;
 }
 
@@ -444,6 +448,86 @@ double ViterbiSearch::AccumulatedCost(const StateId& stateid) const {
   }
 }
 
+StateId::Time ViterbiSearch::FinalTime(StateId& converged) const {
+  converged = {};
+  if (winner_by_time.empty()) {
+    return kInvalidTime;
+  }
+
+  // The scanned states that the paths still being searched go on from, grouped by time. These are
+  // the latest winner, whose successors are only added at the next search, and the predecessors of
+  // the labels left in the queue. Labels without a predecessor began the search over so the path
+  // breaks right before them. The search only begins over once every path before it died, so all
+  // the paths go back to that break and nothing after it is final until the paths meet again
+  std::map<StateId::Time, std::vector<StateId>> frontier;
+  size_t count = 0;
+  bool breaks = false;
+  StateId::Time break_time = kInvalidTime;
+  const auto add = [&frontier, &count, &breaks, &break_time](const StateId& stateid,
+                                                             const StateId& predecessor) {
+    if (!predecessor.IsValid()) {
+      breaks = true;
+      break_time = stateid.time() - 1;
+      return;
+    }
+    auto& states = frontier[predecessor.time()];
+    if (std::find(states.begin(), states.end(), predecessor) == states.end()) {
+      states.push_back(predecessor);
+      ++count;
+    }
+  };
+
+  // The winner has been scanned already so it goes on from itself
+  const auto& winner = winner_by_time.back();
+  if (winner.IsValid()) {
+    add(winner, winner);
+  }
+  for (const auto& label : queue_) {
+    // The search skips these anyhow
+    if (label.stateid().time() < earliest_time_) {
+      continue;
+    }
+    add(label.stateid(), label.predecessor());
+    if (breaks) {
+      final_time_ = break_time;
+      final_state_ = {};
+      return break_time;
+    }
+  }
+
+  // Nothing left to search so the search will start over at the next time
+  if (count == 0) {
+    return winner_by_time.size() - 1;
+  }
+
+  // Walk the paths back from the latest time until they all meet in one state or reach the break.
+  // Every path goes on from where they met or broke last time so the walk stops there, which
+  // makes the walks of all the calls together no longer than the path itself
+  while (count > 1) {
+    const auto latest = std::prev(frontier.end());
+    if (final_time_ != kInvalidTime && latest->first <= final_time_) {
+      converged = final_state_;
+      return final_time_;
+    }
+    const auto states = std::move(latest->second);
+    frontier.erase(latest);
+    count -= states.size();
+    for (const auto& stateid : states) {
+      add(stateid, Predecessor(stateid));
+      if (breaks) {
+        final_time_ = break_time;
+        final_state_ = {};
+        return break_time;
+      }
+    }
+  }
+
+  converged = frontier.begin()->second.front();
+  final_time_ = converged.time();
+  final_state_ = converged;
+  return final_time_;
+}
+
 void ViterbiSearch::Clear() {
   IViterbiSearch::Clear();
   states_by_time.clear();
@@ -452,6 +536,8 @@ void ViterbiSearch::Clear() {
 
 void ViterbiSearch::ClearSearch() {
   earliest_time_ = 0;
+  final_time_ = kInvalidTime;
+  final_state_ = {};
   queue_.clear();
   scanned_labels_.clear();
   winner_by_time.clear();
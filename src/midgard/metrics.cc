@@ -0,0 +1,223 @@
+#include "midgard/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+using namespace valhalla::midgard::metrics;
+
+// One series of a metric as seen by one thread
+struct Series {
+  std::string name;
+  std::string labels; // already rendered without the braces
+  std::unique_ptr<Counter> counter;
+  std::unique_ptr<Histogram> histogram;
+};
+
+// The series of one thread. Only the owning thread adds series so it looks them up without the
+// lock, it takes the lock to add one so that rendering never sees the map while it changes
+struct Shard {
+  std::mutex mutex;
+  std::unordered_map<std::string, Series> series;
+};
+
+// The sum of a series over threads
+struct Total {
+  bool histogram = false;
+  uint64_t value = 0;
+  std::array<uint64_t, Histogram::kBoundCount + 1> buckets{};
+  double sum = 0;
+};
+
+// totals by name then by labels
+using totals_t = std::map<std::string, std::map<std::string, Total>>;
+
+void accumulate(totals_t& totals, const Shard& shard) {
+  for (const auto& entry : shard.series) {
+    const auto& series = entry.second;
+    auto& total = totals[series.name][series.labels];
+    if (series.histogram) {
+      total.histogram = true;
+      for (size_t i = 0; i < total.buckets.size(); ++i) {
+        total.buckets[i] += series.histogram->bucket(i);
+      }
+      total.value += series.histogram->count();
+      total.sum += series.histogram->sum();
+    } else if (!total.histogram) {
+      total.value += series.counter->value();
+    }
+  }
+}
+
+// The shards of the running threads and what the finished ones left behind. Threads come and go
+// with every request that runs on threads so a finished thread folds its shard into the totals
+struct Registry {
+  std::mutex mutex;
+  std::list<Shard*> shards;
+  totals_t retired;
+};
+
+Registry& registry() {
+  static Registry registry;
+  return registry;
+}
+
+// Registers the shard of a thread for as long as the thread runs
+struct ThreadShard {
+  Shard shard;
+  std::list<Shard*>::iterator position;
+
+  ThreadShard() {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    position = registry().shards.insert(registry().shards.end(), &shard);
+  }
+
+  ~ThreadShard() {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    accumulate(registry().retired, shard);
+    registry().shards.erase(position);
+  }
+};
+
+Shard& shard() {
+  thread_local ThreadShard shard;
+  return shard.shard;
+}
+
+std::string render_labels(const labels_t& labels) {
+  std::string rendered;
+  for (const auto& label : labels) {
+    if (!rendered.empty()) {
+      rendered.push_back(',');
+    }
+    rendered += label.first;
+    rendered += "=\"";
+    for (const auto c : label.second) {
+      switch (c) {
+        case '\\':
+          rendered += "\\\\";
+          break;
+        case '"':
+          rendered += "\\\"";
+          break;
+        case '\n':
+          rendered += "\\n";
+          break;
+        default:
+          rendered.push_back(c);
+      }
+    }
+    rendered.push_back('"');
+  }
+  return rendered;
+}
+
+Series& get_series(const std::string& name, const labels_t& labels, const bool histogram) {
+  auto rendered = render_labels(labels);
+  auto key = name + '{' + rendered + '}';
+  auto& s = shard();
+  auto found = s.series.find(key);
+  if (found != s.series.end() &&
+      (histogram ? found->second.histogram != nullptr : found->second.counter != nullptr)) {
+    return found->second;
+  }
+
+  std::lock_guard<std::mutex> lock(s.mutex);
+  auto& series = s.series[key];
+  series.name = name;
+  series.labels = std::move(rendered);
+  if (histogram) {
+    series.histogram.reset(new Histogram());
+  } else {
+    series.counter.reset(new Counter());
+  }
+  return series;
+}
+
+std::string with_label(const std::string& labels, const std::string& label) {
+  return '{' + labels + (labels.empty() ? "" : ",") + label + '}';
+}
+
+std::string format(const double value) {
+  std::ostringstream stream;
+  stream << std::setprecision(9) << value;
+  return stream.str();
+}
+
+} // namespace
+
+namespace valhalla {
+namespace midgard {
+namespace metrics {
+
+const std::array<double, Histogram::kBoundCount> Histogram::kBounds = {
+    .001, .0025, .005, .01, .025, .05, .1, .25, .5, 1, 2.5, 5, 10};
+
+void Histogram::observe(const double seconds) {
+  auto bucket = std::lower_bound(kBounds.cbegin(), kBounds.cend(), seconds) - kBounds.cbegin();
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_micros_.fetch_add(static_cast<uint64_t>(std::llround(std::max(seconds, 0.) * 1e6)),
+                        std::memory_order_relaxed);
+}
+
+Counter& counter(const std::string& name, const labels_t& labels) {
+  return *get_series(name, labels, false).counter;
+}
+
+Histogram& histogram(const std::string& name, const labels_t& labels) {
+  return *get_series(name, labels, true).histogram;
+}
+
+std::string render() {
+  // sum up the series of all the threads, sorted by name and labels
+  totals_t totals;
+  {
+    std::lock_guard<std::mutex> registry_lock(registry().mutex);
+    totals = registry().retired;
+    for (auto* shard : registry().shards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      accumulate(totals, *shard);
+    }
+  }
+
+  std::string rendered;
+  for (const auto& metric : totals) {
+    const auto& name = metric.first;
+    bool histogram = metric.second.cbegin()->second.histogram;
+    rendered += "# TYPE " + name + (histogram ? " histogram\n" : " counter\n");
+    for (const auto& series : metric.second) {
+      const auto& labels = series.first;
+      const auto& total = series.second;
+      if (!histogram) {
+        rendered += name + (labels.empty() ? "" : '{' + labels + '}') + ' ' +
+                    std::to_string(total.value) + '\n';
+        continue;
+      }
+      // the buckets are cumulative
+      uint64_t cumulative = 0;
+      for (size_t i = 0; i < total.buckets.size(); ++i) {
+        cumulative += total.buckets[i];
+        auto bound = i < Histogram::kBoundCount ? format(Histogram::kBounds[i]) : "+Inf";
+        rendered += name + "_bucket" + with_label(labels, "le=\"" + bound + '"') + ' ' +
+                    std::to_string(cumulative) + '\n';
+      }
+      auto braces = labels.empty() ? "" : '{' + labels + '}';
+      rendered += name + "_sum" + braces + ' ' + format(total.sum) + '\n';
+      rendered += name + "_count" + braces + ' ' + std::to_string(total.value) + '\n';
+    }
+  }
+  return rendered;
+}
+
+} // namespace metrics
+} // namespace midgard
+} // namespace valhalla
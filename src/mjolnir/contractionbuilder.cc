@@ -0,0 +1,301 @@
+#include "mjolnir/contractionbuilder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "baldr/contraction.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// How many vertices a witness search may settle before it gives up, in which case the shortcut is
+// added even though a path avoiding the contracted vertex might exist
+constexpr uint32_t kWitnessSettleLimit = 500;
+
+using arcs_t = std::vector<ContractionArc>;
+
+// Add an arc or lower the cost of the parallel arc that is already there
+void add_arc(arcs_t& arcs, const ContractionArc& arc) {
+  for (auto& a : arcs) {
+    if (a.target == arc.target) {
+      if (arc.cost < a.cost) {
+        a = arc;
+      }
+      return;
+    }
+  }
+  arcs.push_back(arc);
+}
+
+// Remove the arcs to a vertex
+void remove_arcs(arcs_t& arcs, const uint32_t target) {
+  arcs.erase(std::remove_if(arcs.begin(), arcs.end(),
+                            [target](const ContractionArc& a) { return a.target == target; }),
+             arcs.end());
+}
+
+/**
+ * Contracts the vertices of a graph one at a time, the one whose contraction adds the fewest
+ * shortcuts compared to the arcs it removes first. The arcs of the remaining graph are kept for
+ * every vertex in both directions, arcs entering a vertex target the vertex they come from.
+ */
+class Contractor {
+public:
+  Contractor(std::vector<arcs_t>&& out, std::vector<arcs_t>&& in)
+      : out_(std::move(out)), in_(std::move(in)), deleted_neighbours_(out_.size(), 0),
+        dist_(out_.size(), std::numeric_limits<float>::infinity()) {
+  }
+
+  /**
+   * Contract all vertices.
+   * @param forward   filled with the arcs from each vertex to higher ranked vertices
+   * @param backward  filled with the arcs to each vertex from higher ranked vertices
+   */
+  void Contract(std::vector<arcs_t>& forward, std::vector<arcs_t>& backward) {
+    forward.resize(out_.size());
+    backward.resize(out_.size());
+
+    using entry_t = std::pair<int32_t, uint32_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+    for (uint32_t v = 0; v < out_.size(); ++v) {
+      queue.emplace(Priority(v), v);
+    }
+
+    size_t contracted = 0;
+    std::vector<std::pair<uint32_t, ContractionArc>> shortcuts;
+    while (!queue.empty()) {
+      auto v = queue.top().second;
+      queue.pop();
+
+      // The priority only goes stale when neighbours are contracted so it is updated lazily
+      auto priority = Priority(v);
+      if (!queue.empty() && priority > queue.top().first) {
+        queue.emplace(priority, v);
+        continue;
+      }
+
+      // Whatever is left of the arcs of the vertex connects it to higher ranked vertices
+      shortcuts.clear();
+      Shortcuts(v, &shortcuts);
+      for (const auto& arc : out_[v]) {
+        forward[v].push_back(arc);
+        remove_arcs(in_[arc.target], v);
+        ++deleted_neighbours_[arc.target];
+      }
+      for (const auto& arc : in_[v]) {
+        backward[v].push_back(arc);
+        remove_arcs(out_[arc.target], v);
+        ++deleted_neighbours_[arc.target];
+      }
+      arcs_t().swap(out_[v]);
+      arcs_t().swap(in_[v]);
+
+      for (const auto& shortcut : shortcuts) {
+        add_arc(out_[shortcut.first], shortcut.second);
+        auto reverse = shortcut.second;
+        reverse.target = shortcut.first;
+        add_arc(in_[shortcut.second.target], reverse);
+      }
+
+      if (++contracted % 1000000 == 0) {
+        LOG_INFO("Contracted " + std::to_string(contracted) + " of " +
+                 std::to_string(out_.size()) + " vertices");
+      }
+    }
+  }
+
+private:
+  // Run a shortest path search from source that avoids the skipped vertex, up to the max cost
+  void Witness(const uint32_t source, const uint32_t skip, const float max_cost) {
+    for (auto t : touched_) {
+      dist_[t] = std::numeric_limits<float>::infinity();
+    }
+    touched_.clear();
+
+    using entry_t = std::pair<float, uint32_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+    dist_[source] = 0.f;
+    touched_.push_back(source);
+    queue.emplace(0.f, source);
+    for (uint32_t settled = 0; !queue.empty() && settled < kWitnessSettleLimit; ++settled) {
+      auto top = queue.top();
+      queue.pop();
+      if (top.first > max_cost) {
+        break;
+      }
+      if (top.first > dist_[top.second]) {
+        continue;
+      }
+      for (const auto& arc : out_[top.second]) {
+        auto cost = top.first + arc.cost;
+        if (arc.target != skip && cost < dist_[arc.target]) {
+          if (dist_[arc.target] == std::numeric_limits<float>::infinity()) {
+            touched_.push_back(arc.target);
+          }
+          dist_[arc.target] = cost;
+          queue.emplace(cost, arc.target);
+        }
+      }
+    }
+  }
+
+  // Count (and optionally collect) the shortcuts needed when contracting a vertex
+  uint32_t Shortcuts(const uint32_t v,
+                     std::vector<std::pair<uint32_t, ContractionArc>>* shortcuts) {
+    float max_out = 0.f;
+    for (const auto& arc : out_[v]) {
+      max_out = std::max(max_out, arc.cost);
+    }
+
+    uint32_t count = 0;
+    for (const auto& in : in_[v]) {
+      Witness(in.target, v, in.cost + max_out);
+      for (const auto& out : out_[v]) {
+        auto cost = in.cost + out.cost;
+        if (out.target == in.target || dist_[out.target] <= cost) {
+          continue;
+        }
+        ++count;
+        if (shortcuts) {
+          shortcuts->emplace_back(in.target,
+                                  ContractionArc{out.target, v, cost, 0, kInvalidGraphId});
+        }
+      }
+    }
+    return count;
+  }
+
+  // The edge difference plus the contracted neighbours, which spreads contraction over the graph
+  int32_t Priority(const uint32_t v) {
+    return static_cast<int32_t>(Shortcuts(v, nullptr)) -
+           static_cast<int32_t>(out_[v].size() + in_[v].size()) +
+           static_cast<int32_t>(deleted_neighbours_[v]);
+  }
+
+  std::vector<arcs_t> out_;
+  std::vector<arcs_t> in_;
+  std::vector<uint32_t> deleted_neighbours_;
+  // witness search distances, only the touched ones are reset between searches
+  std::vector<float> dist_;
+  std::vector<uint32_t> touched_;
+};
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void ContractionBuilder::Build(const boost::property_tree::ptree& pt) {
+  LOG_INFO("Building contraction hierarchy");
+  GraphReader reader(pt.get_child("mjolnir"));
+
+  // The overlay is only valid for requests that use the default auto costing. Like any request
+  // without a date_time it does not use predicted or live speeds
+  rapidjson::Document doc;
+  doc.SetObject();
+  Options options;
+  options.set_costing(Costing::auto_);
+  ParseCostingOptions(doc, "/costing_options", options);
+  auto* auto_options = options.mutable_costing_options(Costing::auto_);
+  auto_options->set_flow_mask(static_cast<uint8_t>(auto_options->flow_mask()) &
+                              ~(kPredictedFlowMask | kCurrentFlowMask));
+  auto costing = CostFactory().Create(options);
+
+  // Number the nodes of all the levels, tile by tile
+  std::vector<std::pair<GraphId, uint32_t>> tiles;
+  for (const auto& level : TileHierarchy::levels()) {
+    for (const auto& tile_id : reader.GetTileSet(level.level)) {
+      auto tile = reader.GetGraphTile(tile_id);
+      tiles.emplace_back(tile_id, tile->header()->nodecount());
+    }
+  }
+  std::sort(tiles.begin(), tiles.end(),
+            [](const std::pair<GraphId, uint32_t>& a, const std::pair<GraphId, uint32_t>& b) {
+              return a.first.tile_value() < b.first.tile_value();
+            });
+  std::unordered_map<uint32_t, uint32_t> first_vertex;
+  uint32_t vertex_count = 0;
+  for (const auto& tile : tiles) {
+    first_vertex.emplace(tile.first.tile_value(), vertex_count);
+    vertex_count += tile.second;
+  }
+  auto vertex = [&first_vertex](const GraphId& node) {
+    auto found = first_vertex.find(node.tile_value());
+    return found == first_vertex.end() ? kInvalidVertex : found->second + node.id();
+  };
+
+  // Every edge the costing allows becomes an arc weighted by its cost and the transitions between
+  // the levels of a node become arcs that cost nothing
+  std::vector<arcs_t> out(vertex_count), in(vertex_count);
+  auto add = [&out, &in](const uint32_t from, const ContractionArc& arc) {
+    add_arc(out[from], arc);
+    auto reverse = arc;
+    reverse.target = from;
+    add_arc(in[arc.target], reverse);
+  };
+  for (const auto& t : tiles) {
+    auto tile = reader.GetGraphTile(t.first);
+    for (uint32_t n = 0, v = vertex(t.first); n < t.second; ++n, ++v) {
+      const NodeInfo* node = tile->node(n);
+      if (!costing->Allowed(node)) {
+        continue;
+      }
+
+      for (const auto& transition : tile->GetNodeTransitions(node)) {
+        auto w = vertex(transition.endnode());
+        if (w != kInvalidVertex) {
+          add(v, {w, kInvalidVertex, 0.f, 0, kInvalidGraphId});
+        }
+      }
+
+      for (uint32_t i = 0; i < node->edge_count(); ++i) {
+        // The overlay makes its own shortcuts and destination only edges may not be passed through
+        const DirectedEdge* edge = tile->directededge(node->edge_index() + i);
+        if (!costing->Allowed(edge, tile, kDisallowShortcut) || edge->destonly()) {
+          continue;
+        }
+        auto w = vertex(edge->endnode());
+        if (w == kInvalidVertex || w == v) {
+          continue;
+        }
+        uint8_t flow_sources;
+        auto cost = costing->EdgeCost(edge, tile, kInvalidSecondsOfWeek, flow_sources).cost;
+        GraphId edgeid(t.first.tileid(), t.first.level(), node->edge_index() + i);
+        add(v, {w, kInvalidVertex, cost, 0, edgeid.value});
+      }
+    }
+    // The tiles are only read once so there is no need to keep them around
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  std::vector<arcs_t> forward, backward;
+  Contractor(std::move(out), std::move(in)).Contract(forward, backward);
+
+  size_t arc_count = 0;
+  for (uint32_t v = 0; v < vertex_count; ++v) {
+    arc_count += forward[v].size() + backward[v].size();
+  }
+  ContractionOverlay::Write(pt.get<std::string>("mjolnir.tile_dir"), tiles, forward, backward);
+  LOG_INFO("Finished contraction hierarchy with " + std::to_string(vertex_count) +
+           " vertices and " + std::to_string(arc_count) + " arcs");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -172,11 +172,18 @@ void ElevationBuilder::Build(const boost::property_tree::ptree& pt) {
   auto hierarchy_properties = pt.get_child("mjolnir");
   std::string tile_dir = hierarchy_properties.get<std::string>("tile_dir");
 
-  // Crack open some elevation data if its there. Return if it is not.
+  // How many threads to add elevation with
+  uint32_t nthreads =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+
+  // Crack open some elevation data if its there. Return if it is not. The threads share the
+  // sample so keep enough decompressed tiles around for each of them to work on its own
   boost::optional<std::string> elevation = pt.get_optional<std::string>("additional_data.elevation");
   std::unique_ptr<const skadi::sample> sample;
   if (elevation && filesystem::exists(*elevation)) {
-    sample.reset(new skadi::sample(*elevation));
+    sample.reset(new skadi::sample(*elevation, std::max<size_t>(skadi::kDefaultUnzippedCacheSize,
+                                                                nthreads)));
   } else {
     LOG_INFO("ElevationBuilder: no elevation data, skipping");
     return;
@@ -196,9 +203,6 @@ void ElevationBuilder::Build(const boost::property_tree::ptree& pt) {
   std::mutex lock;
 
   // Setup threads
-  uint32_t nthreads =
-      std::max(static_cast<unsigned int>(1),
-               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
   std::vector<std::shared_ptr<std::thread>> threads(nthreads);
 
   // Setup promises. Hold the results for the threads
@@ -40,17 +40,21 @@ namespace {
  * we also need to then update the edges that pointed to them
  *
  */
-std::map<GraphId, size_t> SortGraph(const std::string& nodes_file, const std::string& edges_file) {
+std::map<GraphId, size_t> SortGraph(const std::string& nodes_file,
+                                    const std::string& edges_file,
+                                    size_t sort_buffer_size,
+                                    unsigned int threads) {
   LOG_INFO("Sorting graph...");
 
   // Sort nodes by graphid then by osmid, so its basically a set of tiles
   sequence<Node> nodes(nodes_file, false);
-  nodes.sort([](const Node& a, const Node& b) {
+  auto by_tile_and_osmid = [](const Node& a, const Node& b) {
     if (a.graph_id == b.graph_id) {
       return a.node.osmid_ < b.node.osmid_;
     }
     return a.graph_id < b.graph_id;
-  });
+  };
+  nodes.sort(by_tile_and_osmid, sort_buffer_size / sizeof(Node), threads);
 
   // run through the sorted nodes, going back to the edges they reference and updating each edge
   // to point to the first (out of the duplicates) nodes index. at the end of this there will be
@@ -113,8 +117,8 @@ std::map<GraphId, size_t> SortGraph(const std::string& nodes_file, const std::st
   auto cmp = [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) {
     return a.first < b.first;
   };
-  starts->sort(cmp);
-  ends->sort(cmp);
+  starts->sort(cmp, sort_buffer_size / sizeof(std::pair<uint32_t, uint32_t>), threads);
+  ends->sort(cmp, sort_buffer_size / sizeof(std::pair<uint32_t, uint32_t>), threads);
 
   sequence<Edge> edges(edges_file, false);
 
@@ -1118,7 +1122,11 @@ std::map<GraphId, size_t> GraphBuilder::BuildEdges(const boost::property_tree::p
                  },
                  pt.get<bool>("mjolnir.data_processing.infer_turn_channels", true));
 
-  return SortGraph(nodes_file, edges_file);
+  unsigned int threads =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+  return SortGraph(nodes_file, edges_file,
+                   pt.get<size_t>("mjolnir.sort_buffer_size", 1024 * 1024 * 512), threads);
 }
 
 // Build the graph from the input
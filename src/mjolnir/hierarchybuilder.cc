@@ -4,11 +4,16 @@
 #include <boost/format.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <future>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -68,10 +73,14 @@ bool AddUpwardTransition(const GraphId& node, GraphTileBuilder* tilebuilder) {
   }
 }
 
-void SortSequences(const std::string& new_to_old_file, const std::string& old_to_new_file) {
+void SortSequences(const std::string& new_to_old_file,
+                   const std::string& old_to_new_file,
+                   size_t sort_buffer_size,
+                   unsigned int threads) {
   // Sort the new nodes. Sort so highway level is first
   sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
-  new_to_old.sort([](const std::pair<GraphId, GraphId>& a, const std::pair<GraphId, GraphId>& b) {
+  auto by_level_tile_id = [](const std::pair<GraphId, GraphId>& a,
+                             const std::pair<GraphId, GraphId>& b) {
     if (a.first.level() == b.first.level()) {
       if (a.first.tileid() == b.first.tileid()) {
         return a.first.id() < b.first.id();
@@ -79,12 +88,16 @@ void SortSequences(const std::string& new_to_old_file, const std::string& old_to
       return a.first.tileid() < b.first.tileid();
     }
     return a.first.level() < b.first.level();
-  });
+  };
+  new_to_old.sort(by_level_tile_id, sort_buffer_size / sizeof(std::pair<GraphId, GraphId>),
+                  threads);
 
   // Sort old to new by node Id
   sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
-  old_to_new.sort(
-      [](const OldToNewNodes& a, const OldToNewNodes& b) { return a.node_id < b.node_id; });
+  auto by_node_id = [](const OldToNewNodes& a, const OldToNewNodes& b) {
+    return a.node_id < b.node_id;
+  };
+  old_to_new.sort(by_node_id, sort_buffer_size / sizeof(OldToNewNodes), threads);
 }
 
 // Convenience method to find the node association.
@@ -121,16 +134,18 @@ bool OpposingEdgeInfoMatches(const graph_tile_ptr& tile, const DirectedEdge* edg
   return false;
 }
 
-// Form tiles in the new level.
-void FormTilesInNewLevel(GraphReader& reader,
-                         const std::string& new_to_old_file,
-                         const std::string& old_to_new_file) {
-  // Use the sequence that associate new nodes to old nodes
-  sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
-
-  // Use the sorted sequence that associates old nodes to new nodes
-  sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
+// The range of the sorted new to old sequence holding the nodes of one new tile
+struct TileRange {
+  GraphId tile_id; // New tile
+  size_t begin;    // First new node of the tile
+  size_t end;      // One past the last new node of the tile
+};
 
+// Form a tile in the new level from its range of new nodes.
+void FormTileInNewLevel(GraphReader& reader,
+                        sequence<std::pair<GraphId, GraphId>>& new_to_old,
+                        sequence<OldToNewNodes>& old_to_new,
+                        const TileRange& range) {
   // lambda to indicate whether a directed edge should be included
   auto include_edge = [&old_to_new](const DirectedEdge* directededge, const GraphId& base_node,
                                     const uint8_t current_level) {
@@ -158,39 +173,21 @@ void FormTilesInNewLevel(GraphReader& reader,
     }
   };
 
-  // Iterate through the new nodes. They have been sorted by level so that
-  // highway level is done first.
-  reader.Clear();
+  // New tilebuilder for the tile
   bool added = false;
-  uint8_t current_level = std::numeric_limits<uint8_t>::max();
-  GraphId tile_id;
   std::hash<std::string> hasher;
-  PointLL base_ll;
-  GraphTileBuilder* tilebuilder = nullptr;
-  for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); new_node++) {
-    // Get the node - check if a new tile
-    GraphId nodea = (*new_node).first;
-    if (nodea.Tile_Base() != tile_id) {
-      // Store the prior tile
-      if (tilebuilder != nullptr) {
-        tilebuilder->StoreTileData();
-        delete tilebuilder;
-      }
-
-      // New tilebuilder for the next tile. Update current level.
-      tile_id = nodea.Tile_Base();
-      tilebuilder = new GraphTileBuilder(reader.tile_dir(), tile_id, false);
-      current_level = nodea.level();
+  GraphId tile_id = range.tile_id;
+  uint8_t current_level = tile_id.level();
+  GraphTileBuilder tilebuilder(reader.tile_dir(), tile_id, false);
 
-      // Set the base ll for this tile
-      base_ll = TileHierarchy::get_tiling(current_level).Base(tile_id.tileid());
-      tilebuilder->header_builder().set_base_ll(base_ll);
+  // Set the base ll for this tile
+  PointLL base_ll = TileHierarchy::get_tiling(current_level).Base(tile_id.tileid());
+  tilebuilder.header_builder().set_base_ll(base_ll);
 
-      // Check if we need to clear the base/local tile cache
-      if (reader.OverCommitted()) {
-        reader.Trim();
-      }
-    }
+  // Iterate through the new nodes of the tile
+  auto new_node = new_to_old.at(range.begin);
+  for (size_t n = range.begin; n < range.end; ++n, new_node++) {
+    GraphId nodea = (*new_node).first;
 
     // Get the node in the base level
     GraphId base_node = (*new_node).second;
@@ -201,25 +198,25 @@ void FormTilesInNewLevel(GraphReader& reader,
     }
 
     // Copy the data version
-    tilebuilder->header_builder().set_dataset_id(tile->header()->dataset_id());
+    tilebuilder.header_builder().set_dataset_id(tile->header()->dataset_id());
 
     // Copy node information and set the node lat,lon offsets within the new tile
     NodeInfo baseni = *(tile->node(base_node.id()));
-    tilebuilder->nodes().push_back(baseni);
+    tilebuilder.nodes().push_back(baseni);
     const auto& admin = tile->admininfo(baseni.admin_index());
-    NodeInfo& node = tilebuilder->nodes().back();
+    NodeInfo& node = tilebuilder.nodes().back();
     node.set_latlng(base_ll, baseni.latlng(tile->header()->base_ll()));
-    node.set_edge_index(tilebuilder->directededges().size());
+    node.set_edge_index(tilebuilder.directededges().size());
     node.set_timezone(baseni.timezone());
-    node.set_admin_index(tilebuilder->AddAdmin(admin.country_text(), admin.state_text(),
-                                               admin.country_iso(), admin.state_iso()));
+    node.set_admin_index(tilebuilder.AddAdmin(admin.country_text(), admin.state_text(),
+                                              admin.country_iso(), admin.state_iso()));
 
     // Update node LL based on tile base
     // Density at this node
     uint32_t density1 = baseni.density();
 
     // Current edge count
-    size_t edge_count = tilebuilder->directededges().size();
+    size_t edge_count = tilebuilder.directededges().size();
 
     // Iterate through directed edges of the base node to get remaining
     // directed edges (based on classification/importance cutoff)
@@ -273,13 +270,13 @@ void FormTilesInNewLevel(GraphReader& reader,
         if (signs.size() == 0) {
           LOG_ERROR("Base edge should have signs, but none found");
         }
-        tilebuilder->AddSigns(tilebuilder->directededges().size(), signs);
+        tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
       }
 
       // Get turn lanes from the base directed edge
       if (directededge->turnlanes()) {
         uint32_t offset = tile->turnlanes_offset(base_edge_id.id());
-        tilebuilder->AddTurnLanes(tilebuilder->directededges().size(), tile->GetName(offset));
+        tilebuilder.AddTurnLanes(tilebuilder.directededges().size(), tile->GetName(offset));
       }
 
       // Get access restrictions from the base directed edge. Add these to
@@ -288,8 +285,8 @@ void FormTilesInNewLevel(GraphReader& reader,
       if (directededge->access_restriction()) {
         auto restrictions = tile->GetAccessRestrictions(base_edge_id.id(), kAllAccess);
         for (const auto& res : restrictions) {
-          tilebuilder->AddAccessRestriction(AccessRestriction(tilebuilder->directededges().size(),
-                                                              res.type(), res.modes(), res.value()));
+          tilebuilder.AddAccessRestriction(AccessRestriction(tilebuilder.directededges().size(),
+                                                             res.type(), res.modes(), res.value()));
         }
       }
 
@@ -300,9 +297,9 @@ void FormTilesInNewLevel(GraphReader& reader,
           LOG_ERROR("Base edge should have lane connectivity, but none found");
         }
         for (auto& lc : laneconnectivity) {
-          lc.set_to(tilebuilder->directededges().size());
+          lc.set_to(tilebuilder.directededges().size());
         }
-        tilebuilder->AddLaneConnectivity(laneconnectivity);
+        tilebuilder.AddLaneConnectivity(laneconnectivity);
       }
 
       // Do we need to force adding edgeinfo (opposing edge could have diff names)?
@@ -319,41 +316,41 @@ void FormTilesInNewLevel(GraphReader& reader,
       std::string encoded_shape = edgeinfo.encoded_shape();
       uint32_t w = hasher(encoded_shape + std::to_string(edgeinfo.wayid()));
       uint32_t edge_info_offset =
-          tilebuilder->AddEdgeInfo(w, nodea, nodeb, edgeinfo.wayid(), edgeinfo.mean_elevation(),
-                                   edgeinfo.bike_network(), edgeinfo.speed_limit(), encoded_shape,
-                                   edgeinfo.GetNames(), edgeinfo.GetNames(true), edgeinfo.GetTypes(),
-                                   added, diff_names);
+          tilebuilder.AddEdgeInfo(w, nodea, nodeb, edgeinfo.wayid(), edgeinfo.mean_elevation(),
+                                  edgeinfo.bike_network(), edgeinfo.speed_limit(), encoded_shape,
+                                  edgeinfo.GetNames(), edgeinfo.GetNames(true), edgeinfo.GetTypes(),
+                                  added, diff_names);
       newedge.set_edgeinfo_offset(edge_info_offset);
 
       // Add directed edge
-      tilebuilder->directededges().emplace_back(std::move(newedge));
+      tilebuilder.directededges().emplace_back(std::move(newedge));
     }
 
     // Add node transitions
-    uint32_t index = tilebuilder->transitions().size();
+    uint32_t index = tilebuilder.transitions().size();
     auto new_nodes = find_nodes(old_to_new, base_node);
     if (current_level == 0) {
-      AddDownwardTransition(new_nodes.arterial_node, tilebuilder);
-      AddDownwardTransition(new_nodes.local_node, tilebuilder);
+      AddDownwardTransition(new_nodes.arterial_node, &tilebuilder);
+      AddDownwardTransition(new_nodes.local_node, &tilebuilder);
     } else if (current_level == 1) {
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder);
-      AddDownwardTransition(new_nodes.local_node, tilebuilder);
+      AddUpwardTransition(new_nodes.highway_node, &tilebuilder);
+      AddDownwardTransition(new_nodes.local_node, &tilebuilder);
     } else if (current_level == 2) {
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder);
-      AddUpwardTransition(new_nodes.arterial_node, tilebuilder);
+      AddUpwardTransition(new_nodes.highway_node, &tilebuilder);
+      AddUpwardTransition(new_nodes.arterial_node, &tilebuilder);
     } else {
       throw std::logic_error("current_level was never set");
     }
 
     // Set the node transition count and index
-    uint32_t count = tilebuilder->transitions().size() - index;
+    uint32_t count = tilebuilder.transitions().size() - index;
     if (count > 0) {
       node.set_transition_count(count);
       node.set_transition_index(index);
     }
 
     // Set the edge count for the new node
-    node.set_edge_count(tilebuilder->directededges().size() - edge_count);
+    node.set_edge_count(tilebuilder.directededges().size() - edge_count);
 
     // Get named signs from the base node
     if (baseni.named_intersection()) {
@@ -362,27 +359,177 @@ void FormTilesInNewLevel(GraphReader& reader,
         LOG_ERROR("Base node should have signs, but none found");
       }
       node.set_named_intersection(true);
-      tilebuilder->AddSigns(tilebuilder->nodes().size() - 1, signs);
+      tilebuilder.AddSigns(tilebuilder.nodes().size() - 1, signs);
     }
   }
 
-  // Delete the tile builder
-  if (tilebuilder != nullptr) {
-    tilebuilder->StoreTileData();
-    delete tilebuilder;
+  // Store the tile
+  tilebuilder.StoreTileData();
+
+  // Check if we need to clear the base/local tile cache
+  if (reader.OverCommitted()) {
+    reader.Trim();
+  }
+}
+
+/**
+ * Form the new tiles of the given ranges. Each thread takes the next tile until there are none
+ * left, every tile only depends on its own range of new nodes so the output does not depend on
+ * which thread did which tile.
+ * @param  pt               the valhalla config
+ * @param  new_to_old_file  sorted sequence associating new nodes to old nodes
+ * @param  old_to_new_file  sorted sequence associating old nodes to new nodes
+ * @param  ranges           the ranges of new nodes of the tiles to form
+ * @param  concurrency      number of threads to use
+ */
+void FormTiles(const boost::property_tree::ptree& pt,
+               const std::string& new_to_old_file,
+               const std::string& old_to_new_file,
+               const std::vector<TileRange>& ranges,
+               const unsigned int concurrency) {
+  std::atomic<size_t> next(0);
+  std::vector<std::promise<void>> results(concurrency);
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < concurrency; ++i) {
+    threads.emplace_back([&, i]() {
+      try {
+        GraphReader reader(pt.get_child("mjolnir"));
+        sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
+        sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
+        for (size_t r = next++; r < ranges.size(); r = next++) {
+          FormTileInNewLevel(reader, new_to_old, old_to_new, ranges[r]);
+        }
+        results[i].set_value();
+      } catch (...) { results[i].set_exception(std::current_exception()); }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // If something bad went down this will rethrow it
+  for (auto& result : results) {
+    result.get_future().get();
   }
 }
 
+// Form tiles in the new level.
+void FormTilesInNewLevel(const boost::property_tree::ptree& pt,
+                         const std::string& new_to_old_file,
+                         const std::string& old_to_new_file,
+                         const unsigned int concurrency) {
+  // Find the range of new nodes of each new tile. They have been sorted by level so that
+  // highway level is first.
+  std::vector<TileRange> ranges;
+  {
+    sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
+    size_t n = 0;
+    for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); new_node++, ++n) {
+      GraphId tile_id = (*new_node).first.Tile_Base();
+      if (ranges.empty() || ranges.back().tile_id != tile_id) {
+        ranges.push_back({tile_id, n, n});
+      }
+      ranges.back().end = n + 1;
+    }
+  }
+
+  // The new local tiles replace the base tiles that all the other levels are formed from, so form
+  // those last once nothing reads the base tiles anymore
+  auto local_level = TileHierarchy::levels().back().level;
+  auto local = std::find_if(ranges.begin(), ranges.end(), [local_level](const TileRange& range) {
+    return range.tile_id.level() >= local_level;
+  });
+  FormTiles(pt, new_to_old_file, old_to_new_file, std::vector<TileRange>(ranges.begin(), local),
+            concurrency);
+  FormTiles(pt, new_to_old_file, old_to_new_file, std::vector<TileRange>(local, ranges.end()),
+            concurrency);
+}
+
+/**
+ * Find the levels the nodes of a base tile exist on. The associated new nodes are only set to the
+ * tile they will be in, they get their ids afterwards when all the tiles are numbered in order.
+ * @param  reader        graph reader
+ * @param  base_tile_id  the base tile
+ * @return the association of each node of the tile, empty if there is no tile
+ */
+std::vector<OldToNewNodes> FindNodeLevels(GraphReader& reader, const GraphId& base_tile_id) {
+  // Get the graph tile. Skip if no tile exists or no nodes exist in the tile.
+  std::vector<OldToNewNodes> assocs;
+  graph_tile_ptr tile = reader.GetGraphTile(base_tile_id);
+  if (!tile) {
+    return assocs;
+  }
+
+  // Hierarchy level information
+  const auto& arterial_level = TileHierarchy::levels()[1];
+  uint32_t al = static_cast<uint32_t>(arterial_level.level);
+  const auto& highway_level = TileHierarchy::levels()[0];
+  uint32_t hl = static_cast<uint32_t>(highway_level.level);
+
+  // Iterate through the nodes. Add nodes to the new level when
+  // best road class <= the new level classification cutoff
+  bool levels[3];
+  uint32_t nodecount = tile->header()->nodecount();
+  assocs.reserve(nodecount);
+  GraphId basenode = base_tile_id;
+  GraphId edgeid = base_tile_id;
+  PointLL base_ll = tile->header()->base_ll();
+  const NodeInfo* nodeinfo = tile->node(basenode);
+  for (uint32_t i = 0; i < nodecount; i++, nodeinfo++, ++basenode) {
+    // Iterate through the edges to see which levels this node exists.
+    levels[0] = levels[1] = levels[2] = false;
+    for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
+      // Update the flag for the level of this edge (skip transit
+      // connection edges)
+      const DirectedEdge* directededge = tile->directededge(edgeid);
+      if (directededge->bss_connection()) {
+        // Despite the road class, Bike Share Stations' connections are always at local level
+        levels[2] = true;
+      } else if (directededge->use() != Use::kTransitConnection &&
+                 directededge->use() != Use::kEgressConnection &&
+                 directededge->use() != Use::kPlatformConnection) {
+        levels[TileHierarchy::get_level(directededge->classification())] = true;
+      }
+    }
+
+    // Tiles of the new nodes on each level the node is on
+    GraphId highway_tile, arterial_tile, local_tile;
+    if (levels[0]) {
+      highway_tile = GraphId(highway_level.tiles.TileId(nodeinfo->latlng(base_ll)), hl, 0);
+    }
+    if (levels[1]) {
+      arterial_tile = GraphId(arterial_level.tiles.TileId(nodeinfo->latlng(base_ll)), al, 0);
+    }
+    if (levels[2]) {
+      local_tile = base_tile_id;
+    }
+
+    if (!levels[0] && !levels[1] && !levels[2]) {
+      LOG_ERROR("No valid level for this node!");
+    }
+    assocs.emplace_back(basenode, highway_tile, arterial_tile, local_tile, nodeinfo->density());
+  }
+
+  // Check if we need to clear the tile cache
+  if (reader.OverCommitted()) {
+    reader.Trim();
+  }
+  return assocs;
+}
+
 /**
  * Create node associations between "new" nodes placed into respective
  * hierarchy levels and the existing nodes on the base/local level. The
  * associations go both ways: from the "old" nodes on the base/local level
  * to new nodes (using a mapping in memory) and from new nodes to old nodes
- * using a sequence (file).
+ * using a sequence (file). The levels of the nodes are found for batches of
+ * tiles in parallel, the new nodes are numbered in tile order afterwards so
+ * the associations do not depend on the number of threads.
  */
-void CreateNodeAssociations(GraphReader& reader,
+void CreateNodeAssociations(const boost::property_tree::ptree& pt,
                             const std::string& new_to_old_file,
-                            const std::string& old_to_new_file) {
+                            const std::string& old_to_new_file,
+                            const unsigned int concurrency) {
   // Map of tiles vs. count of nodes. Used to construct new node Ids.
   std::unordered_map<GraphId, uint32_t> new_nodes;
 
@@ -406,79 +553,62 @@ void CreateNodeAssociations(GraphReader& reader,
   // Create a sequence to associate new nodes to old nodes
   sequence<OldToNewNodes> old_to_new(old_to_new_file, true);
 
-  // Hierarchy level information
-  const auto& arterial_level = TileHierarchy::levels()[1];
-  uint32_t al = static_cast<uint32_t>(arterial_level.level);
-  const auto& highway_level = TileHierarchy::levels()[0];
-  uint32_t hl = static_cast<uint32_t>(highway_level.level);
-
-  // Iterate through all tiles in the local level
-  auto local_tiles = reader.GetTileSet();
-  for (const auto& base_tile_id : local_tiles) {
-    // Get the graph tile. Skip if no tile exists or no nodes exist in the tile.
-    graph_tile_ptr tile = reader.GetGraphTile(base_tile_id);
-    if (!tile) {
-      continue;
+  // All tiles in the local level, a reader for each thread
+  std::vector<std::unique_ptr<GraphReader>> readers;
+  for (unsigned int i = 0; i < concurrency; ++i) {
+    readers.emplace_back(new GraphReader(pt.get_child("mjolnir")));
+  }
+  auto tile_set = readers.front()->GetTileSet();
+  std::vector<GraphId> local_tiles(tile_set.begin(), tile_set.end());
+
+  // Iterate through batches of tiles, small enough to keep the associations of all their nodes
+  const size_t batch_size = concurrency * 64;
+  std::vector<std::vector<OldToNewNodes>> batch;
+  for (size_t first = 0; first < local_tiles.size(); first += batch_size) {
+    batch.assign(std::min(batch_size, local_tiles.size() - first), {});
+    std::atomic<size_t> next(0);
+    std::vector<std::promise<void>> results(concurrency);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < concurrency; ++i) {
+      threads.emplace_back([&, i]() {
+        try {
+          for (size_t t = next++; t < batch.size(); t = next++) {
+            batch[t] = FindNodeLevels(*readers[i], local_tiles[first + t]);
+          }
+          results[i].set_value();
+        } catch (...) { results[i].set_exception(std::current_exception()); }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (auto& result : results) {
+      result.get_future().get();
     }
 
-    // Iterate through the nodes. Add nodes to the new level when
-    // best road class <= the new level classification cutoff
-    bool levels[3];
-    uint32_t nodecount = tile->header()->nodecount();
-    GraphId basenode = base_tile_id;
-    GraphId edgeid = base_tile_id;
-    PointLL base_ll = tile->header()->base_ll();
-    const NodeInfo* nodeinfo = tile->node(basenode);
-    for (uint32_t i = 0; i < nodecount; i++, nodeinfo++, ++basenode) {
-      // Iterate through the edges to see which levels this node exists.
-      levels[0] = levels[1] = levels[2] = false;
-      for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
-        // Update the flag for the level of this edge (skip transit
-        // connection edges)
-        const DirectedEdge* directededge = tile->directededge(edgeid);
-        if (directededge->bss_connection()) {
-          // Despite the road class, Bike Share Stations' connections are always at local level
-          levels[2] = true;
-        } else if (directededge->use() != Use::kTransitConnection &&
-                   directededge->use() != Use::kEgressConnection &&
-                   directededge->use() != Use::kPlatformConnection) {
-          levels[TileHierarchy::get_level(directededge->classification())] = true;
+    // Associate new nodes to base nodes and base node to new nodes
+    for (auto& assocs : batch) {
+      for (auto& assoc : assocs) {
+        if (assoc.highway_node.Is_Valid()) {
+          // New node is on the highway level. Associate back to base/local node
+          assoc.highway_node = get_new_node(assoc.highway_node);
+          new_to_old.push_back(std::make_pair(assoc.highway_node, assoc.node_id));
+        }
+        if (assoc.arterial_node.Is_Valid()) {
+          // New node is on the arterial level. Associate back to base/local node
+          assoc.arterial_node = get_new_node(assoc.arterial_node);
+          new_to_old.push_back(std::make_pair(assoc.arterial_node, assoc.node_id));
+        }
+        if (assoc.local_node.Is_Valid()) {
+          // New node is on the local level. Associate back to base/local node
+          assoc.local_node = get_new_node(assoc.local_node);
+          new_to_old.push_back(std::make_pair(assoc.local_node, assoc.node_id));
         }
-      }
-
-      // Associate new nodes to base nodes and base node to new nodes
-      GraphId highway_node, arterial_node, local_node;
-      if (levels[0]) {
-        // New node is on the highway level. Associate back to base/local node
-        GraphId new_tile(highway_level.tiles.TileId(nodeinfo->latlng(base_ll)), hl, 0);
-        highway_node = get_new_node(new_tile);
-        new_to_old.push_back(std::make_pair(highway_node, basenode));
-      }
-      if (levels[1]) {
-        // New node is on the arterial level. Associate back to base/local node
-        GraphId new_tile(arterial_level.tiles.TileId(nodeinfo->latlng(base_ll)), al, 0);
-        arterial_node = get_new_node(new_tile);
-        new_to_old.push_back(std::make_pair(arterial_node, basenode));
-      }
-      if (levels[2]) {
-        // New node is on the local level. Associate back to base/local node
-        local_node = get_new_node(base_tile_id);
-        new_to_old.push_back(std::make_pair(local_node, basenode));
-      }
 
-      if (!levels[0] && !levels[1] && !levels[2]) {
-        LOG_ERROR("No valid level for this node!");
+        // Associate the old node to the new node(s). Entries in the tuple
+        // that are invalid nodes indicate no node exists in the new level.
+        old_to_new.push_back(assoc);
       }
-
-      // Associate the old node to the new node(s). Entries in the tuple
-      // that are invalid nodes indicate no node exists in the new level.
-      OldToNewNodes assoc(basenode, highway_node, arterial_node, local_node, nodeinfo->density());
-      old_to_new.push_back(assoc);
-    }
-
-    // Check if we need to clear the tile cache
-    if (reader.OverCommitted()) {
-      reader.Trim();
     }
   }
 }
@@ -578,23 +708,23 @@ namespace mjolnir {
 void HierarchyBuilder::Build(const boost::property_tree::ptree& pt,
                              const std::string& new_to_old_file,
                              const std::string& old_to_new_file) {
-
-  // TODO: thread this. Might be more possible now that we don't create
-  // shortcuts in the HierarchyBuilder
-
   // Construct GraphReader
   LOG_INFO("HierarchyBuilder");
   GraphReader reader(pt.get_child("mjolnir"));
+  unsigned int threads =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
 
   // Association of old nodes to new nodes
-  CreateNodeAssociations(reader, new_to_old_file, old_to_new_file);
+  CreateNodeAssociations(pt, new_to_old_file, old_to_new_file, threads);
 
   // Sort the sequences
-  SortSequences(new_to_old_file, old_to_new_file);
+  SortSequences(new_to_old_file, old_to_new_file,
+                pt.get<size_t>("mjolnir.sort_buffer_size", 1024 * 1024 * 512), threads);
 
   // Iterate through the hierarchy (from highway down to local) and build
   // new tiles
-  FormTilesInNewLevel(reader, new_to_old_file, old_to_new_file);
+  FormTilesInNewLevel(pt, new_to_old_file, old_to_new_file, threads);
 
   // Remove any base tiles that no longer have any data (nodes and edges
   // only exist on arterial and highway levels)
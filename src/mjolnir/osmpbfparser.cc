@@ -33,6 +33,10 @@
 #else
 #include <netinet/in.h>
 #endif
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <zlib.h>
@@ -81,9 +85,7 @@ BlobHeader read_header(char* buffer, std::ifstream& file, bool& finished) {
   return result;
 }
 
-int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const BlobHeader& header) {
-  Blob blob;
-
+int32_t read_blob_bytes(char* buffer, std::ifstream& file, const BlobHeader& header) {
   // is the size of the following blob sane
   int32_t sz = header.datasize();
   if (sz > MAX_UNCOMPRESSED_BLOB_SIZE) {
@@ -94,24 +96,42 @@ int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const
   if (!file.read(buffer, sz)) {
     throw std::runtime_error("unable to read blob from file");
   }
+  return sz;
+}
 
+Blob parse_blob(const char* buffer, int32_t sz) {
   // turn it into a protobuf object
+  Blob blob;
   if (!blob.ParseFromArray(buffer, sz)) {
     throw std::runtime_error("unable to parse blob");
   }
 
+  // make sure whatever we unpack will fit
+  if (blob.raw_size() > MAX_UNCOMPRESSED_BLOB_SIZE ||
+      (blob.has_raw() && blob.raw().size() > MAX_UNCOMPRESSED_BLOB_SIZE)) {
+    throw std::runtime_error("uncompressed blob-size is bigger than allowed");
+  }
+  return blob;
+}
+
+// how many bytes the caller must have available to unpack this blob
+int32_t unpacked_size(const Blob& blob) {
+  return blob.has_raw() ? blob.raw().size() : blob.raw_size();
+}
+
+int32_t unpack_blob(const Blob& blob, char* unpack_buffer) {
   // if the blob was uncompressed
   if (blob.has_raw()) {
     // check that raw_size is set correctly and move it to the final buffer
-    sz = blob.raw().size();
+    int32_t sz = blob.raw().size();
     if (sz != blob.raw_size()) {
       LOG_WARN("blob reports wrong raw_size: " + std::to_string(blob.raw_size()) + " bytes");
     }
-    memcpy(unpack_buffer, buffer, sz);
+    memcpy(unpack_buffer, blob.raw().data(), sz);
     return sz;
   } // if the blob was zlib compressed
   else if (blob.has_zlib_data()) {
-    sz = blob.zlib_data().size();
+    int32_t sz = blob.zlib_data().size();
     z_stream z;
     z.next_in = (unsigned char*)blob.zlib_data().c_str();
     z.avail_in = sz;
@@ -139,6 +159,11 @@ int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const
   throw std::runtime_error("Unsupported blob data format");
 }
 
+int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const BlobHeader& header) {
+  int32_t sz = read_blob_bytes(buffer, file, header);
+  return unpack_blob(parse_blob(buffer, sz), unpack_buffer);
+}
+
 template <class T> OSMPBF::Tags get_tags(const T& object, const OSMPBF::PrimitiveBlock& primblock) {
   OSMPBF::Tags result(object.keys_size());
   for (int i = 0; i < object.keys_size(); ++i) {
@@ -272,6 +297,103 @@ void parse_header_block(char* unpack_buffer, int32_t sz) {
   // TODO: do something with replication information?
 }
 
+// Records the callbacks fired while decoding a primitive block so they can be replayed later, in
+// file order, against the real callback. This lets the expensive part (inflating and decoding the
+// protobuf) happen on any thread while the consumer still sees exactly the serial sequence of calls
+class block_recorder : public Callback {
+public:
+  virtual void
+  node_callback(const uint64_t osmid, const double lng, const double lat, const Tags& tags) override {
+    events_.push_back(kNode);
+    nodes_.push_back({osmid, lng, lat, tags});
+  }
+  virtual void
+  way_callback(const uint64_t osmid, const Tags& tags, const std::vector<uint64_t>& nodes) override {
+    events_.push_back(kWay);
+    ways_.push_back({osmid, tags, nodes});
+  }
+  virtual void relation_callback(const uint64_t osmid,
+                                 const Tags& tags,
+                                 const std::vector<Member>& members) override {
+    events_.push_back(kRelation);
+    relations_.emplace_back();
+    auto& relation = relations_.back();
+    relation.osmid = osmid;
+    relation.tags = tags;
+    relation.members.reserve(members.size());
+    for (const auto& member : members) {
+      relation.members.emplace_back(member.member_type, member.member_id, member.role);
+    }
+  }
+  virtual void changeset_callback(const uint64_t changeset_id) override {
+    events_.push_back(kChangeset);
+    changesets_.push_back(changeset_id);
+  }
+
+  // hand everything we recorded to the real callback in the order it was decoded
+  void replay(Callback& callback) const {
+    size_t n = 0, w = 0, r = 0, c = 0;
+    for (const auto event : events_) {
+      switch (event) {
+        case kNode: {
+          const auto& node = nodes_[n++];
+          callback.node_callback(node.osmid, node.lng, node.lat, node.tags);
+          break;
+        }
+        case kWay: {
+          const auto& way = ways_[w++];
+          callback.way_callback(way.osmid, way.tags, way.nodes);
+          break;
+        }
+        case kRelation: {
+          const auto& relation = relations_[r++];
+          callback.relation_callback(relation.osmid, relation.tags, relation.members);
+          break;
+        }
+        case kChangeset:
+          callback.changeset_callback(changesets_[c++]);
+          break;
+      }
+    }
+  }
+
+private:
+  enum event_t : uint8_t { kNode, kWay, kRelation, kChangeset };
+  struct node_t {
+    uint64_t osmid;
+    double lng;
+    double lat;
+    Tags tags;
+  };
+  struct way_t {
+    uint64_t osmid;
+    Tags tags;
+    std::vector<uint64_t> nodes;
+  };
+  struct relation_t {
+    uint64_t osmid;
+    Tags tags;
+    std::vector<Member> members;
+  };
+
+  std::vector<event_t> events_;
+  std::vector<node_t> nodes_;
+  std::vector<way_t> ways_;
+  std::vector<relation_t> relations_;
+  std::vector<uint64_t> changesets_;
+};
+
+// inflate and decode a single raw OSMData blob, recording what the callback would have seen
+std::unique_ptr<block_recorder> decode_block(const std::vector<char>& bytes,
+                                             const Interest interest) {
+  auto blob = parse_blob(bytes.data(), static_cast<int32_t>(bytes.size()));
+  std::unique_ptr<char[]> unpack_buffer(new char[std::max(unpacked_size(blob), 1)]);
+  int32_t sz = unpack_blob(blob, unpack_buffer.get());
+  std::unique_ptr<block_recorder> recorder(new block_recorder());
+  parse_primitive_block(unpack_buffer.get(), sz, interest, *recorder);
+  return recorder;
+}
+
 } // namespace
 
 // extend the protobuf osmpbf namespace
@@ -285,7 +407,15 @@ Member::Member(Member&& other)
     : member_type(other.member_type), member_id(other.member_id), role(std::move(other.role)) {
 }
 
-void Parser::parse(std::ifstream& file, const Interest interest, Callback& callback) {
+void Parser::parse(std::ifstream& file,
+                   const Interest interest,
+                   Callback& callback,
+                   const unsigned int threads) {
+  if (threads > 1) {
+    parse_parallel(file, interest, callback, threads);
+    return;
+  }
+
   char* buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
   char* unpack_buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
 
@@ -319,6 +449,69 @@ void Parser::parse(std::ifstream& file, const Interest interest, Callback& callb
   delete[] unpack_buffer;
 }
 
+void Parser::parse_parallel(std::ifstream& file,
+                            const Interest interest,
+                            Callback& callback,
+                            const unsigned int threads) {
+  std::unique_ptr<char[]> buffer(new char[MAX_BLOB_HEADER_SIZE]);
+
+  // blocks being decoded, oldest first. we keep a couple per thread in flight so that the workers
+  // stay busy while the consumer is replaying, but bound it so memory use doesnt run away
+  std::deque<std::future<std::unique_ptr<block_recorder>>> pending;
+  const size_t max_pending = threads * 2;
+  auto consume_oldest = [&pending, &callback]() {
+    auto recorder = pending.front().get();
+    pending.pop_front();
+    recorder->replay(callback);
+  };
+
+  // start from the top
+  file.clear();
+  file.seekg(0, std::ios::beg);
+
+  // while there is more to read
+  while (!file.eof()) {
+    // grab the blob header
+    bool finished = false;
+    BlobHeader header = read_header(buffer.get(), file, finished);
+    if (finished) {
+      break;
+    }
+
+    // grab the raw bytes of the blob, the workers will take it from there
+    if (header.datasize() > MAX_UNCOMPRESSED_BLOB_SIZE) {
+      throw std::runtime_error("blob-size is bigger than allowed");
+    }
+    std::vector<char> bytes(header.datasize());
+    read_blob_bytes(bytes.data(), file, header);
+
+    // if its data decode it in the background
+    if (header.type() == "OSMData") {
+      pending.emplace_back(std::async(std::launch::async,
+                                      [interest](const std::vector<char>& bytes) {
+                                        return decode_block(bytes, interest);
+                                      },
+                                      std::move(bytes)));
+      // replay finished blocks in file order so the callback sees the same sequence as serially
+      while (pending.size() >= max_pending) {
+        consume_oldest();
+      }
+    } // headers are tiny, just do them inline
+    else if (header.type() == "OSMHeader") {
+      auto blob = parse_blob(bytes.data(), static_cast<int32_t>(bytes.size()));
+      std::unique_ptr<char[]> unpack_buffer(new char[std::max(unpacked_size(blob), 1)]);
+      parse_header_block(unpack_buffer.get(), unpack_blob(blob, unpack_buffer.get()));
+    } else {
+      LOG_WARN("Unknown blob type: " + header.type());
+    }
+  }
+
+  // drain whatever is left
+  while (!pending.empty()) {
+    consume_oldest();
+  }
+}
+
 void Parser::free() {
   google::protobuf::ShutdownProtobufLibrary();
 }
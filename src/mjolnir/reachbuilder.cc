@@ -0,0 +1,146 @@
+#include "mjolnir/reachbuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/reachtable.h"
+#include "baldr/tilehierarchy.h"
+#include "loki/reach.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// The costings loki correlates most locations with
+const valhalla::Costing kReachCostings[] = {valhalla::Costing::auto_, valhalla::Costing::bicycle,
+                                            valhalla::Costing::pedestrian};
+
+using tiles_t = std::vector<std::pair<GraphId, uint32_t>>;
+
+/**
+ * Compute the reach of the edges of the tiles handed out by the shared counter.
+ * @param pt         the valhalla config
+ * @param options    options of the costing to compute the reach for
+ * @param max_reach  the reach to stop searching at
+ * @param tiles      the tiles and their edge counts
+ * @param offsets    the first reach of each tile
+ * @param next       counter of the next tile to compute
+ * @param reaches    the reach of every edge, tile by tile
+ */
+void compute_reach(const boost::property_tree::ptree& pt,
+                   const valhalla::Options& options,
+                   const uint32_t max_reach,
+                   const tiles_t& tiles,
+                   const std::vector<size_t>& offsets,
+                   std::atomic<size_t>& next,
+                   std::vector<EdgeReach>& reaches) {
+  GraphReader reader(pt.get_child("mjolnir"));
+  auto costing = CostFactory().Create(options);
+  valhalla::loki::Reach reach_finder;
+  for (size_t i = next++; i < tiles.size(); i = next++) {
+    auto tile = reader.GetGraphTile(tiles[i].first);
+    GraphId edgeid = tiles[i].first;
+    for (uint32_t e = 0; e < tiles[i].second; ++e, ++edgeid) {
+      // loki never considers the edges the costing does not allow so neither do we
+      const auto* edge = tile->directededge(e);
+      if (!costing->Allowed(edge, tile, kDisallowShortcut)) {
+        reaches[offsets[i] + e] = {0, 0};
+        continue;
+      }
+      auto reach = reach_finder(edge, edgeid, max_reach, reader, costing);
+      reaches[offsets[i] + e] = {static_cast<uint8_t>(reach.outbound),
+                                 static_cast<uint8_t>(reach.inbound)};
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void ReachBuilder::Build(const boost::property_tree::ptree& pt) {
+  auto max_reach = std::min(pt.get<uint32_t>("service_limits.max_reachability", 100),
+                            kMaxStoredReach);
+  LOG_INFO("Building reach tables up to " + std::to_string(max_reach));
+
+  // Lay out the edges of all the levels, tile by tile
+  tiles_t tiles;
+  {
+    GraphReader reader(pt.get_child("mjolnir"));
+    for (const auto& level : TileHierarchy::levels()) {
+      for (const auto& tile_id : reader.GetTileSet(level.level)) {
+        auto tile = reader.GetGraphTile(tile_id);
+        tiles.emplace_back(tile_id, tile->header()->directededgecount());
+      }
+    }
+  }
+  std::sort(tiles.begin(), tiles.end(),
+            [](const std::pair<GraphId, uint32_t>& a, const std::pair<GraphId, uint32_t>& b) {
+              return a.first.tile_value() < b.first.tile_value();
+            });
+  std::vector<size_t> offsets;
+  offsets.reserve(tiles.size());
+  size_t edge_count = 0;
+  for (const auto& tile : tiles) {
+    offsets.push_back(edge_count);
+    edge_count += tile.second;
+  }
+
+  auto concurrency = std::max(static_cast<unsigned int>(1),
+                              pt.get<unsigned int>("mjolnir.concurrency",
+                                                   std::thread::hardware_concurrency()));
+  auto tile_dir = pt.get<std::string>("mjolnir.tile_dir");
+  for (const auto costing : kReachCostings) {
+    // The tables are only valid for requests that use the default costing options
+    const auto& costing_str = Costing_Enum_Name(costing);
+    rapidjson::Document doc;
+    doc.SetObject();
+    Options options;
+    options.set_costing(costing);
+    ParseCostingOptions(doc, "/costing_options", options);
+
+    // Each thread takes the next tile until there are none left, the tiles are big enough that
+    // handing them out one at a time costs nothing
+    std::vector<EdgeReach> reaches(edge_count);
+    std::atomic<size_t> next(0);
+    std::vector<std::exception_ptr> errors(concurrency);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < concurrency; ++i) {
+      threads.emplace_back([&, i]() {
+        try {
+          compute_reach(pt, options, max_reach, tiles, offsets, next, reaches);
+        } catch (...) { errors[i] = std::current_exception(); }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (const auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+
+    ReachTable::Write(tile_dir, costing_str, max_reach, tiles, reaches);
+    LOG_INFO("Wrote " + costing_str + " reach of " + std::to_string(edge_count) + " edges");
+  }
+}
+
+} // namespace mjolnir
+} // namespace valhalla
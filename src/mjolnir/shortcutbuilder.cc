@@ -3,12 +3,16 @@
 
 #include <boost/format.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <algorithm>
+#include <atomic>
+#include <future>
 #include <iostream>
 #include <map>
 #include <ostream>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -17,6 +21,7 @@
 #include "baldr/graphreader.h"
 #include "baldr/graphtile.h"
 #include "baldr/tilehierarchy.h"
+#include "filesystem.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
@@ -575,26 +580,30 @@ uint32_t AddShortcutEdges(GraphReader& reader,
   return shortcut_count;
 }
 
-// Form shortcuts for tiles in this level.
-uint32_t FormShortcuts(GraphReader& reader, const TileLevel& level) {
-  // Iterate through the tiles at this level (TODO - can we mark the tiles
-  // the tiles that shortcuts end within?)
-  reader.Clear();
+// Form shortcuts for the tiles of a level handed out by the shared counter. The new tiles are
+// written to the staging directory rather than over the tiles they replace, shortcuts cross tile
+// boundaries so every thread must only ever read the original tiles of the level
+uint32_t FormShortcuts(GraphReader& reader,
+                       const std::vector<GraphId>& tiles,
+                       const std::string& staging_dir,
+                       std::atomic<size_t>& next) {
   bool added = false;
   uint32_t shortcut_count = 0;
-  uint32_t ntiles = level.tiles.TileCount();
-  uint32_t tile_level = (uint32_t)level.level;
   graph_tile_ptr tile;
-  for (uint32_t tileid = 0; tileid < ntiles; tileid++) {
-    // Get the graph tile. Skip if no tile exists (common case)
-    tile = reader.GetGraphTile(GraphId(tileid, tile_level, 0));
+  for (size_t t = next++; t < tiles.size(); t = next++) {
+    // Get the graph tile. Skip if the tile is unreadable
+    uint32_t tileid = tiles[t].tileid();
+    uint32_t tile_level = tiles[t].level();
+    tile = reader.GetGraphTile(tiles[t]);
     if (!tile) {
       continue;
     }
 
-    // Create GraphTileBuilder for the new tile
+    // Create GraphTileBuilder for the new tile in the staging directory, there is no tile there
+    // yet so copy the header of the tile it replaces
     GraphId new_tile(tileid, tile_level, 0);
-    GraphTileBuilder tilebuilder(reader.tile_dir(), new_tile, false);
+    GraphTileBuilder tilebuilder(staging_dir, new_tile, false);
+    tilebuilder.header_builder() = *tile->header();
 
     // Since the old tile is not serialized we must copy any data that is not
     // dependent on edge Id into the new builders (e.g., node transitions)
@@ -736,20 +745,64 @@ namespace mjolnir {
 // only connect to 2 edges on the hierarchy level, and have compatible
 // attributes. Shortcut edges are inserted before regular edges.
 void ShortcutBuilder::Build(const boost::property_tree::ptree& pt) {
-
-  // TODO: thread this. would need to make sure we dont make shortcuts
-  // across tile boundaries so that we are only messing with one tile
-  // in one thread at a time
-
   // Get GraphReader
   GraphReader reader(pt.get_child("mjolnir"));
+  auto concurrency = std::max(static_cast<unsigned int>(1),
+                              pt.get<unsigned int>("mjolnir.concurrency",
+                                                   std::thread::hardware_concurrency()));
 
   auto tile_level = TileHierarchy::levels().rbegin();
   tile_level++;
   for (; tile_level != TileHierarchy::levels().rend(); ++tile_level) {
     // Create shortcuts on this level
-    LOG_INFO("Creating shortcuts on level " + std::to_string(tile_level->level));
-    uint32_t count = FormShortcuts(reader, *tile_level);
+    LOG_INFO("Creating shortcuts on level " + std::to_string(tile_level->level) + " with " +
+             std::to_string(concurrency) + " threads");
+    auto tile_set = reader.GetTileSet(tile_level->level);
+    std::vector<GraphId> tiles(tile_set.begin(), tile_set.end());
+    std::sort(tiles.begin(), tiles.end());
+
+    // Each thread takes the next tile until there are none left and writes its new tile to the
+    // staging directory, so the output does not depend on which thread did which tile
+    std::string staging_dir = reader.tile_dir() + filesystem::path::preferred_separator +
+                              "shortcuts_" + std::to_string(tile_level->level) + ".tmp";
+    if (filesystem::exists(staging_dir)) {
+      filesystem::remove_all(staging_dir);
+    }
+    std::atomic<size_t> next(0);
+    std::vector<std::promise<uint32_t>> results(concurrency);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < concurrency; ++i) {
+      threads.emplace_back([&, i]() {
+        try {
+          GraphReader thread_reader(pt.get_child("mjolnir"));
+          results[i].set_value(FormShortcuts(thread_reader, tiles, staging_dir, next));
+        } catch (...) { results[i].set_exception(std::current_exception()); }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    // If something bad went down this will rethrow it
+    uint32_t count = 0;
+    for (auto& result : results) {
+      count += result.get_future().get();
+    }
+
+    // Now that nothing reads the original tiles anymore replace them with the new ones
+    for (const auto& tile_id : tiles) {
+      auto suffix = GraphTile::FileSuffix(tile_id);
+      auto staged = staging_dir + filesystem::path::preferred_separator + suffix;
+      if (filesystem::exists(staged) &&
+          !filesystem::rename(staged,
+                              reader.tile_dir() + filesystem::path::preferred_separator + suffix)) {
+        throw std::runtime_error("Failed to replace tile with its shortcuts: " + suffix);
+      }
+    }
+    if (filesystem::exists(staging_dir)) {
+      filesystem::remove_all(staging_dir);
+    }
+    reader.Clear();
     LOG_INFO("Finished with " + std::to_string(count) + " shortcuts");
   }
 }
@@ -7,6 +7,7 @@
 #include "midgard/point2.h"
 #include "midgard/polyline2.h"
 #include "mjolnir/bssbuilder.h"
+#include "mjolnir/contractionbuilder.h"
 #include "mjolnir/elevationbuilder.h"
 #include "mjolnir/graphbuilder.h"
 #include "mjolnir/graphenhancer.h"
@@ -15,6 +16,7 @@
 #include "mjolnir/hierarchybuilder.h"
 #include "mjolnir/osmpbfparser.h"
 #include "mjolnir/pbfgraphparser.h"
+#include "mjolnir/reachbuilder.h"
 #include "mjolnir/restrictionbuilder.h"
 #include "mjolnir/shortcutbuilder.h"
 #include "mjolnir/transitbuilder.h"
@@ -381,6 +383,26 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     GraphValidator::Validate(config);
   }
 
+  // Build the reach tables if specified in the config file. Like the contraction hierarchy they are
+  // built from the validated tiles
+  if (config.get<bool>("mjolnir.reach", false)) {
+    if (start_stage <= BuildStage::kReach && BuildStage::kReach <= end_stage) {
+      ReachBuilder::Build(config);
+    }
+  } else {
+    LOG_INFO("Skipping reach builder");
+  }
+
+  // Build the contraction hierarchy overlay if specified in the config file. It is built from the
+  // validated tiles so it has to run after everything that changes them.
+  if (config.get<bool>("mjolnir.contraction", false)) {
+    if (start_stage <= BuildStage::kContract && BuildStage::kContract <= end_stage) {
+      ContractionBuilder::Build(config);
+    }
+  } else {
+    LOG_INFO("Skipping contraction builder");
+  }
+
   // Cleanup bin files
   if (start_stage <= BuildStage::kCleanup && BuildStage::kCleanup <= end_stage) {
     LOG_INFO("Cleaning up temporary *.bin files within " + tile_dir);
@@ -114,6 +114,7 @@ bool Options_Action_Enum_Parse(const std::string& action, Options::Action* a) {
       {"expansion", Options::expansion},
       {"centroid", Options::centroid},
       {"status", Options::status},
+      {"metrics", Options::metrics},
   };
   auto i = actions.find(action);
   if (i == actions.cend())
@@ -137,6 +138,7 @@ const std::string& Options_Action_Enum_Name(const Options::Action action) {
       {Options::expansion, "expansion"},
       {Options::centroid, "centroid"},
       {Options::status, "status"},
+      {Options::metrics, "metrics"},
   };
   auto i = actions.find(action);
   return i == actions.cend() ? empty : i->second;
@@ -128,7 +128,7 @@ const BaseCostingOptionsConfig kBaseCostOptsConfig = GetBaseCostOptsConfig();
  * can result in slightly longer routes that avoid shortcuts on residential
  * roads.
  */
-class AutoCost : public DynamicCost {
+class AutoCost : public DynamicCostKernel<AutoCost> {
 public:
   /**
    * Construct auto costing. Pass in cost type and costing_options using protocol buffer(pbf).
@@ -321,7 +321,7 @@ public:
 
 // Constructor
 AutoCost::AutoCost(const CostingOptions& costing_options, uint32_t access_mask)
-    : DynamicCost(costing_options, TravelMode::kDrive, access_mask, true),
+    : DynamicCostKernel(costing_options, TravelMode::kDrive, access_mask, true),
       trans_density_factor_{1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.1f, 1.2f, 1.3f,
                             1.4f, 1.6f, 1.9f, 2.2f, 2.5f, 2.8f, 3.1f, 3.5f} {
 
@@ -714,14 +714,14 @@ cost_ptr_t CreateAutoCost(const CostingOptions& costing_options) {
 /**
  * Derived class providing bus costing for driving.
  */
-class BusCost : public AutoCost {
+class BusCost : public DynamicCostKernel<BusCost, AutoCost> {
 public:
   /**
    * Construct bus costing.
    * Pass in configuration using property tree.
    * @param  pt  Property tree with configuration/options.
    */
-  BusCost(const CostingOptions& costing_options) : AutoCost(costing_options, kBusAccess) {
+  BusCost(const CostingOptions& costing_options) : DynamicCostKernel(costing_options, kBusAccess) {
     type_ = VehicleType::kBus;
   }
 
@@ -845,14 +845,14 @@ cost_ptr_t CreateBusCost(const CostingOptions& costing_options) {
  * Derived class providing an alternate costing for driving that is intended
  * to favor HOV roads.
  */
-class HOVCost : public AutoCost {
+class HOVCost : public DynamicCostKernel<HOVCost, AutoCost> {
 public:
   /**
    * Construct hov costing.
    * Pass in costing_options using protocol buffer(pbf).
    * @param  costing_options  pbf with costing_options.
    */
-  HOVCost(const CostingOptions& costing_options) : AutoCost(costing_options, kHOVAccess) {
+  HOVCost(const CostingOptions& costing_options) : DynamicCostKernel(costing_options, kHOVAccess) {
   }
 
   virtual ~HOVCost() {
@@ -1021,14 +1021,15 @@ cost_ptr_t CreateHOVCost(const CostingOptions& costing_options) {
  * Derived class providing an alternate costing for driving that is intended
  * to favor Taxi roads.
  */
-class TaxiCost : public AutoCost {
+class TaxiCost : public DynamicCostKernel<TaxiCost, AutoCost> {
 public:
   /**
    * Construct taxi costing.
    * Pass in costing_options using protocol buffer(pbf).
    * @param  costing_options  pbf with costing_options.
    */
-  TaxiCost(const CostingOptions& costing_options) : AutoCost(costing_options, kTaxiAccess) {
+  TaxiCost(const CostingOptions& costing_options)
+      : DynamicCostKernel(costing_options, kTaxiAccess) {
   }
 
   virtual ~TaxiCost() {
@@ -208,7 +208,7 @@ const BaseCostingOptionsConfig kBaseCostOptsConfig = GetBaseCostOptsConfig();
 /**
  * Derived class providing dynamic edge costing for bicycle routes.
  */
-class BicycleCost : public DynamicCost {
+class BicycleCost : public DynamicCostKernel<BicycleCost> {
 public:
   /**
    * Construct bicycle costing. Pass in cost type and costing_options using protocol buffer(pbf).
@@ -412,7 +412,7 @@ protected:
 
 // Constructor
 BicycleCost::BicycleCost(const CostingOptions& costing_options)
-    : DynamicCost(costing_options, TravelMode::kBicycle, kBicycleAccess) {
+    : DynamicCostKernel(costing_options, TravelMode::kBicycle, kBicycleAccess) {
   // Set hierarchy to allow unlimited transitions
   for (auto& h : hierarchy_limits_) {
     h.max_up_transitions = kUnlimitedTransitions;
@@ -156,7 +156,7 @@ const BaseCostingOptionsConfig kBaseCostOptsConfig = GetBaseCostOptsConfig();
 /**
  * Derived class providing dynamic edge costing for pedestrian routes.
  */
-class PedestrianCost : public DynamicCost {
+class PedestrianCost : public DynamicCostKernel<PedestrianCost> {
 public:
   /**
    * Construct pedestrian costing. Pass in cost type and costing_options using protocol buffer(pbf).
@@ -489,7 +489,7 @@ public:
 // Constructor. Parse pedestrian options from property tree. If option is
 // not present, set the default.
 PedestrianCost::PedestrianCost(const CostingOptions& costing_options)
-    : DynamicCost(costing_options, TravelMode::kPedestrian, kPedestrianAccess) {
+    : DynamicCostKernel(costing_options, TravelMode::kPedestrian, kPedestrianAccess) {
   // Set hierarchy to allow unlimited transitions
   for (auto& h : hierarchy_limits_) {
     h.max_up_transitions = kUnlimitedTransitions;
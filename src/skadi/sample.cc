@@ -1,10 +1,12 @@
 #include "skadi/sample.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <fstream>
 #include <limits>
 #include <list>
+#include <mutex>
 #include <regex>
 #include <stdexcept>
 #include <string>
@@ -75,13 +77,103 @@ uint64_t file_size(const std::string& file_name) {
   return rc == 0 ? s.st_size : -1;
 }
 
+// bilinear interpolation of the posting within the tile it falls in
+template <class coord_t> double interpolate(const int16_t* t, const coord_t& coord) {
+  auto lon = std::floor(coord.first);
+  auto lat = std::floor(coord.second);
+
+  // figure out what row and column we need from the array of data
+  // NOTE: data is arranged from upper left to bottom right, so y is flipped
+
+  // fractional pixel
+  double u = (coord.first - lon) * (HGT_DIM - 1);
+  double v = (1.0 - (coord.second - lat)) * (HGT_DIM - 1);
+
+  // integer pixel
+  size_t x = std::floor(u);
+  size_t y = std::floor(v);
+
+  // coefficients
+  double u_ratio = u - x;
+  double v_ratio = v - y;
+  double u_inv = 1 - u_ratio;
+  double v_inv = 1 - v_ratio;
+  double a_coef = u_inv * v_inv;
+  double b_coef = u_ratio * v_inv;
+  double c_coef = u_inv * v_ratio;
+  double d_coef = u_ratio * v_ratio;
+
+  // values
+  double adjust = 0;
+  auto a = flip(t[y * HGT_DIM + x]);
+  auto b = flip(t[y * HGT_DIM + x + 1]);
+  if (out_of_range(a)) {
+    a_coef = 0;
+  }
+  if (out_of_range(b)) {
+    b_coef = 0;
+  }
+
+  // first part of the bilinear interpolation
+  auto value = a * a_coef + b * b_coef;
+  adjust += a_coef + b_coef;
+  // LOG_INFO('{' + std::to_string(y * HGT_DIM + x) + ',' + std::to_string(a) + '}');
+  // LOG_INFO('{' + std::to_string(y * HGT_DIM + x + 1) + ',' + std::to_string(b) + '}');
+  // only need the second part if you aren't right on the row
+  // this also protects from a corner case where you sample past the end of the image
+  if (y < HGT_DIM - 1) {
+    auto c = flip(t[(y + 1) * HGT_DIM + x]);
+    auto d = flip(t[(y + 1) * HGT_DIM + x + 1]);
+    if (out_of_range(c)) {
+      c_coef = 0;
+    }
+    if (out_of_range(d)) {
+      d_coef = 0;
+    }
+    // LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x) + ',' + std::to_string(c) + '}');
+    // LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x + 1) + ',' + std::to_string(d) + '}');
+    value += c * c_coef + d * d_coef;
+    adjust += c_coef + d_coef;
+  }
+  // if we are missing everything then give up
+  if (adjust == 0) {
+    return NO_DATA_VALUE;
+  }
+  // if we were missing some we need to adjust by that
+  return value / adjust;
+}
+
 } // namespace
 
 namespace valhalla {
 namespace skadi {
 
-::valhalla::skadi::sample::sample(const std::string& data_source)
-    : unzipped_cache(-1, std::vector<int16_t>()), data_source(data_source) {
+struct sample::unzipped_cache_t {
+  explicit unzipped_cache_t(size_t max_size) : max_size(max_size) {
+  }
+
+  using tile_t = std::pair<uint16_t, std::shared_ptr<const std::vector<int16_t>>>;
+
+  // finds the tile and marks it as the most recently used, returns nullptr if its not cached
+  std::shared_ptr<const int16_t> get(uint16_t index) {
+    auto cached = std::find_if(tiles.begin(), tiles.end(),
+                               [index](const tile_t& t) { return t.first == index; });
+    if (cached == tiles.end()) {
+      return nullptr;
+    }
+    tiles.splice(tiles.begin(), tiles, cached);
+    return std::shared_ptr<const int16_t>(tiles.front().second, tiles.front().second->data());
+  }
+
+  std::mutex lock;
+  size_t max_size;
+  // most recently used tiles are at the front
+  std::list<tile_t> tiles;
+};
+
+::valhalla::skadi::sample::sample(const std::string& data_source, size_t cache_size)
+    : unzipped_cache(new unzipped_cache_t(std::max(cache_size, static_cast<size_t>(1)))),
+      data_source(data_source) {
   // messy but needed
   while (this->data_source.size() &&
          this->data_source.back() == filesystem::path::preferred_separator) {
@@ -113,13 +205,18 @@ namespace skadi {
   }
 }
 
-const int16_t* sample::source(uint16_t index) const {
+sample::sample(sample&&) = default;
+sample& sample::operator=(sample&&) = default;
+sample::~sample() = default;
+
+std::shared_ptr<const int16_t> sample::source(uint16_t index) const {
   // bail if its out of bounds
-  if (index >= TILE_COUNT) {
+  if (index >= mapped_cache.size()) {
     return nullptr;
   }
 
   // if we dont have anything maybe its lazy loaded
+  std::unique_lock<std::mutex> lock(unzipped_cache->lock);
   auto& mapped = mapped_cache[index];
   if (mapped.second.get() == nullptr) {
     auto f = data_source + get_hgt_file_name(index);
@@ -131,16 +228,22 @@ const int16_t* sample::source(uint16_t index) const {
     mapped.second.map(f, size, POSIX_MADV_SEQUENTIAL);
   }
 
-  // we have it raw or we dont
+  // we have it raw or we dont, the mapping lives as long as the sample so nothing owns it
   if (mapped.first == format_t::RAW) {
-    return static_cast<const int16_t*>(static_cast<const void*>(mapped.second.get()));
+    const auto* data = static_cast<const int16_t*>(static_cast<const void*>(mapped.second.get()));
+    return std::shared_ptr<const int16_t>(std::shared_ptr<const int16_t>(), data);
   }
 
   // if we have it already unzipped
-  if (unzipped_cache.first == index) {
-    return unzipped_cache.second.data();
+  if (auto cached = unzipped_cache->get(index)) {
+    return cached;
   }
 
+  // we have to unzip it, do it without holding the lock so other threads can carry on. the
+  // compressed data is never remapped so it is safe to read
+  lock.unlock();
+  auto unzipped = std::make_shared<std::vector<int16_t>>(HGT_PIXELS);
+
   // for setting where to read compressed data from
   auto src_func = [&mapped](z_stream& s) -> void {
     s.next_in = static_cast<Byte*>(static_cast<void*>(mapped.second.get()));
@@ -148,104 +251,66 @@ const int16_t* sample::source(uint16_t index) const {
   };
 
   // for setting where to write the uncompressed data to
-  auto dst_func = [this](z_stream& s) -> int {
-    unzipped_cache.second.resize(HGT_PIXELS);
-    s.next_out = static_cast<Byte*>(static_cast<void*>(unzipped_cache.second.data()));
+  auto dst_func = [&unzipped](z_stream& s) -> int {
+    s.next_out = static_cast<Byte*>(static_cast<void*>(unzipped->data()));
     s.avail_out = HGT_BYTES;
     return Z_FINISH; // we know the output will hold all the input
   };
 
-  // we have to unzip it
   if (!baldr::inflate(src_func, dst_func)) {
     LOG_WARN("Corrupt compressed elevation data");
-    unzipped_cache.first = -1;
     return nullptr;
   }
 
-  // update the simple cache
-  // TODO: LRU
-  unzipped_cache.first = index;
-  return unzipped_cache.second.data();
+  // update the cache, unless another thread beat us to it in which case we use theirs
+  lock.lock();
+  if (auto cached = unzipped_cache->get(index)) {
+    return cached;
+  }
+  auto& tiles = unzipped_cache->tiles;
+  tiles.emplace_front(index, std::move(unzipped));
+  if (tiles.size() > unzipped_cache->max_size) {
+    tiles.pop_back();
+  }
+  return std::shared_ptr<const int16_t>(tiles.front().second, tiles.front().second->data());
 }
 
 template <class coord_t> double sample::get(const coord_t& coord) const {
-  // check the cache and load
-  auto lon = std::floor(coord.first);
-  auto lat = std::floor(coord.second);
-  auto index = static_cast<uint16_t>(lat + 90) * 360 + static_cast<uint16_t>(lon + 180);
-
   // get the proper source of the data
-  const auto* t = source(index);
+  auto t = source(get_tile_index(coord));
   if (t == nullptr) {
     return NO_DATA_VALUE;
   }
-
-  // figure out what row and column we need from the array of data
-  // NOTE: data is arranged from upper left to bottom right, so y is flipped
-
-  // fractional pixel
-  double u = (coord.first - lon) * (HGT_DIM - 1);
-  double v = (1.0 - (coord.second - lat)) * (HGT_DIM - 1);
-
-  // integer pixel
-  size_t x = std::floor(u);
-  size_t y = std::floor(v);
-
-  // coefficients
-  double u_ratio = u - x;
-  double v_ratio = v - y;
-  double u_inv = 1 - u_ratio;
-  double v_inv = 1 - v_ratio;
-  double a_coef = u_inv * v_inv;
-  double b_coef = u_ratio * v_inv;
-  double c_coef = u_inv * v_ratio;
-  double d_coef = u_ratio * v_ratio;
-
-  // values
-  double adjust = 0;
-  auto a = flip(t[y * HGT_DIM + x]);
-  auto b = flip(t[y * HGT_DIM + x + 1]);
-  if (out_of_range(a)) {
-    a_coef = 0;
-  }
-  if (out_of_range(b)) {
-    b_coef = 0;
-  }
-
-  // first part of the bilinear interpolation
-  auto value = a * a_coef + b * b_coef;
-  adjust += a_coef + b_coef;
-  // LOG_INFO('{' + std::to_string(y * HGT_DIM + x) + ',' + std::to_string(a) + '}');
-  // LOG_INFO('{' + std::to_string(y * HGT_DIM + x + 1) + ',' + std::to_string(b) + '}');
-  // only need the second part if you aren't right on the row
-  // this also protects from a corner case where you sample past the end of the image
-  if (y < HGT_DIM - 1) {
-    auto c = flip(t[(y + 1) * HGT_DIM + x]);
-    auto d = flip(t[(y + 1) * HGT_DIM + x + 1]);
-    if (out_of_range(c)) {
-      c_coef = 0;
-    }
-    if (out_of_range(d)) {
-      d_coef = 0;
-    }
-    // LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x) + ',' + std::to_string(c) + '}');
-    // LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x + 1) + ',' + std::to_string(d) + '}');
-    value += c * c_coef + d * d_coef;
-    adjust += c_coef + d_coef;
-  }
-  // if we are missing everything then give up
-  if (adjust == 0) {
-    return NO_DATA_VALUE;
-  }
-  // if we were missing some we need to adjust by that
-  return value / adjust;
+  return interpolate(t.get(), coord);
 }
 
 template <class coords_t> std::vector<double> sample::get_all(const coords_t& coords) const {
-  std::vector<double> values;
-  values.reserve(coords.size());
+  // remember which tile each posting is in and where it goes in the output
+  std::vector<const typename coords_t::value_type*> postings;
+  std::vector<std::pair<uint16_t, uint32_t>> tile_postings;
+  postings.reserve(coords.size());
+  tile_postings.reserve(coords.size());
   for (const auto& coord : coords) {
-    values.emplace_back(get(coord));
+    tile_postings.emplace_back(get_tile_index(coord), postings.size());
+    postings.push_back(&coord);
+  }
+
+  // group the postings by tile so that each tile is only fetched once no matter how the
+  // postings alternate between them, then sample all the postings of the tile in one go
+  std::sort(tile_postings.begin(), tile_postings.end());
+  std::vector<double> values(postings.size(), NO_DATA_VALUE);
+  for (auto begin = tile_postings.cbegin(); begin != tile_postings.cend();) {
+    auto end = std::find_if(begin, tile_postings.cend(),
+                            [begin](const std::pair<uint16_t, uint32_t>& p) {
+                              return p.first != begin->first;
+                            });
+    auto t = source(begin->first);
+    if (t != nullptr) {
+      for (auto p = begin; p != end; ++p) {
+        values[p->second] = interpolate(t.get(), *postings[p->second]);
+      }
+    }
+    begin = end;
   }
   return values;
 }
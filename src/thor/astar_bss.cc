@@ -33,7 +33,11 @@ AStarBSSAlgorithm::AStarBSSAlgorithm(const boost::property_tree::ptree& config)
     : PathAlgorithm(), max_label_count_(std::numeric_limits<uint32_t>::max()),
       mode_(TravelMode::kDrive), travel_type_(0),
       max_reserved_labels_count_(
-          config.get<uint32_t>("max_reserved_labels_count", kInitialEdgeLabelCount)) {
+          config.get<uint32_t>("max_reserved_labels_count", kInitialEdgeLabelCount)),
+      pedestrian_edgestatus_(config.get<uint32_t>("max_reserved_edge_status_count",
+                                                  kDefaultReservedEdgeStatusCount)),
+      bicycle_edgestatus_(config.get<uint32_t>("max_reserved_edge_status_count",
+                                               kDefaultReservedEdgeStatusCount)) {
 }
 
 // Destructor
@@ -42,6 +46,9 @@ AStarBSSAlgorithm::~AStarBSSAlgorithm() {
 
 // Clear the temporary information generated during path construction.
 void AStarBSSAlgorithm::Clear() {
+  // Hand the work of the last search to the metrics
+  search_metrics_.Record(name(), edgelabels_.size());
+
   // Reduce edge labels capacity if it's more than limit
   if (edgelabels_.size() > max_reserved_labels_count_) {
     edgelabels_.resize(max_reserved_labels_count_);
@@ -324,10 +331,12 @@ AStarBSSAlgorithm::GetBestPath(valhalla::Location& origin,
     // edge (this will allow loops/around the block cases)
     if (!pred.origin() && pred.mode() == TravelMode::kPedestrian) {
       pedestrian_edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      search_metrics_.Settle();
     }
 
     if (!pred.origin() && pred.mode() == TravelMode::kBicycle) {
       bicycle_edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      search_metrics_.Settle();
     }
 
     // Check that distance is converging towards the destination. Return route
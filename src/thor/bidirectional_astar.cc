@@ -48,6 +48,10 @@ namespace thor {
 BidirectionalAStar::BidirectionalAStar(const boost::property_tree::ptree& config)
     : PathAlgorithm(), max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count",
                                                                        kInitialEdgeLabelCountBD)),
+      edgestatus_forward_(config.get<uint32_t>("max_reserved_edge_status_count",
+                                               kDefaultReservedEdgeStatusCount)),
+      edgestatus_reverse_(config.get<uint32_t>("max_reserved_edge_status_count",
+                                               kDefaultReservedEdgeStatusCount)),
       extended_search_(config.get<bool>("extended_search", false)) {
   cost_threshold_ = 0;
   iterations_threshold_ = 0;
@@ -66,6 +70,9 @@ BidirectionalAStar::~BidirectionalAStar() {
 
 // Clear the temporary information generated during path construction.
 void BidirectionalAStar::Clear() {
+  // Hand the work of the last search to the metrics
+  search_metrics_.Record(name(), edgelabels_forward_.size() + edgelabels_reverse_.size());
+
   if (edgelabels_forward_.size() > max_reserved_labels_count_) {
     // reduce edge labels capacity
     edgelabels_forward_.resize(max_reserved_labels_count_);
@@ -204,8 +211,11 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
   // Skip this edge if no access is allowed (based on costing method)
   // or if a complex restriction prevents transition onto this edge.
   // if its not time dependent set to 0 for Allowed and Restricted methods below
+  // The costing hands back the transition and edge costs along with its access check.
   const uint64_t localtime = time_info.valid ? time_info.local_time : 0;
   uint8_t restriction_idx = -1;
+  sif::Cost transition_cost, edge_cost;
+  uint8_t flow_sources;
   if (FORWARD) {
     // Why is is_dest false?
     // We have to consider next cases:
@@ -215,32 +225,24 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
     // We can set is_dest incorrectly in the second case, but it is the rare case.
     // The result path will be correct, because there are cosing.Allowed calls inside recost_forward
     // function in second time.
-    if (!costing_->Allowed(meta.edge, false, pred, tile, meta.edge_id, localtime,
-                           time_info.timezone_index, restriction_idx) ||
+    if (!costing_->AllowedEdgeCost(meta.edge, false, pred, tile, meta.edge_id, nodeinfo, localtime,
+                                   time_info.timezone_index, time_info.second_of_week,
+                                   restriction_idx, transition_cost, edge_cost, flow_sources) ||
         costing_->Restricted(meta.edge, pred, edgelabels_forward_, tile, meta.edge_id, true,
                              &edgestatus_forward_, localtime, time_info.timezone_index)) {
       return false;
     }
   } else {
-    if (!costing_->AllowedReverse(meta.edge, pred, opp_edge, t2, opp_edge_id, localtime,
-                                  time_info.timezone_index, restriction_idx) ||
+    if (!costing_->AllowedEdgeCostReverse(meta.edge, pred, opp_edge, t2, opp_edge_id, nodeinfo,
+                                          opp_pred_edge, localtime, time_info.timezone_index,
+                                          time_info.second_of_week, restriction_idx,
+                                          transition_cost, edge_cost, flow_sources) ||
         costing_->Restricted(meta.edge, pred, edgelabels_reverse_, tile, meta.edge_id, false,
                              &edgestatus_reverse_, localtime, time_info.timezone_index)) {
       return false;
     }
   }
-
-  // Get cost. Separate out transition cost.
-  sif::Cost transition_cost =
-      FORWARD ? costing_->TransitionCost(meta.edge, nodeinfo, pred)
-              : costing_->TransitionCostReverse(meta.edge->localedgeidx(), nodeinfo, opp_edge,
-                                                opp_pred_edge, pred.has_measured_speed(),
-                                                pred.internal_turn());
-  uint8_t flow_sources;
-  sif::Cost newcost =
-      pred.cost() + transition_cost +
-      (FORWARD ? costing_->EdgeCost(meta.edge, tile, time_info.second_of_week, flow_sources)
-               : costing_->EdgeCost(opp_edge, t2, time_info.second_of_week, flow_sources));
+  sif::Cost newcost = pred.cost() + transition_cost + edge_cost;
 
   // Check if edge is temporarily labeled and this path has less cost. If
   // less cost the predecessor is updated and the sort cost is decremented
@@ -523,6 +525,7 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
 
         // Forward path to this edge can't be improved, so we can settle it right now.
         edgestatus_forward_.Update(fwd_pred.edgeid(), EdgeSet::kPermanent);
+        search_metrics_.Settle();
 
         // Terminate if the cost threshold has been exceeded.
         if (fwd_pred.sortcost() + cost_diff_ > cost_threshold_) {
@@ -568,6 +571,7 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
 
         // Reverse path to this edge can't be improved, so we can settle it right now.
         edgestatus_reverse_.Update(rev_pred.edgeid(), EdgeSet::kPermanent);
+        search_metrics_.Settle();
 
         // Terminate if the cost threshold has been exceeded.
         if (rev_pred.sortcost() > cost_threshold_) {
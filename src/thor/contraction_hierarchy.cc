@@ -0,0 +1,266 @@
+#include "thor/contraction_hierarchy.h"
+#include "baldr/graphconstants.h"
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace valhalla {
+namespace thor {
+
+ContractionHierarchy::ContractionHierarchy(std::shared_ptr<const ContractionOverlay> overlay)
+    : PathAlgorithm(), overlay_(std::move(overlay)), mode_(TravelMode::kDrive) {
+}
+
+void ContractionHierarchy::Clear() {
+  forward_labels_.clear();
+  backward_labels_.clear();
+  forward_queue_ = queue_t();
+  backward_queue_ = queue_t();
+  edgelabels_.clear();
+}
+
+void ContractionHierarchy::Seed(const uint32_t vertex,
+                                const float cost,
+                                const int seed,
+                                labels_t& labels,
+                                queue_t& queue) {
+  if (vertex == kInvalidVertex) {
+    return;
+  }
+  auto inserted = labels.emplace(vertex, label_t{cost, kInvalidVertex, nullptr, seed});
+  if (!inserted.second) {
+    if (cost >= inserted.first->second.cost) {
+      return;
+    }
+    inserted.first->second = label_t{cost, kInvalidVertex, nullptr, seed};
+  }
+  queue.emplace(cost, vertex);
+}
+
+std::vector<std::vector<PathInfo>>
+ContractionHierarchy::GetBestPath(valhalla::Location& origin,
+                                  valhalla::Location& dest,
+                                  GraphReader& graphreader,
+                                  const mode_costing_t& mode_costing,
+                                  const TravelMode mode,
+                                  const Options& /*options*/) {
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+
+  // The forward search starts at the end of the origin's edges, like A* we skip the edges that
+  // only end at the origin if there are others
+  bool has_other_edges = std::any_of(origin.path_edges().begin(), origin.path_edges().end(),
+                                     [](const valhalla::Location::PathEdge& e) {
+                                       return !e.end_node();
+                                     });
+  for (int i = 0; i < origin.path_edges_size(); ++i) {
+    const auto& edge = origin.path_edges(i);
+    GraphId edgeid(edge.graph_id());
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if ((has_other_edges && edge.end_node()) || tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    uint8_t flow_sources;
+    auto cost = costing_->EdgeCost(directededge, tile, kInvalidSecondsOfWeek, flow_sources).cost *
+                    (1.0f - edge.percent_along()) +
+                edge.distance();
+    Seed(overlay_->vertex(directededge->endnode()), cost, i, forward_labels_, forward_queue_);
+  }
+
+  // The reverse search starts at the beginning of the destination's edges
+  has_other_edges = std::any_of(dest.path_edges().begin(), dest.path_edges().end(),
+                                [](const valhalla::Location::PathEdge& e) {
+                                  return !e.begin_node();
+                                });
+  for (int i = 0; i < dest.path_edges_size(); ++i) {
+    const auto& edge = dest.path_edges(i);
+    GraphId edgeid(edge.graph_id());
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if ((has_other_edges && edge.begin_node()) || tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    uint8_t flow_sources;
+    auto cost = costing_->EdgeCost(directededge, tile, kInvalidSecondsOfWeek, flow_sources).cost *
+                    edge.percent_along() +
+                edge.distance();
+    Seed(overlay_->vertex(graphreader.edge_startnode(edgeid)), cost, i, backward_labels_,
+         backward_queue_);
+  }
+
+  // Both directions only go up in rank, we are done once neither can beat the best meeting
+  float best = std::numeric_limits<float>::infinity();
+  uint32_t meet = kInvalidVertex;
+  size_t n = 0;
+  while (true) {
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+
+    auto forward_min = forward_queue_.empty() ? std::numeric_limits<float>::infinity()
+                                              : forward_queue_.top().first;
+    auto backward_min = backward_queue_.empty() ? std::numeric_limits<float>::infinity()
+                                                : backward_queue_.top().first;
+    if (std::min(forward_min, backward_min) >= best) {
+      break;
+    }
+
+    // Take the cheaper of the two directions
+    bool forward = forward_min <= backward_min;
+    auto& queue = forward ? forward_queue_ : backward_queue_;
+    auto& labels = forward ? forward_labels_ : backward_labels_;
+    const auto& other = forward ? backward_labels_ : forward_labels_;
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > labels[top.second].cost) {
+      continue;
+    }
+
+    auto met = other.find(top.second);
+    if (met != other.end() && top.first + met->second.cost < best) {
+      best = top.first + met->second.cost;
+      meet = top.second;
+    }
+
+    auto arcs = forward ? overlay_->forward(top.second) : overlay_->backward(top.second);
+    for (const auto& arc : arcs) {
+      auto cost = top.first + arc.cost;
+      auto inserted = labels.emplace(arc.target, label_t{cost, top.second, &arc, -1});
+      if (!inserted.second) {
+        if (cost >= inserted.first->second.cost) {
+          continue;
+        }
+        inserted.first->second = label_t{cost, top.second, &arc, -1};
+      }
+      queue.emplace(cost, arc.target);
+    }
+  }
+  if (meet == kInvalidVertex) {
+    return {};
+  }
+
+  // Walk from the meeting vertex down to the origin and the destination unpacking the arcs
+  std::vector<GraphId> edges;
+  std::vector<std::tuple<uint32_t, uint32_t, const ContractionArc*>> arcs;
+  auto v = meet;
+  for (auto label = forward_labels_[v]; label.arc; v = label.parent, label = forward_labels_[v]) {
+    arcs.emplace_back(label.parent, v, label.arc);
+  }
+  const auto& origin_edge = origin.path_edges(forward_labels_[v].seed);
+  edges.emplace_back(origin_edge.graph_id());
+  std::reverse(arcs.begin(), arcs.end());
+
+  v = meet;
+  for (auto label = backward_labels_[v]; label.arc; v = label.parent, label = backward_labels_[v]) {
+    arcs.emplace_back(v, label.parent, label.arc);
+  }
+  const auto& dest_edge = dest.path_edges(backward_labels_[v].seed);
+
+  for (const auto& arc : arcs) {
+    if (!Unpack(std::get<0>(arc), std::get<1>(arc), *std::get<2>(arc), edges)) {
+      return {};
+    }
+  }
+  edges.emplace_back(dest_edge.graph_id());
+
+  auto path = FormPath(origin_edge, dest_edge, edges, graphreader);
+  if (path.empty()) {
+    return {};
+  }
+  return {std::move(path)};
+}
+
+bool ContractionHierarchy::Unpack(const uint32_t from,
+                                  const uint32_t to,
+                                  const ContractionArc& arc,
+                                  std::vector<GraphId>& edges) const {
+  if (!arc.is_shortcut()) {
+    // transitions between levels have no edge
+    if (arc.edgeid != kInvalidGraphId) {
+      edges.emplace_back(arc.edgeid);
+    }
+    return true;
+  }
+
+  // The first half of a shortcut enters the middle from a higher ranked vertex and the second half
+  // leaves it to one, so they are found among the middle's backward and forward arcs
+  const auto middle = arc.middle;
+  auto first = overlay_->backward(middle);
+  auto in = std::find_if(first.begin(), first.end(),
+                         [from](const ContractionArc& a) { return a.target == from; });
+  auto second = overlay_->forward(middle);
+  auto out = std::find_if(second.begin(), second.end(),
+                          [to](const ContractionArc& a) { return a.target == to; });
+  if (in == first.end() || out == second.end()) {
+    return false;
+  }
+  return Unpack(from, middle, *in, edges) && Unpack(middle, to, *out, edges);
+}
+
+std::vector<PathInfo> ContractionHierarchy::FormPath(const valhalla::Location::PathEdge& origin,
+                                                     const valhalla::Location::PathEdge& dest,
+                                                     const std::vector<GraphId>& edges,
+                                                     GraphReader& graphreader) {
+  std::vector<PathInfo> path;
+  path.reserve(edges.size());
+  has_ferry_ = false;
+
+  Cost elapsed;
+  float distance = 0.f;
+  for (size_t i = 0; i < edges.size(); ++i) {
+    const auto& edgeid = edges[i];
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      return {};
+    }
+    const DirectedEdge* edge = tile->directededge(edgeid);
+
+    // Only the part of the origin's and the destination's edges between the locations counts
+    float fraction = 1.f;
+    if (i == 0) {
+      fraction = 1.f - origin.percent_along();
+    } else if (i == edges.size() - 1) {
+      fraction = dest.percent_along();
+    }
+
+    // The overlay does not know about restrictions, closures or turn costs so check them here
+    Cost transition;
+    uint8_t restriction_idx = kInvalidRestriction;
+    if (i > 0) {
+      const auto& pred = edgelabels_.back();
+      graph_tile_ptr node_tile = graphreader.GetGraphTile(pred.endnode());
+      if (node_tile == nullptr ||
+          !costing_->Allowed(edge, i == edges.size() - 1, pred, tile, edgeid, 0, 0,
+                             restriction_idx) ||
+          costing_->Restricted(edge, pred, edgelabels_, tile, edgeid, true) ||
+          costing_->IsClosed(edge, tile)) {
+        edgelabels_.clear();
+        return {};
+      }
+      transition = costing_->TransitionCost(edge, node_tile->node(pred.endnode()), pred);
+    }
+
+    uint8_t flow_sources;
+    elapsed += costing_->EdgeCost(edge, tile, kInvalidSecondsOfWeek, flow_sources) * fraction +
+               transition;
+    distance += edge->length() * fraction;
+    has_ferry_ = has_ferry_ || edge->use() == Use::kFerry;
+
+    auto predecessor = edgelabels_.empty() ? kInvalidLabel : edgelabels_.size() - 1;
+    edgelabels_.emplace_back(predecessor, edgeid, edge, elapsed, elapsed.cost, 0.f, mode_,
+                             static_cast<uint32_t>(distance), transition, restriction_idx, true,
+                             static_cast<bool>(flow_sources & kDefaultFlowMask),
+                             InternalTurn::kNoTurn);
+    path.emplace_back(mode_, elapsed, edgeid, 0, distance, restriction_idx, transition);
+  }
+  edgelabels_.clear();
+  return path;
+}
+
+} // namespace thor
+} // namespace valhalla
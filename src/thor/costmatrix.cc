@@ -1,5 +1,10 @@
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "midgard/logging.h"
@@ -21,6 +26,37 @@ int GetThreshold(const TravelMode mode, const int n) {
   return (mode == TravelMode::kDrive) ? std::min(2700, std::max(100, n / 3)) : 500;
 }
 
+// Each source and target keeps its own edge status, so by default reserve less per location than
+// a single search would
+constexpr uint32_t kReservedEdgeStatusCountPerLocation = 256 * 1024;
+
+// Keep the existing (pooled) edge status objects and only add or remove the difference
+void ResizeEdgeStatus(std::vector<valhalla::thor::EdgeStatus>& edgestatus,
+                      const size_t count,
+                      const size_t max_reserved_count) {
+  if (edgestatus.size() > count) {
+    edgestatus.resize(count);
+  }
+  edgestatus.reserve(count);
+  while (edgestatus.size() < count) {
+    edgestatus.emplace_back(max_reserved_count);
+  }
+}
+
+// Remove a location from the remaining locations of a status. Once all locations are found
+// the search continues for a limited number of iterations given by the threshold
+void RemoveLocation(valhalla::thor::LocationStatus& status,
+                    const uint32_t location,
+                    const int threshold) {
+  auto it = status.remaining_locations.find(location);
+  if (it != status.remaining_locations.end()) {
+    status.remaining_locations.erase(it);
+    if (status.remaining_locations.empty() && status.threshold > 0) {
+      status.threshold = threshold;
+    }
+  }
+}
+
 bool equals(const valhalla::LatLng& a, const valhalla::LatLng& b) {
   return a.has_lat() == b.has_lat() && a.has_lng() == b.has_lng() &&
          (!a.has_lat() || a.lat() == b.lat()) && (!a.has_lng() || a.lng() == b.lng());
@@ -33,10 +69,121 @@ namespace thor {
 
 class CostMatrix::TargetMap : public robin_hood::unordered_map<uint64_t, std::vector<uint32_t>> {};
 
+// Threads that repeatedly run a search over a list of locations. Each phase of the matrix only
+// settles a single edge per location so the threads are kept around and woken for every phase
+// rather than being started each time. The calling thread takes part in the work as well.
+class CostMatrix::ThreadPool {
+public:
+  explicit ThreadPool(const uint32_t threads) {
+    for (uint32_t i = 1; i < threads; ++i) {
+      threads_.emplace_back([this]() { work(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutdown_ = true;
+      ++phase_;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Runs func for each index in [0, count) and returns when all of them are done
+  void run(const uint32_t count, const std::function<void(uint32_t)>& func) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      func_ = &func;
+      count_ = count;
+      next_ = 0;
+      pending_ = threads_.size();
+      error_ = nullptr;
+      ++phase_;
+    }
+    wake_.notify_all();
+    drain();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return pending_ == 0; });
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+  // Serializes access to state shared by the searches (the graph reader)
+  std::mutex& tile_mutex() {
+    return tile_mutex_;
+  }
+
+private:
+  void work() {
+    uint64_t phase = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this, phase]() { return phase_ != phase; });
+        if (shutdown_) {
+          return;
+        }
+        phase = phase_;
+      }
+      drain();
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--pending_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  void drain() {
+    for (uint32_t i = next_++; i < count_; i = next_++) {
+      try {
+        (*func_)(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::mutex tile_mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(uint32_t)>* func_ = nullptr;
+  uint32_t count_ = 0;
+  std::atomic<uint32_t> next_{0};
+  size_t pending_ = 0;
+  uint64_t phase_ = 0;
+  bool shutdown_ = false;
+  std::exception_ptr error_;
+};
+
 // Constructor with cost threshold.
-CostMatrix::CostMatrix()
+CostMatrix::CostMatrix(const boost::property_tree::ptree& config)
     : mode_(TravelMode::kDrive), access_mode_(kAutoAccess), source_count_(0), remaining_sources_(0),
-      target_count_(0), remaining_targets_(0), current_cost_threshold_(0), targets_{new TargetMap} {
+      target_count_(0), remaining_targets_(0), current_cost_threshold_(0),
+      max_reserved_edge_status_count_(
+          config.get<uint32_t>("costmatrix_max_reserved_edge_status_count",
+                               kReservedEdgeStatusCountPerLocation)),
+      targets_{new TargetMap} {
+  auto threads = std::max(1u, config.get<unsigned int>("costmatrix_threads", 1));
+#ifndef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+  // Tiles are shared between the searches so their reference counts need to be thread safe
+  if (threads > 1) {
+    LOG_WARN("costmatrix_threads requires ENABLE_THREAD_SAFE_TILE_REF_COUNT, using 1 thread");
+    threads = 1;
+  }
+#endif
+  if (threads > 1) {
+    pool_.reset(new ThreadPool(threads));
+  }
 }
 
 CostMatrix::~CostMatrix() {
@@ -65,23 +212,41 @@ float CostMatrix::GetCostThreshold(const float max_matrix_distance) {
 // Clear the temporary information generated during time + distance matrix
 // construction.
 void CostMatrix::Clear() {
+  // Hand the work of the last matrix to the metrics
+  size_t labels = 0;
+  for (const auto& edgelabels : source_edgelabel_) {
+    labels += edgelabels.size();
+  }
+  for (const auto& edgelabels : target_edgelabel_) {
+    labels += edgelabels.size();
+  }
+  search_metrics_.Record("cost_matrix", labels);
+
   // Clear the target edge markings
   targets_->clear();
 
-  // Clear all source adjacency lists, edge labels, and edge status
+  // Clear all source adjacency lists, edge labels, and edge status. The edge
+  // status objects are kept so their memory can be reused by the next matrix
   source_adjacency_.clear();
   source_edgelabel_.clear();
-  source_edgestatus_.clear();
+  for (auto& edgestatus : source_edgestatus_) {
+    edgestatus.clear();
+  }
 
   // Clear all target adjacency lists, edge labels, and edge status
   target_adjacency_.clear();
   target_edgelabel_.clear();
-  target_edgestatus_.clear();
+  for (auto& edgestatus : target_edgestatus_) {
+    edgestatus.clear();
+  }
 
   source_hierarchy_limits_.clear();
   target_hierarchy_limits_.clear();
   source_status_.clear();
   target_status_.clear();
+  source_status_updates_.clear();
+  target_status_updates_.clear();
+  target_reached_edges_.clear();
 }
 
 // Form a time distance matrix from the set of source locations
@@ -114,31 +279,56 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
   // search from all source locations. Connections between the 2 search
   // spaces is checked during the forward search.
   int n = 0;
+  std::vector<uint32_t> locations;
   while (true) {
     // Iterate all target locations in a backwards search
+    locations.clear();
     for (uint32_t i = 0; i < target_count_; i++) {
       if (target_status_[i].threshold > 0) {
         target_status_[i].threshold--;
-        BackwardSearch(i, graphreader);
-        if (target_status_[i].threshold == 0) {
-          target_status_[i].threshold = -1;
-          if (remaining_targets_ > 0) {
-            remaining_targets_--;
-          }
+        locations.push_back(i);
+      }
+    }
+    Expand(locations, [&](const uint32_t i) { BackwardSearch(i, graphreader); });
+
+    // Apply what each target found in target order, as if they were expanded one after another
+    for (auto i : locations) {
+      for (const auto& edgeid : target_reached_edges_[i]) {
+        (*targets_)[edgeid].push_back(i);
+      }
+      target_reached_edges_[i].clear();
+      for (const auto& update : target_status_updates_[i]) {
+        RemoveLocation(source_status_[update.first], i, update.second);
+      }
+      target_status_updates_[i].clear();
+      if (target_status_[i].threshold == 0) {
+        target_status_[i].threshold = -1;
+        if (remaining_targets_ > 0) {
+          remaining_targets_--;
         }
       }
     }
 
     // Iterate all source locations in a forward search
+    locations.clear();
     for (uint32_t i = 0; i < source_count_; i++) {
       if (source_status_[i].threshold > 0) {
         source_status_[i].threshold--;
-        ForwardSearch(i, n, graphreader);
-        if (source_status_[i].threshold == 0) {
-          source_status_[i].threshold = -1;
-          if (remaining_sources_ > 0) {
-            remaining_sources_--;
-          }
+        locations.push_back(i);
+      }
+    }
+    Expand(locations, [&](const uint32_t i) { ForwardSearch(i, n, graphreader); });
+
+    // Apply what each source found in source order
+    for (auto i : locations) {
+      for (const auto& update : source_status_updates_[i]) {
+        RemoveLocation(target_status_[update.first], i, update.second);
+      }
+      source_status_updates_[i].clear();
+      if (source_status_[i].threshold == 0) {
+        source_status_[i].threshold = -1;
+        if (remaining_sources_ > 0) {
+          remaining_sources_--;
         }
       }
     }
@@ -226,7 +416,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
     // Forward search is exhausted - mark this and update so we don't
     // extend searches more than we need to
     for (uint32_t target = 0; target < target_count_; target++) {
-      UpdateStatus(index, target);
+      UpdateStatus(index, target, true);
     }
     source_status_[index].threshold = 0;
     return;
@@ -242,6 +432,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
   // Settle this edge
   auto& edgestate = source_edgestatus_[index];
   edgestate.Update(pred.edgeid(), EdgeSet::kPermanent);
+  search_metrics_.Settle();
 
   // Check for connections to backwards search.
   CheckForwardConnections(index, pred, n);
@@ -293,18 +484,17 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
 
       // Skip this edge if no access is allowed (based on costing method)
       // or if a complex restriction prevents transition onto this edge.
+      // Get cost along with the access check. Separate out transition cost.
       uint8_t restriction_idx = -1;
-      if (!costing_->Allowed(directededge, false, pred, tile, edgeid, 0, 0, restriction_idx) ||
+      Cost tc, edge_cost;
+      uint8_t flow_sources;
+      if (!costing_->AllowedEdgeCost(directededge, false, pred, tile, edgeid, nodeinfo, 0, 0,
+                                     kConstrainedFlowSecondOfDay, restriction_idx, tc, edge_cost,
+                                     flow_sources) ||
           costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, true)) {
         continue;
       }
-
-      // Get cost. Separate out transition cost.
-      Cost tc = costing_->TransitionCost(directededge, nodeinfo, pred);
-      uint8_t flow_sources;
-      Cost newcost =
-          pred.cost() + tc +
-          costing_->EdgeCost(directededge, tile, kConstrainedFlowSecondOfDay, flow_sources);
+      Cost newcost = pred.cost() + tc + edge_cost;
 
       // Check if edge is temporarily labeled and this path has less cost. If
       // less cost the predecessor is updated along with new cost and distance.
@@ -320,7 +510,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
 
       // Get end node tile (skip if tile is not found) and opposing edge Id
       graph_tile_ptr t2 =
-          directededge->leaves_tile() ? graphreader.GetGraphTile(directededge->endnode()) : tile;
+          directededge->leaves_tile() ? GetGraphTile(graphreader, directededge->endnode()) : tile;
       if (t2 == nullptr) {
         continue;
       }
@@ -351,7 +541,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
 
         // Expand from end node of this transition.
         GraphId node = trans->endnode();
-        graph_tile_ptr endtile = graphreader.GetGraphTile(node);
+        graph_tile_ptr endtile = GetGraphTile(graphreader, node);
         if (endtile != nullptr) {
           expand(endtile, node, endtile->node(node), pred, pred_idx, true);
         }
@@ -362,7 +552,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
   // Expand from node in forward search path. Get the tile and the node info.
   // Skip if tile is null (can happen with regional data sets) or if no access
   // at the node.
-  graph_tile_ptr tile = graphreader.GetGraphTile(node);
+  graph_tile_ptr tile = GetGraphTile(graphreader, node);
   if (tile != nullptr) {
     const NodeInfo* nodeinfo = tile->node(node);
     if (costing_->Allowed(nodeinfo)) {
@@ -434,7 +624,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
         // Update status and update threshold if this is the last location
         // to find for this source or target
-        UpdateStatus(source, target);
+        UpdateStatus(source, target, true);
       } else {
         float oppcost = (predidx == kInvalidLabel) ? 0 : edgelabels[predidx].cost().cost;
         float c = pred.cost().cost + oppcost + opp_el.transition_cost().cost;
@@ -456,7 +646,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
           // Update status and update threshold if this is the last location
           // to find for this source or target
-          UpdateStatus(source, target);
+          UpdateStatus(source, target, true);
         }
       }
     }
@@ -464,32 +654,42 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 }
 
 // Update status when a connection is found.
-void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
-  // Remove the target from the source status
-  auto& s = source_status_[source].remaining_locations;
-  auto it = s.find(target);
-  if (it != s.end()) {
-    s.erase(it);
-    if (s.empty() && source_status_[source].threshold > 0) {
-      // At least 1 connection has been found to each target for this source.
-      // Set a threshold to continue search for a limited number of times.
-      source_status_[source].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
-    }
+void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target, const bool forward) {
+  // At least 1 connection has been found to each location for this source or target once
+  // its remaining locations are empty. Set a threshold to continue search for a limited number
+  // of times.
+  int threshold =
+      GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+
+  // The other side is owned by another search, it is updated once the phase is over
+  if (forward) {
+    RemoveLocation(source_status_[source], target, threshold);
+    source_status_updates_[source].emplace_back(target, threshold);
+  } else {
+    RemoveLocation(target_status_[target], source, threshold);
+    target_status_updates_[target].emplace_back(source, threshold);
   }
+}
 
-  // Remove the source from the target status
-  auto& t = target_status_[target].remaining_locations;
-  it = t.find(source);
-  if (it != t.end()) {
-    t.erase(it);
-    if (t.empty() && target_status_[target].threshold > 0) {
-      // At least 1 connection has been found to each source for this target.
-      // Set a threshold to continue search for a limited number of times.
-      target_status_[target].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+// Run the searches of all the given locations
+void CostMatrix::Expand(const std::vector<uint32_t>& locations,
+                        const std::function<void(uint32_t)>& search) {
+  if (!pool_ || locations.size() < 2) {
+    for (auto i : locations) {
+      search(i);
     }
+    return;
+  }
+  pool_->run(locations.size(), [&](const uint32_t i) { search(locations[i]); });
+}
+
+// Get a tile, the graph reader (and its cache) is not safe to use from multiple threads
+graph_tile_ptr CostMatrix::GetGraphTile(GraphReader& graphreader, const GraphId& id) {
+  if (!pool_) {
+    return graphreader.GetGraphTile(id);
   }
+  std::lock_guard<std::mutex> lock(pool_->tile_mutex());
+  return graphreader.GetGraphTile(id);
 }
 
 // Expand the backwards search trees.
@@ -502,7 +702,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
     // Backward search is exhausted - mark this and update so we don't
     // extend searches more than we need to
     for (uint32_t source = 0; source < source_count_; source++) {
-      UpdateStatus(source, index);
+      UpdateStatus(source, index, false);
     }
     target_status_[index].threshold = 0;
     return;
@@ -518,6 +718,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
   // Settle this edge
   auto& edgestate = target_edgestatus_[index];
   edgestate.Update(pred.edgeid(), EdgeSet::kPermanent);
+  search_metrics_.Settle();
 
   // Prune path if predecessor is not a through edge
   if (pred.not_thru() && pred.not_thru_pruning()) {
@@ -568,7 +769,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
 
       // Get opposing edge Id and end node tile
       graph_tile_ptr t2 =
-          directededge->leaves_tile() ? graphreader.GetGraphTile(directededge->endnode()) : tile;
+          directededge->leaves_tile() ? GetGraphTile(graphreader, directededge->endnode()) : tile;
       if (t2 == nullptr) {
         continue;
       }
@@ -577,21 +778,18 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
       // Skip this edge if no access is allowed (based on costing method)
       // or if a complex restriction prevents transition onto this edge.
       const DirectedEdge* opp_edge = t2->directededge(oppedge);
+      // Get cost along with the access check. Use opposing edge for EdgeCost. Separate the
+      // transition seconds so we can properly recover elapsed time on the reverse path.
       uint8_t restriction_idx = -1;
-      if (!costing_->AllowedReverse(directededge, pred, opp_edge, t2, oppedge, 0, 0,
-                                    restriction_idx) ||
+      Cost tc, edge_cost;
+      uint8_t flow_sources;
+      if (!costing_->AllowedEdgeCostReverse(directededge, pred, opp_edge, t2, oppedge, nodeinfo,
+                                            opp_pred_edge, 0, 0, kConstrainedFlowSecondOfDay,
+                                            restriction_idx, tc, edge_cost, flow_sources) ||
           costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, false)) {
         continue;
       }
-
-      // Get cost. Use opposing edge for EdgeCost. Separate the transition seconds so
-      // we can properly recover elapsed time on the reverse path.
-      Cost tc = costing_->TransitionCostReverse(directededge->localedgeidx(), nodeinfo, opp_edge,
-                                                opp_pred_edge, pred.has_measured_speed(),
-                                                pred.internal_turn());
-      uint8_t flow_sources;
-      Cost newcost = pred.cost() + tc +
-                     costing_->EdgeCost(opp_edge, tile, kConstrainedFlowSecondOfDay, flow_sources);
+      Cost newcost = pred.cost() + tc + edge_cost;
 
       // Check if edge is temporarily labeled and this path has less cost. If
       // less cost the predecessor is updated along with new cost and distance.
@@ -618,8 +816,8 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
                               restriction_idx);
       adj->add(idx);
 
-      // Add to the list of targets that have reached this edge
-      (*targets_)[edgeid].push_back(index);
+      // Add to the list of edges this target has reached
+      target_reached_edges_[index].push_back(edgeid);
     }
 
     // Handle transitions - expand from the end node of the transition
@@ -634,7 +832,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
 
         // Expand from end node of this transition edge.
         GraphId node = trans->endnode();
-        graph_tile_ptr endtile = graphreader.GetGraphTile(node);
+        graph_tile_ptr endtile = GetGraphTile(graphreader, node);
         if (endtile != nullptr) {
           expand(endtile, node, endtile->node(node), index, pred, pred_idx, opp_pred_edge, true);
         }
@@ -645,7 +843,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
 
   // Get the tile and the node info. Skip if tile is null (can happen
   // with regional data sets) or if no access at the node.
-  graph_tile_ptr tile = graphreader.GetGraphTile(node);
+  graph_tile_ptr tile = GetGraphTile(graphreader, node);
   if (tile != nullptr) {
     const NodeInfo* nodeinfo = tile->node(node);
     if (costing_->Allowed(nodeinfo)) {
@@ -655,8 +853,8 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
       if (pred.opp_edgeid().Tile_Base() == tile->id().Tile_Base()) {
         opp_pred_edge = tile->directededge(pred.opp_edgeid().id());
       } else {
-        opp_pred_edge =
-            graphreader.GetGraphTile(pred.opp_edgeid().Tile_Base())->directededge(pred.opp_edgeid());
+        graph_tile_ptr opp_tile = GetGraphTile(graphreader, pred.opp_edgeid().Tile_Base());
+        opp_pred_edge = opp_tile->directededge(pred.opp_edgeid());
       }
       expand(tile, node, nodeinfo, index, pred, pred_idx, opp_pred_edge, false);
     }
@@ -670,9 +868,10 @@ void CostMatrix::SetSources(GraphReader& graphreader,
   // Allocate edge labels and edge status
   source_count_ = sources.size();
   source_edgelabel_.resize(source_count_);
-  source_edgestatus_.resize(source_count_);
+  ResizeEdgeStatus(source_edgestatus_, source_count_, max_reserved_edge_status_count_);
   source_adjacency_.resize(source_count_);
   source_hierarchy_limits_.resize(source_count_);
+  source_status_updates_.resize(source_count_);
 
   // Go through each source location
   uint32_t index = 0;
@@ -746,9 +945,11 @@ void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
   // Allocate target edge labels and edge status
   target_count_ = targets.size();
   target_edgelabel_.resize(targets.size());
-  target_edgestatus_.resize(targets.size());
+  ResizeEdgeStatus(target_edgestatus_, targets.size(), max_reserved_edge_status_count_);
   target_adjacency_.resize(targets.size());
   target_hierarchy_limits_.resize(targets.size());
+  target_status_updates_.resize(targets.size());
+  target_reached_edges_.resize(targets.size());
 
   // Go through each target location
   uint32_t index = 0;
@@ -46,11 +46,16 @@ Dijkstras::Dijkstras(const boost::property_tree::ptree& config)
     : mode_(TravelMode::kDrive), access_mode_(kAutoAccess),
       max_reserved_labels_count_(
           config.get<uint32_t>("max_reserved_labels_count", kInitialEdgeLabelCount)),
+      edgestatus_(config.get<uint32_t>("max_reserved_edge_status_count",
+                                       kDefaultReservedEdgeStatusCount)),
       multipath_(false) {
 }
 
 // Clear the temporary information generated during path construction.
 void Dijkstras::Clear() {
+  // Hand the work of the last search to the metrics
+  search_metrics_.Record("dijkstras", bdedgelabels_.size() + mmedgelabels_.size());
+
   // Clear the edge labels, edge status flags, and adjacency list
   // TODO - clear only the edge label set that was used?
   if (bdedgelabels_.size() > max_reserved_labels_count_) {
@@ -184,47 +189,35 @@ void Dijkstras::ExpandInner(baldr::GraphReader& graphreader,
     // is_dest is false, because it is a traversal algorithm in this context, not a path search
     // algorithm. In other words, destination edges are not defined for this Dijkstra's algorithm.
     const bool is_dest = false;
+    // With date time we check time dependent restrictions and access. The costing computes the
+    // cost to the end of this edge along with its access check.
+    const uint64_t localtime = offset_time.valid ? offset_time.local_time : 0;
+    const uint32_t tz_index = offset_time.valid ? nodeinfo->timezone() : 0;
+    Cost transition_cost, edge_cost;
+    uint8_t flow_sources;
+    const bool allowed =
+        FORWARD ? costing_->AllowedEdgeCost(directededge, is_dest, pred, tile, edgeid, nodeinfo,
+                                            localtime, tz_index, offset_time.second_of_week,
+                                            restriction_idx, transition_cost, edge_cost,
+                                            flow_sources)
+                : costing_->AllowedEdgeCostReverse(directededge, pred, opp_edge, t2, oppedgeid,
+                                                   nodeinfo, opp_pred_edge, localtime, tz_index,
+                                                   offset_time.second_of_week, restriction_idx,
+                                                   transition_cost, edge_cost, flow_sources);
+    if (!allowed) {
+      continue;
+    }
     if (offset_time.valid) {
-      // With date time we check time dependent restrictions and access
-      const bool allowed =
-          FORWARD ? costing_->Allowed(directededge, is_dest, pred, tile, edgeid,
-                                      offset_time.local_time, nodeinfo->timezone(), restriction_idx)
-                  : costing_->AllowedReverse(directededge, pred, opp_edge, t2, oppedgeid,
-                                             offset_time.local_time, nodeinfo->timezone(),
-                                             restriction_idx);
-      if (!allowed || costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, true,
-                                           todo, offset_time.local_time, nodeinfo->timezone())) {
-        continue;
-      }
-    } else {
-      const bool allowed = FORWARD ? costing_->Allowed(directededge, is_dest, pred, tile, edgeid, 0,
-                                                       0, restriction_idx)
-                                   : costing_->AllowedReverse(directededge, pred, opp_edge, t2,
-                                                              oppedgeid, 0, 0, restriction_idx);
-
-      if (!allowed || costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, true)) {
+      if (costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, true, todo,
+                               offset_time.local_time, nodeinfo->timezone())) {
         continue;
       }
+    } else if (costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, true)) {
+      continue;
     }
 
     // Compute the cost and path distance to the end of this edge
-    Cost transition_cost, newcost;
-    uint8_t flow_sources;
-
-    if (FORWARD) {
-      transition_cost = costing_->TransitionCost(directededge, nodeinfo, pred);
-      newcost = pred.cost() +
-                costing_->EdgeCost(directededge, tile, offset_time.second_of_week, flow_sources) +
-                transition_cost;
-    } else {
-      transition_cost =
-          costing_->TransitionCostReverse(directededge->localedgeidx(), nodeinfo, opp_edge,
-                                          opp_pred_edge, pred.has_measured_speed(),
-                                          pred.internal_turn());
-      newcost = pred.cost() +
-                costing_->EdgeCost(opp_edge, t2, offset_time.second_of_week, flow_sources) +
-                transition_cost;
-    }
+    Cost newcost = pred.cost() + edge_cost + transition_cost;
     uint32_t path_dist = pred.path_distance() + directededge->length();
 
     // Check if edge is temporarily labeled and this path has less cost. If
@@ -351,6 +344,7 @@ void Dijkstras::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>&
     // Copy the EdgeLabel for use in costing and settle the edge.
     sif::BDEdgeLabel pred = bdedgelabels_[predindex];
     edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent, pred.path_id());
+    search_metrics_.Settle();
 
     // Get the opposing predecessor directed edge. Need to make sure we get
     // the correct one if a transition occurred
@@ -733,6 +727,7 @@ void Dijkstras::ComputeMultiModal(
     // Copy the EdgeLabel for use in costing and settle the edge.
     MMEdgeLabel pred = mmedgelabels_[predindex];
     edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent, pred.path_id());
+    search_metrics_.Settle();
 
     // Check if we should stop
     cb_decision = ShouldExpand(graphreader, pred, ExpansionType::multimodal);
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <iostream> // TODO remove if not needed
 #include <map>
+#include <thread>
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -60,9 +61,14 @@ namespace thor {
 
 constexpr uint32_t kInitialEdgeLabelCount = 500000;
 
+// Number of segments to queue up before marking them in the isotile
+constexpr size_t kSegmentBatchSize = 1 << 16;
+
 // Default constructor
 Isochrone::Isochrone(const boost::property_tree::ptree& config)
-    : Dijkstras(config), shape_interval_(50.0f) {
+    : Dijkstras(config), shape_interval_(50.0f),
+      threads_(std::max(config.get<uint32_t>("isochrone_threads", 1), 1u)) {
+  segments_.reserve(kSegmentBatchSize);
 }
 
 // Construct the isotile. Use a fixed grid size. Convert time in minutes to
@@ -157,6 +163,7 @@ void Isochrone::ConstructIsoTile(const bool multimodal,
 
   // Create isotile (gridded data)
   isotile_.reset(new GriddedData<2>(bounds, grid_size, {max_minutes, max_km}));
+  segments_.clear();
 
   // Find the center of the grid that the location lies within. Shift the
   // tilebounds so the location lies in the center of a tile.
@@ -190,6 +197,8 @@ std::shared_ptr<const GriddedData<2>> Isochrone::Expand(const ExpansionType& exp
   ConstructIsoTile(expansion_type == ExpansionType::multimodal, api, mode);
   // Compute the expansion
   Dijkstras::Expand(expansion_type, api, reader, mode_costing, mode);
+  // Mark whatever is left over from the last batch
+  MarkSegments();
   return isotile_;
 }
 
@@ -197,24 +206,76 @@ void Isochrone::UpdateIsoTileAlongSegment(const midgard::PointLL& from,
                                           const midgard::PointLL& to,
                                           float seconds,
                                           float meters) {
-  float minutes = seconds * kMinPerSec;
-  float km = meters * kKmPerMeter;
-  // Mark tiles that intersect the segment. Optimize this to avoid calling the Intersect
-  // method unless more than 2 tiles are crossed by the segment.
-  auto tile1 = isotile_->TileId(from);
-  auto tile2 = isotile_->TileId(to);
-  if (tile1 == tile2) {
-    isotile_->SetIfLessThan(tile1, {minutes, km});
-  } else if (isotile_->AreNeighbors(tile1, tile2)) {
-    // If tile 2 is directly east, west, north, or south of tile 1 then the
-    // segment will not intersect any other tiles other than tile1 and tile2.
-    isotile_->SetIfLessThan(tile1, {minutes, km});
-    isotile_->SetIfLessThan(tile2, {minutes, km});
+  segments_.push_back({from, to, seconds * kMinPerSec, meters * kKmPerMeter});
+  if (segments_.size() >= kSegmentBatchSize) {
+    MarkSegments();
+  }
+}
+
+void Isochrone::MarkSegments() {
+  // The cells are only ever lowered to the smallest value so it does not matter in which order
+  // the segments are marked, splitting the work by rows gives the same grid as marking serially
+  auto nrows = isotile_->nrows();
+  auto threads = std::min(threads_, static_cast<uint32_t>(segments_.size() / 1024 + 1));
+  if (threads < 2) {
+    MarkSegments(0, nrows);
   } else {
-    // Find intersecting tiles (using a Bresenham method)
-    auto tiles = isotile_->Intersect(std::list<PointLL>{from, to});
-    for (const auto& t : tiles) {
-      isotile_->SetIfLessThan(t.first, {minutes, km});
+    int32_t band = (nrows + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (int32_t row = band; row < nrows; row += band) {
+      workers.emplace_back([this, row, band, nrows]() {
+        MarkSegments(row, std::min(row + band, nrows));
+      });
+    }
+    MarkSegments(0, std::min(band, nrows));
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+  segments_.clear();
+}
+
+void Isochrone::MarkSegments(const int32_t begin_row, const int32_t end_row) {
+  auto bounds = isotile_->TileBounds();
+  auto ncolumns = isotile_->ncolumns();
+  auto tile_size = isotile_->TileSize();
+  auto in_band = [begin_row, end_row, ncolumns](const int32_t tile_id) {
+    return tile_id >= begin_row * ncolumns && tile_id < end_row * ncolumns;
+  };
+  for (const auto& segment : segments_) {
+    // Skip segments that can not touch the band, the intersection is only ever a row off
+    auto lat_min = std::min(segment.from.lat(), segment.to.lat());
+    auto lat_max = std::max(segment.from.lat(), segment.to.lat());
+    if (std::floor((lat_max - bounds.miny()) / tile_size) + 1 < begin_row ||
+        std::floor((lat_min - bounds.miny()) / tile_size) - 1 >= end_row) {
+      continue;
+    }
+
+    // Mark tiles that intersect the segment. Optimize this to avoid calling the Intersect
+    // method unless more than 2 tiles are crossed by the segment.
+    auto tile1 = isotile_->TileId(segment.from);
+    auto tile2 = isotile_->TileId(segment.to);
+    if (tile1 == tile2) {
+      if (in_band(tile1)) {
+        isotile_->SetIfLessThan(tile1, {segment.minutes, segment.km});
+      }
+    } else if (isotile_->AreNeighbors(tile1, tile2)) {
+      // If tile 2 is directly east, west, north, or south of tile 1 then the
+      // segment will not intersect any other tiles other than tile1 and tile2.
+      if (in_band(tile1)) {
+        isotile_->SetIfLessThan(tile1, {segment.minutes, segment.km});
+      }
+      if (in_band(tile2)) {
+        isotile_->SetIfLessThan(tile2, {segment.minutes, segment.km});
+      }
+    } else {
+      // Find intersecting tiles (using a Bresenham method)
+      auto tiles = isotile_->Intersect(std::list<PointLL>{segment.from, segment.to});
+      for (const auto& t : tiles) {
+        if (in_band(t.first)) {
+          isotile_->SetIfLessThan(t.first, {segment.minutes, segment.km});
+        }
+      }
     }
   }
 }
@@ -41,7 +41,8 @@ std::string thor_worker_t::isochrones(Api& request) {
   // this method sorts the contour specifications by metric (time or distance) and then by value
   // with the largest values coming first. eg (60min, 30min, 10min, 40km, 10km)
   auto isolines =
-      grid->GenerateContours(contours, options.polygons(), options.denoise(), options.generalize());
+      grid->GenerateContours(contours, options.polygons(), options.denoise(), options.generalize(),
+                             isochrone_gen.threads());
 
   // make the final json
   std::string ret = tyr::serializeIsochrones(request, contours, isolines, options.polygons(),
@@ -42,14 +42,13 @@ std::string thor_worker_t::matrix(Api& request) {
   // do the real work
   std::vector<TimeDistance> time_distances;
   auto costmatrix = [&]() {
-    thor::CostMatrix matrix;
-    return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
-                                 max_matrix_distance.find(costing)->second);
+    return cost_matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing,
+                                      mode, max_matrix_distance.find(costing)->second);
   };
   auto timedistancematrix = [&]() {
-    thor::TimeDistanceMatrix matrix;
-    return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
-                                 max_matrix_distance.find(costing)->second);
+    return time_distance_matrix.SourceToTarget(options.sources(), options.targets(), *reader,
+                                               mode_costing, mode,
+                                               max_matrix_distance.find(costing)->second);
   };
   if (costing == "bikeshare") {
     thor::TimeDistanceBSSMatrix matrix;
@@ -45,7 +45,9 @@ MultiModalPathAlgorithm::MultiModalPathAlgorithm(const boost::property_tree::ptr
     : PathAlgorithm(), walking_distance_(0), max_label_count_(std::numeric_limits<uint32_t>::max()),
       mode_(TravelMode::kPedestrian), travel_type_(0),
       max_reserved_labels_count_(
-          config.get<uint32_t>("max_reserved_labels_count", kInitialEdgeLabelCount)) {
+          config.get<uint32_t>("max_reserved_labels_count", kInitialEdgeLabelCount)),
+      edgestatus_(config.get<uint32_t>("max_reserved_edge_status_count",
+                                       kDefaultReservedEdgeStatusCount)) {
 }
 
 // Destructor
@@ -76,6 +78,9 @@ void MultiModalPathAlgorithm::Init(const midgard::PointLL& destll,
 
 // Clear the temporary information generated during path construction.
 void MultiModalPathAlgorithm::Clear() {
+  // Hand the work of the last search to the metrics
+  search_metrics_.Record(name(), edgelabels_.size());
+
   // Clear the edge labels and destination list
   if (edgelabels_.size() > max_reserved_labels_count_) {
     edgelabels_.resize(max_reserved_labels_count_);
@@ -206,6 +211,7 @@ MultiModalPathAlgorithm::GetBestPath(valhalla::Location& origin,
     // edge (this will allow loops/around the block cases)
     if (!pred.origin()) {
       edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      search_metrics_.Settle();
     }
 
     // Check that distance is converging towards the destination. Return route
@@ -824,6 +830,7 @@ bool MultiModalPathAlgorithm::CanReachDestination(const valhalla::Location& dest
     // Mark the edge as as permanently labeled - copy the EdgeLabel for use in costing
     EdgeLabel pred = edgelabels[predindex];
     edgestatus.Update(pred.edgeid(), EdgeSet::kPermanent);
+    search_metrics_.Settle();
 
     // Expand from the end node of the predecessor
     if (ExpandFromNode(graphreader, pred.endnode(), pred, predindex, costing, edgestatus, edgelabels,
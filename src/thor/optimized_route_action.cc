@@ -27,10 +27,9 @@ void thor_worker_t::optimized_route(Api& request) {
   auto& options = *request.mutable_options();
 
   // Use CostMatrix to find costs from each location to every other location
-  CostMatrix costmatrix;
   std::vector<thor::TimeDistance> td =
-      costmatrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
-                                max_matrix_distance.find(costing)->second);
+      cost_matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
+                                 max_matrix_distance.find(costing)->second);
 
   // Return an error if any locations are totally unreachable
   const auto& correlated =
@@ -52,7 +51,6 @@ void thor_worker_t::optimized_route(Api& request) {
     time_costs.emplace_back(static_cast<float>(td[i].time));
   }
 
-  Optimizer optimizer;
   // returns the optimal order of the path_locations
   auto optimal_order = optimizer.Solve(correlated.size(), time_costs);
   // put the optimal order into the locations array
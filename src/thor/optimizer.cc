@@ -1,9 +1,26 @@
 #include "thor/optimizer.h"
 #include "midgard/logging.h"
 
+#include <functional>
+#include <limits>
+#include <thread>
+
+namespace {
+
+// Smallest decrease in tour cost a local search move has to make so that
+// rounding can not make the search go around in circles
+constexpr double kMinImprovement = 1e-3;
+
+} // namespace
+
 namespace valhalla {
 namespace thor {
 
+Optimizer::Optimizer(const boost::property_tree::ptree& config)
+    : threads_(std::max(config.get<uint32_t>("optimizer_threads", 1), 1u)),
+      time_budget_(std::max(config.get<float>("optimizer_time_budget", 0.0f), 0.0f)) {
+}
+
 // Optimize the tour through a set of locations given the cost matrix
 // among all locations. The first location (origin) and last location
 // (destination) remain fixed in the tour.
@@ -21,23 +38,78 @@ std::vector<uint32_t> Optimizer::Solve(const uint32_t count, const std::vector<f
     return (TourCost(costs, tour1) < TourCost(costs, tour2)) ? tour1 : tour2;
   }
 
+  // Without a time budget there is no deadline
+  auto deadline = std::chrono::steady_clock::time_point::max();
+  if (time_budget_ > 0.0f) {
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<float>(time_budget_));
+  }
+
+  // The optimizer lives as long as the worker, start over from the seed so
+  // the tour does not depend on the requests that came before
+  random_generator_.seed(seed_);
+
+  // Set a run limit per annealing step and a success limit to break out
+  // early if enough successes are found.
+  ntry_ = 0;
+  attempts_ = 400 * count_;
+  successes_ = 40 * count_;
+  best_tour_.clear();
+  best_cost_ = std::numeric_limits<float>::max();
+
+  // Every thread anneals on a copy of the optimizer with a random number
+  // generator of its own. With a time budget they keep starting over from
+  // new random tours until it is spent.
+  auto runs = [this, &costs, &deadline](Optimizer& optimizer) {
+    do {
+      optimizer.Run(costs, deadline);
+    } while (time_budget_ > 0.0f && std::chrono::steady_clock::now() < deadline);
+  };
+  std::vector<Optimizer> others;
+  for (uint32_t i = 1; i < threads_; ++i) {
+    others.push_back(*this);
+    others.back().Seed(static_cast<uint32_t>(random_generator_()));
+  }
+  std::vector<std::thread> workers;
+  for (auto& other : others) {
+    workers.emplace_back(runs, std::ref(other));
+  }
+  runs(*this);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (const auto& other : others) {
+    ntry_ += other.ntry_;
+    if (other.best_cost_ < best_cost_) {
+      best_cost_ = other.best_cost_;
+      best_tour_ = other.best_tour_;
+    }
+  }
+
+  // Return the best tour
+  LOG_DEBUG("Best tour cost = " + std::to_string(best_cost_) + " ntries = " + std::to_string(ntry_));
+  return best_tour_;
+}
+
+// Anneal from a random tour and improve the best tour found with local search.
+void Optimizer::Run(const std::vector<float>& costs,
+                    const std::chrono::steady_clock::time_point& deadline) {
   // Populate the initial tour with a random order. The first and last
   // locations must remain fixed as the tour begin and end locations do not
   // change.
   CreateRandomTour();
 
-  // Copy current tour to best tour and get the tour cost. Set the initial
-  // temperature based on tour cost
+  // Keep the best tour of the previous runs aside, the annealing tracks the
+  // best tour of this one. Set the initial temperature based on tour cost
+  auto best_tour = std::move(best_tour_);
+  auto best_cost = best_cost_;
   best_tour_ = tour_;
   best_cost_ = TourCost(costs, tour_);
   float temperature = best_cost_ / count_;
 
-  // Perform simulated annealing. Set a run limit per annealing step and a
-  // success limit to break out early if enough successes are found.
-  ntry_ = 0;
-  attempts_ = 400 * count_;
-  successes_ = 40 * count_;
-  for (uint32_t i = 0; i < 100; i++) {
+  // Perform simulated annealing.
+  for (uint32_t i = 0; i < 100 && std::chrono::steady_clock::now() < deadline; i++) {
     // Break if no successes were found during this annealing step.
     if (Anneal(costs, temperature) == 0) {
       break;
@@ -47,9 +119,90 @@ std::vector<uint32_t> Optimizer::Solve(const uint32_t count, const std::vector<f
     temperature *= kCoolingRate;
   }
 
-  // Return the best tour
-  LOG_DEBUG("Best tour cost = " + std::to_string(best_cost_) + " ntries = " + std::to_string(ntry_));
-  return best_tour_;
+  // Annealing leaves tours that a single move can still improve
+  LocalSearch(costs, best_tour_, deadline);
+  best_cost_ = TourCost(costs, best_tour_);
+  if (best_cost < best_cost_) {
+    best_cost_ = best_cost;
+    best_tour_ = std::move(best_tour);
+  }
+}
+
+// Improve the tour with 2-opt and Or-opt moves until neither finds a better
+// tour. A move of one kind can open up moves of the other.
+void Optimizer::LocalSearch(const std::vector<float>& costs,
+                            std::vector<uint32_t>& tour,
+                            const std::chrono::steady_clock::time_point& deadline) const {
+  bool improved = true;
+  while (improved && std::chrono::steady_clock::now() < deadline) {
+    improved = TwoOpt(costs, tour);
+    improved = OrOpt(costs, tour) || improved;
+  }
+}
+
+// Reverse each part of the tour whose reversal lowers the tour cost.
+bool Optimizer::TwoOpt(const std::vector<float>& costs, std::vector<uint32_t>& tour) const {
+  // Cost of the tour up to each location going forward and going backward, so
+  // the cost of a part of the tour and of its reverse are differences of two
+  std::vector<double> forward(count_, 0.0), backward(count_, 0.0);
+  auto sum = [&]() {
+    for (uint32_t i = 1; i < count_; i++) {
+      forward[i] = forward[i - 1] + Cost(costs, tour[i - 1], tour[i]);
+      backward[i] = backward[i - 1] + Cost(costs, tour[i], tour[i - 1]);
+    }
+  };
+  sum();
+
+  bool improved = false;
+  for (uint32_t i = 1; i < count_ - 2; i++) {
+    for (uint32_t j = i + 1; j < count_ - 1; j++) {
+      double diff = static_cast<double>(Cost(costs, tour[i - 1], tour[j])) +
+                    Cost(costs, tour[i], tour[j + 1]) - Cost(costs, tour[i - 1], tour[i]) -
+                    Cost(costs, tour[j], tour[j + 1]) + (backward[j] - backward[i]) -
+                    (forward[j] - forward[i]);
+      if (diff < -kMinImprovement) {
+        std::reverse(tour.begin() + i, tour.begin() + j + 1);
+        sum();
+        improved = true;
+      }
+    }
+  }
+  return improved;
+}
+
+// Move each run of 1 to 3 locations to wherever in the tour lowers the tour
+// cost, keeping the order of the run.
+bool Optimizer::OrOpt(const std::vector<float>& costs, std::vector<uint32_t>& tour) const {
+  bool improved = false;
+  for (uint32_t length = 1; length <= 3; length++) {
+    for (uint32_t i = 1; i + length < count_; i++) {
+      // What taking the run out of the tour saves
+      uint32_t first = tour[i];
+      uint32_t last = tour[i + length - 1];
+      double saved = static_cast<double>(Cost(costs, tour[i - 1], first)) +
+                     Cost(costs, last, tour[i + length]) -
+                     Cost(costs, tour[i - 1], tour[i + length]);
+
+      // What putting it back in between two other locations costs
+      for (uint32_t k = 0; k + 1 < count_; k++) {
+        if (k + 1 >= i && k < i + length) {
+          continue;
+        }
+        double diff = static_cast<double>(Cost(costs, tour[k], first)) +
+                      Cost(costs, last, tour[k + 1]) - Cost(costs, tour[k], tour[k + 1]) - saved;
+        if (diff < -kMinImprovement) {
+          if (k < i) {
+            std::rotate(tour.begin() + k + 1, tour.begin() + i, tour.begin() + i + length);
+          } else {
+            std::rotate(tour.begin() + i, tour.begin() + i + length, tour.begin() + k + 1);
+          }
+          improved = true;
+          break;
+        }
+      }
+    }
+  }
+  return improved;
 }
 
 // Perform the annealing process.
@@ -106,8 +259,7 @@ void Optimizer::CreateRandomTour() {
   for (uint32_t i = 1; i < count_ - 1; i++) {
     tour_.push_back(i);
   }
-  std::random_device rd;
-  std::shuffle(tour_.begin(), tour_.end(), std::mt19937(rd()));
+  std::shuffle(tour_.begin(), tour_.end(), random_generator_);
   tour_.insert(tour_.begin(), 0);
   tour_.push_back(count_ - 1);
 }
@@ -0,0 +1,819 @@
+#include "thor/raptor.h"
+#include "baldr/datetime.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/distanceapproximator.h"
+#include "midgard/logging.h"
+#include "worker.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::sif;
+
+namespace {
+
+constexpr uint32_t kInitialEdgeLabelCount = 200000;
+
+// Arrival at a stop or the destination that has not been reached
+constexpr uint32_t kUnreached = std::numeric_limits<uint32_t>::max();
+
+// Walk target to walk as far as possible, recording every stop along the way
+constexpr uint32_t kAllStops = valhalla::thor::kInvalidTimetableIndex - 1;
+
+// Walks from and to the locations are limited by the pedestrian costing itself
+constexpr uint32_t kUnlimitedWalk = std::numeric_limits<uint32_t>::max();
+
+// The most transit legs a journey can have
+constexpr uint32_t kMaxRounds = 8;
+
+// Time to board a different trip at the stop a trip was left at, the same as the label setting
+// algorithm gives an in-station transfer
+constexpr uint32_t kInStationTransferSecs = 30;
+
+// The timetable covers the transit tiles within this many meters around the locations, or this
+// fraction of the distance between them if that is more
+constexpr float kMinTimetableMargin = 10000.0f;
+constexpr float kTimetableMarginFactor = 0.5f;
+
+// The timetable kept between requests grows to cover new areas up to this many tiles
+constexpr size_t kMaxTimetableTiles = 256;
+
+// Whether the transit costing allows a route or a stop
+constexpr uint8_t kUnknown = 0;
+constexpr uint8_t kAllowed = 1;
+constexpr uint8_t kDisallowed = 2;
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+RaptorPathAlgorithm::RaptorPathAlgorithm(const boost::property_tree::ptree& config)
+    : PathAlgorithm(), departure_window_(config.get<uint32_t>("transit_departure_window", 0)),
+      max_transfer_distance_(0), start_time_(0), access_slack_(0), transfer_slack_(0),
+      max_reserved_labels_count_(
+          config.get<uint32_t>("max_reserved_labels_count", kInitialEdgeLabelCount)),
+      timetable_key_(0), timetable_generation_(0), dest_arrival_(kUnreached), dest_round_(0),
+      dest_stop_(kInvalidTimetableIndex),
+      walk_status_(config.get<uint32_t>("max_reserved_edge_status_count",
+                                        kDefaultReservedEdgeStatusCount)),
+      walk_dest_label_(kInvalidLabel),
+      walk_dest_arrival_(kUnreached) {
+}
+
+// Clear the temporary information generated during path construction. The timetable is kept.
+void RaptorPathAlgorithm::Clear() {
+  if (walk_labels_.size() > max_reserved_labels_count_) {
+    walk_labels_.resize(max_reserved_labels_count_);
+    walk_labels_.shrink_to_fit();
+  }
+  ResetWalk();
+  walk_queue_.clear();
+  destinations_.clear();
+  labels_.clear();
+  marked_.clear();
+  route_queue_.clear();
+  has_ferry_ = false;
+}
+
+std::vector<std::vector<PathInfo>>
+RaptorPathAlgorithm::GetBestPath(valhalla::Location& origin,
+                                 valhalla::Location& destination,
+                                 GraphReader& graphreader,
+                                 const sif::mode_costing_t& mode_costing,
+                                 const TravelMode mode,
+                                 const Options& options) {
+  // Walking uses transit connections and is limited to the max multimodal distance
+  const auto& pc = mode_costing[static_cast<uint32_t>(TravelMode::kPedestrian)];
+  pc->SetAllowTransitConnections(true);
+  pc->UseMaxMultiModalDistance();
+  const auto& costing = mode_costing[static_cast<uint32_t>(mode)];
+  const auto& tc = mode_costing[static_cast<uint32_t>(TravelMode::kPublicTransit)];
+  max_transfer_distance_ = costing->GetMaxTransferDistanceMM();
+  access_slack_ = tc->DefaultTransferCost().secs;
+  transfer_slack_ = tc->TransferCost().secs;
+
+  // For now the date_time must be set on the origin, a current one is set to the local time
+  if (!origin.has_date_time()) {
+    return {};
+  }
+  TimeInfo::make(origin, graphreader, &tz_cache_);
+  start_time_ = DateTime::seconds_from_midnight(origin.date_time());
+
+  LoadTimetable(graphreader, origin, destination, tc);
+  const auto stop_count = timetable_->stop_count();
+  for (const auto& tile_id : timetable_tiles_) {
+    auto tile = graphreader.GetGraphTile(tile_id);
+    if (tile) {
+      tc->AddToExcludeList(tile);
+    }
+  }
+  route_allowed_.assign(timetable_->route_count(), kUnknown);
+  stop_allowed_.assign(stop_count, kUnknown);
+
+  // How long it takes to walk from each stop to the destination
+  ResetWalk();
+  SetDestination(graphreader, destination, pc);
+  Walk(graphreader, pc, kUnlimitedWalk, kAllStops);
+  egress_.assign(stop_count, kUnreached);
+  bool has_egress = false;
+  for (const auto& stop : walk_stops_) {
+    auto secs = static_cast<uint32_t>(walk_labels_[stop.second].cost().secs);
+    egress_[stop.first] = std::min(egress_[stop.first], secs);
+    has_egress = true;
+  }
+
+  // How long it takes to walk from the origin to each stop and maybe to the destination
+  ResetWalk();
+  SeedOrigin(graphreader, origin, 0, pc);
+  Walk(graphreader, pc, kUnlimitedWalk, kAllStops);
+  access_.assign(stop_count, kUnreached);
+  for (const auto& stop : walk_stops_) {
+    auto secs = static_cast<uint32_t>(walk_labels_[stop.second].cost().secs);
+    access_[stop.first] = std::min(access_[stop.first], secs);
+  }
+  auto direct = walk_dest_arrival_;
+  if (!has_egress && direct == kUnreached) {
+    throw valhalla_exception_t{440};
+  }
+
+  // Within the departure window every departure from the stops around the origin is a run of its
+  // own, latest first so each run can reuse the arrivals of the ones before it
+  std::vector<uint32_t> departures;
+  if (departure_window_ > 0) {
+    for (uint32_t stop = 0; stop < stop_count; ++stop) {
+      if (access_[stop] == kUnreached) {
+        continue;
+      }
+      auto slack = access_[stop] + access_slack_;
+      auto routes = timetable_->stop_routes(stop);
+      for (auto served = routes.first; served != routes.second; ++served) {
+        const auto& route = timetable_->route(served->first);
+        auto trip = timetable_->EarliestTrip(route, served->second, start_time_ + slack);
+        for (; trip != kInvalidTimetableIndex && trip < route.trip_count; ++trip) {
+          auto departure = timetable_->stop_time(route, trip, served->second).departure;
+          if (departure > start_time_ + departure_window_ + slack) {
+            break;
+          }
+          departures.push_back(departure - slack);
+        }
+      }
+    }
+    std::sort(departures.begin(), departures.end(), std::greater<uint32_t>());
+    departures.erase(std::unique(departures.begin(), departures.end()), departures.end());
+    departures.erase(std::remove(departures.begin(), departures.end(), start_time_),
+                     departures.end());
+  }
+  departures.push_back(start_time_);
+
+  labels_.assign((kMaxRounds + 1) * stop_count,
+                 {kUnreached, Reached::kNot, kInvalidTimetableIndex, kInvalidTimetableIndex,
+                  kInvalidTimetableIndex, kInvalidTimetableIndex});
+  best_.assign(stop_count, kUnreached);
+  is_marked_.assign(stop_count, 0);
+  marked_.clear();
+  route_from_.assign(timetable_->route_count(), kInvalidTimetableIndex);
+  route_queue_.clear();
+  dest_arrival_ = kUnreached;
+  dest_stop_ = kInvalidTimetableIndex;
+
+  // Keep the journey of every run that arrives earlier than the runs leaving later
+  std::vector<Journey> journeys;
+  for (const auto departure : departures) {
+    auto arrival = dest_arrival_;
+    // Walking the whole way only competes with transit at the requested departure
+    if (departure == start_time_ && direct != kUnreached && departure + direct < dest_arrival_) {
+      dest_arrival_ = departure + direct;
+      dest_stop_ = kInvalidTimetableIndex;
+    }
+    Run(graphreader, departure, pc, tc);
+    if (dest_arrival_ < arrival) {
+      journeys.push_back(Trace(departure));
+    }
+  }
+
+  // The journey arriving first is the best path, the ones that leave later are alternates
+  std::vector<std::vector<PathInfo>> paths;
+  const size_t max_paths = 1 + options.alternates();
+  for (auto journey = journeys.rbegin(); journey != journeys.rend() && paths.size() < max_paths;
+       ++journey) {
+    auto path = FormPath(graphreader, origin, *journey, pc);
+    if (!path.empty()) {
+      paths.emplace_back(std::move(path));
+    }
+  }
+  if (paths.empty()) {
+    LOG_ERROR("Route failed after " + std::to_string(departures.size()) + " runs");
+  }
+  return paths;
+}
+
+void RaptorPathAlgorithm::LoadTimetable(GraphReader& graphreader,
+                                        const valhalla::Location& origin,
+                                        const valhalla::Location& dest,
+                                        const std::shared_ptr<DynamicCost>& tc) {
+  // The service day and the departures that are kept
+  auto date = DateTime::days_from_pivot_date(DateTime::get_formatted_date(origin.date_time()));
+  auto dow = DateTime::day_of_week_mask(origin.date_time());
+  uint64_t key = (static_cast<uint64_t>(date) << 32) | (dow << 2) | (tc->wheelchair() << 1) |
+                 static_cast<uint64_t>(tc->bicycle());
+
+  // The transit tiles around the locations
+  PointLL a(origin.ll().lng(), origin.ll().lat());
+  PointLL b(dest.ll().lng(), dest.ll().lat());
+  auto margin =
+      std::max(kMinTimetableMargin, static_cast<float>(a.Distance(b)) * kTimetableMarginFactor);
+  auto dlat = margin / kMetersPerDegreeLat;
+  auto dlng = margin / DistanceApproximator<PointLL>::MetersPerLngDegree((a.lat() + b.lat()) / 2);
+  AABB2<PointLL> box(std::min(a.lng(), b.lng()) - dlng, std::min(a.lat(), b.lat()) - dlat,
+                     std::max(a.lng(), b.lng()) + dlng, std::max(a.lat(), b.lat()) + dlat);
+  const auto& level = TileHierarchy::GetTransitLevel();
+  std::vector<GraphId> tiles;
+  for (const auto id : level.tiles.TileList(box)) {
+    GraphId tile_id(id, level.level, 0);
+    if (graphreader.DoesTileExist(tile_id)) {
+      tiles.push_back(tile_id);
+    }
+  }
+  std::sort(tiles.begin(), tiles.end());
+
+  // Reuse the last timetable if it is for the same day and covers these tiles, otherwise grow it
+  bool same_day = timetable_ && key == timetable_key_ &&
+                  graphreader.TileExtractGeneration() == timetable_generation_;
+  if (same_day &&
+      std::includes(timetable_tiles_.begin(), timetable_tiles_.end(), tiles.begin(), tiles.end())) {
+    return;
+  }
+  if (same_day) {
+    std::vector<GraphId> both;
+    std::set_union(timetable_tiles_.begin(), timetable_tiles_.end(), tiles.begin(), tiles.end(),
+                   std::back_inserter(both));
+    if (both.size() <= kMaxTimetableTiles) {
+      tiles.swap(both);
+    }
+  }
+  timetable_ =
+      TransitTimetable::Build(graphreader, tiles, date, dow, tc->wheelchair(), tc->bicycle());
+  timetable_tiles_.swap(tiles);
+  timetable_key_ = key;
+  timetable_generation_ = graphreader.TileExtractGeneration();
+}
+
+bool RaptorPathAlgorithm::RouteAllowed(GraphReader& graphreader,
+                                       const uint32_t route,
+                                       const std::shared_ptr<DynamicCost>& tc) {
+  auto& allowed = route_allowed_[route];
+  if (allowed == kUnknown) {
+    allowed = kAllowed;
+    const auto& r = timetable_->route(route);
+    EdgeLabel pred;
+    uint8_t restriction_idx = kInvalidRestriction;
+    for (uint32_t pos = 0; pos + 1 < r.stop_count; ++pos) {
+      const auto& edgeid = timetable_->route_edge(r, pos);
+      auto tile = graphreader.GetGraphTile(edgeid);
+      if (!tile) {
+        allowed = kDisallowed;
+        break;
+      }
+      const DirectedEdge* edge = tile->directededge(edgeid);
+      if (!tc->Allowed(edge, false, pred, tile, edgeid, 0, 0, restriction_idx) ||
+          tc->IsExcluded(tile, edge)) {
+        allowed = kDisallowed;
+        break;
+      }
+    }
+  }
+  return allowed == kAllowed;
+}
+
+bool RaptorPathAlgorithm::StopAllowed(GraphReader& graphreader,
+                                      const uint32_t stop,
+                                      const std::shared_ptr<DynamicCost>& tc) {
+  auto& allowed = stop_allowed_[stop];
+  if (allowed == kUnknown) {
+    const auto& node = timetable_->stop(stop);
+    auto tile = graphreader.GetGraphTile(node);
+    allowed = tile && !tc->IsExcluded(tile, tile->node(node)) ? kAllowed : kDisallowed;
+  }
+  return allowed == kAllowed;
+}
+
+void RaptorPathAlgorithm::Run(GraphReader& graphreader,
+                              const uint32_t departure,
+                              const std::shared_ptr<DynamicCost>& pc,
+                              const std::shared_ptr<DynamicCost>& tc) {
+  // Round 0 walks from the origin, every later round takes one more trip
+  for (uint32_t stop = 0; stop < access_.size(); ++stop) {
+    if (access_[stop] != kUnreached) {
+      Improve(0, stop,
+              {departure + access_[stop], Reached::kAccess, kInvalidTimetableIndex,
+               kInvalidTimetableIndex, kInvalidTimetableIndex, kInvalidTimetableIndex});
+    }
+  }
+  for (uint32_t round = 1; round <= kMaxRounds && !marked_.empty(); ++round) {
+    if (interrupt) {
+      (*interrupt)();
+    }
+    ScanRoutes(graphreader, round, tc);
+    Transfer(graphreader, round, pc);
+  }
+  for (const auto stop : marked_) {
+    is_marked_[stop] = 0;
+  }
+  marked_.clear();
+}
+
+void RaptorPathAlgorithm::ScanRoutes(GraphReader& graphreader,
+                                     const uint32_t round,
+                                     const std::shared_ptr<DynamicCost>& tc) {
+  // Queue the routes serving the stops reached in the last round from the first of those stops
+  for (const auto stop : marked_) {
+    is_marked_[stop] = 0;
+    auto routes = timetable_->stop_routes(stop);
+    for (auto served = routes.first; served != routes.second; ++served) {
+      auto& from = route_from_[served->first];
+      if (from == kInvalidTimetableIndex) {
+        route_queue_.push_back(served->first);
+        from = served->second;
+      } else {
+        from = std::min(from, served->second);
+      }
+    }
+  }
+  marked_.clear();
+
+  const auto stop_count = timetable_->stop_count();
+  const auto* previous = labels_.data() + (round - 1) * stop_count;
+  for (const auto r : route_queue_) {
+    auto from = route_from_[r];
+    route_from_[r] = kInvalidTimetableIndex;
+    if (!RouteAllowed(graphreader, r, tc)) {
+      continue;
+    }
+
+    // Ride the earliest trip that can be caught so far, hopping on an earlier one when possible
+    const auto& route = timetable_->route(r);
+    uint32_t trip = kInvalidTimetableIndex;
+    uint32_t board = 0;
+    for (uint32_t pos = from; pos < route.stop_count; ++pos) {
+      auto stop = timetable_->route_stop(route, pos);
+      if (!StopAllowed(graphreader, stop, tc)) {
+        trip = kInvalidTimetableIndex;
+        continue;
+      }
+      if (trip != kInvalidTimetableIndex) {
+        Improve(round, stop,
+                {timetable_->stop_time(route, trip, pos).arrival, Reached::kRide, r, trip, board,
+                 pos});
+      }
+
+      const auto& reached = previous[stop];
+      if (reached.reached == Reached::kNot || pos + 1 == route.stop_count) {
+        continue;
+      }
+      auto ready = reached.arrival + (reached.reached == Reached::kAccess ? access_slack_
+                                      : reached.reached == Reached::kRide ? kInStationTransferSecs
+                                                                          : transfer_slack_);
+      if (trip == kInvalidTimetableIndex ||
+          ready <= timetable_->stop_time(route, trip, pos).departure) {
+        auto earliest = timetable_->EarliestTrip(route, pos, ready);
+        if (earliest != kInvalidTimetableIndex && earliest != trip) {
+          trip = earliest;
+          board = pos;
+        }
+      }
+    }
+  }
+  route_queue_.clear();
+}
+
+void RaptorPathAlgorithm::Transfer(GraphReader& graphreader,
+                                   const uint32_t round,
+                                   const std::shared_ptr<DynamicCost>& pc) {
+  // Walk from the end of the trips to the stops around where they were left
+  const auto* labels = labels_.data() + round * timetable_->stop_count();
+  ResetWalk();
+  for (const auto stop : marked_) {
+    const auto& label = labels[stop];
+    if (label.reached == Reached::kRide) {
+      const auto& route = timetable_->route(label.route);
+      SeedEdge(graphreader, timetable_->route_edge(route, label.alight - 1), label.arrival);
+    }
+  }
+  if (walk_labels_.empty()) {
+    return;
+  }
+  Walk(graphreader, pc, max_transfer_distance_, kAllStops);
+
+  // The walk started at the stop the edge it starts from ends at
+  auto walk_stops = walk_stops_;
+  for (const auto& reached : walk_stops) {
+    auto start = reached.second;
+    while (walk_labels_[start].predecessor() != kInvalidLabel) {
+      start = walk_labels_[start].predecessor();
+    }
+    Improve(round, reached.first,
+            {static_cast<uint32_t>(walk_labels_[reached.second].cost().secs), Reached::kTransfer,
+             kInvalidTimetableIndex, kInvalidTimetableIndex,
+             timetable_->stop_index(walk_labels_[start].endnode()), kInvalidTimetableIndex});
+  }
+}
+
+bool RaptorPathAlgorithm::Improve(const uint32_t round,
+                                  const uint32_t stop,
+                                  const StopLabel& label) {
+  // Only an arrival earlier than any so far at the stop and at the destination helps
+  if (label.arrival >= best_[stop] || label.arrival >= dest_arrival_) {
+    return false;
+  }
+  labels_[round * timetable_->stop_count() + stop] = label;
+  best_[stop] = label.arrival;
+  if (egress_[stop] != kUnreached && label.arrival + egress_[stop] < dest_arrival_) {
+    dest_arrival_ = label.arrival + egress_[stop];
+    dest_round_ = round;
+    dest_stop_ = stop;
+  }
+  if (!is_marked_[stop]) {
+    is_marked_[stop] = 1;
+    marked_.push_back(stop);
+  }
+  return true;
+}
+
+void RaptorPathAlgorithm::SetDestination(GraphReader& graphreader,
+                                         const valhalla::Location& dest,
+                                         const std::shared_ptr<DynamicCost>& pc) {
+  // Only skip outbound edges if we have other options
+  bool has_other_edges =
+      std::any_of(dest.path_edges().begin(), dest.path_edges().end(),
+                  [](const valhalla::Location::PathEdge& e) { return !e.begin_node(); });
+
+  destinations_.clear();
+  for (const auto& edge : dest.path_edges()) {
+    GraphId edgeid(edge.graph_id());
+    if ((has_other_edges && edge.begin_node()) ||
+        pc->AvoidAsDestinationEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+    auto tile = graphreader.GetGraphTile(edgeid);
+    if (!tile) {
+      continue;
+    }
+
+    // Keep the cost of the rest of the edge past the destination
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    destinations_[edgeid] = pc->EdgeCost(directededge, tile) * (1.0f - edge.percent_along());
+
+    // Walk away from the destination along the opposing edge
+    graph_tile_ptr opp_tile = tile;
+    GraphId oppedge = graphreader.GetOpposingEdgeId(edgeid, opp_tile);
+    if (!oppedge.Is_Valid()) {
+      continue;
+    }
+    const DirectedEdge* opp_directededge = opp_tile->directededge(oppedge);
+    Cost cost = pc->EdgeCost(opp_directededge, opp_tile) * edge.percent_along();
+    walk_labels_.emplace_back(kInvalidLabel, oppedge, opp_directededge, cost, cost.secs, 0.0f,
+                              TravelMode::kPedestrian,
+                              static_cast<uint32_t>(opp_directededge->length() *
+                                                    edge.percent_along()),
+                              Cost{}, kInvalidRestriction, true, false, InternalTurn::kNoTurn);
+    walk_labels_.back().set_origin();
+  }
+}
+
+void RaptorPathAlgorithm::ResetWalk() {
+  search_metrics_.Record(name(), walk_labels_.size());
+  walk_labels_.clear();
+  walk_status_.clear();
+  walk_stops_.clear();
+  walk_dest_label_ = kInvalidLabel;
+  walk_dest_arrival_ = kUnreached;
+}
+
+void RaptorPathAlgorithm::SeedOrigin(GraphReader& graphreader,
+                                     const valhalla::Location& origin,
+                                     const uint32_t time,
+                                     const std::shared_ptr<DynamicCost>& pc) {
+  // Only skip inbound edges if we have other options
+  bool has_other_edges =
+      std::any_of(origin.path_edges().begin(), origin.path_edges().end(),
+                  [](const valhalla::Location::PathEdge& e) { return !e.end_node(); });
+
+  for (const auto& edge : origin.path_edges()) {
+    GraphId edgeid(edge.graph_id());
+    if ((has_other_edges && edge.end_node()) ||
+        pc->AvoidAsOriginEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+    auto tile = graphreader.GetGraphTile(edgeid);
+    if (!tile) {
+      continue;
+    }
+
+    // Walk the rest of the edge past the origin
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    Cost cost = pc->EdgeCost(directededge, tile) * (1.0f - edge.percent_along());
+    cost.secs += time;
+    auto distance = static_cast<uint32_t>(directededge->length() * (1.0f - edge.percent_along()));
+    uint32_t idx = walk_labels_.size();
+    walk_labels_.emplace_back(kInvalidLabel, edgeid, directededge, cost, cost.secs, 0.0f,
+                              TravelMode::kPedestrian, distance, Cost{}, kInvalidRestriction, true,
+                              false, InternalTurn::kNoTurn);
+    walk_labels_.back().set_origin();
+
+    // The destination may be further along the same edge
+    auto dest = destinations_.find(edgeid);
+    if (dest != destinations_.end() && dest->second.secs <= cost.secs - time) {
+      auto arrival = static_cast<uint32_t>(cost.secs - dest->second.secs);
+      if (arrival < walk_dest_arrival_) {
+        walk_dest_arrival_ = arrival;
+        walk_dest_label_ = idx;
+      }
+    }
+  }
+}
+
+void RaptorPathAlgorithm::SeedEdge(GraphReader& graphreader,
+                                   const GraphId& edgeid,
+                                   const uint32_t time) {
+  auto tile = graphreader.GetGraphTile(edgeid);
+  if (!tile) {
+    return;
+  }
+  // Not an origin, its predecessor is invalid and it is not part of the walk
+  Cost cost(time, time);
+  walk_labels_.emplace_back(kInvalidLabel, edgeid, tile->directededge(edgeid), cost, cost.secs,
+                            0.0f, TravelMode::kPedestrian, 0, Cost{}, kInvalidRestriction, true,
+                            false, InternalTurn::kNoTurn);
+}
+
+uint32_t RaptorPathAlgorithm::Walk(GraphReader& graphreader,
+                                   const std::shared_ptr<DynamicCost>& pc,
+                                   const uint32_t max_distance,
+                                   const uint32_t target) {
+  if (walk_labels_.empty()) {
+    return kInvalidLabel;
+  }
+
+  // Walks are sorted by arrival time in buckets of a second
+  float mincost = std::numeric_limits<float>::max();
+  for (const auto& label : walk_labels_) {
+    mincost = std::min(mincost, label.sortcost());
+  }
+  walk_queue_.reuse(mincost, kBucketCount, 1, &walk_labels_);
+  for (uint32_t idx = 0; idx < walk_labels_.size(); ++idx) {
+    walk_queue_.add(idx);
+  }
+
+  size_t total_labels = 0;
+  uint32_t predindex;
+  while ((predindex = walk_queue_.pop()) != kInvalidLabel) {
+    // Allow this process to be aborted
+    size_t current_labels = walk_labels_.size();
+    if (interrupt && total_labels / kInterruptIterationsInterval <
+                         current_labels / kInterruptIterationsInterval) {
+      (*interrupt)();
+    }
+    total_labels = current_labels;
+
+    // Copy the label, the expansion may grow the labels
+    EdgeLabel pred = walk_labels_[predindex];
+    bool seed = pred.predecessor() == kInvalidLabel;
+    if (!seed) {
+      walk_status_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      search_metrics_.Settle();
+    }
+
+    // A destination edge, the origin edges were checked when they were seeded
+    if (!pred.origin()) {
+      auto dest = destinations_.find(pred.edgeid());
+      if (dest != destinations_.end()) {
+        auto arrival = static_cast<uint32_t>(pred.cost().secs - dest->second.secs);
+        if (arrival < walk_dest_arrival_) {
+          walk_dest_arrival_ = arrival;
+          walk_dest_label_ = predindex;
+        }
+        if (target == kInvalidTimetableIndex) {
+          walk_queue_.clear();
+          return walk_dest_label_;
+        }
+      }
+    }
+
+    // A stop is walked to but not through, unless the walk starts there
+    auto tile = graphreader.GetGraphTile(pred.endnode());
+    if (!tile) {
+      continue;
+    }
+    if (tile->node(pred.endnode())->type() == NodeType::kMultiUseTransitPlatform) {
+      auto stop = timetable_->stop_index(pred.endnode());
+      if (stop != kInvalidTimetableIndex) {
+        walk_stops_.emplace_back(stop, predindex);
+        if (stop == target) {
+          walk_queue_.clear();
+          return predindex;
+        }
+      }
+      if (!seed || pred.origin()) {
+        continue;
+      }
+    }
+    ExpandWalk(graphreader, pred.endnode(), pred, predindex, pc, max_distance, false);
+  }
+  return target == kInvalidTimetableIndex ? walk_dest_label_ : kInvalidLabel;
+}
+
+void RaptorPathAlgorithm::ExpandWalk(GraphReader& graphreader,
+                                     const GraphId& node,
+                                     const EdgeLabel& pred,
+                                     const uint32_t pred_idx,
+                                     const std::shared_ptr<DynamicCost>& pc,
+                                     const uint32_t max_distance,
+                                     const bool from_transition) {
+  auto tile = graphreader.GetGraphTile(node);
+  if (tile == nullptr) {
+    return;
+  }
+  const NodeInfo* nodeinfo = tile->node(node);
+  if (!pc->Allowed(nodeinfo)) {
+    return;
+  }
+
+  GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
+  EdgeStatusInfo* es = walk_status_.GetPtr(edgeid, tile);
+  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid, ++es) {
+    // Trips are only taken by the rounds
+    if (directededge->is_shortcut() || directededge->IsTransitLine() ||
+        es->set() == EdgeSet::kPermanent) {
+      continue;
+    }
+
+    // Prevent going from one transit connection directly to another at a transit stop - this is
+    // like entering a station and exiting without getting on transit
+    if (nodeinfo->type() == NodeType::kTransitEgress && pred.use() == Use::kTransitConnection &&
+        directededge->use() == Use::kTransitConnection) {
+      continue;
+    }
+
+    uint32_t walking_distance = pred.path_distance() + directededge->length();
+    uint8_t restriction_idx = kInvalidRestriction;
+    const bool is_dest = destinations_.find(edgeid) != destinations_.cend();
+    if (walking_distance > max_distance ||
+        !pc->Allowed(directededge, is_dest, pred, tile, edgeid, 0, 0, restriction_idx)) {
+      continue;
+    }
+
+    auto transition_cost = pc->TransitionCost(directededge, nodeinfo, pred);
+    Cost newcost = pred.cost() + pc->EdgeCost(directededge, tile) + transition_cost;
+
+    // Check if the edge is reached sooner
+    if (es->set() == EdgeSet::kTemporary) {
+      EdgeLabel& lab = walk_labels_[es->index()];
+      if (newcost.secs < lab.cost().secs) {
+        walk_queue_.decrease(es->index(), newcost.secs);
+        lab.Update(pred_idx, newcost, newcost.secs, walking_distance, transition_cost,
+                   restriction_idx);
+      }
+      continue;
+    }
+
+    uint32_t idx = walk_labels_.size();
+    walk_labels_.emplace_back(pred_idx, edgeid, directededge, newcost, newcost.secs, 0.0f,
+                              TravelMode::kPedestrian, walking_distance, transition_cost,
+                              restriction_idx, true, false, InternalTurn::kNoTurn);
+    *es = {EdgeSet::kTemporary, idx};
+    walk_queue_.add(idx);
+  }
+
+  // Handle transitions - expand from the end node each transition
+  if (!from_transition && nodeinfo->transition_count() > 0) {
+    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
+      ExpandWalk(graphreader, trans->endnode(), pred, pred_idx, pc, max_distance, true);
+    }
+  }
+}
+
+RaptorPathAlgorithm::Journey RaptorPathAlgorithm::Trace(const uint32_t departure) const {
+  Journey journey{departure, dest_arrival_, {}};
+  if (dest_stop_ == kInvalidTimetableIndex) {
+    return journey;
+  }
+
+  // Arrivals only get earlier along the way back so this always ends at the origin
+  const auto stop_count = timetable_->stop_count();
+  auto round = dest_round_;
+  auto stop = dest_stop_;
+  while (true) {
+    const auto& label = labels_[round * stop_count + stop];
+    journey.legs.emplace_back(stop, label);
+    if (label.reached == Reached::kRide) {
+      stop = timetable_->route_stop(timetable_->route(label.route), label.from);
+      --round;
+    } else if (label.reached == Reached::kTransfer) {
+      stop = label.from;
+    } else {
+      break;
+    }
+  }
+  return journey;
+}
+
+std::vector<PathInfo> RaptorPathAlgorithm::FormPath(GraphReader& graphreader,
+                                                    const valhalla::Location& origin,
+                                                    const Journey& journey,
+                                                    const std::shared_ptr<DynamicCost>& pc) {
+  std::vector<PathInfo> path;
+  float path_distance = 0.0f;
+
+  // Walk from the origin to the first stop, or the destination when there is no trip
+  ResetWalk();
+  SeedOrigin(graphreader, origin, journey.departure, pc);
+  if (!journey.legs.empty()) {
+    if (journey.legs.back().second.reached != Reached::kAccess) {
+      return {};
+    }
+    auto label = Walk(graphreader, pc, kUnlimitedWalk, journey.legs.back().first);
+    if (label == kInvalidLabel) {
+      return {};
+    }
+    AppendWalk(label, path, path_distance);
+  }
+
+  // Ride the trips and walk between them
+  for (auto leg = journey.legs.rbegin() + (journey.legs.empty() ? 0 : 1);
+       leg != journey.legs.rend(); ++leg) {
+    const auto& label = leg->second;
+    if (label.reached == Reached::kRide) {
+      const auto& route = timetable_->route(label.route);
+      auto tripid = timetable_->trip(route, label.trip).tripid;
+      for (uint32_t pos = label.from; pos < label.alight; ++pos) {
+        const auto& edgeid = timetable_->route_edge(route, pos);
+        auto tile = graphreader.GetGraphTile(edgeid);
+        if (!tile) {
+          return {};
+        }
+        path_distance += tile->directededge(edgeid)->length();
+        float elapsed = timetable_->stop_time(route, label.trip, pos + 1).arrival - start_time_;
+        path.emplace_back(TravelMode::kPublicTransit, Cost{elapsed, elapsed}, edgeid, tripid,
+                          path_distance);
+      }
+    } else {
+      ResetWalk();
+      SeedEdge(graphreader, path.back().edgeid, start_time_ + path.back().elapsed_cost.secs);
+      auto found = Walk(graphreader, pc, max_transfer_distance_, leg->first);
+      if (found == kInvalidLabel) {
+        return {};
+      }
+      AppendWalk(found, path, path_distance);
+    }
+  }
+
+  // Walk from the last stop to the destination
+  if (!path.empty()) {
+    ResetWalk();
+    SeedEdge(graphreader, path.back().edgeid, start_time_ + path.back().elapsed_cost.secs);
+  }
+  auto found = Walk(graphreader, pc, kUnlimitedWalk, kInvalidTimetableIndex);
+  if (found == kInvalidLabel) {
+    return {};
+  }
+  AppendWalk(found, path, path_distance);
+
+  // The destination is part way along the last edge
+  float elapsed = walk_dest_arrival_ - static_cast<float>(start_time_);
+  path.back().elapsed_cost = Cost{elapsed, elapsed};
+  return path;
+}
+
+void RaptorPathAlgorithm::AppendWalk(uint32_t label,
+                                     std::vector<PathInfo>& path,
+                                     float& path_distance) {
+  // The edge a walk is seeded with ends where the walk starts and is not part of it
+  std::vector<uint32_t> labels;
+  for (; label != kInvalidLabel; label = walk_labels_[label].predecessor()) {
+    const auto& edgelabel = walk_labels_[label];
+    if (edgelabel.predecessor() == kInvalidLabel && !edgelabel.origin()) {
+      break;
+    }
+    labels.push_back(label);
+  }
+
+  float start_distance = path_distance;
+  for (auto idx = labels.rbegin(); idx != labels.rend(); ++idx) {
+    const auto& edgelabel = walk_labels_[*idx];
+    float elapsed = edgelabel.cost().secs - start_time_;
+    path_distance = start_distance + edgelabel.path_distance();
+    path.emplace_back(TravelMode::kPedestrian, Cost{elapsed, elapsed}, edgelabel.edgeid(), 0,
+                      path_distance, edgelabel.restriction_idx(), edgelabel.transition_cost());
+    if (edgelabel.use() == Use::kFerry) {
+      has_ferry_ = true;
+    }
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
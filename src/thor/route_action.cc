@@ -214,6 +214,7 @@ std::string thor_worker_t::expansion(Api& request) {
   // tell all the algorithms how to track expansion
   for (auto* alg : std::vector<PathAlgorithm*>{
            &multi_modal_astar,
+           &multi_modal_raptor,
            &timedep_forward,
            &timedep_reverse,
            &bidir_astar,
@@ -232,6 +233,7 @@ std::string thor_worker_t::expansion(Api& request) {
   // tell all the algorithms to stop tracking the expansion
   for (auto* alg : std::vector<PathAlgorithm*>{
            &multi_modal_astar,
+           &multi_modal_raptor,
            &timedep_forward,
            &timedep_reverse,
            &bidir_astar,
@@ -308,6 +310,7 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
   // make sure they are all cancelable
   for (auto* alg : std::vector<PathAlgorithm*>{
            &multi_modal_astar,
+           &multi_modal_raptor,
            &timedep_forward,
            &timedep_reverse,
            &bidir_astar,
@@ -318,7 +321,7 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
 
   // Have to use multimodal for transit based routing
   if (routetype == "multimodal" || routetype == "transit") {
-    return &multi_modal_astar;
+    return use_raptor ? static_cast<PathAlgorithm*>(&multi_modal_raptor) : &multi_modal_astar;
   }
 
   // Have to use bike share station algorithm
@@ -361,6 +364,16 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
     }
   }
 
+  // Time independent auto routes with the default costing can use the contraction hierarchy, as
+  // long as they run on the tiles it was built for
+  if (contraction_hierarchy && reader->TileExtractGeneration() == contraction_generation &&
+      options.costing() == Costing::auto_ && !options.alternates() && !origin.has_date_time() &&
+      !destination.has_date_time() &&
+      options.costing_options(Costing::auto_).SerializeAsString() == contraction_costing_options) {
+    contraction_hierarchy->set_interrupt(interrupt);
+    return contraction_hierarchy.get();
+  }
+
   // No other special cases we land on bidirectional a*
   return &bidir_astar;
 }
@@ -379,6 +392,21 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
   cost->set_allow_destination_only(path_algorithm == &bidir_astar ? false : true);
 
   cost->set_pass(0);
+
+  // The contraction hierarchy knows nothing of restrictions or turns. If the costing does not allow
+  // the path it found we fall back to bidirectional A*
+  if (contraction_hierarchy && path_algorithm == contraction_hierarchy.get()) {
+    auto paths =
+        path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+    if (!paths.empty()) {
+      return paths;
+    }
+    LOG_INFO("contraction_hierarchy::falling back to bidirectional_astar");
+    path_algorithm = &bidir_astar;
+    path_algorithm->Clear();
+    cost->set_allow_destination_only(false);
+  }
+
   auto paths = path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
 
   // Check if we should run a second pass pedestrian route with different A*
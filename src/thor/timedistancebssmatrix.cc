@@ -48,6 +48,9 @@ float TimeDistanceBSSMatrix::GetCostThreshold(const float max_matrix_distance) c
 // Clear the temporary information generated during time + distance matrix
 // construction.
 void TimeDistanceBSSMatrix::Clear() {
+  // Hand the work of the last search to the metrics
+  search_metrics_.Record("time_distance_bss_matrix", edgelabels_.size());
+
   // Clear the edge labels and destination list
   edgelabels_.clear();
   destinations_.clear();
@@ -209,10 +212,12 @@ std::vector<TimeDistance> TimeDistanceBSSMatrix::OneToMany(
     // edge (this will allow loops/around the block cases)
     if (!pred.origin() && pred.mode() == TravelMode::kPedestrian) {
       pedestrian_edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      search_metrics_.Settle();
     }
 
     if (!pred.origin() && pred.mode() == TravelMode::kBicycle) {
       bicycle_edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      search_metrics_.Settle();
     }
 
     auto endnode = pred.endnode();
@@ -402,10 +407,12 @@ std::vector<TimeDistance> TimeDistanceBSSMatrix::ManyToOne(
     // edge (this will allow loops/around the block cases)
     if (!pred.origin() && pred.mode() == TravelMode::kPedestrian) {
       pedestrian_edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      search_metrics_.Settle();
     }
 
     if (!pred.origin() && pred.mode() == TravelMode::kBicycle) {
       bicycle_edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      search_metrics_.Settle();
     }
 
     // Identify any destinations on this edge
@@ -1,12 +1,21 @@
 #include "thor/timedistancematrix.h"
 #include "midgard/logging.h"
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
 #include <vector>
 
 using namespace valhalla::baldr;
 using namespace valhalla::sif;
 
 namespace {
+
+// Lowest cost per meter of a ferry, at the highest ferry speed with the costing favouring ferries
+// the most (a ferry factor of 0.5)
+constexpr float kMinFerryCostFactor =
+    0.5f * valhalla::midgard::kSecPerHour * 0.001f / valhalla::baldr::kMaxFerrySpeedKph;
+
 static bool IsTrivial(const uint64_t& edgeid,
                       const valhalla::Location& origin,
                       const valhalla::Location& destination) {
@@ -27,8 +36,22 @@ namespace valhalla {
 namespace thor {
 
 // Constructor with cost threshold.
-TimeDistanceMatrix::TimeDistanceMatrix()
-    : mode_(TravelMode::kDrive), settled_count_(0), current_cost_threshold_(0) {
+TimeDistanceMatrix::TimeDistanceMatrix(const boost::property_tree::ptree& config)
+    : mode_(TravelMode::kDrive), settled_count_(0), current_cost_threshold_(0),
+      edgestatus_(config.get<uint32_t>("max_reserved_edge_status_count",
+                                       kDefaultReservedEdgeStatusCount)),
+      tile_mutex_(nullptr), target_cost_factor_(0.0f) {
+  // Opt in as the bound only holds if the A* cost factor of the costing never overestimates
+  target_pruning_ = config.get<bool>("timedistancematrix_target_pruning", false);
+  threads_ = std::max(1u, config.get<unsigned int>("timedistancematrix_threads", 1));
+#ifndef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+  // Tiles are shared between the searches so their reference counts need to be thread safe
+  if (threads_ > 1) {
+    LOG_WARN("timedistancematrix_threads requires ENABLE_THREAD_SAFE_TILE_REF_COUNT, using 1 "
+             "thread");
+    threads_ = 1;
+  }
+#endif
 }
 
 // Compute a cost threshold in seconds based on average speed for the travel mode.
@@ -55,6 +78,9 @@ float TimeDistanceMatrix::GetCostThreshold(const float max_matrix_distance) cons
 // Clear the temporary information generated during time + distance matrix
 // construction.
 void TimeDistanceMatrix::Clear() {
+  // Hand the work of the last search to the metrics
+  search_metrics_.Record("time_distance_matrix", edgelabels_.size());
+
   // Clear the edge labels and destination list
   edgelabels_.clear();
   destinations_.clear();
@@ -65,6 +91,64 @@ void TimeDistanceMatrix::Clear() {
 
   // Clear the edge status flags
   edgestatus_.clear();
+
+  // Clear the searches of the threads
+  for (auto& worker : workers_) {
+    worker->Clear();
+  }
+}
+
+// Get a tile, the graph reader (and its cache) is not safe to use from multiple threads
+graph_tile_ptr TimeDistanceMatrix::GetGraphTile(GraphReader& graphreader, const GraphId& id) {
+  if (!tile_mutex_) {
+    return graphreader.GetGraphTile(id);
+  }
+  std::lock_guard<std::mutex> lock(*tile_mutex_);
+  return graphreader.GetGraphTile(id);
+}
+
+// Get the opposing edge, the graph reader (and its cache) is not safe to use from multiple threads
+GraphId TimeDistanceMatrix::GetOpposingEdgeId(GraphReader& graphreader,
+                                              const GraphId& edgeid,
+                                              const DirectedEdge*& opp_edge) {
+  graph_tile_ptr tile;
+  if (!tile_mutex_) {
+    return graphreader.GetOpposingEdgeId(edgeid, opp_edge, tile);
+  }
+  std::lock_guard<std::mutex> lock(*tile_mutex_);
+  return graphreader.GetOpposingEdgeId(edgeid, opp_edge, tile);
+}
+
+// Keep the bounding box of the locations the search is looking for
+void TimeDistanceMatrix::SetTargetRegion(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& locations) {
+  std::vector<PointLL> points;
+  for (const auto& loc : locations) {
+    for (const auto& edge : loc.path_edges()) {
+      points.emplace_back(edge.ll().lng(), edge.ll().lat());
+    }
+  }
+  // Costs are at least the cost factor per meter of distance, without one there is no bound. The
+  // A* factor may only bound the main mode of the costing (pedestrians on the first pass), ferries
+  // can be faster and be favoured by up to half their time so take the cheaper of the two
+  target_cost_factor_ =
+      points.empty() ? 0.0f : std::min(costing_->AStarCostFactor(), kMinFerryCostFactor);
+  if (!points.empty()) {
+    target_box_ = AABB2<PointLL>(points);
+  }
+}
+
+// Lower bound of the cost from the node to the closest point of the bounding box of the locations.
+// It is only a true lower bound when no edge costs less per meter than the A* cost factor (or the
+// ferry factor). The costings aim for that but nothing checks it for every costing and its options,
+// hence pruning is opt in
+bool TimeDistanceMatrix::CanReachTargets(const PointLL& ll, const float cost) const {
+  if (!target_pruning_ || target_cost_factor_ <= 0.0f) {
+    return true;
+  }
+  PointLL closest(std::min(std::max(ll.lng(), target_box_.minx()), target_box_.maxx()),
+                  std::min(std::max(ll.lat(), target_box_.miny()), target_box_.maxy()));
+  return cost + ll.Distance(closest) * target_cost_factor_ <= current_cost_threshold_;
 }
 
 // Expand from a node in the forward direction
@@ -75,7 +159,7 @@ void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
                                        const bool from_transition) {
   // Get the tile and the node info. Skip if tile is null (can happen
   // with regional data sets) or if no access at the node.
-  graph_tile_ptr tile = graphreader.GetGraphTile(node);
+  graph_tile_ptr tile = GetGraphTile(graphreader, node);
   if (tile == nullptr) {
     return;
   }
@@ -84,6 +168,12 @@ void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
     return;
   }
 
+  // Skip the node if none of the locations can be reached from it in time
+  if (!from_transition && !CanReachTargets(nodeinfo->latlng(tile->header()->base_ll()),
+                                           pred.cost().cost)) {
+    return;
+  }
+
   // Expand from end node.
   GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
   EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
@@ -172,6 +262,7 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
   settled_count_ = 0;
   SetOriginOneToMany(graphreader, origin);
   SetDestinations(graphreader, locations);
+  SetTargetRegion(locations);
 
   // Find shortest path
   graph_tile_ptr tile;
@@ -192,6 +283,7 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
     // edge. Otherwise loops/around the block cases will not work
     if (!pred.origin()) {
       edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      search_metrics_.Settle();
     }
 
     // Identify any destinations on this edge
@@ -199,7 +291,7 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
     if (destedge != dest_edges_.end()) {
       // Update any destinations along this edge. Return if all destinations
       // have been settled.
-      tile = graphreader.GetGraphTile(pred.edgeid());
+      tile = GetGraphTile(graphreader, pred.edgeid());
       const DirectedEdge* edge = tile->directededge(pred.edgeid());
       if (UpdateDestinations(origin, locations, destedge->second, edge, tile, pred)) {
         return FormTimeDistanceMatrix();
@@ -225,7 +317,7 @@ void TimeDistanceMatrix::ExpandReverse(GraphReader& graphreader,
                                        const bool from_transition) {
   // Get the tile and the node info. Skip if tile is null (can happen
   // with regional data sets) or if no access at the node.
-  graph_tile_ptr tile = graphreader.GetGraphTile(node);
+  graph_tile_ptr tile = GetGraphTile(graphreader, node);
   if (tile == nullptr) {
     return;
   }
@@ -234,6 +326,12 @@ void TimeDistanceMatrix::ExpandReverse(GraphReader& graphreader,
     return;
   }
 
+  // Skip the node if none of the locations can be reached from it in time
+  if (!from_transition && !CanReachTargets(nodeinfo->latlng(tile->header()->base_ll()),
+                                           pred.cost().cost)) {
+    return;
+  }
+
   // Get the opposing predecessor directed edge
   const DirectedEdge* opp_pred_edge = tile->directededge(nodeinfo->edge_index());
   for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, opp_pred_edge++) {
@@ -255,7 +353,7 @@ void TimeDistanceMatrix::ExpandReverse(GraphReader& graphreader,
 
     // Get opposing edge Id and end node tile
     graph_tile_ptr t2 =
-        directededge->leaves_tile() ? graphreader.GetGraphTile(directededge->endnode()) : tile;
+        directededge->leaves_tile() ? GetGraphTile(graphreader, directededge->endnode()) : tile;
     if (t2 == nullptr) {
       continue;
     }
@@ -340,6 +438,7 @@ TimeDistanceMatrix::ManyToOne(const valhalla::Location& dest,
   settled_count_ = 0;
   SetOriginManyToOne(graphreader, dest);
   SetDestinationsManyToOne(graphreader, locations);
+  SetTargetRegion(locations);
 
   // Find shortest path
   graph_tile_ptr tile;
@@ -360,6 +459,7 @@ TimeDistanceMatrix::ManyToOne(const valhalla::Location& dest,
     // edge (this will allow loops/around the block cases)
     if (!pred.origin()) {
       edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      search_metrics_.Settle();
     }
 
     // Identify any destinations on this edge
@@ -367,7 +467,7 @@ TimeDistanceMatrix::ManyToOne(const valhalla::Location& dest,
     if (destedge != dest_edges_.end()) {
       // Update any destinations along this edge. Return if all destinations
       // have been settled.
-      tile = graphreader.GetGraphTile(pred.edgeid());
+      tile = GetGraphTile(graphreader, pred.edgeid());
       const DirectedEdge* edge = tile->directededge(pred.edgeid());
       if (UpdateDestinations(dest, locations, destedge->second, edge, tile, pred)) {
         return FormTimeDistanceMatrix();
@@ -404,21 +504,64 @@ std::vector<TimeDistance> TimeDistanceMatrix::SourceToTarget(
     const sif::TravelMode mode,
     const float max_matrix_distance) {
   // Run a series of one to many calls and concatenate the results.
-  std::vector<TimeDistance> many_to_many;
-  if (source_location_list.size() <= target_location_list.size()) {
-    for (const auto& origin : source_location_list) {
-      std::vector<TimeDistance> td = OneToMany(origin, target_location_list, graphreader,
-                                               mode_costing, mode, max_matrix_distance);
-      many_to_many.insert(many_to_many.end(), td.begin(), td.end());
-      Clear();
+  const bool one_to_many = source_location_list.size() <= target_location_list.size();
+  const auto& origins = one_to_many ? source_location_list : target_location_list;
+  const auto& locations = one_to_many ? target_location_list : source_location_list;
+  std::vector<std::vector<TimeDistance>> results(origins.size());
+  auto search = [&](TimeDistanceMatrix& matrix, const int i) {
+    results[i] = one_to_many ? matrix.OneToMany(origins.Get(i), locations, graphreader,
+                                                mode_costing, mode, max_matrix_distance)
+                             : matrix.ManyToOne(origins.Get(i), locations, graphreader,
+                                                mode_costing, mode, max_matrix_distance);
+    matrix.Clear();
+  };
+
+  if (threads_ < 2 || origins.size() < 2) {
+    for (int i = 0; i < origins.size(); ++i) {
+      search(*this, i);
     }
   } else {
-    for (const auto& destination : target_location_list) {
-      std::vector<TimeDistance> td = ManyToOne(destination, source_location_list, graphreader,
-                                               mode_costing, mode, max_matrix_distance);
-      many_to_many.insert(many_to_many.end(), td.begin(), td.end());
-      Clear();
+    // The searches are independent so each thread takes the next one until there are none left,
+    // the results are kept in the order of the origins so they do not depend on the threads
+    std::mutex tile_mutex;
+    size_t count = std::min(static_cast<size_t>(threads_), static_cast<size_t>(origins.size()));
+    while (workers_.size() < count) {
+      workers_.emplace_back(new TimeDistanceMatrix());
+      workers_.back()->edgestatus_ = EdgeStatus(edgestatus_.max_reserved_count());
+      workers_.back()->target_pruning_ = target_pruning_;
+    }
+    std::atomic<int> next(0);
+    std::vector<std::exception_ptr> errors(count);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < count; ++t) {
+      threads.emplace_back([&, t]() {
+        auto& worker = *workers_[t];
+        worker.tile_mutex_ = &tile_mutex;
+        try {
+          for (int i = next++; i < origins.size(); i = next++) {
+            search(worker, i);
+          }
+        } catch (...) {
+          errors[t] = std::current_exception();
+          worker.Clear();
+        }
+        worker.tile_mutex_ = nullptr;
+      });
     }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (const auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+  }
+
+  std::vector<TimeDistance> many_to_many;
+  many_to_many.reserve(origins.size() * locations.size());
+  for (const auto& td : results) {
+    many_to_many.insert(many_to_many.end(), td.begin(), td.end());
   }
   return many_to_many;
 }
@@ -447,12 +590,12 @@ void TimeDistanceMatrix::SetOriginOneToMany(GraphReader& graphreader,
     }
 
     // Get the directed edge
-    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    graph_tile_ptr tile = GetGraphTile(graphreader, edgeid);
     const DirectedEdge* directededge = tile->directededge(edgeid);
 
     // Get the tile at the end node. Skip if tile not found as we won't be
     // able to expand from this origin edge.
-    graph_tile_ptr endtile = graphreader.GetGraphTile(directededge->endnode());
+    graph_tile_ptr endtile = GetGraphTile(graphreader, directededge->endnode());
     if (endtile == nullptr) {
       continue;
     }
@@ -493,19 +636,19 @@ void TimeDistanceMatrix::SetOriginManyToOne(GraphReader& graphreader,
     }
 
     // Get the directed edge
-    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    graph_tile_ptr tile = GetGraphTile(graphreader, edgeid);
     const DirectedEdge* directededge = tile->directededge(edgeid);
 
     // Get the opposing directed edge, continue if we cannot get it
-    GraphId opp_edge_id = graphreader.GetOpposingEdgeId(edgeid);
+    const DirectedEdge* opp_dir_edge = nullptr;
+    GraphId opp_edge_id = GetOpposingEdgeId(graphreader, edgeid, opp_dir_edge);
     if (!opp_edge_id.Is_Valid()) {
       continue;
     }
-    const DirectedEdge* opp_dir_edge = graphreader.GetOpposingEdge(edgeid);
 
     // Get the tile at the end node. Skip if tile not found as we won't be
     // able to expand from this origin edge.
-    graph_tile_ptr endtile = graphreader.GetGraphTile(directededge->endnode());
+    graph_tile_ptr endtile = GetGraphTile(graphreader, directededge->endnode());
     if (endtile == nullptr) {
       continue;
     }
@@ -564,7 +707,7 @@ void TimeDistanceMatrix::SetDestinations(
 
       // Form a threshold cost (the total cost to traverse the edge)
       GraphId id(static_cast<GraphId>(edge.graph_id()));
-      graph_tile_ptr tile = graphreader.GetGraphTile(id);
+      graph_tile_ptr tile = GetGraphTile(graphreader, id);
       const DirectedEdge* directededge = tile->directededge(id);
       float c = costing_->EdgeCost(directededge, tile).cost;
 
@@ -596,7 +739,9 @@ void TimeDistanceMatrix::SetDestinationsManyToOne(
     for (const auto& edge : loc.path_edges()) {
       // Get the opposing directed edge Id - this is the edge marked as the "destination",
       // but the cost is based on the forward path along the initial edge.
-      GraphId opp_edge_id = graphreader.GetOpposingEdgeId(static_cast<GraphId>(edge.graph_id()));
+      const DirectedEdge* opp_dir_edge = nullptr;
+      GraphId opp_edge_id =
+          GetOpposingEdgeId(graphreader, static_cast<GraphId>(edge.graph_id()), opp_dir_edge);
 
       // Add a destination if this is the first allowed edge for the location
       if (!added) {
@@ -610,7 +755,7 @@ void TimeDistanceMatrix::SetDestinationsManyToOne(
 
       // Form a threshold cost (the total cost to traverse the edge)
       GraphId id(static_cast<GraphId>(edge.graph_id()));
-      graph_tile_ptr tile = graphreader.GetGraphTile(id);
+      graph_tile_ptr tile = GetGraphTile(graphreader, id);
       const DirectedEdge* directededge = tile->directededge(id);
       float c = costing_->EdgeCost(directededge, tile).cost;
 
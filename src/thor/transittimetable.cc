@@ -0,0 +1,257 @@
+#include "thor/transittimetable.h"
+#include "baldr/graphconstants.h"
+#include "baldr/transitdeparture.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <map>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// The hops of a trip that are not yet chained, keyed by trip and by the run of a frequency trip
+struct TripHops {
+  uint32_t blockid;
+  std::vector<valhalla::thor::TransitTimetable::Hop> hops;
+};
+
+// A transit line edge and the platforms it connects
+struct Line {
+  GraphId edgeid;
+  GraphId stop;
+  GraphId next_stop;
+};
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+std::shared_ptr<TransitTimetable> TransitTimetable::Build(GraphReader& reader,
+                                                          const std::vector<GraphId>& tiles,
+                                                          const uint32_t date,
+                                                          const uint32_t dow,
+                                                          const bool wheelchair,
+                                                          const bool bicycle) {
+  std::unordered_map<uint64_t, TripHops> trips;
+  for (const auto& tile_id : tiles) {
+    auto tile = reader.GetGraphTile(tile_id);
+    if (!tile || tile->header()->departurecount() == 0) {
+      continue;
+    }
+
+    // The schedules are relative to the date the transit data was fetched at
+    bool date_before_tile = date < tile->header()->date_created();
+    uint32_t day = date_before_tile ? 0 : date - tile->header()->date_created();
+
+    // Departures only know their line so find the edge and the platforms of every line
+    std::unordered_map<uint32_t, Line> lines;
+    GraphId nodeid = tile->header()->graphid();
+    for (const auto& node : tile->GetNodes()) {
+      if (node.type() == NodeType::kMultiUseTransitPlatform) {
+        GraphId edgeid(nodeid.tileid(), nodeid.level(), node.edge_index());
+        const DirectedEdge* edge = tile->directededge(node.edge_index());
+        for (uint32_t i = 0; i < node.edge_count(); ++i, ++edge, ++edgeid) {
+          if (edge->IsTransitLine()) {
+            lines[edge->lineid()] = {edgeid, nodeid, edge->endnode()};
+          }
+        }
+      }
+      ++nodeid;
+    }
+
+    for (const auto& departure : tile->GetDepartures()) {
+      auto line = lines.find(departure.lineid());
+      if (line == lines.end() ||
+          !tile->GetTransitSchedule(departure.schedule_index())
+               ->IsValid(day, dow, date_before_tile) ||
+          (wheelchair && !departure.wheelchair_accessible()) ||
+          (bicycle && !departure.bicycle_accessible())) {
+        continue;
+      }
+
+      // Frequency based departures are expanded into one trip per run
+      uint64_t run = 0;
+      uint32_t time = departure.departure_time();
+      do {
+        auto& trip = trips[(static_cast<uint64_t>(departure.tripid()) << 32) | run];
+        trip.blockid = departure.blockid();
+        trip.hops.push_back({line->second.edgeid, line->second.stop, line->second.next_stop, time,
+                             time + departure.elapsed_time()});
+        time += departure.frequency();
+        ++run;
+      } while (departure.type() == kFrequencySchedule && departure.frequency() > 0 &&
+               time < departure.end_time());
+    }
+  }
+
+  // Chain the hops of each trip, a trip with a gap (a missing tile for instance) is split in two
+  std::shared_ptr<TransitTimetable> timetable(new TransitTimetable());
+  std::vector<uint64_t> keys;
+  keys.reserve(trips.size());
+  for (const auto& trip : trips) {
+    keys.push_back(trip.first);
+  }
+  std::sort(keys.begin(), keys.end());
+  std::vector<Hop> chain;
+  for (const auto key : keys) {
+    auto& trip = trips[key];
+    std::sort(trip.hops.begin(), trip.hops.end(),
+              [](const Hop& a, const Hop& b) { return a.departure < b.departure; });
+    chain.clear();
+    for (const auto& hop : trip.hops) {
+      if (!chain.empty() &&
+          (chain.back().next_stop != hop.stop || chain.back().arrival > hop.departure)) {
+        timetable->AddTrip(key >> 32, trip.blockid, chain);
+        chain.clear();
+      }
+      chain.push_back(hop);
+    }
+    if (!chain.empty()) {
+      timetable->AddTrip(key >> 32, trip.blockid, chain);
+    }
+  }
+  timetable->Finalize();
+
+  LOG_DEBUG("Transit timetable of " + std::to_string(tiles.size()) + " tiles has " +
+            std::to_string(timetable->stop_count()) + " stops, " +
+            std::to_string(timetable->route_count()) + " routes and " +
+            std::to_string(timetable->trips_.size()) + " trips");
+  return timetable;
+}
+
+void TransitTimetable::AddTrip(const uint32_t tripid,
+                               const uint32_t blockid,
+                               const std::vector<Hop>& hops) {
+  if (!hops.empty()) {
+    pending_.push_back({{tripid, blockid}, hops});
+  }
+}
+
+uint32_t TransitTimetable::AddStop(const GraphId& node) {
+  auto inserted = stop_indices_.emplace(node, static_cast<uint32_t>(stops_.size()));
+  if (inserted.second) {
+    stops_.push_back(node);
+  }
+  return inserted.first->second;
+}
+
+void TransitTimetable::Finalize() {
+  // Group the trips by the edges they run along, the ordered map keeps the layout deterministic
+  std::map<std::vector<uint64_t>, std::vector<uint32_t>> groups;
+  for (uint32_t i = 0; i < pending_.size(); ++i) {
+    std::vector<uint64_t> edges;
+    edges.reserve(pending_[i].hops.size());
+    for (const auto& hop : pending_[i].hops) {
+      edges.push_back(hop.edgeid);
+    }
+    groups[edges].push_back(i);
+  }
+
+  for (auto& group : groups) {
+    // Sort the trips by their departure from the first stop then by the rest of their times
+    auto& members = group.second;
+    auto earlier = [this](const uint32_t a, const uint32_t b) {
+      const auto& x = pending_[a].hops;
+      const auto& y = pending_[b].hops;
+      for (size_t i = 0; i < x.size(); ++i) {
+        if (x[i].departure != y[i].departure) {
+          return x[i].departure < y[i].departure;
+        }
+        if (x[i].arrival != y[i].arrival) {
+          return x[i].arrival < y[i].arrival;
+        }
+      }
+      return pending_[a].trip.tripid < pending_[b].trip.tripid;
+    };
+    std::sort(members.begin(), members.end(), earlier);
+
+    // A trip goes into the first route whose last trip it does not overtake at any stop
+    std::vector<std::vector<uint32_t>> fifo_routes;
+    for (const auto member : members) {
+      const auto& hops = pending_[member].hops;
+      auto fits = std::find_if(fifo_routes.begin(), fifo_routes.end(),
+                               [&](const std::vector<uint32_t>& route) {
+                                 const auto& last = pending_[route.back()].hops;
+                                 for (size_t i = 0; i < hops.size(); ++i) {
+                                   if (hops[i].departure < last[i].departure ||
+                                       hops[i].arrival < last[i].arrival) {
+                                     return false;
+                                   }
+                                 }
+                                 return true;
+                               });
+      if (fits == fifo_routes.end()) {
+        fifo_routes.emplace_back();
+        fits = fifo_routes.end() - 1;
+      }
+      fits->push_back(member);
+    }
+
+    // Lay out the stops, edges, trips and stop times of each route
+    for (const auto& fifo_route : fifo_routes) {
+      const auto& hops = pending_[fifo_route.front()].hops;
+      Route route{static_cast<uint32_t>(route_stops_.size()),
+                  static_cast<uint32_t>(hops.size() + 1), static_cast<uint32_t>(trips_.size()),
+                  static_cast<uint32_t>(fifo_route.size()),
+                  static_cast<uint32_t>(stop_times_.size())};
+      for (const auto& hop : hops) {
+        route_stops_.push_back(AddStop(hop.stop));
+        route_edges_.push_back(hop.edgeid);
+      }
+      route_stops_.push_back(AddStop(hops.back().next_stop));
+      route_edges_.emplace_back();
+
+      for (const auto member : fifo_route) {
+        const auto& trip_hops = pending_[member].hops;
+        trips_.push_back(pending_[member].trip);
+        // nobody arrives at the first stop or departs from the last one
+        stop_times_.push_back({trip_hops.front().departure, trip_hops.front().departure});
+        for (size_t i = 1; i < trip_hops.size(); ++i) {
+          stop_times_.push_back({trip_hops[i - 1].arrival, trip_hops[i].departure});
+        }
+        stop_times_.push_back({trip_hops.back().arrival, trip_hops.back().arrival});
+      }
+      routes_.push_back(route);
+    }
+  }
+  pending_.clear();
+  pending_.shrink_to_fit();
+
+  // Index the routes serving each stop
+  stop_route_offsets_.assign(stops_.size() + 1, 0);
+  for (const auto& route : routes_) {
+    for (uint32_t pos = 0; pos < route.stop_count; ++pos) {
+      ++stop_route_offsets_[route_stop(route, pos) + 1];
+    }
+  }
+  for (size_t i = 1; i < stop_route_offsets_.size(); ++i) {
+    stop_route_offsets_[i] += stop_route_offsets_[i - 1];
+  }
+  stop_routes_.resize(stop_route_offsets_.back());
+  auto next = stop_route_offsets_;
+  for (uint32_t r = 0; r < routes_.size(); ++r) {
+    for (uint32_t pos = 0; pos < routes_[r].stop_count; ++pos) {
+      stop_routes_[next[route_stop(routes_[r], pos)]++] = {r, pos};
+    }
+  }
+}
+
+uint32_t
+TransitTimetable::EarliestTrip(const Route& route, const uint32_t pos, const uint32_t time) const {
+  // No trip overtakes another so their departures from any stop are sorted
+  uint32_t low = 0, high = route.trip_count;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (stop_time(route, mid, pos).departure < time) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low < route.trip_count ? low : kInvalidTimetableIndex;
+}
+
+} // namespace thor
+} // namespace valhalla
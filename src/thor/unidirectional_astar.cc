@@ -23,6 +23,8 @@ UnidirectionalAStar<expansion_direction, FORWARD>::UnidirectionalAStar(
       mode_(TravelMode::kDrive), travel_type_(0),
       max_reserved_labels_count_(
           config.get<uint32_t>("max_reserved_labels_count", kInitialEdgeLabelCount)),
+      edgestatus_(config.get<uint32_t>("max_reserved_edge_status_count",
+                                       kDefaultReservedEdgeStatusCount)),
       access_mode_{kAutoAccess} {
 }
 
@@ -37,6 +39,9 @@ template UnidirectionalAStar<ExpansionType::reverse>::UnidirectionalAStar(
 // Clear the temporary information generated during path construction.
 template <const ExpansionType expansion_direction, const bool FORWARD>
 void UnidirectionalAStar<expansion_direction, FORWARD>::Clear() {
+  // Hand the work of the last search to the metrics
+  search_metrics_.Record(name(), edgelabels_.size());
+
   // Clear the edge labels and destination list. Reset the adjacency list
   // and clear edge status.
   if (edgelabels_.size() > max_reserved_labels_count_) {
@@ -212,33 +217,30 @@ inline bool UnidirectionalAStar<expansion_direction, FORWARD>::ExpandInner(
   uint8_t restriction_idx = kInvalidRestriction;
   bool const is_dest =
       destinations_percent_along_.find(meta.edge_id) != destinations_percent_along_.cend();
+  // The costing computes the cost to the end of this edge along with its access check
+  Cost edge_cost, transition_cost;
+  uint8_t flow_sources;
   if (FORWARD) {
-    if (!costing_->Allowed(meta.edge, is_dest, pred, tile, meta.edge_id, time_info.local_time,
-                           nodeinfo->timezone(), restriction_idx) ||
+    if (!costing_->AllowedEdgeCost(meta.edge, is_dest, pred, tile, meta.edge_id, nodeinfo,
+                                   time_info.local_time, nodeinfo->timezone(),
+                                   time_info.second_of_week, restriction_idx, transition_cost,
+                                   edge_cost, flow_sources) ||
         costing_->Restricted(meta.edge, pred, edgelabels_, tile, meta.edge_id, true, &edgestatus_,
                              time_info.local_time, nodeinfo->timezone())) {
       return false;
     }
   } else {
-    if (!costing_->AllowedReverse(meta.edge, pred, opp_edge, t2, opp_edge_id, time_info.local_time,
-                                  nodeinfo->timezone(), restriction_idx) ||
+    if (!costing_->AllowedEdgeCostReverse(meta.edge, pred, opp_edge, t2, opp_edge_id, nodeinfo,
+                                          opp_pred_edge, time_info.local_time,
+                                          nodeinfo->timezone(), time_info.second_of_week,
+                                          restriction_idx, transition_cost, edge_cost,
+                                          flow_sources) ||
         costing_->Restricted(meta.edge, pred, edgelabels_, tile, meta.edge_id, false, &edgestatus_,
                              time_info.local_time, nodeinfo->timezone())) {
       return false;
     }
   }
 
-  // Compute the cost to the end of this edge
-  uint8_t flow_sources;
-  auto edge_cost = FORWARD
-                       ? costing_->EdgeCost(meta.edge, tile, time_info.second_of_week, flow_sources)
-                       : costing_->EdgeCost(opp_edge, t2, time_info.second_of_week, flow_sources);
-
-  auto transition_cost =
-      FORWARD ? costing_->TransitionCost(meta.edge, nodeinfo, pred)
-              : costing_->TransitionCostReverse(meta.edge->localedgeidx(), nodeinfo, opp_edge,
-                                                opp_pred_edge, pred.has_measured_speed(),
-                                                pred.internal_turn());
   Cost newcost = pred.cost() + edge_cost;
   newcost += transition_cost;
 
@@ -496,6 +498,7 @@ std::vector<std::vector<PathInfo>> UnidirectionalAStar<expansion_direction, FORW
     // edge (this will allow loops/around the block cases)
     if (!pred.origin()) {
       edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+      search_metrics_.Settle();
     }
 
     // Check that distance is converging towards the destination. Return route
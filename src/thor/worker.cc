@@ -6,6 +6,9 @@
 #include <unordered_map>
 #include <vector>
 
+#include "baldr/contraction.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilefile.h"
 #include "midgard/constants.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
@@ -69,8 +72,10 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
                              const std::shared_ptr<baldr::GraphReader>& graph_reader)
     : mode(valhalla::sif::TravelMode::kPedestrian), bidir_astar(config.get_child("thor")),
       bss_astar(config.get_child("thor")), multi_modal_astar(config.get_child("thor")),
-      timedep_forward(config.get_child("thor")), timedep_reverse(config.get_child("thor")),
-      isochrone_gen(config.get_child("thor")), matcher_factory(config, graph_reader),
+      multi_modal_raptor(config.get_child("thor")), timedep_forward(config.get_child("thor")),
+      timedep_reverse(config.get_child("thor")), cost_matrix(config.get_child("thor")),
+      time_distance_matrix(config.get_child("thor")), isochrone_gen(config.get_child("thor")),
+      optimizer(config.get_child("thor")), matcher_factory(config, graph_reader),
       reader(graph_reader), controller{} {
   // If we weren't provided with a graph reader make our own
   if (!reader)
@@ -102,6 +107,33 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
 
   max_timedep_distance =
       config.get<float>("service_limits.max_timedep_distance", kDefaultMaxTimeDependentDistance);
+
+  // Select the transit engine for multimodal routes (defaults to the label setting multimodal)
+  use_raptor = config.get<std::string>("thor.transit_engine", "multimodal") == "raptor";
+
+  // Use the contraction hierarchy overlay if asked to and the tiles have one. It ignores turn and
+  // transition costs so its routes can differ from those of bidirectional A*, hence it is opt in
+  auto tile_dir = config.get<std::string>("mjolnir.tile_dir", "");
+  if (config.get<bool>("thor.contraction_hierarchy", false) && !tile_dir.empty()) {
+    // the overlay is large and read only so all the workers of a process share it
+    auto overlay = load_shared<ContractionOverlay>(
+        tile_dir, [&]() { return ContractionOverlay::Load(tile_dir); });
+    if (overlay) {
+      contraction_hierarchy.reset(new ContractionHierarchy(overlay));
+      contraction_generation = reader->TileExtractGeneration();
+      // The overlay was built for the auto costing of a request without any costing options or
+      // date_time, which do not use predicted or live speeds
+      rapidjson::Document doc;
+      doc.SetObject();
+      Options defaults;
+      defaults.set_costing(Costing::auto_);
+      ParseCostingOptions(doc, "/costing_options", defaults);
+      auto* auto_options = defaults.mutable_costing_options(Costing::auto_);
+      auto_options->set_flow_mask(static_cast<uint8_t>(auto_options->flow_mask()) &
+                                  ~(kPredictedFlowMask | kCurrentFlowMask));
+      contraction_costing_options = auto_options->SerializeAsString();
+    }
+  }
 }
 
 thor_worker_t::~thor_worker_t() {
@@ -127,6 +159,14 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
     }
     const auto& options = request.options();
 
+    // Use the tile extract loki started the request on. We may have moved on to a newer one for
+    // another request already but a request must never mix tiles from two extracts
+    if (!request.info().has_tile_extract_generation()) {
+      reader->UpdateTileExtract();
+    } else if (!reader->UseTileExtract(request.info().tile_extract_generation())) {
+      throw valhalla_exception_t{403};
+    }
+
     // Set the interrupt function
     service_worker_t::set_interrupt(&interrupt_function);
 
@@ -335,7 +375,13 @@ void thor_worker_t::cleanup() {
   timedep_forward.Clear();
   timedep_reverse.Clear();
   multi_modal_astar.Clear();
+  multi_modal_raptor.Clear();
   bss_astar.Clear();
+  if (contraction_hierarchy) {
+    contraction_hierarchy->Clear();
+  }
+  cost_matrix.Clear();
+  time_distance_matrix.Clear();
   trace.clear();
   isochrone_gen.Clear();
   centroid_gen.Clear();
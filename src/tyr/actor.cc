@@ -1,6 +1,8 @@
 #include "tyr/actor.h"
 #include "baldr/rapidjson_utils.h"
 #include "loki/worker.h"
+#include "midgard/logging.h"
+#include "midgard/metrics.h"
 #include "odin/worker.h"
 #include "thor/worker.h"
 #include "tyr/serializers.h"
@@ -51,287 +53,352 @@ void actor_t::cleanup() {
   pimpl->cleanup();
 }
 
-std::string
-actor_t::route(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
+std::string actor_t::act(Api& request, const std::function<void()>* interrupt) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // parse the request
-  Api request;
-  ParseApi(request_str, Options::route, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.route(request);
-  // route between the locations in the graph to find the best path
-  pimpl->thor_worker.route(request);
-  // get some directions back from them
-  pimpl->odin_worker.narrate(request);
-  // serialize them out to json string
-  auto bytes = tyr::serializeDirections(request);
+  // every stage works on the same request so nothing is serialized until the response
+  std::string response;
+  switch (request.options().action()) {
+    case Options::route:
+      // check the request and locate the locations in the graph
+      pimpl->loki_worker.route(request);
+      // route between the locations in the graph to find the best path
+      pimpl->thor_worker.route(request);
+      // get some directions back from them
+      pimpl->odin_worker.narrate(request);
+      // serialize them out to json string
+      response = tyr::serializeDirections(request);
+      break;
+    case Options::locate:
+      response = pimpl->loki_worker.locate(request);
+      break;
+    case Options::sources_to_targets:
+      pimpl->loki_worker.matrix(request);
+      response = pimpl->thor_worker.matrix(request);
+      break;
+    case Options::optimized_route:
+      pimpl->loki_worker.matrix(request);
+      // compute compute all pairs and then the shortest path through them all
+      pimpl->thor_worker.optimized_route(request);
+      pimpl->odin_worker.narrate(request);
+      response = tyr::serializeDirections(request);
+      break;
+    case Options::isochrone:
+      pimpl->loki_worker.isochrones(request);
+      response = pimpl->thor_worker.isochrones(request);
+      break;
+    case Options::trace_route:
+      pimpl->loki_worker.trace(request);
+      pimpl->thor_worker.trace_route(request);
+      pimpl->odin_worker.narrate(request);
+      response = tyr::serializeDirections(request);
+      break;
+    case Options::trace_attributes:
+      pimpl->loki_worker.trace(request);
+      // get the path and turn it into attribution along it
+      response = pimpl->thor_worker.trace_attributes(request);
+      break;
+    case Options::height:
+      response = pimpl->loki_worker.height(request);
+      break;
+    case Options::transit_available:
+      response = pimpl->loki_worker.transit_available(request);
+      break;
+    case Options::expansion:
+      pimpl->loki_worker.route(request);
+      response = pimpl->thor_worker.expansion(request);
+      break;
+    case Options::centroid:
+      pimpl->loki_worker.route(request);
+      pimpl->thor_worker.centroid(request);
+      pimpl->odin_worker.narrate(request);
+      response = tyr::serializeDirections(request);
+      break;
+    case Options::status:
+      pimpl->loki_worker.status(request);
+      pimpl->thor_worker.status(request);
+      pimpl->odin_worker.status(request);
+      response = tyr::serializeStatus(request);
+      break;
+    case Options::metrics:
+      response = midgard::metrics::render();
+      break;
+    default:
+      // apparently you wanted something that we figured we'd support but havent written yet
+      throw valhalla_exception_t{107};
+  }
   // if they want you do to do the cleanup automatically
   if (auto_cleanup) {
     cleanup();
   }
+  return response;
+}
+
+std::string
+actor_t::route(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
+  // parse the request
+  Api request;
+  ParseApi(request_str, Options::route, request);
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return bytes;
+  return response;
 }
 
 std::string
 actor_t::locate(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::locate, request);
-  // check the request and locate the locations in the graph
-  auto json = pimpl->loki_worker.locate(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return json;
+  return response;
 }
 
 std::string
 actor_t::matrix(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::sources_to_targets, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.matrix(request);
-  // compute the matrix
-  auto json = pimpl->thor_worker.matrix(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return json;
+  return response;
 }
 
 std::string actor_t::optimized_route(const std::string& request_str,
                                      const std::function<void()>* interrupt,
                                      Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::optimized_route, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.matrix(request);
-  // compute compute all pairs and then the shortest path through them all
-  pimpl->thor_worker.optimized_route(request);
-  // get some directions back from them
-  pimpl->odin_worker.narrate(request);
-  // serialize them out to json string
-  auto bytes = tyr::serializeDirections(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return bytes;
+  return response;
 }
 
 std::string
 actor_t::isochrone(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::isochrone, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.isochrones(request);
-  // compute the isochrones
-  auto json = pimpl->thor_worker.isochrones(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return json;
+  return response;
 }
 
 std::string actor_t::trace_route(const std::string& request_str,
                                  const std::function<void()>* interrupt,
                                  Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::trace_route, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.trace(request);
-  // route between the locations in the graph to find the best path
-  pimpl->thor_worker.trace_route(request);
-  // get some directions back from them
-  pimpl->odin_worker.narrate(request);
-  // serialize them out to json string
-  auto bytes = tyr::serializeDirections(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return bytes;
+  return response;
 }
 
 std::string actor_t::trace_attributes(const std::string& request_str,
                                       const std::function<void()>* interrupt,
                                       Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::trace_attributes, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.trace(request);
-  // get the path and turn it into attribution along it
-  auto json = pimpl->thor_worker.trace_attributes(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return json;
+  return response;
 }
 
 std::string
 actor_t::height(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::height, request);
-  // get the height at each point
-  auto json = pimpl->loki_worker.height(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return json;
+  return response;
 }
 
 std::string actor_t::transit_available(const std::string& request_str,
                                        const std::function<void()>* interrupt,
                                        Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::transit_available, request);
-  // check the request and locate the locations in the graph
-  auto json = pimpl->loki_worker.transit_available(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return json;
+  return response;
 }
 
 std::string
 actor_t::expansion(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::expansion, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.route(request);
-  // route between the locations in the graph to find the best path
-  auto json = pimpl->thor_worker.expansion(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return json;
+  return response;
 }
 
 std::string
 actor_t::centroid(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
   ParseApi(request_str, Options::centroid, request);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.route(request);
-  // route between the locations in the graph to find the best path
-  pimpl->thor_worker.centroid(request);
-  // get some directions back from them
-  pimpl->odin_worker.narrate(request);
-  // serialize them out to json string
-  auto bytes = tyr::serializeDirections(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return bytes;
+  return response;
 }
 
 std::string
 actor_t::status(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // parse the request
   Api request;
-  ParseApi(request_str, Options::centroid, request);
-  // check lokis status
-  pimpl->loki_worker.status(request);
-  // check thors status
-  pimpl->thor_worker.status(request);
-  // check odins status
-  pimpl->odin_worker.status(request);
-  // get the json
-  auto json = tyr::serializeStatus(request);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
+  ParseApi(request_str, Options::status, request);
+  // run it through each stage
+  auto response = act(request, interrupt);
   // give the caller a copy
   if (api) {
     api->Swap(&request);
   }
-  return json;
+  return response;
+}
+
+#ifdef HAVE_HTTP
+namespace {
+
+// Answers the requests coming from the http server by running all of their stages in this thread
+class pipeline_worker_t {
+public:
+  pipeline_worker_t(const boost::property_tree::ptree& config) : actor(config) {
+    // Only answer the actions loki would
+    Options::Action action;
+    for (const auto& kv : config.get_child("loki.actions")) {
+      auto path = kv.second.get_value<std::string>();
+      if (!Options_Action_Enum_Parse(path, &action)) {
+        throw std::runtime_error("Action not supported " + path);
+      }
+      actions.insert(action);
+      action_str.append("'/" + path + "' ");
+    }
+  }
+
+  prime_server::worker_t::result_t work(const std::list<zmq::message_t>& job,
+                                        void* request_info,
+                                        const std::function<void()>& interrupt_function) {
+    auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
+    LOG_INFO("Got Request " + std::to_string(info.id));
+    Api request;
+    try {
+      auto http_request =
+          prime_server::http_request_t::from_string(static_cast<const char*>(job.front().data()),
+                                                    job.front().size());
+      ParseApi(http_request, request);
+      const auto& options = request.options();
+      if (!options.has_action() || actions.find(options.action()) == actions.cend()) {
+        return jsonify_error({106, action_str}, info, request);
+      }
+
+      auto response = actor.act(request, &interrupt_function);
+
+      // the actions that odin narrates can also be serialized as gpx
+      const bool narrated = options.action() == Options::route ||
+                            options.action() == Options::optimized_route ||
+                            options.action() == Options::trace_route ||
+                            options.action() == Options::centroid;
+      const bool as_gpx = narrated && options.format() == Options::gpx;
+      if (options.action() == Options::metrics) {
+        return to_response(response, info, request, worker::TEXT_MIME);
+      }
+      return to_response(response, info, request, as_gpx ? worker::GPX_MIME : worker::JSON_MIME,
+                         as_gpx);
+    } catch (const valhalla_exception_t& e) {
+      LOG_WARN("400::" + std::string(e.what()) + " request_id=" + std::to_string(info.id));
+      return jsonify_error(e, info, request);
+    } catch (const std::exception& e) {
+      LOG_ERROR("400::" + std::string(e.what()) + " request_id=" + std::to_string(info.id));
+      return jsonify_error({599, std::string(e.what())}, info, request);
+    }
+  }
+
+  void cleanup() {
+    actor.cleanup();
+  }
+
+protected:
+  actor_t actor;
+  std::unordered_set<Options::Action> actions;
+  std::string action_str;
+};
+
+} // namespace
+
+void run_service(const boost::property_tree::ptree& config) {
+  // gracefully shutdown when asked via SIGTERM
+  prime_server::quiesce(config.get<unsigned int>("httpd.service.drain_seconds", 28),
+                        config.get<unsigned int>("httpd.service.shutting_seconds", 1));
+
+  // gets requests from the http server
+  auto upstream_endpoint = config.get<std::string>("loki.service.proxy") + "_out";
+  // every response goes straight back to the server so nothing is ever sent downstream
+  auto downstream_endpoint = config.get<std::string>("thor.service.proxy") + "_in";
+  auto loopback_endpoint = config.get<std::string>("httpd.service.loopback");
+  auto interrupt_endpoint = config.get<std::string>("httpd.service.interrupt");
+
+  // listen for requests
+  zmq::context_t context;
+  pipeline_worker_t pipeline_worker(config);
+  prime_server::worker_t worker(context, upstream_endpoint, downstream_endpoint, loopback_endpoint,
+                                interrupt_endpoint,
+                                std::bind(&pipeline_worker_t::work, std::ref(pipeline_worker),
+                                          std::placeholders::_1, std::placeholders::_2,
+                                          std::placeholders::_3),
+                                std::bind(&pipeline_worker_t::cleanup, std::ref(pipeline_worker)));
+  worker.work();
 }
+#endif
 
 } // namespace tyr
 } // namespace valhalla
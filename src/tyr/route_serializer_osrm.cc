@@ -1,10 +1,8 @@
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
-#include "baldr/json.h"
 #include "midgard/encoded.h"
 #include "midgard/pointll.h"
 #include "midgard/polyline2.h"
@@ -200,7 +198,10 @@ OSRM output is described in: http://project-osrm.org/docs/v5.5.1/api/
 std::string guide_destinations(const valhalla::TripSign& sign);
 
 // Add OSRM route summary information: distance, duration
-void route_summary(json::MapPtr& route, const valhalla::Api& api, bool imperial, int route_index) {
+void route_summary(rapidjson::writer_wrapper_t& writer,
+                   const valhalla::Api& api,
+                   bool imperial,
+                   int route_index) {
   // Compute total distance and duration
   double duration = 0;
   double distance = 0;
@@ -226,38 +227,51 @@ void route_summary(json::MapPtr& route, const valhalla::Api& api, bool imperial,
 
   // Convert distance to meters. Output distance and duration.
   distance = units_to_meters(distance, !imperial);
-  route->emplace("distance", json::fixed_t{distance, 3});
-  route->emplace("duration", json::fixed_t{duration, 3});
+  writer("distance", distance, 3);
+  writer("duration", duration, 3);
 
-  route->emplace("weight", json::fixed_t{weight, 3});
+  writer("weight", weight, 3);
   assert(api.options().costing_options(api.options().costing()).has_name());
-  route->emplace("weight_name", api.options().costing_options(api.options().costing()).name());
+  writer("weight_name", api.options().costing_options(api.options().costing()).name());
 
   auto recosting_itr = api.options().recostings().begin();
   for (const auto& recost : recosts) {
     if (recost.first < 0) {
-      route->emplace("duration_" + recosting_itr->name(), nullptr_t());
-      route->emplace("weight_" + recosting_itr->name(), nullptr_t());
+      writer("duration_" + recosting_itr->name(), nullptr);
+      writer("weight_" + recosting_itr->name(), nullptr);
     } else {
-      route->emplace("duration_" + recosting_itr->name(), json::fixed_t{recost.first, 3});
-      route->emplace("weight_" + recosting_itr->name(), json::fixed_t{recost.second, 3});
+      writer("duration_" + recosting_itr->name(), recost.first, 3);
+      writer("weight_" + recosting_itr->name(), recost.second, 3);
     }
     ++recosting_itr;
   }
 }
 
 // Generate leg shape in geojson format.
-json::MapPtr geojson_shape(const std::vector<PointLL> shape) {
-  auto geojson = json::map({});
-  auto coords = json::array({});
-  coords->reserve(shape.size());
+void geojson_shape(const std::vector<PointLL>& shape, rapidjson::writer_wrapper_t& writer) {
+  writer.start_object("geometry");
+  writer("type", "LineString");
+  writer.start_array("coordinates");
   for (const auto& p : shape) {
-    coords->emplace_back(json::array(
-        {json::fixed_t{p.lng(), DIGITS_PRECISION}, json::fixed_t{p.lat(), DIGITS_PRECISION}}));
+    writer.start_array();
+    writer(p.lng(), DIGITS_PRECISION);
+    writer(p.lat(), DIGITS_PRECISION);
+    writer.end_array();
+  }
+  writer.end_array();
+  writer.end_object();
+}
+
+// Add the geometry of a route or a step in the requested shape format
+void shape_geometry(const std::vector<PointLL>& shape,
+                    const valhalla::Options& options,
+                    rapidjson::writer_wrapper_t& writer) {
+  if (options.shape_format() == geojson) {
+    geojson_shape(shape, writer);
+  } else {
+    int precision = options.shape_format() == polyline6 ? 1e6 : 1e5;
+    writer("geometry", midgard::encode(shape, precision));
   }
-  geojson->emplace("type", std::string("LineString"));
-  geojson->emplace("coordinates", std::move(coords));
-  return geojson;
 }
 
 // Generate full shape of the route.
@@ -312,7 +326,7 @@ std::vector<PointLL> simplified_shape(const valhalla::DirectionsRoute& direction
   return simple_shape;
 }
 
-void route_geometry(json::MapPtr& route,
+void route_geometry(rapidjson::writer_wrapper_t& writer,
                     const valhalla::DirectionsRoute& directions,
                     const valhalla::Options& options) {
   std::vector<PointLL> shape;
@@ -321,74 +335,65 @@ void route_geometry(json::MapPtr& route,
   } else if (!options.has_generalize() || (options.has_generalize() && options.generalize() > 0.0f)) {
     shape = full_shape(directions, options);
   }
-  if (options.shape_format() == geojson) {
-    route->emplace("geometry", geojson_shape(shape));
-  } else {
-    int precision = options.shape_format() == polyline6 ? 1e6 : 1e5;
-    route->emplace("geometry", midgard::encode(shape, precision));
-  }
+  shape_geometry(shape, options, writer);
 }
 
-json::MapPtr serialize_annotations(const valhalla::TripLeg& trip_leg) {
-  auto attributes_map = json::map({});
-  attributes_map->reserve(4);
+void serialize_annotations(const valhalla::TripLeg& trip_leg, rapidjson::writer_wrapper_t& writer) {
+  writer.start_object("annotation");
 
   if (trip_leg.shape_attributes().time_size() > 0) {
-    auto duration_array = json::array({});
-    duration_array->reserve(trip_leg.shape_attributes().time_size());
+    writer.start_array("duration");
     for (const auto& time : trip_leg.shape_attributes().time()) {
       // milliseconds (ms) to seconds (sec)
-      duration_array->push_back(json::fixed_t{time * kSecPerMillisecond, 3});
+      writer(time * kSecPerMillisecond, 3);
     }
-    attributes_map->emplace("duration", duration_array);
+    writer.end_array();
   }
 
   if (trip_leg.shape_attributes().length_size() > 0) {
-    auto distance_array = json::array({});
-    distance_array->reserve(trip_leg.shape_attributes().length_size());
+    writer.start_array("distance");
     for (const auto& length : trip_leg.shape_attributes().length()) {
       // decimeters (dm) to meters (m)
-      distance_array->push_back(json::fixed_t{length * kMeterPerDecimeter, 1});
+      writer(length * kMeterPerDecimeter, 1);
     }
-    attributes_map->emplace("distance", distance_array);
+    writer.end_array();
   }
 
   if (trip_leg.shape_attributes().speed_size() > 0) {
-    auto speeds_array = json::array({});
-    speeds_array->reserve(trip_leg.shape_attributes().speed_size());
+    writer.start_array("speed");
     for (const auto& speed : trip_leg.shape_attributes().speed()) {
       // dm/s to m/s
-      speeds_array->push_back(json::fixed_t{speed * kMeterPerDecimeter, 1});
+      writer(speed * kMeterPerDecimeter, 1);
     }
-    attributes_map->emplace("speed", speeds_array);
+    writer.end_array();
   }
 
   if (trip_leg.shape_attributes().speed_limit_size() > 0) {
-    auto speed_limits_array = json::array({});
-    speed_limits_array->reserve(trip_leg.shape_attributes().speed_limit_size());
+    writer.start_array("maxspeed");
     for (const auto& speed_limit : trip_leg.shape_attributes().speed_limit()) {
-      auto speed_limit_annotation = json::map({});
+      writer.start_object();
       if (speed_limit == kUnlimitedSpeedLimit) {
-        speed_limit_annotation->emplace("none", true);
+        writer("none", true);
       } else if (speed_limit > 0) {
         // TODO support mph?
-        speed_limit_annotation->emplace("unit", kSpeedLimitUnitsKph);
-        speed_limit_annotation->emplace("speed", static_cast<uint64_t>(speed_limit));
+        writer("unit", kSpeedLimitUnitsKph);
+        writer("speed", static_cast<uint64_t>(speed_limit));
       } else {
-        speed_limit_annotation->emplace("unknown", true);
+        writer("unknown", true);
       }
-      speed_limits_array->push_back(speed_limit_annotation);
+      writer.end_object();
     }
-    attributes_map->emplace("maxspeed", speed_limits_array);
+    writer.end_array();
   }
 
-  return attributes_map;
+  writer.end_object();
 }
 
 // Serialize waypoints for optimized route. Note that OSRM retains the
 // original location order, and stores an index for the waypoint index in
 // the optimized sequence.
-json::ArrayPtr waypoints(google::protobuf::RepeatedPtrField<valhalla::Location>& locs) {
+void waypoints(google::protobuf::RepeatedPtrField<valhalla::Location>& locs,
+               rapidjson::writer_wrapper_t& writer) {
   // Create a vector of indexes.
   uint32_t i = 0;
   std::vector<uint32_t> indexes;
@@ -403,12 +408,10 @@ json::ArrayPtr waypoints(google::protobuf::RepeatedPtrField<valhalla::Location>&
 
   // Output each location in its original index order along with its
   // waypoint index (which is the index in the optimized order).
-  auto waypoints = json::array({});
   for (const auto& index : indexes) {
     locs.Mutable(index)->set_shape_index(index);
-    waypoints->emplace_back(osrm::waypoint(locs.Get(index), false, true));
+    osrm::waypoint(locs.Get(index), writer, false, true);
   }
-  return waypoints;
 }
 
 // Simple structure for storing intersection data
@@ -428,18 +431,19 @@ struct IntersectionEdges {
 };
 
 // Add intersections along a step/maneuver.
-json::ArrayPtr intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
-                             valhalla::odin::EnhancedTripLeg* etp,
-                             const std::vector<PointLL>& shape,
-                             uint32_t& count,
-                             const bool arrive_maneuver) {
+void intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
+                   valhalla::odin::EnhancedTripLeg* etp,
+                   const std::vector<PointLL>& shape,
+                   uint32_t& count,
+                   const bool arrive_maneuver,
+                   rapidjson::writer_wrapper_t& writer) {
   // Iterate through the nodes/intersections of the path for this maneuver
   count = 0;
-  auto intersections = json::array({});
+  writer.start_array("intersections");
   uint32_t n = arrive_maneuver ? maneuver.end_path_index() + 1 : maneuver.end_path_index();
   EnhancedTripLeg_Node* prev_node = nullptr;
   for (uint32_t i = maneuver.begin_path_index(); i < n; i++) {
-    auto intersection = json::map({});
+    writer.start_object();
 
     // Get the node and current edge from the enhanced trip path
     // NOTE: curr_edge does not exist for the arrive maneuver
@@ -449,60 +453,60 @@ json::ArrayPtr intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
 
     // Add the node location (lon, lat). Use the last shape point for
     // the arrive step
-    auto loc = json::array({});
     size_t shape_index = arrive_maneuver ? shape.size() - 1 : curr_edge->begin_shape_index();
     PointLL ll = shape[shape_index];
-    loc->emplace_back(json::fixed_t{ll.lng(), 6});
-    loc->emplace_back(json::fixed_t{ll.lat(), 6});
-    intersection->emplace("location", loc);
-    intersection->emplace("geometry_index", static_cast<uint64_t>(shape_index));
+    writer.start_array("location");
+    writer(ll.lng(), 6);
+    writer(ll.lat(), 6);
+    writer.end_array();
+    writer("geometry_index", static_cast<uint64_t>(shape_index));
 
     // Add index into admin list
     if (node->has_admin_index()) {
-      intersection->emplace("admin_index", static_cast<uint64_t>(node->admin_index()));
+      writer("admin_index", static_cast<uint64_t>(node->admin_index()));
     }
 
     if (!arrive_maneuver) {
       if (curr_edge->has_is_urban()) {
-        intersection->emplace("is_urban", curr_edge->is_urban());
+        writer("is_urban", curr_edge->is_urban());
       }
     }
 
-    auto toll_collection = json::map({});
     if (node->type() == TripLeg_Node::kTollBooth) {
-      toll_collection->emplace("type", std::string("toll_booth"));
+      writer.start_object("toll_collection");
+      writer("type", "toll_booth");
+      writer.end_object();
     } else if (node->type() == TripLeg_Node::kTollGantry) {
-      toll_collection->emplace("type", std::string("toll_gantry"));
+      writer.start_object("toll_collection");
+      writer("type", "toll_gantry");
+      writer.end_object();
     }
-    if (!toll_collection->empty())
-      intersection->emplace("toll_collection", toll_collection);
 
     if (node->cost().transition_cost().seconds() > 0)
-      intersection->emplace("turn_duration",
-                            json::fixed_t{node->cost().transition_cost().seconds(), 3});
+      writer("turn_duration", node->cost().transition_cost().seconds(), 3);
     if (node->cost().transition_cost().cost() > 0)
-      intersection->emplace("turn_weight", json::fixed_t{node->cost().transition_cost().cost(), 3});
+      writer("turn_weight", node->cost().transition_cost().cost(), 3);
     auto next_node = i + 1 < n ? etp->GetEnhancedNode(i + 1) : nullptr;
     if (next_node) {
       auto secs = next_node->cost().elapsed_cost().seconds() - node->cost().elapsed_cost().seconds();
       auto cost = next_node->cost().elapsed_cost().cost() - node->cost().elapsed_cost().cost();
       if (secs > 0)
-        intersection->emplace("duration", json::fixed_t{secs, 3});
+        writer("duration", secs, 3);
       if (cost > 0)
-        intersection->emplace("weight", json::fixed_t{cost, 3});
+        writer("weight", cost, 3);
     }
 
     // TODO: add recosted durations to the intersection?
 
     // Add rest_stop when passing by a rest_area or service_area
     if (i > 0 && !arrive_maneuver) {
-      auto rest_stop = json::map({});
       for (uint32_t m = 0; m < node->intersecting_edge_size(); m++) {
         auto intersecting_edge = node->GetIntersectingEdge(m);
         bool routeable = intersecting_edge->IsTraversableOutbound(curr_edge->travel_mode());
 
         if (routeable && intersecting_edge->use() == TripLeg_Use_kRestAreaUse) {
-          rest_stop->emplace("type", std::string("rest_area"));
+          writer.start_object("rest_stop");
+          writer("type", "rest_area");
           if (intersecting_edge->has_sign()) {
             const valhalla::TripSign& trip_leg_sign = intersecting_edge->sign();
             // I've looked at the results from guide_destinations(), destinations(), and
@@ -510,13 +514,14 @@ json::ArrayPtr intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
             // guide_destinations() and destinations() return the same string value for
             // the rest area name. So I've decided to use guide_destinations().
             std::string guide_destinations_str = guide_destinations(trip_leg_sign);
-            rest_stop->emplace("name", guide_destinations_str);
+            writer("name", guide_destinations_str);
           }
-          intersection->emplace("rest_stop", rest_stop);
+          writer.end_object();
           break;
         } else if (routeable && intersecting_edge->use() == TripLeg_Use_kServiceAreaUse) {
-          rest_stop->emplace("type", std::string("service_area"));
-          intersection->emplace("rest_stop", rest_stop);
+          writer.start_object("rest_stop");
+          writer("type", "service_area");
+          writer.end_object();
           break;
         }
       }
@@ -541,10 +546,6 @@ json::ArrayPtr intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
       edges.emplace_back(((prior_heading + 180) % 360), entry, true, false);
     }
 
-    // Create bearing and entry output
-    auto bearings = json::array({});
-    auto entries = json::array({});
-
     // Sort edges by increasing bearing and update the in/out edge indexes
     std::sort(edges.begin(), edges.end());
     uint32_t incoming_index, outgoing_index;
@@ -555,27 +556,35 @@ json::ArrayPtr intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
       if (edges[n].out_edge) {
         outgoing_index = n;
       }
-      bearings->emplace_back(static_cast<uint64_t>(edges[n].bearing));
-      entries->emplace_back(edges[n].routeable);
     }
 
     // Add the index of the input edge and output edge
     if (i > 0) {
-      intersection->emplace("in", static_cast<uint64_t>(incoming_index));
+      writer("in", static_cast<uint64_t>(incoming_index));
     }
     if (!arrive_maneuver) {
-      intersection->emplace("out", static_cast<uint64_t>(outgoing_index));
+      writer("out", static_cast<uint64_t>(outgoing_index));
     }
 
-    intersection->emplace("entry", entries);
-    intersection->emplace("bearings", bearings);
+    // Add bearing and entry output
+    writer.start_array("entry");
+    for (const auto& edge : edges) {
+      writer(edge.routeable);
+    }
+    writer.end_array();
+    writer.start_array("bearings");
+    for (const auto& edge : edges) {
+      writer(static_cast<uint64_t>(edge.bearing));
+    }
+    writer.end_array();
 
-    // Add tunnel_name for tunnels
+    // Add tunnel_name for tunnels, only the first one
     if (!arrive_maneuver) {
       if (curr_edge->tunnel() && !curr_edge->tagged_name().empty()) {
         for (uint32_t t = 0; t < curr_edge->tagged_name().size(); ++t) {
           if (curr_edge->tagged_name().Get(t).type() == TaggedName_Type_kTunnel) {
-            intersection->emplace("tunnel_name", curr_edge->tagged_name().Get(t).value());
+            writer("tunnel_name", curr_edge->tagged_name().Get(t).value());
+            break;
           }
         }
       }
@@ -602,11 +611,11 @@ json::ArrayPtr intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
         classes.push_back("restricted");
       }
       if (classes.size() > 0) {
-        auto class_list = json::array({});
+        writer.start_array("classes");
         for (const auto& cl : classes) {
-          class_list->emplace_back(cl);
+          writer(cl);
         }
-        intersection->emplace("classes", class_list);
+        writer.end_array();
       }
     }
 
@@ -615,73 +624,73 @@ json::ArrayPtr intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
     // Verify that turn lanes are not non-directional
     if (prev_edge && (prev_edge->turn_lanes_size() > 0) && prev_edge->HasActiveTurnLane() &&
         !prev_edge->HasNonDirectionalTurnLane()) {
-      auto lanes = json::array({});
+      writer.start_array("lanes");
       for (const auto& turn_lane : prev_edge->turn_lanes()) {
-        auto lane = json::map({});
+        writer.start_object();
         // Process 'valid' & 'active' flags
         bool is_active = turn_lane.state() == TurnLane::kActive;
         // an active lane is also valid
         bool is_valid = is_active || turn_lane.state() == TurnLane::kValid;
-        lane->emplace("active", is_active);
-        lane->emplace("valid", is_valid);
+        writer("active", is_active);
+        writer("valid", is_valid);
         // Add valid_indication for a valid & active lanes
         if (turn_lane.state() != TurnLane::kInvalid) {
-          lane->emplace("valid_indication", turn_lane_direction(turn_lane.active_direction()));
+          writer("valid_indication", turn_lane_direction(turn_lane.active_direction()));
         }
 
         // Process 'indications' array - add indications from left to right
-        auto indications = json::array({});
+        writer.start_array("indications");
         uint16_t mask = turn_lane.directions_mask();
 
         // TODO make map for lane mask to osrm indication string
 
         // reverse (left u-turn)
         if (mask & kTurnLaneReverse && prev_edge->drive_on_right()) {
-          indications->emplace_back(osrmconstants::kModifierUturn);
+          writer(osrmconstants::kModifierUturn);
         }
         // sharp_left
         if (mask & kTurnLaneSharpLeft) {
-          indications->emplace_back(osrmconstants::kModifierSharpLeft);
+          writer(osrmconstants::kModifierSharpLeft);
         }
         // left
         if (mask & kTurnLaneLeft) {
-          indications->emplace_back(osrmconstants::kModifierLeft);
+          writer(osrmconstants::kModifierLeft);
         }
         // slight_left
         if (mask & kTurnLaneSlightLeft) {
-          indications->emplace_back(osrmconstants::kModifierSlightLeft);
+          writer(osrmconstants::kModifierSlightLeft);
         }
         // through
         if (mask & kTurnLaneThrough) {
-          indications->emplace_back(osrmconstants::kModifierStraight);
+          writer(osrmconstants::kModifierStraight);
         }
         // slight_right
         if (mask & kTurnLaneSlightRight) {
-          indications->emplace_back(osrmconstants::kModifierSlightRight);
+          writer(osrmconstants::kModifierSlightRight);
         }
         // right
         if (mask & kTurnLaneRight) {
-          indications->emplace_back(osrmconstants::kModifierRight);
+          writer(osrmconstants::kModifierRight);
         }
         // sharp_right
         if (mask & kTurnLaneSharpRight) {
-          indications->emplace_back(osrmconstants::kModifierSharpRight);
+          writer(osrmconstants::kModifierSharpRight);
         }
         // reverse (right u-turn)
         if (mask & kTurnLaneReverse && !prev_edge->drive_on_right()) {
-          indications->emplace_back(osrmconstants::kModifierUturn);
+          writer(osrmconstants::kModifierUturn);
         }
-        lane->emplace("indications", std::move(indications));
-        lanes->emplace_back(std::move(lane));
+        writer.end_array();
+        writer.end_object();
       }
-      intersection->emplace("lanes", std::move(lanes));
+      writer.end_array();
     }
 
-    // Add the intersection to the JSON array
-    intersections->emplace_back(intersection);
+    // Close the intersection
+    writer.end_object();
     count++;
   }
-  return intersections;
+  writer.end_array();
 }
 
 // Add exits (exit numbers) along a step/maneuver.
@@ -697,58 +706,40 @@ std::string exits(const valhalla::TripSign& sign) {
   return exits;
 }
 
-valhalla::baldr::json::RawJSON serializeIncident(const TripLeg::Incident& incident) {
-  rapidjson::StringBuffer stringbuffer;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(stringbuffer);
-  writer.StartObject();
-  osrm::serializeIncidentProperties(writer, incident.metadata(),
-                                    incident.has_begin_shape_index() ? incident.begin_shape_index()
-                                                                     : -1,
-                                    incident.has_end_shape_index() ? incident.end_shape_index() : -1,
-                                    "", "");
-  writer.EndObject();
-  return {stringbuffer.GetString()};
-}
-
-// Serializes incidents and adds to json-document
+// Serializes incidents into the leg
 void serializeIncidents(const google::protobuf::RepeatedPtrField<TripLeg::Incident>& incidents,
-                        json::Jmap& doc) {
+                        rapidjson::writer_wrapper_t& writer) {
   if (incidents.size() == 0) {
     // No incidents, nothing to do
     return;
   }
-  json::ArrayPtr serialized_incidents = std::shared_ptr<json::Jarray>(new json::Jarray());
-  {
-    // Bring up any already existing array
-    auto existing = doc.find("incidents");
-    if (existing != doc.end()) {
-      if (auto* ptr = boost::get<std::shared_ptr<valhalla::baldr::json::Jarray>>(&existing->second)) {
-        serialized_incidents = *ptr;
-      } else {
-        throw std::logic_error("Invalid state: stored ptr should not be null");
-      }
-    }
-  }
+  writer.start_array("incidents");
   for (const auto& incident : incidents) {
-    auto json_incident = serializeIncident(incident);
-    serialized_incidents->emplace_back(json_incident);
-  }
-  doc.emplace("incidents", serialized_incidents);
+    int begin_shape_index = incident.has_begin_shape_index() ? incident.begin_shape_index() : -1;
+    int end_shape_index = incident.has_end_shape_index() ? incident.end_shape_index() : -1;
+    rapidjson::StringBuffer stringbuffer;
+    rapidjson::Writer<rapidjson::StringBuffer> incident_writer(stringbuffer);
+    incident_writer.StartObject();
+    osrm::serializeIncidentProperties(incident_writer, incident.metadata(), begin_shape_index,
+                                      end_shape_index, "", "");
+    incident_writer.EndObject();
+    writer.raw(stringbuffer.GetString());
+  }
+  writer.end_array();
 }
 
-void serializeClosures(const valhalla::TripLeg& leg, json::Jmap& doc) {
+void serializeClosures(const valhalla::TripLeg& leg, rapidjson::writer_wrapper_t& writer) {
   if (!leg.closures_size()) {
     return;
   }
-  auto closures = json::array({});
-  closures->reserve(leg.closures_size());
+  writer.start_array("closures");
   for (const valhalla::TripLeg_Closure& closure : leg.closures()) {
-    auto closure_obj = json::map({});
-    closure_obj->emplace("geometry_index_start", static_cast<uint64_t>(closure.begin_shape_index()));
-    closure_obj->emplace("geometry_index_end", static_cast<uint64_t>(closure.end_shape_index()));
-    closures->emplace_back(std::move(closure_obj));
+    writer.start_object();
+    writer("geometry_index_start", static_cast<uint64_t>(closure.begin_shape_index()));
+    writer("geometry_index_end", static_cast<uint64_t>(closure.end_shape_index()));
+    writer.end_object();
   }
-  doc.emplace("closures", closures);
+  writer.end_array();
 }
 
 // Compile and return the refs of the specified list
@@ -1041,24 +1032,25 @@ std::string ramp_type(const valhalla::DirectionsLeg::Maneuver& maneuver) {
 }
 
 // Populate the OSRM maneuver record within a step.
-json::MapPtr osrm_maneuver(const valhalla::DirectionsLeg::Maneuver& maneuver,
-                           valhalla::odin::EnhancedTripLeg* etp,
-                           const PointLL& man_ll,
-                           const bool depart_maneuver,
-                           const bool arrive_maneuver,
-                           const uint32_t prev_intersection_count,
-                           const std::string& mode,
-                           const std::string& prev_mode,
-                           const bool rotary,
-                           const bool prev_rotary,
-                           const valhalla::Options& options) {
-  auto osrm_man = json::map({});
+void osrm_maneuver(const valhalla::DirectionsLeg::Maneuver& maneuver,
+                   valhalla::odin::EnhancedTripLeg* etp,
+                   const PointLL& man_ll,
+                   const bool depart_maneuver,
+                   const bool arrive_maneuver,
+                   const uint32_t prev_intersection_count,
+                   const std::string& mode,
+                   const std::string& prev_mode,
+                   const bool rotary,
+                   const bool prev_rotary,
+                   const valhalla::Options& options,
+                   rapidjson::writer_wrapper_t& writer) {
+  writer.start_object("maneuver");
 
   // Set the location
-  auto loc = json::array({});
-  loc->emplace_back(json::fixed_t{man_ll.lng(), 6});
-  loc->emplace_back(json::fixed_t{man_ll.lat(), 6});
-  osrm_man->emplace("location", loc);
+  writer.start_array("location");
+  writer(man_ll.lng(), 6);
+  writer(man_ll.lat(), 6);
+  writer.end_array();
 
   // Get incoming and outgoing bearing. For the incoming heading, use the
   // prior edge from the TripLeg. Compute turn modifier. TODO - reconcile
@@ -1066,18 +1058,18 @@ json::MapPtr osrm_maneuver(const valhalla::DirectionsLeg::Maneuver& maneuver,
   uint32_t idx = maneuver.begin_path_index();
   uint32_t in_brg = (idx > 0) ? etp->GetPrevEdge(idx)->end_heading() : 0;
   uint32_t out_brg = maneuver.begin_heading();
-  osrm_man->emplace("bearing_before", static_cast<uint64_t>(in_brg));
-  osrm_man->emplace("bearing_after", static_cast<uint64_t>(out_brg));
+  writer("bearing_before", static_cast<uint64_t>(in_brg));
+  writer("bearing_after", static_cast<uint64_t>(out_brg));
 
   std::string modifier;
   if (!depart_maneuver) {
     modifier = turn_modifier(maneuver, in_brg, out_brg, arrive_maneuver);
     if (!modifier.empty())
-      osrm_man->emplace("modifier", modifier);
+      writer("modifier", modifier);
   }
 
   if (options.directions_type() == DirectionsType::instructions) {
-    osrm_man->emplace("instruction", maneuver.text_instruction());
+    writer("instruction", maneuver.text_instruction());
   }
 
   // TODO - logic to convert maneuver types from Valhalla into OSRM maneuver types.
@@ -1096,7 +1088,7 @@ json::MapPtr osrm_maneuver(const valhalla::DirectionsLeg::Maneuver& maneuver,
     }
     // Roundabout count
     if (maneuver.has_roundabout_exit_count()) {
-      osrm_man->emplace("exit", static_cast<uint64_t>(maneuver.roundabout_exit_count()));
+      writer("exit", static_cast<uint64_t>(maneuver.roundabout_exit_count()));
     }
   } else if (maneuver.type() == DirectionsLeg_Maneuver_Type_kRoundaboutExit) {
     if (prev_rotary) {
@@ -1185,31 +1177,25 @@ json::MapPtr osrm_maneuver(const valhalla::DirectionsLeg::Maneuver& maneuver,
       }
     }
   }
-  osrm_man->emplace("type", maneuver_type);
+  writer("type", maneuver_type);
 
-  return osrm_man;
+  writer.end_object();
 }
 
 // Method to get the geometry string for a maneuver.
-void maneuver_geometry(json::MapPtr& step,
-                       const uint32_t begin_idx,
+void maneuver_geometry(const uint32_t begin_idx,
                        const uint32_t end_idx,
                        const std::vector<PointLL>& shape,
                        bool is_arrive_maneuver,
-                       const valhalla::Options& options) {
+                       const valhalla::Options& options,
+                       rapidjson::writer_wrapper_t& writer) {
   // Must add one to the end range since maneuver end shape index is exclusive
   std::vector<PointLL> maneuver_shape(shape.begin() + begin_idx, shape.begin() + end_idx + 1);
   // Last maneuver shape is a linestring with two identical points at the destination
   if (is_arrive_maneuver) {
     maneuver_shape.push_back(shape.back());
   }
-
-  if (options.shape_format() == geojson) {
-    step->emplace("geometry", geojson_shape(maneuver_shape));
-  } else {
-    int precision = options.shape_format() == polyline6 ? 1e6 : 1e5;
-    step->emplace("geometry", midgard::encode(maneuver_shape, precision));
-  }
+  shape_geometry(maneuver_shape, options, writer);
 }
 
 // Get the mode
@@ -1274,26 +1260,60 @@ names_and_refs(const valhalla::DirectionsLeg::Maneuver& maneuver) {
 }
 
 // Serialize each leg
-json::ArrayPtr serialize_legs(const google::protobuf::RepeatedPtrField<valhalla::DirectionsLeg>& legs,
-                              const std::vector<std::string>& leg_summaries,
-                              google::protobuf::RepeatedPtrField<valhalla::TripLeg>& path_legs,
-                              bool imperial,
-                              const valhalla::Options& options) {
-  auto output_legs = json::array({});
-  output_legs->reserve(path_legs.size());
-
+void serialize_legs(const google::protobuf::RepeatedPtrField<valhalla::DirectionsLeg>& legs,
+                    const std::vector<std::string>& leg_summaries,
+                    google::protobuf::RepeatedPtrField<valhalla::TripLeg>& path_legs,
+                    bool imperial,
+                    const valhalla::Options& options,
+                    rapidjson::writer_wrapper_t& writer) {
   // Verify that the path_legs list is the same size as the legs list
   if (legs.size() != path_legs.size()) {
     throw valhalla_exception_t{503};
   }
 
   // Iterate through the legs in DirectionsLeg and TripLeg
+  writer.start_array("legs");
   int leg_index = 0;
   auto leg = legs.begin();
   for (auto& path_leg : path_legs) {
     valhalla::odin::EnhancedTripLeg etp(path_leg);
-    auto output_leg = json::map({});
-    output_leg->reserve(10);
+    writer.start_object();
+
+    // Add distance, duration, weight, and summary
+    // Get a summary based on longest maneuvers.
+    double duration = leg->summary().time();
+    double distance = units_to_meters(leg->summary().length(), !imperial);
+    writer("summary", leg_summaries[leg_index]);
+    writer("distance", distance, 3);
+    writer("duration", duration, 3);
+    writer("weight", path_leg.node().rbegin()->cost().elapsed_cost().cost(), 3);
+    auto recost_itr = options.recostings().begin();
+    for (const auto& recost : path_leg.node().rbegin()->recosts()) {
+      if (recost.has_elapsed_cost()) {
+        writer("duration_" + recost_itr->name(), recost.elapsed_cost().seconds(), 3);
+        writer("weight_" + recost_itr->name(), recost.elapsed_cost().cost(), 3);
+      } else {
+        writer("duration_" + recost_itr->name(), nullptr);
+        writer("weight_" + recost_itr->name(), nullptr);
+      }
+      ++recost_itr;
+    }
+
+    // Add admin country codes to leg json
+    writer.start_array("admins");
+    for (const auto& admin : path_leg.admin()) {
+      writer.start_object();
+      if (admin.has_country_code()) {
+        writer("iso_3166_1", admin.country_code());
+        auto country_iso3 = valhalla::baldr::get_iso_3166_1_alpha3(admin.country_code());
+        if (!country_iso3.empty()) {
+          writer("iso_3166_1_alpha3", country_iso3);
+        }
+      }
+      // TODO: iso_3166_2 state code
+      writer.end_object();
+    }
+    writer.end_array();
 
     // Get the full shape for the leg. We want to use this for serializing
     // encoded shape for each step (maneuver) in OSRM output.
@@ -1301,6 +1321,7 @@ json::ArrayPtr serialize_legs(const google::protobuf::RepeatedPtrField<valhalla:
 
     //#########################################################################
     // Iterate through maneuvers - convert to OSRM steps
+    writer.start_array("steps");
     uint32_t maneuver_index = 0;
     uint32_t prev_intersection_count = 0;
     std::string drive_side = "right";
@@ -1310,12 +1331,8 @@ json::ArrayPtr serialize_legs(const google::protobuf::RepeatedPtrField<valhalla:
     std::string prev_mode = "";
     bool rotary = false;
     bool prev_rotary = false;
-    auto steps = json::array({});
-    const DirectionsLeg_Maneuver* prev_maneuver = nullptr;
-    json::MapPtr prev_step;
     for (const auto& maneuver : leg->maneuver()) {
-      auto step = json::map({});
-      step->reserve(15); // lots of conditional stuff here
+      writer.start_object();
       bool depart_maneuver = (maneuver_index == 0);
       bool arrive_maneuver = (maneuver_index == leg->maneuver_size() - 1);
 
@@ -1324,8 +1341,8 @@ json::ArrayPtr serialize_legs(const google::protobuf::RepeatedPtrField<valhalla:
       // name change
 
       // Add geometry for this maneuver
-      maneuver_geometry(step, maneuver.begin_shape_index(), maneuver.end_shape_index(), shape,
-                        arrive_maneuver, options);
+      maneuver_geometry(maneuver.begin_shape_index(), maneuver.end_shape_index(), shape,
+                        arrive_maneuver, options, writer);
 
       // Add mode, driving side, weight, distance, duration, name
       double distance = units_to_meters(maneuver.length(), !imperial);
@@ -1343,37 +1360,34 @@ json::ArrayPtr serialize_legs(const google::protobuf::RepeatedPtrField<valhalla:
           prev_mode = mode;
       }
 
-      step->emplace("mode", mode);
-      step->emplace("driving_side", drive_side);
-      step->emplace("distance", json::fixed_t{distance, 3});
-      step->emplace("duration", json::fixed_t{duration, 3});
+      writer("mode", mode);
+      writer("driving_side", drive_side);
+      writer("distance", distance, 3);
+      writer("duration", duration, 3);
       const auto& end_node = path_leg.node(maneuver.end_path_index());
       const auto& begin_node = path_leg.node(maneuver.begin_path_index());
       auto weight = end_node.cost().elapsed_cost().cost() - begin_node.cost().elapsed_cost().cost();
-      step->emplace("weight", json::fixed_t{weight, 3});
+      writer("weight", weight, 3);
       auto recost_itr = options.recostings().begin();
       auto begin_recost_itr = begin_node.recosts().begin();
       for (const auto& end_recost : end_node.recosts()) {
         if (end_recost.has_elapsed_cost()) {
-          step->emplace("duration_" + recost_itr->name(),
-                        json::fixed_t{end_recost.elapsed_cost().seconds() -
-                                          begin_recost_itr->elapsed_cost().seconds(),
-                                      3});
-          step->emplace("weight_" + recost_itr->name(),
-                        json::fixed_t{end_recost.elapsed_cost().cost() -
-                                          begin_recost_itr->elapsed_cost().cost(),
-                                      3});
+          writer("duration_" + recost_itr->name(),
+                 end_recost.elapsed_cost().seconds() - begin_recost_itr->elapsed_cost().seconds(),
+                 3);
+          writer("weight_" + recost_itr->name(),
+                 end_recost.elapsed_cost().cost() - begin_recost_itr->elapsed_cost().cost(), 3);
         } else {
-          step->emplace("duration_" + recost_itr->name(), nullptr_t());
-          step->emplace("weight_" + recost_itr->name(), nullptr_t());
+          writer("duration_" + recost_itr->name(), nullptr);
+          writer("weight_" + recost_itr->name(), nullptr);
         }
         ++recost_itr;
         ++begin_recost_itr;
       }
 
-      step->emplace("name", name);
+      writer("name", name);
       if (!ref.empty()) {
-        step->emplace("ref", ref);
+        writer("ref", ref);
       }
 
       // Check if speed limits were requested
@@ -1383,153 +1397,105 @@ json::ArrayPtr serialize_legs(const google::protobuf::RepeatedPtrField<valhalla:
         auto country = speed_limit_info.find(country_code);
         if (country != speed_limit_info.end()) {
           // Some countries have different speed limit sign types and speed units
-          step->emplace("speedLimitSign", country->second.first);
-          step->emplace("speedLimitUnit", country->second.second);
+          writer("speedLimitSign", country->second.first);
+          writer("speedLimitUnit", country->second.second);
         } else {
           // Otherwise use the defaults (vienna convention style and km/h)
-          step->emplace("speedLimitSign", kSpeedLimitSignVienna);
-          step->emplace("speedLimitUnit", kSpeedLimitUnitsKph);
+          writer("speedLimitSign", kSpeedLimitSignVienna);
+          writer("speedLimitUnit", kSpeedLimitUnitsKph);
         }
       }
 
       rotary = ((maneuver.type() == DirectionsLeg_Maneuver_Type_kRoundaboutEnter) &&
                 (maneuver.street_name_size() > 0));
       if (rotary) {
-        step->emplace("rotary_name", maneuver.street_name(0).value());
+        writer("rotary_name", maneuver.street_name(0).value());
       }
 
       // Add OSRM maneuver
-      step->emplace("maneuver",
-                    osrm_maneuver(maneuver, &etp, shape[maneuver.begin_shape_index()],
-                                  depart_maneuver, arrive_maneuver, prev_intersection_count, mode,
-                                  prev_mode, rotary, prev_rotary, options));
+      osrm_maneuver(maneuver, &etp, shape[maneuver.begin_shape_index()], depart_maneuver,
+                    arrive_maneuver, prev_intersection_count, mode, prev_mode, rotary, prev_rotary,
+                    options, writer);
 
       // Add destinations
       const auto& sign = maneuver.sign();
       std::string dest = destinations(sign);
-      if (!dest.empty()) {
-        step->emplace("destinations", dest);
-        // If the maneuver is an exit roundabout
-        // and the previous maneuver is an enter roundabout
-        // then set the destinations on the previous step
-        if ((maneuver.type() == DirectionsLeg_Maneuver_Type_kRoundaboutExit) && prev_maneuver &&
-            (prev_maneuver->type() == DirectionsLeg_Maneuver_Type_kRoundaboutEnter) && prev_step) {
-          prev_step->emplace("destinations", dest);
+      // If the maneuver is an enter roundabout without destinations
+      // and the next maneuver is an exit roundabout
+      // then use the destinations of the next step
+      if (dest.empty() && !arrive_maneuver &&
+          (maneuver.type() == DirectionsLeg_Maneuver_Type_kRoundaboutEnter)) {
+        const auto& next_maneuver = leg->maneuver(maneuver_index + 1);
+        if (next_maneuver.type() == DirectionsLeg_Maneuver_Type_kRoundaboutExit) {
+          dest = destinations(next_maneuver.sign());
         }
       }
+      if (!dest.empty()) {
+        writer("destinations", dest);
+      }
 
       // Add exits
       std::string ex = exits(sign);
       if (!ex.empty()) {
-        step->emplace("exits", ex);
+        writer("exits", ex);
       }
 
       // Add junction_name if not the start maneuver
       std::string junction_name = get_sign_elements(sign.junction_names());
       if (!depart_maneuver && !junction_name.empty()) {
-        step->emplace("junction_name", junction_name);
+        writer("junction_name", junction_name);
       }
 
       // If the user requested guidance_views
       if (options.guidance_views()) {
         // Add guidance_views if not the start maneuver
         if (!depart_maneuver && (maneuver.guidance_views_size() > 0)) {
-          auto guidance_views = json::array({});
-          guidance_views->reserve(maneuver.guidance_views_size());
+          writer.start_array("guidance_views");
           for (const auto& gv : maneuver.guidance_views()) {
-            auto guidance_view = json::map({});
-            guidance_view->emplace("data_id", gv.data_id());
-            guidance_view->emplace("type", GuidanceViewTypeToString(gv.type()));
-            guidance_view->emplace("base_id", gv.base_id());
-            auto overlay_ids = json::array({});
-            overlay_ids->reserve(gv.overlay_ids_size());
+            writer.start_object();
+            writer("data_id", gv.data_id());
+            writer("type", GuidanceViewTypeToString(gv.type()));
+            writer("base_id", gv.base_id());
+            writer.start_array("overlay_ids");
             for (const auto& overlay : gv.overlay_ids()) {
-              overlay_ids->emplace_back(overlay);
+              writer(overlay);
             }
-            guidance_view->emplace("overlay_ids", std::move(overlay_ids));
-
-            // Append to guidance view list
-            guidance_views->emplace_back(std::move(guidance_view));
+            writer.end_array();
+            writer.end_object();
           }
-          // Add guidance views to step
-          step->emplace("guidance_views", std::move(guidance_views));
+          writer.end_array();
         }
       }
 
       // Add intersections
-      step->emplace("intersections",
-                    intersections(maneuver, &etp, shape, prev_intersection_count, arrive_maneuver));
+      intersections(maneuver, &etp, shape, prev_intersection_count, arrive_maneuver, writer);
 
       // Add step
       prev_rotary = rotary;
       prev_mode = mode;
-      prev_step = step;
-      prev_maneuver = &maneuver;
       maneuver_index++;
-      steps->emplace_back(std::move(step));
+      writer.end_object();
     } // end maneuver loop
+    writer.end_array();
     //#########################################################################
 
-    // Add distance, duration, weight, and summary
-    // Get a summary based on longest maneuvers.
-    double duration = leg->summary().time();
-    double distance = units_to_meters(leg->summary().length(), !imperial);
-    output_leg->emplace("summary", leg_summaries[leg_index]);
-    output_leg->emplace("distance", json::fixed_t{distance, 3});
-    output_leg->emplace("duration", json::fixed_t{duration, 3});
-    output_leg->emplace("weight",
-                        json::fixed_t{path_leg.node().rbegin()->cost().elapsed_cost().cost(), 3});
-    auto recost_itr = options.recostings().begin();
-    for (const auto& recost : path_leg.node().rbegin()->recosts()) {
-      if (recost.has_elapsed_cost()) {
-        output_leg->emplace("duration_" + recost_itr->name(),
-                            json::fixed_t{recost.elapsed_cost().seconds(), 3});
-        output_leg->emplace("weight_" + recost_itr->name(),
-                            json::fixed_t{recost.elapsed_cost().cost(), 3});
-      } else {
-        output_leg->emplace("duration_" + recost_itr->name(), nullptr_t());
-        output_leg->emplace("weight_" + recost_itr->name(), nullptr_t());
-      }
-      ++recost_itr;
-    }
-
-    // Add admin country codes to leg json
-    auto admins = json::array({});
-    admins->reserve(path_leg.admin_size());
-    for (const auto& admin : path_leg.admin()) {
-      auto admin_map = json::map({});
-      if (admin.has_country_code()) {
-        admin_map->emplace("iso_3166_1", admin.country_code());
-        auto country_iso3 = valhalla::baldr::get_iso_3166_1_alpha3(admin.country_code());
-        if (!country_iso3.empty()) {
-          admin_map->emplace("iso_3166_1_alpha3", country_iso3);
-        }
-      }
-      // TODO: iso_3166_2 state code
-      admins->push_back(admin_map);
-    }
-    output_leg->emplace("admins", std::move(admins));
-
-    // Add steps to the leg
-    output_leg->emplace("steps", std::move(steps));
-
     // Add shape_attributes, if requested
     if (path_leg.has_shape_attributes()) {
-      output_leg->emplace("annotation", serialize_annotations(path_leg));
+      serialize_annotations(path_leg, writer);
     }
 
     // Add incidents to the leg
-    serializeIncidents(path_leg.incidents(), *output_leg);
+    serializeIncidents(path_leg.incidents(), writer);
 
     // Add closures
-    serializeClosures(path_leg, *output_leg);
+    serializeClosures(path_leg, writer);
 
     // Keep the leg
-    output_legs->emplace_back(std::move(output_leg));
+    writer.end_object();
     leg++;
     leg_index++;
   }
-  return output_legs;
+  writer.end_array();
 }
 
 std::vector<std::vector<std::string>>
@@ -1614,28 +1580,27 @@ summarize_route_legs(const google::protobuf::RepeatedPtrField<DirectionsRoute>&
 //     DirectionsLeg protocol buffer
 std::string serialize(valhalla::Api& api) {
   auto& options = *api.mutable_options();
-  auto json = json::map({});
+  rapidjson::writer_wrapper_t writer(4096 + api.trip().routes_size() * 16384);
+  writer.start_object();
 
   // If here then the route succeeded. Set status code to OK and serialize waypoints (locations).
-  std::string status("Ok");
-  json->emplace("code", status);
+  writer("code", "Ok");
+  writer.start_array(options.action() == valhalla::Options::trace_route ? "tracepoints"
+                                                                        : "waypoints");
   switch (options.action()) {
     case valhalla::Options::trace_route:
-      json->emplace("tracepoints", osrm::waypoints(options.shape(), true));
+      osrm::waypoints(options.shape(), writer, true);
       break;
     case valhalla::Options::route:
-      json->emplace("waypoints", osrm::waypoints(api.trip()));
+      osrm::waypoints(api.trip(), writer);
       break;
     case valhalla::Options::optimized_route:
-      json->emplace("waypoints", waypoints(*options.mutable_locations()));
+      waypoints(*options.mutable_locations(), writer);
       break;
     default:
       throw std::runtime_error("Unknown route serialization action");
   }
-
-  // Add each route
-  auto routes = json::array({});
-  routes->reserve(api.trip().routes_size());
+  writer.end_array();
 
   // OSRM is always using metric for non narrative stuff
   bool imperial = options.units() == Options::miles;
@@ -1647,40 +1612,35 @@ std::string serialize(valhalla::Api& api) {
   std::vector<std::vector<std::string>> route_leg_summaries =
       summarize_route_legs(api.directions().routes());
 
-  // For each route...
+  // Add each route, routes are called matchings in osrm map matching mode
+  writer.start_array(options.action() == valhalla::Options::trace_route ? "matchings" : "routes");
   for (int i = 0; i < api.trip().routes_size(); ++i) {
-    // Create a route to add to the array
-    auto route = json::map({});
-    route->reserve(10); // some of the things are conditional so we take a swag here
+    writer.start_object();
 
     if (options.action() == Options::trace_route) {
       // NOTE(mookerji): confidence value here is a placeholder for future implementation.
-      route->emplace("confidence", json::fixed_t{1, 1});
+      writer("confidence", 1., 1);
     }
     // Add linear references, if applicable
-    route_references(route, api.trip().routes(i), options);
+    openlr(api, i, writer);
 
     // Concatenated route geometry
-    route_geometry(route, api.directions().routes(i), options);
+    route_geometry(writer, api.directions().routes(i), options);
 
     // Other route summary information
-    route_summary(route, api, imperial, i);
+    route_summary(writer, api, imperial, i);
 
     // Serialize route legs
-    route->emplace("legs", serialize_legs(api.directions().routes(i).legs(), route_leg_summaries[i],
-                                          *api.mutable_trip()->mutable_routes(i)->mutable_legs(),
-                                          imperial, options));
+    serialize_legs(api.directions().routes(i).legs(), route_leg_summaries[i],
+                   *api.mutable_trip()->mutable_routes(i)->mutable_legs(), imperial, options,
+                   writer);
 
-    routes->emplace_back(std::move(route));
+    writer.end_object();
   }
+  writer.end_array();
 
-  // Routes are called matchings in osrm map matching mode
-  json->emplace(options.action() == valhalla::Options::trace_route ? "matchings" : "routes",
-                std::move(routes));
-
-  std::stringstream ss;
-  ss << *json;
-  return ss.str();
+  writer.end_object();
+  return writer.get_buffer();
 }
 
 } // namespace osrm_serializers
@@ -1703,7 +1663,7 @@ TEST(RouteSerializerOsrm, testserializeIncidents) {
 
   rapidjson::Document serialized_to_json;
   {
-    auto intersection_doc = json::Jmap();
+    rapidjson::writer_wrapper_t writer;
     auto leg = TripLeg();
     // Sets up the incident
     auto incidents = leg.mutable_incidents();
@@ -1736,12 +1696,12 @@ TEST(RouteSerializerOsrm, testserializeIncidents) {
     *incident->mutable_metadata() = meta;
 
     // Finally call the function under test to serialize to json
-    serializeIncidents(*incidents, intersection_doc);
+    writer.start_object();
+    serializeIncidents(*incidents, writer);
+    writer.end_object();
 
     // Lastly, convert to rapidjson
-    std::stringstream ss;
-    ss << intersection_doc;
-    serialized_to_json.Parse(ss.str().c_str());
+    serialized_to_json.Parse(writer.get_buffer());
   }
 
   rapidjson::Document expected_json;
@@ -1788,7 +1748,7 @@ TEST(RouteSerializerOsrm, testserializeIncidentsMultipleIncidentsSingleEdge) {
 
   rapidjson::Document serialized_to_json;
   {
-    auto intersection_doc = json::Jmap();
+    rapidjson::writer_wrapper_t writer;
     auto leg = TripLeg();
     // Sets up the incident
     auto* incidents = leg.mutable_incidents();
@@ -1827,12 +1787,12 @@ TEST(RouteSerializerOsrm, testserializeIncidentsMultipleIncidentsSingleEdge) {
     }
 
     // Finally call the function under test to serialize to json
-    serializeIncidents(*incidents, intersection_doc);
+    writer.start_object();
+    serializeIncidents(*incidents, writer);
+    writer.end_object();
 
     // Lastly, convert to rapidjson
-    std::stringstream ss;
-    ss << intersection_doc;
-    serialized_to_json.Parse(ss.str().c_str());
+    serialized_to_json.Parse(writer.get_buffer());
   }
 
   rapidjson::Document expected_json;
@@ -1875,16 +1835,16 @@ TEST(RouteSerializerOsrm, testserializeIncidentsNothingToAdd) {
 
   rapidjson::Document serialized_to_json;
   {
-    auto intersection_doc = json::Jmap();
+    rapidjson::writer_wrapper_t writer;
     auto leg = TripLeg();
 
     // Finally call the function under test to serialize to json
-    serializeIncidents(leg.incidents(), intersection_doc);
+    writer.start_object();
+    serializeIncidents(leg.incidents(), writer);
+    writer.end_object();
 
     // Lastly, convert to rapidjson
-    std::stringstream ss;
-    ss << intersection_doc;
-    serialized_to_json.Parse(ss.str().c_str());
+    serialized_to_json.Parse(writer.get_buffer());
   }
 
   rapidjson::Document expected_json;
@@ -1900,15 +1860,15 @@ TEST(RouteSerializerOsrm, testserializeAnnotationsEmpty) {
   rapidjson::Document serialized_to_json;
   {
     auto leg = TripLeg();
-    json::MapPtr annotations = serialize_annotations(leg);
+    rapidjson::writer_wrapper_t writer;
+    writer.start_object();
+    serialize_annotations(leg, writer);
+    writer.end_object();
 
-    std::stringstream ss;
-    ss << *annotations;
-    serialized_to_json.Parse(ss.str().c_str());
-    std::cout << *annotations << std::endl;
+    serialized_to_json.Parse(writer.get_buffer());
   }
   rapidjson::Document expected_json;
-  { expected_json.Parse(R"({})"); }
+  { expected_json.Parse(R"({"annotation": {}})"); }
 
   assert_json_equality(serialized_to_json, expected_json);
 }
@@ -1920,18 +1880,21 @@ TEST(RouteSerializerOsrm, testserializeAnnotations) {
     leg.mutable_shape_attributes()->add_time(1);
     leg.mutable_shape_attributes()->add_length(2);
     leg.mutable_shape_attributes()->add_speed(3);
-    auto annotations = serialize_annotations(leg);
+    rapidjson::writer_wrapper_t writer;
+    writer.start_object();
+    serialize_annotations(leg, writer);
+    writer.end_object();
 
-    std::stringstream ss;
-    ss << *annotations;
-    serialized_to_json.Parse(ss.str().c_str());
+    serialized_to_json.Parse(writer.get_buffer());
   }
   rapidjson::Document expected_json;
   {
     expected_json.Parse(R"({
-      "duration": [0.001],
-      "distance": [0.2],
-      "speed": [0.3]
+      "annotation": {
+        "duration": [0.001],
+        "distance": [0.2],
+        "speed": [0.3]
+      }
     })");
     ASSERT_TRUE(expected_json.IsObject());
   }
@@ -1946,20 +1909,23 @@ TEST(RouteSerializerOsrm, testserializeAnnotationsSpeedLimits) {
     leg.mutable_shape_attributes()->add_speed_limit(30);
     leg.mutable_shape_attributes()->add_speed_limit(255);
     leg.mutable_shape_attributes()->add_speed_limit(0);
-    auto annotations = serialize_annotations(leg);
+    rapidjson::writer_wrapper_t writer;
+    writer.start_object();
+    serialize_annotations(leg, writer);
+    writer.end_object();
 
-    std::stringstream ss;
-    ss << *annotations;
-    serialized_to_json.Parse(ss.str().c_str());
+    serialized_to_json.Parse(writer.get_buffer());
   }
   rapidjson::Document expected_json;
   {
     expected_json.Parse(R"({
-      "maxspeed": [
-        { "speed": 30, "unit": "km/h" },
-        { "none": true },
-        { "unknown": true }
-      ]
+      "annotation": {
+        "maxspeed": [
+          { "speed": 30, "unit": "km/h" },
+          { "none": true },
+          { "unknown": true }
+        ]
+      }
     })");
     ASSERT_TRUE(expected_json.IsObject());
   }
@@ -128,74 +128,75 @@ namespace osrm {
 
 // Serialize a location (waypoint) in OSRM compatible format. Waypoint format is described here:
 //     http://project-osrm.org/docs/v5.5.1/api/#waypoint-object
-valhalla::baldr::json::MapPtr
-waypoint(const valhalla::Location& location, bool is_tracepoint, bool is_optimized) {
+void waypoint(const valhalla::Location& location,
+              rapidjson::writer_wrapper_t& writer,
+              bool is_tracepoint,
+              bool is_optimized) {
   // Create a waypoint to add to the array
-  auto waypoint = json::map({});
+  writer.start_object();
 
   // Output location as a lon,lat array. Note this is the projected
   // lon,lat on the nearest road.
-  auto loc = json::array({});
-  loc->emplace_back(json::fixed_t{location.path_edges(0).ll().lng(), 6});
-  loc->emplace_back(json::fixed_t{location.path_edges(0).ll().lat(), 6});
-  waypoint->emplace("location", loc);
+  writer.start_array("location");
+  writer(location.path_edges(0).ll().lng(), 6);
+  writer(location.path_edges(0).ll().lat(), 6);
+  writer.end_array();
 
   // Add street name.
   std::string name = location.path_edges_size() && location.path_edges(0).names_size()
                          ? location.path_edges(0).names(0)
                          : "";
-  waypoint->emplace("name", name);
+  writer("name", name);
 
   // Add distance in meters from the input location to the nearest
   // point on the road used in the route
   // TODO: since distance was normalized in thor - need to recalculate here
   //       in the future we shall have store separately from score
-  waypoint->emplace("distance",
-                    json::fixed_t{to_ll(location.ll()).Distance(to_ll(location.path_edges(0).ll())),
-                                  3});
+  writer("distance", to_ll(location.ll()).Distance(to_ll(location.path_edges(0).ll())), 3);
 
   // If the location was used for a tracepoint we trigger extra serialization
   if (is_tracepoint) {
-    waypoint->emplace("alternatives_count", static_cast<uint64_t>(location.path_edges_size() - 1));
+    writer("alternatives_count", static_cast<uint64_t>(location.path_edges_size() - 1));
     uint32_t waypoint_index = location.shape_index();
     if (waypoint_index == numeric_limits<uint32_t>::max()) {
       // when tracepoint is neither a break nor leg's starting/ending
       // point (shape_index is uint32_t max), we assign null to its waypoint_index
-      waypoint->emplace("waypoint_index", static_cast<std::nullptr_t>(nullptr));
+      writer("waypoint_index", nullptr);
     } else {
-      waypoint->emplace("waypoint_index", static_cast<uint64_t>(waypoint_index));
+      writer("waypoint_index", static_cast<uint64_t>(waypoint_index));
     }
-    waypoint->emplace("matchings_index", static_cast<uint64_t>(location.route_index()));
+    writer("matchings_index", static_cast<uint64_t>(location.route_index()));
   }
 
   // If the location was used for optimized route we add trips_index and waypoint
   // index (index of the waypoint in the trip)
   if (is_optimized) {
     int trips_index = 0; // TODO
-    waypoint->emplace("trips_index", static_cast<uint64_t>(trips_index));
-    waypoint->emplace("waypoint_index", static_cast<uint64_t>(location.shape_index()));
+    writer("trips_index", static_cast<uint64_t>(trips_index));
+    // a tracepoint already has its waypoint index
+    if (!is_tracepoint) {
+      writer("waypoint_index", static_cast<uint64_t>(location.shape_index()));
+    }
   }
 
-  return waypoint;
+  writer.end_object();
 }
 
 // Serialize locations (called waypoints in OSRM). Waypoints are described here:
 //     http://project-osrm.org/docs/v5.5.1/api/#waypoint-object
-json::ArrayPtr waypoints(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
-                         bool is_tracepoint) {
-  auto waypoints = json::array({});
+void waypoints(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+               rapidjson::writer_wrapper_t& writer,
+               bool is_tracepoint) {
   for (const auto& location : locations) {
     if (location.path_edges().size() == 0) {
-      waypoints->emplace_back(static_cast<std::nullptr_t>(nullptr));
+      writer(nullptr);
     } else {
-      waypoints->emplace_back(waypoint(location, is_tracepoint));
+      waypoint(location, writer, is_tracepoint);
     }
   }
-  return waypoints;
 }
 
-json::ArrayPtr waypoints(const valhalla::Trip& trip) {
-  auto waypoints = json::array({});
+void waypoints(const valhalla::Trip& trip, rapidjson::writer_wrapper_t& writer) {
   // For multi-route the same waypoints are used for all routes.
   const auto& legs = trip.routes(0).legs();
   for (const auto& leg : legs) {
@@ -203,10 +204,9 @@ json::ArrayPtr waypoints(const valhalla::Trip& trip) {
       if (&location == &leg.location(0) && &leg != &*legs.begin()) {
         continue;
       }
-      waypoints->emplace_back(waypoint(location, false));
+      waypoint(location, writer, false);
     }
   }
-  return waypoints;
 }
 
 void serializeIncidentProperties(rapidjson::Writer<rapidjson::StringBuffer>& writer,
@@ -4,6 +4,7 @@
 #include <list>
 #include <memory>
 #include <set>
+#include <signal.h>
 #include <sstream>
 #include <stdexcept>
 #include <streambuf>
@@ -20,6 +21,7 @@
 using namespace prime_server;
 #endif
 
+#include "baldr/graphreader.h"
 #include "midgard/logging.h"
 
 #include "loki/worker.h"
@@ -177,6 +179,27 @@ int main(int argc, char** argv) {
     worker_concurrency = std::stoul(argv[2]);
   }
 
+  // reload the tile extract when asked via SIGHUP. the signal is blocked in every thread but the
+  // one waiting for it and the workers switch to the new extract between requests
+  sigset_t reload_signal;
+  sigemptyset(&reload_signal);
+  sigaddset(&reload_signal, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &reload_signal, nullptr);
+  std::thread reload_thread([config_file, reload_signal]() {
+    int signal;
+    while (sigwait(&reload_signal, &signal) == 0) {
+      LOG_INFO("Reloading the tile extract");
+      try {
+        boost::property_tree::ptree config;
+        rapidjson::read_json(config_file, config);
+        valhalla::baldr::GraphReader::ReloadTileExtract(config.get_child("mjolnir"));
+      } catch (const std::exception& e) {
+        LOG_ERROR("Could not reload the tile extract: " + std::string(e.what()));
+      }
+    }
+  });
+  reload_thread.detach();
+
   // setup the cluster within this process
   zmq::context_t context;
   std::thread server_thread =
@@ -187,6 +210,18 @@ int main(int argc, char** argv) {
   std::thread loki_proxy_thread(
       std::bind(&proxy_t::forward, proxy_t(context, loki_proxy + "_in", loki_proxy + "_out")));
   loki_proxy_thread.detach();
+
+  // or a single layer where each worker runs all the stages of a request itself
+  if (config.get<bool>("httpd.service.pipeline", false)) {
+    std::list<std::thread> pipeline_worker_threads;
+    for (size_t i = 0; i < worker_concurrency; ++i) {
+      pipeline_worker_threads.emplace_back(valhalla::tyr::run_service, config);
+      pipeline_worker_threads.back().detach();
+    }
+    server_thread.join();
+    return 0;
+  }
+
   std::list<std::thread> loki_worker_threads;
   for (size_t i = 0; i < worker_concurrency; ++i) {
     loki_worker_threads.emplace_back(valhalla::loki::run_service, config);
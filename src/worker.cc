@@ -123,7 +123,7 @@ const std::unordered_map<unsigned, unsigned> ERROR_TO_STATUS{
 
     {399, 400},
 
-    {400, 400}, {401, 500}, {402, 503},
+    {400, 400}, {401, 500}, {402, 503}, {403, 503},
 
     {420, 400}, {421, 400}, {422, 400}, {423, 400}, {424, 400},
 
@@ -261,6 +261,7 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
     {400, R"({"code":"InvalidService","message":"Service name is invalid."})"},
     {401, R"({"code":"InvalidUrl","message":"Failed to serialize route."})"},
     {402, R"({"code":"ServiceUnavailable","message":"The service is shutting down."})"},
+    {403, R"({"code":"ServiceUnavailable","message":"The tile extract was reloaded."})"},
 
     {420,
      R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
@@ -4,6 +4,7 @@
 #include <string>
 
 #include "tyr/actor.h"
+#include "worker.h"
 
 #include "test.h"
 
@@ -73,6 +74,23 @@ TEST(Actor, TraceAttributes) {
   EXPECT_THROW(actor.trace_attributes(request, &interrupt), test_exception_t);
 }
 
+TEST(Actor, Act) {
+  tyr::actor_t actor(conf, true);
+  std::string request = R"({"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
+        {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto"})";
+  auto route_json = actor.route(request);
+
+  // running the stages on a request that was already parsed gives the same answer
+  Api api;
+  ParseApi(request, Options::route, api);
+  EXPECT_EQ(actor.act(api), route_json);
+  EXPECT_TRUE(api.has_trip());
+  EXPECT_TRUE(api.has_directions());
+
+  // and each of them reports how long it took
+  EXPECT_GT(api.info().statistics_size(), 0);
+}
+
 // TODO: test the rest of them
 
 } // namespace
@@ -5,6 +5,7 @@ import os
 import valhalla
 import json
 import re
+import threading
 
 
 def has_cyrillic(text):
@@ -30,3 +31,22 @@ assert('legs' in route['trip'] and len(route['trip']['legs']) > 0)
 assert('maneuvers' in route['trip']['legs'][0] and len(route['trip']['legs'][0]['maneuvers']) > 0)
 assert('instruction' in route['trip']['legs'][0]['maneuvers'][0])
 assert(has_cyrillic(route['trip']['legs'][0]['maneuvers'][0]['instruction']))
+
+# a batch answers every request in order, failed requests get an error instead of stopping the rest
+queries = [query, '{"locations":[],"costing":"bicycle"}', query]
+routes = [json.loads(r) for r in actor.Batch('route', queries, threads=2)]
+assert(len(routes) == 3)
+assert('error_code' in routes[1])
+for r in (routes[0], routes[2]):
+    assert(r['trip']['summary']['length'] == route['trip']['summary']['length'])
+
+# python threads each with their own actor run at the same time and get the same answers
+lengths = []
+def run():
+    lengths.append(json.loads(valhalla.Actor().Route(query))['trip']['summary']['length'])
+threads = [threading.Thread(target=run) for _ in range(4)]
+for t in threads:
+    t.start()
+for t in threads:
+    t.join()
+assert(lengths == [route['trip']['summary']['length']] * 4)
@@ -0,0 +1,83 @@
+#include "baldr/contraction.h"
+#include "filesystem.h"
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+const std::string scratch_dir = std::string("data") + filesystem::path::preferred_separator +
+                                std::string("contraction");
+
+class ContractionOverlayTest : public testing::Test {
+protected:
+  void SetUp() override {
+    filesystem::remove_all(scratch_dir);
+    ASSERT_TRUE(filesystem::create_directories(scratch_dir));
+  }
+  void TearDown() override {
+    filesystem::remove_all(scratch_dir);
+  }
+};
+
+TEST_F(ContractionOverlayTest, MissingOverlay) {
+  EXPECT_EQ(ContractionOverlay::Load(scratch_dir), nullptr);
+}
+
+TEST_F(ContractionOverlayTest, RoundTrip) {
+  // two tiles on different levels with 2 and 3 nodes
+  std::vector<std::pair<GraphId, uint32_t>> tiles{{GraphId(4, 0, 0), 2}, {GraphId(7, 1, 0), 3}};
+  std::vector<std::vector<ContractionArc>> forward(5), backward(5);
+  forward[0].push_back({3, kInvalidVertex, 10.f, 0, GraphId(4, 0, 1).value});
+  forward[1].push_back({3, kInvalidVertex, 0.f, 0, kInvalidGraphId});
+  forward[2].push_back({4, 0, 25.f, 0, kInvalidGraphId});
+  backward[0].push_back({2, kInvalidVertex, 15.f, 0, GraphId(7, 1, 5).value});
+  ContractionOverlay::Write(scratch_dir, tiles, forward, backward);
+
+  auto overlay = ContractionOverlay::Load(scratch_dir);
+  ASSERT_NE(overlay, nullptr);
+  EXPECT_EQ(overlay->vertex_count(), 5);
+
+  // nodes map to consecutive vertices tile by tile and back
+  EXPECT_EQ(overlay->vertex(GraphId(4, 0, 1)), 1);
+  EXPECT_EQ(overlay->vertex(GraphId(7, 1, 0)), 2);
+  EXPECT_EQ(overlay->vertex(GraphId(7, 1, 2)), 4);
+  EXPECT_EQ(overlay->node(0), GraphId(4, 0, 0));
+  EXPECT_EQ(overlay->node(3), GraphId(7, 1, 1));
+  EXPECT_EQ(overlay->node(4), GraphId(7, 1, 2));
+
+  // nodes outside of the overlay have no vertex
+  EXPECT_EQ(overlay->vertex(GraphId(4, 0, 2)), kInvalidVertex);
+  EXPECT_EQ(overlay->vertex(GraphId(5, 0, 0)), kInvalidVertex);
+
+  // the arcs of each vertex come back as they were written
+  for (uint32_t v = 0; v < 5; ++v) {
+    auto f = overlay->forward(v);
+    ASSERT_EQ(static_cast<size_t>(f.end() - f.begin()), forward[v].size());
+    for (size_t i = 0; i < forward[v].size(); ++i) {
+      EXPECT_EQ(f.begin()[i].target, forward[v][i].target);
+      EXPECT_EQ(f.begin()[i].middle, forward[v][i].middle);
+      EXPECT_EQ(f.begin()[i].cost, forward[v][i].cost);
+      EXPECT_EQ(f.begin()[i].edgeid, forward[v][i].edgeid);
+    }
+    auto b = overlay->backward(v);
+    ASSERT_EQ(static_cast<size_t>(b.end() - b.begin()), backward[v].size());
+  }
+  EXPECT_TRUE(overlay->forward(2).begin()->is_shortcut());
+  EXPECT_FALSE(overlay->forward(0).begin()->is_shortcut());
+  EXPECT_EQ(overlay->backward(0).begin()->edgeid, GraphId(7, 1, 5).value);
+}
+
+TEST_F(ContractionOverlayTest, MismatchedArcs) {
+  std::vector<std::pair<GraphId, uint32_t>> tiles{{GraphId(4, 0, 0), 2}};
+  std::vector<std::vector<ContractionArc>> forward(3), backward(3);
+  EXPECT_THROW(ContractionOverlay::Write(scratch_dir, tiles, forward, backward), std::logic_error);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -66,6 +66,74 @@ TEST(EdgeStatus, TestStatus) {
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kUnreachedOrReset);
 }
 
+TEST(EdgeStatus, TestReuseAfterClear) {
+  // Dummy tile header
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile{tt};
+
+  // once with the memory kept between searches and once with it released every time
+  for (size_t reserved : {kDefaultReservedEdgeStatusCount, static_cast<size_t>(10)}) {
+    EdgeStatus edgestatus(reserved);
+    for (uint32_t search = 0; search < 3; ++search) {
+      // each search uses a different edge in the same tile and the same edge on another path
+      edgestatus.Set(GraphId(555, 2, search), EdgeSet::kTemporary, search, tile);
+      edgestatus.Set(GraphId(555, 2, 999), EdgeSet::kTemporary, search, tile, 1);
+      edgestatus.Update(GraphId(555, 2, 999), EdgeSet::kPermanent, 1);
+
+      for (uint32_t previous = 0; previous < search; ++previous) {
+        TryGet(edgestatus, GraphId(555, 2, previous), EdgeSet::kUnreachedOrReset);
+      }
+      TryGet(edgestatus, GraphId(555, 2, search), EdgeSet::kTemporary);
+      TryGet(edgestatus, GraphId(555, 2, 999), EdgeSet::kUnreachedOrReset);
+      EXPECT_EQ(edgestatus.Get(GraphId(555, 2, 999), 1).set(), EdgeSet::kPermanent);
+      EXPECT_EQ(edgestatus.Get(GraphId(555, 2, 999), 1).index(), search);
+      EXPECT_EQ(edgestatus.GetPtr(GraphId(555, 2, search), tile)->index(), search);
+
+      edgestatus.clear();
+      EXPECT_THROW(edgestatus.Update(GraphId(555, 2, search), EdgeSet::kPermanent),
+                   std::runtime_error);
+    }
+  }
+}
+
+TEST(EdgeStatus, TestTrimOnClear) {
+  // Dummy tile header
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile{tt};
+
+  // room for the statuses of 2 tiles
+  EdgeStatus edgestatus(2500);
+  EXPECT_EQ(edgestatus.max_reserved_count(), 2500);
+  std::vector<EdgeStatusInfo*> statuses;
+  for (uint32_t tile_id = 0; tile_id < 5; ++tile_id) {
+    statuses.push_back(edgestatus.GetPtr(GraphId(tile_id, 2, 0), tile));
+    *statuses.back() = {EdgeSet::kPermanent, tile_id};
+  }
+
+  // the tiles seen first keep their memory, the rest is released
+  edgestatus.clear();
+  for (uint32_t tile_id = 0; tile_id < 5; ++tile_id) {
+    TryGet(edgestatus, GraphId(tile_id, 2, 0), EdgeSet::kUnreachedOrReset);
+  }
+  EXPECT_EQ(edgestatus.GetPtr(GraphId(1, 2, 0), tile), statuses[1]);
+  EXPECT_EQ(edgestatus.GetPtr(GraphId(0, 2, 0), tile), statuses[0]);
+
+  // and the pool keeps working for tiles seen again or for the first time
+  for (uint32_t tile_id = 0; tile_id < 8; ++tile_id) {
+    edgestatus.Set(GraphId(tile_id, 2, 7), EdgeSet::kTemporary, tile_id, tile);
+  }
+  for (uint32_t tile_id = 0; tile_id < 8; ++tile_id) {
+    EXPECT_EQ(edgestatus.Get(GraphId(tile_id, 2, 7)).index(), tile_id);
+    TryGet(edgestatus, GraphId(tile_id, 2, 0), EdgeSet::kUnreachedOrReset);
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
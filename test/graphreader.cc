@@ -1,4 +1,10 @@
+#include <algorithm>
 #include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 #include "baldr/connectivity_map.h"
 #include "baldr/graphreader.h"
@@ -7,6 +13,7 @@
 
 #include <fcntl.h>
 
+#include "microtar.h"
 #include "test.h"
 
 using namespace valhalla::baldr;
@@ -126,6 +133,191 @@ TEST(ConnectivityMap, Basic) {
   filesystem::remove_all(tile_dir);
 }
 
+// Tar up a set of fake tiles, with an index listing the indexed ones at the front if any are given
+void write_extract(const std::string& extract,
+                   const std::vector<GraphId>& tiles,
+                   const std::vector<GraphId>& indexed = {},
+                   const size_t index_padding = 0) {
+  mtar_t tar;
+  ASSERT_EQ(mtar_open(&tar, extract.c_str(), "w"), MTAR_ESUCCESS);
+  struct entry_t {
+    uint64_t offset;
+    uint32_t tile_id;
+    uint32_t size;
+  };
+  std::vector<entry_t> index;
+  size_t index_offset = 0;
+  if (!indexed.empty()) {
+    auto size = sizeof(entry_t) * indexed.size() + index_padding;
+    ASSERT_EQ(mtar_write_file_header(&tar, kTileExtractIndex, size), MTAR_ESUCCESS);
+    index_offset = tar.pos;
+    ASSERT_EQ(mtar_write_data(&tar, std::string(size, '\0').data(), size), MTAR_ESUCCESS);
+  }
+  for (const auto& tile_id : tiles) {
+    std::string data = std::to_string(tile_id.value);
+    ASSERT_EQ(mtar_write_file_header(&tar, GraphTile::FileSuffix(tile_id).c_str(), data.size()),
+              MTAR_ESUCCESS);
+    if (std::find(indexed.begin(), indexed.end(), tile_id) != indexed.end()) {
+      index.push_back({tar.pos, static_cast<uint32_t>(tile_id.value),
+                       static_cast<uint32_t>(data.size())});
+    }
+    ASSERT_EQ(mtar_write_data(&tar, data.data(), data.size()), MTAR_ESUCCESS);
+  }
+  mtar_finalize(&tar);
+  mtar_close(&tar);
+
+  // fill in the index now that we know where the tiles are
+  std::sort(index.begin(), index.end(),
+            [](const entry_t& a, const entry_t& b) { return a.tile_id < b.tile_id; });
+  std::fstream file(extract, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(index_offset);
+  file.write(reinterpret_cast<const char*>(index.data()), sizeof(entry_t) * index.size());
+}
+
+class TileExtract : public testing::Test {
+protected:
+  void SetUp() override {
+    filesystem::remove_all(scratch_dir);
+    ASSERT_TRUE(filesystem::create_directories(scratch_dir));
+    conf.put("tile_extract", scratch_dir + filesystem::path::preferred_separator + "tiles.tar");
+  }
+  void TearDown() override {
+    filesystem::remove_all(scratch_dir);
+  }
+
+  const std::string scratch_dir = "test/gphrdr_extract";
+  const std::vector<GraphId> tiles{{2, 0, 0}, {10, 1, 0}, {7, 2, 0}, {3, 2, 0}, {1000, 2, 0}};
+  boost::property_tree::ptree conf;
+};
+
+TEST_F(TileExtract, WithoutIndex) {
+  write_extract(conf.get<std::string>("tile_extract"), tiles);
+  auto reader = test::make_clean_graphreader(conf);
+  EXPECT_EQ(reader->GetTileSet(), std::unordered_set<GraphId>(tiles.begin(), tiles.end()));
+  EXPECT_EQ(reader->GetTileSet(2),
+            std::unordered_set<GraphId>({{7, 2, 0}, {3, 2, 0}, {1000, 2, 0}}));
+  for (const auto& tile_id : tiles) {
+    EXPECT_TRUE(reader->DoesTileExist(tile_id));
+  }
+  EXPECT_FALSE(reader->DoesTileExist({4, 2, 0}));
+}
+
+TEST_F(TileExtract, WithIndex) {
+  // the index is all that is read so the tile it leaves out is not part of the extract
+  std::vector<GraphId> indexed(tiles.begin(), tiles.end() - 1);
+  write_extract(conf.get<std::string>("tile_extract"), tiles, indexed);
+  auto reader = test::make_clean_graphreader(conf);
+  EXPECT_EQ(reader->GetTileSet(), std::unordered_set<GraphId>(indexed.begin(), indexed.end()));
+  EXPECT_EQ(reader->GetTileSet(2), std::unordered_set<GraphId>({{7, 2, 0}, {3, 2, 0}}));
+  for (const auto& tile_id : indexed) {
+    EXPECT_TRUE(reader->DoesTileExist(tile_id));
+  }
+  EXPECT_FALSE(reader->DoesTileExist(tiles.back()));
+}
+
+TEST_F(TileExtract, InvalidIndex) {
+  // an index that is not made of whole entries is ignored and the archive is scanned instead
+  write_extract(conf.get<std::string>("tile_extract"), tiles, {tiles.front()}, 3);
+  auto reader = test::make_clean_graphreader(conf);
+  EXPECT_EQ(reader->GetTileSet(), std::unordered_set<GraphId>(tiles.begin(), tiles.end()));
+}
+
+TEST_F(TileExtract, Reload) {
+  const std::vector<GraphId> first(tiles.begin(), tiles.begin() + 2);
+  write_extract(conf.get<std::string>("tile_extract"), first);
+  ASSERT_TRUE(GraphReader::ReloadTileExtract(conf));
+  GraphReader reader(conf);
+  EXPECT_EQ(reader.GetTileSet(), std::unordered_set<GraphId>(first.begin(), first.end()));
+  EXPECT_FALSE(reader.UpdateTileExtract());
+
+  // a broken extract is not swapped in
+  auto broken = conf;
+  broken.put("tile_extract", scratch_dir + filesystem::path::preferred_separator + "missing.tar");
+  auto generation = reader.TileExtractGeneration();
+  EXPECT_FALSE(GraphReader::ReloadTileExtract(broken));
+  EXPECT_FALSE(reader.UpdateTileExtract());
+  EXPECT_EQ(reader.TileExtractGeneration(), generation);
+
+  // the reader keeps the extract it has until it is told to switch
+  auto second = conf;
+  second.put("tile_extract", scratch_dir + filesystem::path::preferred_separator + "second.tar");
+  write_extract(second.get<std::string>("tile_extract"), tiles);
+  ASSERT_TRUE(GraphReader::ReloadTileExtract(second));
+  EXPECT_EQ(reader.GetTileSet(), std::unordered_set<GraphId>(first.begin(), first.end()));
+  EXPECT_TRUE(reader.UpdateTileExtract());
+  EXPECT_GT(reader.TileExtractGeneration(), generation);
+  EXPECT_EQ(reader.GetTileSet(), std::unordered_set<GraphId>(tiles.begin(), tiles.end()));
+  EXPECT_FALSE(reader.UpdateTileExtract());
+
+  // new readers start on the latest one
+  EXPECT_EQ(GraphReader(conf).GetTileSet(),
+            std::unordered_set<GraphId>(tiles.begin(), tiles.end()));
+
+  // dont leave the extract around for other tests
+  ASSERT_TRUE(GraphReader::ReloadTileExtract({}));
+}
+
+TEST_F(TileExtract, Pin) {
+  const std::vector<GraphId> first(tiles.begin(), tiles.begin() + 2);
+  write_extract(conf.get<std::string>("tile_extract"), first);
+  ASSERT_TRUE(GraphReader::ReloadTileExtract(conf));
+  GraphReader reader(conf), other(conf);
+  auto generation = reader.TileExtractGeneration();
+
+  // a reader that already moved on can go back to the extract a request was started on
+  auto second = conf;
+  second.put("tile_extract", scratch_dir + filesystem::path::preferred_separator + "second.tar");
+  write_extract(second.get<std::string>("tile_extract"), tiles);
+  ASSERT_TRUE(GraphReader::ReloadTileExtract(second));
+  EXPECT_TRUE(reader.UpdateTileExtract());
+  EXPECT_TRUE(reader.UseTileExtract(generation));
+  EXPECT_EQ(reader.TileExtractGeneration(), generation);
+  EXPECT_EQ(reader.GetTileSet(), std::unordered_set<GraphId>(first.begin(), first.end()));
+  EXPECT_TRUE(reader.UseTileExtract(generation + 1));
+  EXPECT_EQ(reader.GetTileSet(), std::unordered_set<GraphId>(tiles.begin(), tiles.end()));
+
+  // older generations stay mapped only while some reader still uses them
+  ASSERT_TRUE(GraphReader::ReloadTileExtract(conf));
+  EXPECT_TRUE(reader.UseTileExtract(generation));
+  EXPECT_TRUE(reader.UpdateTileExtract());
+  EXPECT_TRUE(other.UpdateTileExtract());
+  EXPECT_FALSE(reader.UseTileExtract(generation));
+  EXPECT_EQ(reader.TileExtractGeneration(), generation + 2);
+  EXPECT_TRUE(reader.UseTileExtract(generation + 1));
+
+  // dont leave the extract around for other tests
+  ASSERT_TRUE(GraphReader::ReloadTileExtract({}));
+}
+
+// Downloads in the background never finish and downloads on the spot always fail
+class StuckTileGetter : public tile_getter_t {
+public:
+  response_t get(const std::string&) override {
+    return {};
+  }
+  bool get_async(const std::string&, const callback_t& callback) override {
+    callbacks.push_back(callback);
+    return true;
+  }
+  std::vector<callback_t> callbacks;
+};
+
+TEST(GraphReader, InterruptPrefetchWait) {
+  boost::property_tree::ptree conf;
+  conf.put("tile_url", "http://localhost/" + std::string(GraphTile::kTilePathPattern));
+  auto getter = std::make_unique<StuckTileGetter>();
+  auto& callbacks = getter->callbacks;
+  GraphReader reader(conf, std::move(getter));
+  valhalla::midgard::PointLL location{5.11909, 52.09620};
+  reader.PrefetchTiles({location});
+  ASSERT_FALSE(callbacks.empty());
+
+  // a request waiting on a download that never finishes can still be interrupted
+  tile_getter_t::interrupt_t interrupt = []() { throw std::runtime_error("interrupted"); };
+  reader.SetInterrupt(&interrupt);
+  EXPECT_THROW(reader.GetGraphTile(location, 2), std::runtime_error);
+}
+
 class TestGraphMemory final : public GraphMemory {
 public:
   TestGraphMemory() : memory_(sizeof(GraphTileHeader)) {
@@ -880,6 +1072,133 @@ TEST(CacheLruSoft, TrimOnExactlyFullCache) {
   CheckGraphTile(cache.Get(tile2_id), tile2_id, tile2_size);
 }
 
+TEST(ConcurrentCache, InsertGetClear) {
+  ConcurrentTileCache cache(1000);
+
+  GraphId id1(100, 2, 0);
+  auto tile1 = cache.Put(id1, graph_tile_ptr{new TestGraphTile(id1, 123)}, 123);
+  EXPECT_EQ(cache.Get(id1), tile1);
+  CheckGraphTile(tile1, id1, 123);
+
+  // putting the same tile again keeps the first copy
+  auto again = cache.Put(id1, graph_tile_ptr{new TestGraphTile(id1, 123)}, 123);
+  EXPECT_EQ(again, tile1);
+
+  GraphId id2(300, 1, 0);
+  auto tile2 = cache.Put(id2, graph_tile_ptr{new TestGraphTile(id2, 200)}, 200);
+  EXPECT_EQ(cache.Get(id2), tile2);
+  EXPECT_TRUE(cache.Contains(id1));
+  EXPECT_TRUE(cache.Contains(id2));
+  EXPECT_FALSE(cache.OverCommitted());
+
+  cache.Clear();
+  EXPECT_FALSE(cache.OverCommitted());
+  EXPECT_FALSE(cache.Contains(id1));
+  EXPECT_FALSE(cache.Contains(id2));
+  EXPECT_EQ(cache.Get(id1), nullptr);
+}
+
+TEST(ConcurrentCache, CopiesShareTiles) {
+  ConcurrentTileCache cache(1000);
+  ConcurrentTileCache copy(cache);
+
+  GraphId id1(100, 2, 0);
+  auto tile1 = cache.Put(id1, graph_tile_ptr{new TestGraphTile(id1, 600)}, 600);
+  EXPECT_EQ(copy.Get(id1), tile1);
+
+  // the memory limit is shared as well
+  GraphId id2(300, 1, 0);
+  copy.Put(id2, graph_tile_ptr{new TestGraphTile(id2, 600)}, 600);
+  EXPECT_FALSE(cache.OverCommitted());
+  EXPECT_FALSE(copy.Contains(id1) && copy.Contains(id2));
+}
+
+TEST(ConcurrentCache, EvictUnusedFirst) {
+  ConcurrentTileCache cache(1000);
+
+  // fill the cache, each put evicts as needed to stay within the limit
+  for (uint32_t i = 0; i < 4; ++i) {
+    GraphId id(i, 2, 0);
+    cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 250)}, 250);
+  }
+  for (uint32_t i = 0; i < 4; ++i) {
+    EXPECT_TRUE(cache.Contains({i, 2, 0}));
+  }
+
+  // a sweep clears the used flags, then only the tile used since survives the next one
+  GraphId id4(4, 2, 0);
+  cache.Put(id4, graph_tile_ptr{new TestGraphTile(id4, 250)}, 250);
+  EXPECT_FALSE(cache.OverCommitted());
+  size_t count = 0;
+  for (uint32_t i = 0; i < 5; ++i) {
+    count += cache.Contains({i, 2, 0});
+  }
+  EXPECT_EQ(count, 4u);
+
+  GraphId hot(id4);
+  cache.Get(hot);
+  for (uint32_t i = 5; i < 8; ++i) {
+    GraphId id(i, 2, 0);
+    cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 250)}, 250);
+  }
+  EXPECT_FALSE(cache.OverCommitted());
+  EXPECT_TRUE(cache.Contains(hot));
+}
+
+TEST_F(TileExtract, SharedCacheClearedOnce) {
+  struct CacheReader : GraphReader {
+    using GraphReader::cache_;
+    using GraphReader::GraphReader;
+  };
+  write_extract(conf.get<std::string>("tile_extract"), tiles);
+  ASSERT_TRUE(GraphReader::ReloadTileExtract(conf));
+  conf.put("global_concurrent_cache", true);
+  CacheReader reader(conf), other(conf);
+  GraphId id(100, 2, 0);
+  reader.cache_->Put(id, graph_tile_ptr{new TestGraphTile(id, 123)}, 123);
+  EXPECT_TRUE(other.cache_->Contains(id));
+
+  // the first reader to switch clears the cache they share, the others leave it be
+  ASSERT_TRUE(GraphReader::ReloadTileExtract(conf));
+  EXPECT_TRUE(reader.UpdateTileExtract());
+  EXPECT_FALSE(other.cache_->Contains(id));
+  reader.cache_->Put(id, graph_tile_ptr{new TestGraphTile(id, 123)}, 123);
+  EXPECT_TRUE(other.UpdateTileExtract());
+  EXPECT_TRUE(reader.cache_->Contains(id));
+
+  // going back to an older extract does not clear it either
+  EXPECT_TRUE(other.UseTileExtract(other.TileExtractGeneration() - 1));
+  EXPECT_TRUE(reader.cache_->Contains(id));
+
+  // dont leave the extract around for other tests
+  reader.cache_->Clear();
+  ASSERT_TRUE(GraphReader::ReloadTileExtract({}));
+}
+
+#ifdef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+TEST(ConcurrentCache, ManyThreads) {
+  ConcurrentTileCache cache(100 * 250);
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < 8; ++t) {
+    threads.emplace_back([&cache, t]() {
+      ConcurrentTileCache reader(cache);
+      for (uint32_t i = 0; i < 10000; ++i) {
+        GraphId id((i * 7 + t) % 300, 2, 0);
+        auto tile = reader.Get(id);
+        if (!tile) {
+          tile = reader.Put(id, graph_tile_ptr{new TestGraphTile(id, 250)}, 250);
+        }
+        EXPECT_EQ(tile->header()->graphid().value, id.value);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(cache.OverCommitted());
+}
+#endif
+
 } // namespace
 
 int main(int argc, char* argv[]) {
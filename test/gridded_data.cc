@@ -1,5 +1,6 @@
 #include "midgard/gridded_data.h"
 #include "midgard/pointll.h"
+#include <cmath>
 #include <limits>
 //#include <iostream>
 
@@ -78,6 +79,33 @@ TEST(GriddedData, Basic) {
   */
 }
 
+TEST(GriddedData, Threads) {
+  // two metrics with a bit of a wave in them so the lines are not all rings
+  GriddedData<2> g({-7, -7, 7, 7}, .25f, {1000.f, 1000.f});
+  for (int i = 0; i < g.ncolumns(); ++i) {
+    for (int j = 0; j < g.nrows(); ++j) {
+      auto b = g.Base(g.TileId(i, j));
+      float d = PointLL(0, 0).Distance(b) / 1000.f;
+      g.SetIfLessThan(g.TileId(i, j), {d, d * (1.5f + static_cast<float>(std::sin(b.first)))});
+    }
+  }
+
+  for (bool rings_only : {true, false}) {
+    std::vector<GriddedData<2>::contour_interval_t> serial_markers;
+    for (float value = 50; value < 700; value += 50) {
+      serial_markers.emplace_back(0, value, "time", "");
+      serial_markers.emplace_back(1, value, "distance", "");
+    }
+    auto threaded_markers = serial_markers;
+    auto serial = g.GenerateContours(serial_markers, rings_only, 0.f, 0.f);
+    auto threaded = g.GenerateContours(threaded_markers, rings_only, 0.f, 0.f, 4);
+
+    // every interval is traced on its own so the threads must not change the output
+    ASSERT_EQ(serial_markers, threaded_markers);
+    ASSERT_EQ(serial, threaded) << "Threads should not change the contours";
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
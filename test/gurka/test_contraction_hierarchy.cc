@@ -0,0 +1,131 @@
+#include "gurka.h"
+#include <gtest/gtest.h>
+
+#include "mjolnir/contractionbuilder.h"
+
+using namespace valhalla;
+
+namespace {
+
+// The edges of the first leg of a route
+std::vector<uint64_t> get_edges(const valhalla::Api& result) {
+  std::vector<uint64_t> edges;
+  for (const auto& node : result.trip().routes(0).legs(0).node()) {
+    if (node.has_edge()) {
+      edges.push_back(node.edge().id());
+    }
+  }
+  return edges;
+}
+
+// The elapsed time of the first leg of a route
+double get_time(const valhalla::Api& result) {
+  return result.trip().routes(0).legs(0).node().rbegin()->cost().elapsed_cost().seconds();
+}
+
+// The cost of the first leg of a route without the costs of the transitions between its edges
+double get_edge_cost(const valhalla::Api& result) {
+  const auto& nodes = result.trip().routes(0).legs(0).node();
+  double transitions = 0;
+  for (const auto& node : nodes) {
+    transitions += node.cost().transition_cost().cost();
+  }
+  return nodes.rbegin()->cost().elapsed_cost().cost() - transitions;
+}
+
+} // namespace
+
+class ContractionHierarchy : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map astar_map;
+
+  static void SetUpTestSuite() {
+    constexpr double gridsize = 200;
+
+    const std::string ascii_map = R"(
+      A---B---C---D---E
+      |           |   |
+      |           H   |
+      |               G
+      |
+      |
+      |
+      |
+      F---I
+    )";
+
+    const gurka::ways ways = {{"ABCD", {{"highway", "primary"}}},
+                              {"DE", {{"highway", "primary"}}},
+                              {"EG", {{"highway", "primary"}}},
+                              {"AF", {{"highway", "primary"}}},
+                              {"FG", {{"highway", "primary"}}},
+                              {"DH", {{"highway", "residential"}}},
+                              {"FI", {{"highway", "residential"}}}};
+
+    // The shortest way from H to A turns left at D, which is not allowed
+    const gurka::relations relations = {{{
+                                             {gurka::way_member, "DH", "from"},
+                                             {gurka::way_member, "ABCD", "to"},
+                                             {gurka::node_member, "D", "via"},
+                                         },
+                                         {
+                                             {"type", "restriction"},
+                                             {"restriction", "no_left_turn"},
+                                         }}};
+
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, gridsize);
+    map = gurka::buildtiles(layout, ways, {}, relations, "test/data/gurka_contraction_hierarchy",
+                            {{"mjolnir.concurrency", "1"}, {"thor.contraction_hierarchy", "true"}});
+    mjolnir::ContractionBuilder::Build(map.config);
+
+    astar_map = map;
+    astar_map.config.put("thor.contraction_hierarchy", false);
+  }
+};
+
+gurka::map ContractionHierarchy::map = {};
+gurka::map ContractionHierarchy::astar_map = {};
+
+TEST_F(ContractionHierarchy, ShortestWithoutTransitionCosts) {
+  // The overlay knows nothing of turns, so its route may differ from the one of A*. What it does
+  // guarantee is that no route has edges that cost less than its own
+  const std::string names = "ABCDEFGHI";
+  for (const auto from : names) {
+    for (const auto to : names) {
+      if (from == to) {
+        continue;
+      }
+      const std::vector<std::string> waypoints{{from}, {to}};
+      auto expected = gurka::do_action(valhalla::Options::route, astar_map, waypoints, "auto");
+      auto result = gurka::do_action(valhalla::Options::route, map, waypoints, "auto");
+      EXPECT_EQ(expected.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+      EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "contraction_hierarchy")
+          << from << " to " << to;
+      EXPECT_LE(get_edge_cost(result), get_edge_cost(expected) + 1.0) << from << " to " << to;
+    }
+  }
+}
+
+TEST_F(ContractionHierarchy, FallbackOnRestriction) {
+  // the overlay goes left at D, the costing rejects that and the route falls back to A*, which goes
+  // around the loop
+  auto expected = gurka::do_action(valhalla::Options::route, astar_map, {"H", "A"}, "auto");
+  auto result = gurka::do_action(valhalla::Options::route, map, {"H", "A"}, "auto");
+  gurka::assert::raw::expect_path(expected, {"DH", "DE", "EG", "FG", "AF"});
+  EXPECT_EQ(get_edges(result), get_edges(expected));
+  EXPECT_NEAR(get_time(result), get_time(expected), 1.0);
+}
+
+TEST_F(ContractionHierarchy, FallbackOnCostingOptions) {
+  // the overlay was built for the default costing options so other ones always go to A*
+  const std::unordered_map<std::string, std::string> options = {
+      {"/costing_options/auto/ignore_restrictions", "1"}};
+  auto expected =
+      gurka::do_action(valhalla::Options::route, astar_map, {"H", "A"}, "auto", options);
+  auto result = gurka::do_action(valhalla::Options::route, map, {"H", "A"}, "auto", options);
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+  gurka::assert::raw::expect_path(result, {"DH", "ABCD"});
+  EXPECT_EQ(get_edges(result), get_edges(expected));
+  EXPECT_NEAR(get_time(result), get_time(expected), 1.0);
+}
@@ -0,0 +1,232 @@
+#include "gurka.h"
+#include <gtest/gtest.h>
+
+#include "baldr/datetime.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "mjolnir/converttransit.h"
+#include "mjolnir/transitpbf.h"
+#include "proto/transit.pb.h"
+
+using namespace valhalla;
+
+namespace {
+
+// One bus line from the station at 1 to the station at 2, leaving every 10 minutes from 08:05
+constexpr uint32_t kFirstDeparture = 8 * 3600 + 5 * 60;
+constexpr uint32_t kHeadway = 10 * 60;
+constexpr uint32_t kRideTime = 6 * 60;
+constexpr uint32_t kTripCount = 6;
+
+const std::string kTransitDir = "test/data/gurka_raptor_transit";
+
+// Adds the egress, station and platform of a stop at ll, in the order the converter expects them
+baldr::GraphId add_stop(mjolnir::Transit& transit,
+                        const baldr::GraphId& tile_id,
+                        const midgard::PointLL& ll,
+                        const std::string& name) {
+  baldr::GraphId egress_id(tile_id.tileid(), tile_id.level(), transit.nodes_size());
+  baldr::GraphId station_id(tile_id.tileid(), tile_id.level(), transit.nodes_size() + 1);
+  baldr::GraphId platform_id(tile_id.tileid(), tile_id.level(), transit.nodes_size() + 2);
+  const std::vector<std::pair<baldr::NodeType, baldr::GraphId>> stop_nodes = {
+      {baldr::NodeType::kTransitEgress, egress_id},
+      {baldr::NodeType::kTransitStation, egress_id},
+      {baldr::NodeType::kMultiUseTransitPlatform, station_id}};
+  for (const auto& stop_node : stop_nodes) {
+    auto* node = transit.add_nodes();
+    node->set_lon(ll.lng());
+    node->set_lat(ll.lat());
+    node->set_type(static_cast<uint32_t>(stop_node.first));
+    node->set_graphid(baldr::GraphId(tile_id.tileid(), tile_id.level(), transit.nodes_size() - 1));
+    node->set_prev_type_graphid(stop_node.second);
+    node->set_name(name);
+    node->set_onestop_id("s-" + name + "-" + std::to_string(transit.nodes_size()));
+    node->set_timezone("Europe/Amsterdam");
+    node->set_wheelchair_boarding(true);
+    node->set_traversability(static_cast<uint32_t>(baldr::Traversability::kBoth));
+  }
+  return platform_id;
+}
+
+// Writes the transit pbf tile of the bus line and converts it to transit graph tiles
+void build_transit(const gurka::nodelayout& layout) {
+  if (filesystem::exists(kTransitDir)) {
+    filesystem::remove_all(kTransitDir);
+  }
+
+  auto tile_id = baldr::TileHierarchy::GetGraphId(layout.at("1"), 2);
+  mjolnir::Transit transit;
+  auto origin = add_stop(transit, tile_id, layout.at("1"), "first");
+  auto destination = add_stop(transit, tile_id, layout.at("2"), "second");
+
+  auto* route = transit.add_routes();
+  route->set_name("1");
+  route->set_onestop_id("r-line-1");
+  route->set_operated_by_name("gurka");
+  route->set_vehicle_type(mjolnir::Transit_VehicleType_kBus);
+
+  // service runs from a week ago for a month around the date the tiles are created
+  auto tz = baldr::DateTime::get_tz_db().from_index(
+      baldr::DateTime::get_tz_db().to_index("America/New_York"));
+  auto today = baldr::DateTime::days_from_pivot_date(
+      baldr::DateTime::get_formatted_date(baldr::DateTime::iso_date_time(tz)));
+  for (uint32_t trip = 0; trip < kTripCount; ++trip) {
+    auto* stop_pair = transit.add_stop_pairs();
+    stop_pair->set_origin_graphid(origin);
+    stop_pair->set_destination_graphid(destination);
+    stop_pair->set_origin_departure_time(kFirstDeparture + trip * kHeadway);
+    stop_pair->set_destination_arrival_time(kFirstDeparture + trip * kHeadway + kRideTime);
+    stop_pair->set_route_index(0);
+    stop_pair->set_trip_id(trip + 1);
+    stop_pair->set_trip_headsign("second");
+    stop_pair->set_service_start_date(today - 7);
+    stop_pair->set_service_end_date(today + 30);
+    for (int day = 0; day < 7; ++day) {
+      stop_pair->add_service_days_of_week(true);
+    }
+    stop_pair->set_bikes_allowed(true);
+    stop_pair->set_wheelchair_accessible(true);
+  }
+
+  auto file_name = baldr::GraphTile::FileSuffix(tile_id);
+  file_name = file_name.substr(0, file_name.size() - 3) + "pbf";
+  mjolnir::write_pbf(transit, kTransitDir + filesystem::path::preferred_separator + file_name);
+
+  // the transit graph tiles go next to the pbf tiles, where the tile builder looks for them
+  boost::property_tree::ptree pt;
+  pt.put("mjolnir.tile_dir", kTransitDir);
+  pt.put("mjolnir.transit_dir", kTransitDir);
+  pt.put("mjolnir.timezone", "test/data/tz.sqlite");
+  pt.put("mjolnir.concurrency", 1);
+  ASSERT_EQ(mjolnir::ConvertTransit::Build(pt).size(), 1);
+}
+
+// The travel modes along a leg and the trip of every ride, each stretch listed once
+std::vector<std::string> get_legs(const valhalla::TripLeg& leg) {
+  std::vector<std::string> legs;
+  for (const auto& node : leg.node()) {
+    if (!node.has_edge()) {
+      continue;
+    }
+    std::string stretch;
+    switch (node.edge().travel_mode()) {
+      case TripLeg::kPedestrian:
+        stretch = "walk";
+        break;
+      case TripLeg::kTransit:
+        stretch = "trip " + std::to_string(node.edge().transit_route_info().trip_id());
+        break;
+      default:
+        stretch = "other";
+    }
+    if (legs.empty() || legs.back() != stretch) {
+      legs.push_back(stretch);
+    }
+  }
+  return legs;
+}
+
+// Seconds from the requested departure to the arrival at the destination
+double get_arrival(const valhalla::TripLeg& leg) {
+  return leg.node().rbegin()->cost().elapsed_cost().seconds();
+}
+
+} // namespace
+
+class Raptor : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map raptor_map;
+  static std::string date;
+
+  static void SetUpTestSuite() {
+    constexpr double gridsize = 100;
+
+    const std::string ascii_map = R"(
+        1                             2
+      A---B-------------------------C---D
+    )";
+
+    const gurka::ways ways = {{"AB", {{"highway", "residential"}}},
+                              {"BC", {{"highway", "residential"}}},
+                              {"CD", {{"highway", "residential"}}}};
+
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, gridsize, {5.1, 52.1});
+    build_transit(layout);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_raptor",
+                            {{"mjolnir.transit_dir", kTransitDir},
+                             {"mjolnir.timezone", "test/data/tz.sqlite"},
+                             {"mjolnir.concurrency", "1"}});
+
+    raptor_map = map;
+    raptor_map.config.put("thor.transit_engine", "raptor");
+
+    // the transit tiles are valid from the day they were built
+    auto tz = baldr::DateTime::get_tz_db().from_index(
+        baldr::DateTime::get_tz_db().to_index("Europe/Amsterdam"));
+    date = baldr::DateTime::iso_date_time(tz).substr(0, 10) + "T08:00";
+  }
+
+  valhalla::Api route(const gurka::map& map,
+                      const std::vector<std::string>& waypoints,
+                      std::unordered_map<std::string, std::string> options = {}) {
+    options["/date_time/type"] = "1";
+    options["/date_time/value"] = date;
+    return gurka::do_action(valhalla::Options::route, map, waypoints, "multimodal", options);
+  }
+};
+
+gurka::map Raptor::map = {};
+gurka::map Raptor::raptor_map = {};
+std::string Raptor::date = {};
+
+TEST_F(Raptor, MatchesMultiModal) {
+  auto multimodal = route(map, {"A", "D"});
+  auto raptor = route(raptor_map, {"A", "D"});
+  ASSERT_EQ(multimodal.trip().routes_size(), 1);
+  ASSERT_EQ(raptor.trip().routes_size(), 1);
+  const auto& expected = multimodal.trip().routes(0).legs(0);
+  const auto& leg = raptor.trip().routes(0).legs(0);
+
+  // walk to the first stop, take the first bus and walk on to the destination
+  EXPECT_EQ(get_legs(expected), (std::vector<std::string>{"walk", "trip 1", "walk"}));
+  EXPECT_EQ(get_legs(leg), get_legs(expected));
+  EXPECT_NEAR(get_arrival(leg), get_arrival(expected), 1.0);
+}
+
+TEST_F(Raptor, DepartureWindowAlternates) {
+  // a departure window of half an hour catches the buses at 08:05, 08:15 and 08:25
+  auto window_map = raptor_map;
+  window_map.config.put("thor.transit_departure_window", 1800);
+  auto result = route(window_map, {"A", "D"}, {{"/alternates", "2"}});
+  ASSERT_EQ(result.trip().routes_size(), 3);
+
+  // the best journey comes first, the alternates leave and arrive later
+  auto best = route(raptor_map, {"A", "D"});
+  EXPECT_EQ(get_legs(result.trip().routes(0).legs(0)), get_legs(best.trip().routes(0).legs(0)));
+  for (int i = 0; i < result.trip().routes_size(); ++i) {
+    const auto& leg = result.trip().routes(i).legs(0);
+    EXPECT_EQ(get_legs(leg),
+              (std::vector<std::string>{"walk", "trip " + std::to_string(i + 1), "walk"}));
+    if (i > 0) {
+      EXPECT_NEAR(get_arrival(leg) - get_arrival(result.trip().routes(i - 1).legs(0)), kHeadway,
+                  1.0);
+    }
+  }
+}
+
+TEST_F(Raptor, DirectWalk) {
+  // walking from A to B is quicker than going by bus
+  auto multimodal = route(map, {"A", "B"});
+  auto raptor = route(raptor_map, {"A", "B"});
+  ASSERT_EQ(multimodal.trip().routes_size(), 1);
+  ASSERT_EQ(raptor.trip().routes_size(), 1);
+  const auto& expected = multimodal.trip().routes(0).legs(0);
+  const auto& leg = raptor.trip().routes(0).legs(0);
+
+  EXPECT_EQ(get_legs(expected), std::vector<std::string>{"walk"});
+  EXPECT_EQ(get_legs(leg), get_legs(expected));
+  EXPECT_NEAR(get_arrival(leg), get_arrival(expected), 1.0);
+}
@@ -84,17 +84,24 @@ void assert_tile_equalish(const GraphTile& a, const GraphTile& b) {
   }
 }
 
-// 1. build tiles with the same input twice
+// 1. build tiles with the same input twice, optionally with a different config each time
 // 2. check that the same tile sets are generated
 struct ReproducibleBuild : ::testing::Test {
-  void BuildTiles(const std::string& ascii_map, const gurka::ways& ways, const double gridsize) {
-    const auto build_tiles = [&](const std::string& dir) -> gurka::map {
+  using config_options = std::unordered_map<std::string, std::string>;
+
+  void BuildTiles(const std::string& ascii_map,
+                  const gurka::ways& ways,
+                  const double gridsize,
+                  const config_options& first_options = {},
+                  const config_options& second_options = {}) {
+    const auto build_tiles = [&](const std::string& dir,
+                                 const config_options& options) -> gurka::map {
       const gurka::nodelayout layout = gurka::detail::map_to_coordinates(ascii_map, gridsize);
       const std::string workdir = "test/data/gurka_reproduce_tile_build/" + dir;
-      return gurka::buildtiles(layout, ways, {}, {}, workdir, {});
+      return gurka::buildtiles(layout, ways, {}, {}, workdir, options);
     };
-    const gurka::map first_map = build_tiles("1");
-    const gurka::map second_map = build_tiles("2");
+    const gurka::map first_map = build_tiles("1", first_options);
+    const gurka::map second_map = build_tiles("2", second_options);
 
     baldr::GraphReader first_reader(first_map.config.get_child("mjolnir"));
     baldr::GraphReader second_reader(second_map.config.get_child("mjolnir"));
@@ -155,3 +162,29 @@ TEST_F(ReproducibleBuild, BigGridSize) {
                             {"EH", {{"highway", "path"}}}};
   BuildTiles(ascii_map, ways, 100000);
 }
+
+TEST_F(ReproducibleBuild, AnyConcurrency) {
+  // spans several tiles of every level, the motorway and the trunk get shortcuts across them
+  const std::string ascii_map = R"(
+    A----B----C----D----E
+    |    |    |    |    |
+    F----G----H----I----J
+    |         |         |
+    K----L----M----N----O)";
+
+  const gurka::ways ways = {{"ABCDE", {{"highway", "motorway"}}},
+                            {"FGHIJ", {{"highway", "trunk"}}},
+                            {"KLMNO", {{"highway", "primary"}}},
+                            {"AFK", {{"highway", "secondary"}}},
+                            {"BG", {{"highway", "residential"}}},
+                            {"CHM", {{"highway", "tertiary"}}},
+                            {"DI", {{"highway", "residential"}}},
+                            {"EJO", {{"highway", "secondary"}}},
+                            {"GL", {{"highway", "service"}}},
+                            {"IN", {{"highway", "service"}}}};
+
+  // the hierarchy and shortcut builders hand tiles out to threads, the result must not depend on
+  // how many there are
+  BuildTiles(ascii_map, ways, 20000, {{"mjolnir.concurrency", "1"}},
+             {{"mjolnir.concurrency", "4"}});
+}
@@ -1,13 +1,17 @@
 #include "test.h"
 
 #include "baldr/curl_tilegetter.h"
+#include "baldr/graphreader.h"
 #include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
 #include "tyr/actor.h"
 #include "valhalla/filesystem.h"
 #include "valhalla/tile_server.h"
 
 #include <prime_server/prime_server.hpp>
 
+#include <chrono>
+#include <future>
 #include <ostream>
 #include <stdexcept>
 #include <string>
@@ -221,6 +225,83 @@ TEST(HttpTiles, test_graphreader_multiple_threads) {
   test_graphreader_tile_download(8, 2, 4);
 }
 
+TEST(HttpTiles, test_curler_async_download) {
+  using namespace baldr;
+
+  TestTileDownloadData params;
+  const auto non_existent_tile_id = params.get_nonexistent_tile_id();
+
+  // more requests than there are background curlers and a queue that can not hold them all
+  curl_tile_getter_t tile_getter(1, "", params.is_gzipped_tile, 2, 4);
+  std::vector<std::future<tile_getter_t::response_t>> downloads;
+  for (size_t tile_i = 0; tile_i < 12; ++tile_i) {
+    auto tile_id = params.test_tile_ids[tile_i % params.test_tile_ids.size()];
+    downloads.emplace_back(
+        tile_getter.get_async(GraphTile::MakeTileURL(params.full_tile_url_pattern, tile_id)));
+  }
+
+  for (size_t tile_i = 0; tile_i < downloads.size(); ++tile_i) {
+    auto expected_tile_id = params.test_tile_ids[tile_i % params.test_tile_ids.size()];
+    auto result = downloads[tile_i].get();
+    if (expected_tile_id != non_existent_tile_id) {
+      ASSERT_EQ(result.status_, tile_getter_t::status_code_t::SUCCESS);
+      auto tile = GraphTile::Create(GraphId(), std::move(result.bytes_));
+      ASSERT_TRUE(tile);
+      EXPECT_EQ(tile->id(), expected_tile_id);
+    } else {
+      EXPECT_EQ(result.status_, tile_getter_t::status_code_t::FAILURE);
+    }
+  }
+}
+
+TEST(HttpTiles, test_graphreader_prefetch) {
+  using namespace baldr;
+
+  // prefetch a corridor through utrecht without any tiles on disk
+  auto conf = make_conf("", false, 1);
+  GraphReader reader(conf.get_child("mjolnir"));
+  std::vector<midgard::PointLL> locations{{5.11909, 52.09620}, {5.11934, 52.09585}};
+  reader.PrefetchTiles(locations);
+
+  // whether or not the downloads are done by now the reader has to hand out the same tiles
+  for (const auto& level : TileHierarchy::levels()) {
+    auto tile = reader.GetGraphTile(locations.front(), level.level);
+    ASSERT_TRUE(tile) << "Missing prefetched tile on level " << int(level.level);
+    EXPECT_EQ(tile->id(), TileHierarchy::GetGraphId(locations.front(), level.level));
+  }
+
+  // prefetching again neither breaks nor refetches what we have
+  reader.PrefetchTiles(locations);
+  EXPECT_TRUE(reader.GetGraphTile(locations.back()));
+}
+
+TEST_F(HttpTilesWithCache, test_graphreader_prefetch_shared_dir) {
+  using namespace baldr;
+
+  // prefetch a corridor through utrecht into the tile dir
+  auto conf = make_conf("url_tile_cache", false, 1);
+  GraphReader reader(conf.get_child("mjolnir"));
+  std::vector<midgard::PointLL> locations{{5.11909, 52.09620}, {5.11934, 52.09585}};
+  reader.PrefetchTiles(locations);
+
+  // another reader sharing the tile dir but without a tile url can only read what is on disk.
+  // the tiles get there as soon as they arrive, the prefetching reader does not have to do anything
+  auto disk_conf = conf.get_child("mjolnir");
+  disk_conf.erase("tile_url");
+  GraphReader disk_reader(disk_conf);
+  for (const auto& level : TileHierarchy::levels()) {
+    graph_tile_ptr tile;
+    for (int attempt = 0; attempt < 100 && !tile; ++attempt) {
+      tile = disk_reader.GetGraphTile(locations.front(), level.level);
+      if (!tile) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+    }
+    ASSERT_TRUE(tile) << "Missing prefetched tile on level " << int(level.level);
+    EXPECT_EQ(tile->id(), TileHierarchy::GetGraphId(locations.front(), level.level));
+  }
+}
+
 TEST(HttpTiles, test_interrupt) {
   using namespace baldr;
 
@@ -1,7 +1,9 @@
 #include "baldr/json.h"
 #include "baldr/rapidjson_utils.h"
 
+#include <cmath>
 #include <cstdint>
+#include <vector>
 
 #include "test.h"
 
@@ -74,6 +76,30 @@ TEST(JSON, Serialize) {
   EXPECT_EQ(res, ans) << "Wrong json";
 }
 
+TEST(JSON, WriterFixedMatchesDom) {
+  using namespace valhalla::baldr;
+  std::vector<std::pair<double, int>> values = {
+      {40.744377, 3}, {-73.990433, 6}, {0.0005, 3}, {2.5, 0}, {3.5, 0},  {-0.0001, 3},
+      {1e20, 2},      {123.0, 1},      {1e300, 6},  {NAN, 3}, {INFINITY, 1}, {-INFINITY, 2},
+  };
+
+  std::stringstream dom;
+  auto array = json::array({});
+  for (const auto& value : values) {
+    array->emplace_back(json::fixed_t{value.first, static_cast<size_t>(value.second)});
+  }
+  dom << *array;
+
+  rapidjson::writer_wrapper_t writer;
+  writer.start_array();
+  for (const auto& value : values) {
+    writer(value.first, value.second);
+  }
+  writer.end_array();
+
+  EXPECT_EQ(std::string(writer.get_buffer()), dom.str());
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -6,6 +6,7 @@
 
 #include "baldr/json.h"
 #include "loki/worker.h"
+#include "meili/map_matcher_factory.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
@@ -291,6 +292,55 @@ TEST(Mapmatch, test_matcher) {
   }
 }
 
+TEST(Mapmatch, test_online_matcher) {
+  tyr::actor_t actor(conf, true);
+  meili::MapMatcherFactory factory(conf);
+  int tested = 0;
+  while (tested < 10) {
+    // get a route shape and drive along it taking a measurement every second or so
+    PointLL start, end;
+    auto test_case = make_test_case(start, end);
+    boost::property_tree::ptree route;
+    try {
+      route = test::json_to_pt(actor.route(test_case));
+    } catch (...) {
+      continue;
+    }
+    auto encoded_shape = route.get_child("trip.legs").front().second.get<std::string>("shape");
+    auto shape = midgard::resample_spherical_polyline(
+        midgard::decode<std::vector<midgard::PointLL>>(encoded_shape), 15., true);
+    std::vector<meili::Measurement> measurements;
+    for (const auto& p : shape) {
+      measurements.emplace_back(p, 5.f, 15.f, 1000. + measurements.size());
+    }
+
+    // match it all at once
+    std::unique_ptr<meili::MapMatcher> offline(factory.Create(Costing::auto_));
+    auto expected = std::move(offline->OfflineMatch(measurements).front());
+
+    // and one measurement at a time
+    std::unique_ptr<meili::MapMatcher> online(factory.Create(Costing::auto_));
+    std::vector<meili::MatchResult> results;
+    for (const auto& measurement : measurements) {
+      auto matched = online->OnlineMatch(measurement);
+      results.insert(results.end(), matched.results.begin(), matched.results.end());
+    }
+    EXPECT_LT(results.size(), measurements.size()) << "the last matches can't be final yet";
+    EXPECT_TRUE(online->IsOnlineMatchIdle(measurements.back().epoch_time() + 61.));
+    EXPECT_FALSE(online->IsOnlineMatchIdle(measurements.back().epoch_time() + 59.));
+    auto finished = online->FinishOnlineMatch();
+    results.insert(results.end(), finished.results.begin(), finished.results.end());
+
+    // they should agree on where each measurement was
+    ASSERT_EQ(results.size(), expected.results.size()) << test_case;
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].edgeid, expected.results[i].edgeid) << test_case << " at " << i;
+      EXPECT_NEAR(results[i].distance_along, expected.results[i].distance_along, 1e-3);
+    }
+    ++tested;
+  }
+}
+
 TEST(Mapmatch, test_distance_only) {
   tyr::actor_t actor(conf, true);
   auto matched = test::json_to_pt(actor.trace_attributes(
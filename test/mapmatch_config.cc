@@ -18,6 +18,7 @@ const auto fake_config = test::json_to_pt(R"({
       "beta": 5,
       "breakage_distance": 5000,
       "gps_accuracy": 6,
+      "idle_timeout": 30,
       "interpolation_distance": 5,
       "max_route_distance_factor": 11,
       "max_route_time_factor": 10,
@@ -60,6 +61,9 @@ TEST(MapmatchConfig, check_read_all_params) {
   const auto& routing = config.routing;
   EXPECT_EQ(routing.interpolation_distance_meters, 5.f);
   EXPECT_FALSE(routing.is_interpolation_distance_customizable);
+
+  // check online params
+  EXPECT_EQ(config.online.idle_timeout_seconds, 30.f);
 }
 
 TEST(MapmatchConfig, validate_candidate_search_params) {
@@ -124,6 +128,14 @@ TEST(MapmatchConfig, validate_routing_params) {
   EXPECT_THROW(config.Read(pt), std::exception);
 }
 
+TEST(MapmatchConfig, validate_online_params) {
+  valhalla::meili::Config config;
+
+  auto pt = fake_config;
+  pt.put<float>("default.idle_timeout", 0.f);
+  EXPECT_THROW(config.Read(pt), std::exception);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -6,6 +6,7 @@
 
 #include "loki/worker.h"
 #include "midgard/logging.h"
+#include "sif/costfactory.h"
 #include "sif/dynamiccost.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancematrix.h"
@@ -256,6 +257,100 @@ TEST(Matrix, test_matrix) {
   }
 }
 
+TEST(Matrix, test_matrix_threads) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] = CreateSimpleCost(
+      request.options().costing_options(static_cast<int>(request.options().costing())));
+
+  CostMatrix cost_matrix;
+  std::vector<TimeDistance> expected =
+      cost_matrix.SourceToTarget(request.options().sources(), request.options().targets(), reader,
+                                 mode_costing, TravelMode::kDrive, 400000.0);
+
+  // expanding the searches on several threads must give exactly the same answer, run it twice to
+  // make sure the threads are reused properly between matrices
+  boost::property_tree::ptree thor_config;
+  thor_config.put("costmatrix_threads", 4);
+  CostMatrix threaded_matrix(thor_config);
+  for (int run = 0; run < 2; ++run) {
+    std::vector<TimeDistance> results =
+        threaded_matrix.SourceToTarget(request.options().sources(), request.options().targets(),
+                                       reader, mode_costing, TravelMode::kDrive, 400000.0);
+    ASSERT_EQ(results.size(), expected.size());
+    for (uint32_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].dist, expected[i].dist) << "result " + std::to_string(i);
+      EXPECT_EQ(results[i].time, expected[i].time) << "result " + std::to_string(i);
+    }
+    threaded_matrix.Clear();
+  }
+}
+
+// Pruned and threaded time distance matrices must give exactly the same answer as a plain one
+void check_timedistancematrix_threads(const std::string& request_json,
+                                      const sif::mode_costing_t& mode_costing,
+                                      const TravelMode mode) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(request_json, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+
+  boost::property_tree::ptree unpruned_config;
+  unpruned_config.put("timedistancematrix_target_pruning", false);
+  TimeDistanceMatrix unpruned_matrix(unpruned_config);
+  std::vector<TimeDistance> expected =
+      unpruned_matrix.SourceToTarget(request.options().sources(), request.options().targets(),
+                                     reader, mode_costing, mode, 400000.0);
+
+  // run it twice to make sure the searches are reused properly between matrices
+  boost::property_tree::ptree thor_config;
+  thor_config.put("timedistancematrix_threads", 4);
+  thor_config.put("timedistancematrix_target_pruning", true);
+  TimeDistanceMatrix threaded_matrix(thor_config);
+  for (int run = 0; run < 2; ++run) {
+    std::vector<TimeDistance> results =
+        threaded_matrix.SourceToTarget(request.options().sources(), request.options().targets(),
+                                       reader, mode_costing, mode, 400000.0);
+    ASSERT_EQ(results.size(), expected.size());
+    for (uint32_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].dist, expected[i].dist) << "result " + std::to_string(i);
+      EXPECT_EQ(results[i].time, expected[i].time) << "result " + std::to_string(i);
+    }
+    threaded_matrix.Clear();
+  }
+}
+
+TEST(Matrix, test_timedistancematrix_threads) {
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] = CreateSimpleCost(
+      request.options().costing_options(static_cast<int>(request.options().costing())));
+  check_timedistancematrix_threads(test_request, mode_costing, TravelMode::kDrive);
+}
+
+TEST(Matrix, test_timedistancematrix_threads_pedestrian) {
+  // the A* cost factor of pedestrians only bounds walking, not the ferries they may take
+  std::string pedestrian_request = test_request;
+  pedestrian_request.replace(pedestrian_request.find("\"auto\""), 6, "\"pedestrian\"");
+  sif::mode_costing_t mode_costing;
+  mode_costing[static_cast<uint32_t>(TravelMode::kPedestrian)] =
+      sif::CostFactory{}.Create(Costing::pedestrian);
+  check_timedistancematrix_threads(pedestrian_request, mode_costing, TravelMode::kPedestrian);
+}
+
 // TODO: it was commented before. Why?
 TEST(Matrix, DISABLED_test_matrix_osrm) {
   loki_worker_t loki_worker(config);
@@ -0,0 +1,83 @@
+#include "midgard/metrics.h"
+
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla::midgard;
+
+namespace {
+
+bool contains(const std::string& rendered, const std::string& line) {
+  return rendered.find(line + '\n') != std::string::npos;
+}
+
+TEST(Metrics, CountersSumOverThreads) {
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([]() {
+      // hold on to the series like a hot path would
+      auto& counter = metrics::counter("test_things_total", {{"kind", "a"}});
+      for (int i = 0; i < 1000; ++i) {
+        counter.add();
+      }
+      metrics::counter("test_things_total", {{"kind", "b"}}).add(3);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // and threads that come and go with each request, the finished ones are folded into one total
+  for (int t = 0; t < 100; ++t) {
+    std::thread([]() { metrics::counter("test_things_total", {{"kind", "b"}}).add(); }).join();
+  }
+
+  // the same series is handed out again to the same thread
+  auto& counter = metrics::counter("test_things_total", {{"kind", "a"}});
+  EXPECT_EQ(&counter, &metrics::counter("test_things_total", {{"kind", "a"}}));
+  counter.add(5);
+
+  auto rendered = metrics::render();
+  EXPECT_TRUE(contains(rendered, "# TYPE test_things_total counter")) << rendered;
+  EXPECT_TRUE(contains(rendered, "test_things_total{kind=\"a\"} 4005")) << rendered;
+  EXPECT_TRUE(contains(rendered, "test_things_total{kind=\"b\"} 112")) << rendered;
+}
+
+TEST(Metrics, Histogram) {
+  auto& histogram = metrics::histogram("test_duration_seconds", {{"stage", "a \"quoted\" one"}});
+  histogram.observe(.0005);
+  histogram.observe(.001);
+  histogram.observe(.3);
+  histogram.observe(20);
+  EXPECT_EQ(histogram.count(), 4);
+  EXPECT_EQ(histogram.bucket(0), 2);
+  EXPECT_EQ(histogram.bucket(8), 1);
+  EXPECT_EQ(histogram.bucket(metrics::Histogram::kBoundCount), 1);
+  EXPECT_NEAR(histogram.sum(), 20.3015, 1e-6);
+
+  // one more from another thread
+  std::thread([]() {
+    metrics::histogram("test_duration_seconds", {{"stage", "a \"quoted\" one"}}).observe(.002);
+  }).join();
+
+  auto rendered = metrics::render();
+  const std::string series = "test_duration_seconds_bucket{stage=\"a \\\"quoted\\\" one\",le=";
+  EXPECT_TRUE(contains(rendered, "# TYPE test_duration_seconds histogram")) << rendered;
+  EXPECT_TRUE(contains(rendered, series + "\"0.001\"} 2")) << rendered;
+  EXPECT_TRUE(contains(rendered, series + "\"0.0025\"} 3")) << rendered;
+  EXPECT_TRUE(contains(rendered, series + "\"0.25\"} 3")) << rendered;
+  EXPECT_TRUE(contains(rendered, series + "\"0.5\"} 4")) << rendered;
+  EXPECT_TRUE(contains(rendered, series + "\"10\"} 4")) << rendered;
+  EXPECT_TRUE(contains(rendered, series + "\"+Inf\"} 5")) << rendered;
+  const std::string labels = "{stage=\"a \\\"quoted\\\" one\"}";
+  EXPECT_TRUE(contains(rendered, "test_duration_seconds_sum" + labels + " 20.3035")) << rendered;
+  EXPECT_TRUE(contains(rendered, "test_duration_seconds_count" + labels + " 5")) << rendered;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
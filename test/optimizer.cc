@@ -1,8 +1,15 @@
 #include "thor/optimizer.h"
 #include "config.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <numeric>
+#include <random>
 #include <vector>
 
+#include <boost/property_tree/ptree.hpp>
+
 #include "test.h"
 
 using namespace std;
@@ -35,6 +42,120 @@ TEST(Optimizer, Basic) {
   TryOptimizer(11, costs, expected_order);
 }
 
+// Locations along a line, the only best tour visits them in order
+std::vector<float> LineCosts(const uint32_t nlocs, const std::vector<uint32_t>& positions) {
+  std::vector<float> costs(nlocs * nlocs);
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    for (uint32_t j = 0; j < nlocs; ++j) {
+      costs[i * nlocs + j] = std::abs(static_cast<float>(positions[i]) - positions[j]);
+    }
+  }
+  return costs;
+}
+
+TEST(Optimizer, ManyLocationsOnThreads) {
+  // Shuffle the positions of the locations in between the fixed origin and destination
+  const uint32_t nlocs = 100;
+  std::vector<uint32_t> positions(nlocs);
+  std::iota(positions.begin(), positions.end(), 0);
+  std::shuffle(positions.begin() + 1, positions.end() - 1, std::mt19937(7));
+  auto costs = LineCosts(nlocs, positions);
+
+  boost::property_tree::ptree config;
+  config.put("optimizer_threads", 4);
+  Optimizer optimizer(config);
+  optimizer.Seed(111111);
+  auto order = optimizer.Solve(nlocs, costs);
+
+  ASSERT_EQ(order.size(), nlocs);
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    EXPECT_EQ(positions[order[i]], i);
+  }
+}
+
+TEST(Optimizer, OneWayCosts) {
+  // Going back to a lower location costs ten times as much so any tour that is not in order is
+  // far worse, a reversal has to take the costs of the reversed part into account to see that
+  const uint32_t nlocs = 30;
+  std::vector<uint32_t> positions(nlocs);
+  std::iota(positions.begin(), positions.end(), 0);
+  std::shuffle(positions.begin() + 1, positions.end() - 1, std::mt19937(11));
+  auto costs = LineCosts(nlocs, positions);
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    for (uint32_t j = 0; j < nlocs; ++j) {
+      if (positions[j] < positions[i]) {
+        costs[i * nlocs + j] *= 10.0f;
+      }
+    }
+  }
+
+  Optimizer optimizer;
+  optimizer.Seed(111111);
+  auto order = optimizer.Solve(nlocs, costs);
+  ASSERT_EQ(order.size(), nlocs);
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    EXPECT_EQ(positions[order[i]], i);
+  }
+}
+
+TEST(Optimizer, SameTourForSameLocations) {
+  // Every tour costs the same, so which one comes out only depends on the random numbers
+  const uint32_t nlocs = 12;
+  std::vector<float> costs(nlocs * nlocs, 1.0f);
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    costs[i * nlocs + i] = 0.0f;
+  }
+
+  for (uint32_t threads : {1, 4}) {
+    boost::property_tree::ptree config;
+    config.put("optimizer_threads", threads);
+    Optimizer optimizer(config);
+    optimizer.Seed(111111);
+    auto order = optimizer.Solve(nlocs, costs);
+
+    // the optimizer is kept between requests, the same request must get the same tour
+    EXPECT_EQ(optimizer.Solve(nlocs, costs), order) << threads << " threads";
+
+    // as must another optimizer with the same seed
+    Optimizer other(config);
+    other.Seed(111111);
+    EXPECT_EQ(other.Solve(nlocs, costs), order) << threads << " threads";
+
+    // while the seed does pick the tour
+    other.Seed(222222);
+    EXPECT_NE(other.Solve(nlocs, costs), order) << threads << " threads";
+  }
+}
+
+TEST(Optimizer, TimeBudget) {
+  const uint32_t nlocs = 120;
+  std::vector<uint32_t> positions(nlocs);
+  std::iota(positions.begin(), positions.end(), 0);
+  std::shuffle(positions.begin() + 1, positions.end() - 1, std::mt19937(3));
+  auto costs = LineCosts(nlocs, positions);
+
+  boost::property_tree::ptree config;
+  config.put("optimizer_threads", 2);
+  config.put("optimizer_time_budget", 0.2f);
+  Optimizer optimizer(config);
+  auto start = std::chrono::steady_clock::now();
+  auto order = optimizer.Solve(nlocs, costs);
+  auto elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+  // The runs keep starting over until the budget is spent
+  EXPECT_GE(elapsed, 0.2f);
+
+  // Every location is still visited once with the origin and destination in place
+  ASSERT_EQ(order.size(), nlocs);
+  EXPECT_EQ(order.front(), 0);
+  EXPECT_EQ(order.back(), nlocs - 1);
+  auto sorted = order;
+  std::sort(sorted.begin(), sorted.end());
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    EXPECT_EQ(sorted[i], i);
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -254,6 +254,44 @@ TEST(PredictedSpeeds, test_compress_decompress_accuracy) {
   EXPECT_LE(max_diff, 2.f) << "Low decompression accuracy"; // <= 2 KPH
 }
 
+TEST(PredictedSpeeds, test_decoded_speed_cache) {
+  // two edges with different profiles
+  std::array<float, kBucketsPerWeek> speeds1, speeds2;
+  for (uint32_t i = 0; i < kBucketsPerWeek; ++i) {
+    speeds1[i] = roundf(30.f + 15.f * sin(i / 20.f));
+    speeds2[i] = roundf(60.f + 10.f * cos(i / 30.f));
+  }
+  std::array<int16_t, 2 * kCoefficientCount> profiles;
+  auto compressed1 = compress_speed_buckets(speeds1.data());
+  auto compressed2 = compress_speed_buckets(speeds2.data());
+  std::copy(compressed1.begin(), compressed1.end(), profiles.begin());
+  std::copy(compressed2.begin(), compressed2.end(), profiles.begin() + kCoefficientCount);
+
+  // edges 0 and 2 share a cache slot, as do 1 and 3, so they keep evicting each other
+  uint32_t indexes[] = {0, kCoefficientCount, kCoefficientCount, 0};
+  PredictedSpeeds uncached, cached;
+  for (auto* pred_speeds : {&uncached, &cached}) {
+    pred_speeds->set_offset(indexes);
+    pred_speeds->set_profiles(profiles.data());
+  }
+  cached.set_cache_size(2);
+
+  // cached speeds must be identical to decoding every time, whether they hit or miss the cache
+  for (uint32_t pass = 0; pass < 2; ++pass) {
+    for (uint32_t i = 0; i < kBucketsPerWeek; ++i) {
+      uint32_t secs = i * kSpeedBucketSizeSeconds + pass;
+      for (uint32_t idx = 0; idx < 4; ++idx) {
+        EXPECT_EQ(cached.speed(idx, secs), uncached.speed(idx, secs));
+        EXPECT_EQ(cached.speed(idx, secs), uncached.speed(idx, secs));
+      }
+    }
+  }
+
+  // disabling the cache decodes again
+  cached.set_cache_size(0);
+  EXPECT_EQ(cached.speed(1, 0), decompress_speed_bucket(compressed2.data(), 0));
+}
+
 struct EncoderDecoderTest : public ::testing::Test {
   EncoderDecoderTest() {
     // fill in coefficients
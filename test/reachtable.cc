@@ -0,0 +1,131 @@
+#include "gurka/gurka.h"
+#include "test.h"
+
+#include "baldr/graphreader.h"
+#include "baldr/location.h"
+#include "baldr/pathlocation.h"
+#include "baldr/reachtable.h"
+#include "loki/search.h"
+#include "midgard/logging.h"
+#include "mjolnir/reachbuilder.h"
+#include "sif/costfactory.h"
+
+#include <algorithm>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+// Searching with the reach computed when the tiles were built has to find the very same candidates
+// with the very same reach as searching for the reach of every candidate
+void expect_same_edges(const std::vector<PathLocation::PathEdge>& edges,
+                       const std::vector<PathLocation::PathEdge>& expected) {
+  ASSERT_EQ(edges.size(), expected.size());
+  for (size_t i = 0; i < edges.size(); ++i) {
+    EXPECT_EQ(edges[i].id, expected[i].id);
+    EXPECT_EQ(edges[i].percent_along, expected[i].percent_along);
+    EXPECT_EQ(edges[i].distance, expected[i].distance);
+    EXPECT_EQ(edges[i].sos, expected[i].sos);
+    EXPECT_EQ(edges[i].outbound_reach, expected[i].outbound_reach);
+    EXPECT_EQ(edges[i].inbound_reach, expected[i].inbound_reach);
+  }
+}
+
+bool has_edge(const std::vector<PathLocation::PathEdge>& edges, const GraphId& id) {
+  return std::any_of(edges.begin(), edges.end(),
+                     [&id](const PathLocation::PathEdge& edge) { return edge.id == id; });
+}
+
+class ReachTableSearch : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    constexpr double gridsize = 100;
+
+    // a small grid with a oneway, a dead end and an island that is not connected to the rest
+    const std::string ascii_map = R"(
+      A-----B-----C-----D
+      |     |     |     |
+      |  1  |     |  2  |
+      |     |     |     |
+      E-----F-----G-----H
+      |
+      |           3 M---N
+      I
+    )";
+
+    const gurka::ways ways = {{"ABCD", {{"highway", "residential"}}},
+                              {"EFGH", {{"highway", "residential"}}},
+                              {"AEI", {{"highway", "residential"}}},
+                              {"BF", {{"highway", "residential"}, {"oneway", "yes"}}},
+                              {"CG", {{"highway", "residential"}}},
+                              {"DH", {{"highway", "residential"}}},
+                              {"MN", {{"highway", "residential"}}}};
+
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, gridsize);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/reachtable");
+    mjolnir::ReachBuilder::Build(map.config);
+  }
+};
+
+gurka::map ReachTableSearch::map = {};
+
+TEST_F(ReachTableSearch, SearchMatchesSearchWithoutTable) {
+  auto table = ReachTable::Load(map.config.get<std::string>("mjolnir.tile_dir"), "auto");
+  ASSERT_NE(table, nullptr);
+
+  GraphReader reader(map.config.get_child("mjolnir"));
+  auto costing = sif::CostFactory{}.Create(Costing::auto_);
+
+  // locations on nodes, next to edges and next to the island asking for more and more reach
+  std::vector<baldr::Location> locations;
+  for (const auto& name : {"1", "2", "3", "A", "F", "I", "M"}) {
+    for (unsigned int reach : {0u, 1u, 3u, 5u, 50u}) {
+      locations.emplace_back(map.nodes.at(name), baldr::Location::StopType::BREAK, reach, reach);
+    }
+  }
+
+  auto expected = loki::Search(locations, reader, costing);
+  auto results = loki::Search(locations, reader, costing, table.get());
+  ASSERT_EQ(results.size(), expected.size());
+  for (const auto& location : locations) {
+    auto found = results.find(location);
+    auto found_expected = expected.find(location);
+    ASSERT_EQ(found == results.end(), found_expected == expected.end());
+    if (found == results.end()) {
+      continue;
+    }
+    expect_same_edges(found->second.edges, found_expected->second.edges);
+    expect_same_edges(found->second.filtered_edges, found_expected->second.filtered_edges);
+  }
+}
+
+TEST_F(ReachTableSearch, FiltersIsland) {
+  auto table = ReachTable::Load(map.config.get<std::string>("mjolnir.tile_dir"), "auto");
+  ASSERT_NE(table, nullptr);
+
+  GraphReader reader(map.config.get_child("mjolnir"));
+  auto costing = sif::CostFactory{}.Create(Costing::auto_);
+  auto island_edge = std::get<0>(gurka::findEdgeByNodes(reader, map.nodes, "M", "N"));
+  ASSERT_NE(table->reach(island_edge), nullptr);
+  EXPECT_LT(table->reach(island_edge)->outbound, 5);
+
+  // the island is the closest but only a location that does not ask for any reach may use it
+  baldr::Location anywhere(map.nodes.at("3"));
+  baldr::Location reachable(map.nodes.at("3"), baldr::Location::StopType::BREAK, 5, 5);
+  auto results = loki::Search({anywhere, reachable}, reader, costing, table.get());
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_TRUE(has_edge(results.at(anywhere).edges, island_edge));
+  EXPECT_FALSE(has_edge(results.at(reachable).edges, island_edge));
+  EXPECT_FALSE(results.at(reachable).edges.empty());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  logging::Configure({{"type", ""}});
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -212,6 +212,59 @@ TEST(Routing, TestRoutePathIterator) {
   EXPECT_EQ(it5, the_end) << "TestRoutePathIterator: wrong advance";
 }
 
+TEST(Routing, TestLabelStatus) {
+  LabelStatus status(16);
+  const baldr::GraphId a(100, 2, 5), b(100, 2, 7), c(101, 2, 0);
+  EXPECT_EQ(status.find(a), nullptr);
+  EXPECT_EQ(status.find(uint16_t(3)), nullptr);
+
+  status.emplace(a, 1);
+  status.emplace(c, 2);
+  status.emplace(uint16_t(3), 4);
+  ASSERT_NE(status.find(a), nullptr);
+  EXPECT_EQ(status.find(a)->label_idx, 1);
+  EXPECT_FALSE(status.find(a)->permanent);
+  EXPECT_EQ(status.find(b), nullptr);
+  EXPECT_EQ(status.find(c)->label_idx, 2);
+  EXPECT_EQ(status.find(uint16_t(3))->label_idx, 4);
+  EXPECT_EQ(status.find(uint16_t(2)), nullptr);
+  status.find(a)->permanent = true;
+  EXPECT_TRUE(status.find(a)->permanent);
+
+  // clearing forgets everything but the next search can set it all again
+  status.clear();
+  EXPECT_EQ(status.find(a), nullptr);
+  EXPECT_EQ(status.find(c), nullptr);
+  EXPECT_EQ(status.find(uint16_t(3)), nullptr);
+  status.emplace(a, 6);
+  EXPECT_EQ(status.find(a)->label_idx, 6);
+  EXPECT_FALSE(status.find(a)->permanent);
+
+  // going beyond the reserved count releases the memory on clear
+  status.emplace(baldr::GraphId(100, 2, 100), 7);
+  status.clear();
+  EXPECT_EQ(status.find(a), nullptr);
+  status.emplace(b, 8);
+  EXPECT_EQ(status.find(b)->label_idx, 8);
+}
+
+TEST(Routing, TestLabelSetSharedStatus) {
+  auto status = std::make_shared<LabelStatus>();
+  LabelSet first(100, 1.f, status);
+  first.put(baldr::GraphId(100, 2, 5), sif::TravelMode::kDrive, nullptr);
+  first.put(uint16_t(1), sif::TravelMode::kDrive, nullptr);
+  // both origins cost nothing so either may come out first
+  const auto popped = first.pop();
+  EXPECT_EQ(popped + first.pop(), 1);
+  EXPECT_EQ(first.pop(), baldr::kInvalidLabel);
+
+  // a new label set starts a new search in the pool even if the last one did not clear up
+  LabelSet second(100, 1.f, status);
+  second.put(baldr::GraphId(100, 2, 5), sif::TravelMode::kDrive, nullptr);
+  EXPECT_EQ(second.pop(), 0);
+  EXPECT_EQ(second.label(0).nodeid(), baldr::GraphId(100, 2, 5));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -8,6 +8,7 @@
 #include <cmath>
 #include <fstream>
 #include <list>
+#include <thread>
 
 #include "test.h"
 
@@ -103,6 +104,43 @@ TEST(Sample, getgz) {
   _get("test/data/samplegz");
 };
 
+TEST(Sample, get_all_alternating_tiles) {
+  // postings bounce between a tile with data and one without, the order of the results has to
+  // match the order of the postings
+  skadi::sample s("test/data/samplegz", 1);
+  std::vector<std::pair<double, double>> postings;
+  for (int i = 0; i < 10; ++i) {
+    postings.emplace_back(-76.503915, 40.678783);
+    postings.emplace_back(-75.503915, 40.678783);
+  }
+  auto heights = s.get_all(postings);
+  ASSERT_EQ(heights.size(), postings.size());
+  for (size_t i = 0; i < heights.size(); ++i) {
+    if (i % 2 == 0) {
+      EXPECT_NEAR(490, heights[i], 1.0);
+    } else {
+      EXPECT_EQ(heights[i], skadi::sample::get_no_data_value());
+    }
+  }
+}
+
+TEST(Sample, get_concurrent) {
+  // one sample shared by many threads, each of them unzipping and evicting tiles
+  skadi::sample s("test/data/samplegz", 1);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&s]() {
+      for (int i = 0; i < 3; ++i) {
+        EXPECT_NEAR(490, s.get(std::make_pair(-76.503915, 40.678783)), 1.0);
+        EXPECT_EQ(s.get(std::make_pair(1.5, 1.5)), skadi::sample::get_no_data_value());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 struct testable_sample_t : public skadi::sample {
   testable_sample_t(const std::string& dir) : sample(dir) {
     {
@@ -455,6 +455,39 @@ TEST(Search, test_search_cutoff) {
   search(x, 2, 0);
 }
 
+TEST(Search, test_batch_search) {
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", tile_dir);
+  valhalla::baldr::GraphReader reader(conf);
+  const auto costing = create_costing();
+
+  // lots of nearby locations share bins, searching them together has to give what searching each
+  // of them on its own does
+  std::vector<Location> locations;
+  for (int i = 0; i < 20; ++i) {
+    for (int j = 0; j < 10; ++j) {
+      locations.emplace_back(PointLL{.005 + i * .011, .005 + j * .021});
+    }
+  }
+  const auto batch = Search(locations, reader, costing);
+  ASSERT_FALSE(batch.empty());
+  for (const auto& location : locations) {
+    const auto single = Search({location}, reader, costing);
+    auto found = batch.find(location);
+    ASSERT_EQ(found == batch.end(), single.empty());
+    if (single.empty()) {
+      continue;
+    }
+    const auto& expected = single.at(location);
+    ASSERT_EQ(found->second.edges.size(), expected.edges.size());
+    for (size_t k = 0; k < expected.edges.size(); ++k) {
+      EXPECT_EQ(found->second.edges[k].id, expected.edges[k].id);
+      EXPECT_EQ(found->second.edges[k].percent_along, expected.edges[k].percent_along);
+      EXPECT_TRUE(found->second.edges[k].projected.ApproximatelyEqual(expected.edges[k].projected));
+    }
+  }
+}
+
 } // namespace
 
 // Setup and tearown will be called only once for the entire suite121
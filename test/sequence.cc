@@ -1,5 +1,7 @@
 #include "midgard/sequence.h"
+#include <algorithm>
 #include <cstdint>
+#include <random>
 
 #include "test.h"
 
@@ -54,6 +56,69 @@ TEST(Sequence, ReadWrite) {
   read_nodes(file_name, count);
 }
 
+TEST(Sequence, ParallelSort) {
+  // shuffled ids with plenty of duplicates so that ties have to be handled during merging
+  std::vector<uint64_t> ids;
+  for (uint64_t i = 0; i < 10000; ++i)
+    ids.push_back(i / 3);
+  std::shuffle(ids.begin(), ids.end(), std::mt19937(7));
+
+  auto less_than = [](const osm_node& a, const osm_node& b) { return a.id < b.id; };
+  // in memory with a single thread, in memory with many threads and then merging on disk
+  for (const auto& buffer_threads : std::vector<std::pair<size_t, unsigned int>>{{20000, 1},
+                                                                                 {20000, 4},
+                                                                                 {333, 1},
+                                                                                 {333, 4},
+                                                                                 {1, 3}}) {
+    {
+      sequence<osm_node> sequence("parallel.nd", true, 512);
+      for (auto id : ids)
+        sequence.push_back({id, 0.f, 0.f, static_cast<uint32_t>(id)});
+      sequence.sort(less_than, buffer_threads.first, buffer_threads.second);
+    }
+
+    sequence<osm_node> sequence("parallel.nd", false, 512);
+    ASSERT_EQ(sequence.size(), ids.size());
+    for (uint64_t i = 0; i < ids.size(); ++i) {
+      osm_node node = *sequence[i];
+      ASSERT_EQ(node.id, i / 3) << "Found wrong node at: " + std::to_string(i) +
+                                       " with buffer size " + std::to_string(buffer_threads.first) +
+                                       " and " + std::to_string(buffer_threads.second) + " threads";
+      ASSERT_EQ(node.attributes, node.id) << "Node contents got mixed up";
+    }
+  }
+}
+
+TEST(Sequence, StableInMemorySort) {
+  // the same shuffled duplicates, each remembering where it was pushed
+  std::vector<uint64_t> ids;
+  for (uint64_t i = 0; i < 10000; ++i)
+    ids.push_back(i / 3);
+  std::shuffle(ids.begin(), ids.end(), std::mt19937(7));
+
+  auto less_than = [](const osm_node& a, const osm_node& b) { return a.id < b.id; };
+  for (unsigned int threads : {1u, 4u}) {
+    {
+      sequence<osm_node> sequence("stable.nd", true, 512);
+      for (uint32_t i = 0; i < ids.size(); ++i)
+        sequence.push_back({ids[i], 0.f, 0.f, i});
+      sequence.sort(less_than, 20000, threads);
+    }
+
+    // equal ids have to keep the order they were pushed in no matter how many threads sorted them
+    sequence<osm_node> sequence("stable.nd", false, 512);
+    ASSERT_EQ(sequence.size(), ids.size());
+    for (uint64_t i = 1; i < ids.size(); ++i) {
+      osm_node previous = *sequence[i - 1];
+      osm_node node = *sequence[i];
+      if (previous.id == node.id) {
+        ASSERT_LT(previous.attributes, node.attributes)
+            << "Equal ids got reordered with " + std::to_string(threads) + " threads";
+      }
+    }
+  }
+}
+
 TEST(Sequence, Iterator) {
   sequence<osm_node> sequence("nodes.nd", false, 512);
   auto i = sequence.begin();
@@ -0,0 +1,104 @@
+#include "thor/transittimetable.h"
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::thor;
+
+namespace {
+
+// Platforms a, b, c and d along one line, b and e along another
+const GraphId a(1, 3, 0), b(1, 3, 1), c(1, 3, 2), d(1, 3, 3), e(1, 3, 4);
+const GraphId ab(1, 3, 10), bc(1, 3, 11), cd(1, 3, 12), be(1, 3, 13);
+
+std::vector<TransitTimetable::Hop> trip(uint32_t departure) {
+  return {{ab, a, b, departure, departure + 60},
+          {bc, b, c, departure + 90, departure + 150},
+          {cd, c, d, departure + 180, departure + 240}};
+}
+
+TEST(TransitTimetable, Routes) {
+  TransitTimetable timetable;
+  // added out of order
+  timetable.AddTrip(2, 0, trip(1200));
+  timetable.AddTrip(1, 0, trip(600));
+  timetable.AddTrip(3, 0, {{be, b, e, 700, 800}});
+  timetable.Finalize();
+
+  ASSERT_EQ(timetable.stop_count(), 5);
+  ASSERT_EQ(timetable.route_count(), 2);
+
+  // the trips along the same edges make one route sorted by departure
+  const auto& route = timetable.route(0);
+  ASSERT_EQ(route.stop_count, 4);
+  ASSERT_EQ(route.trip_count, 2);
+  EXPECT_EQ(timetable.stop(timetable.route_stop(route, 0)), a);
+  EXPECT_EQ(timetable.stop(timetable.route_stop(route, 3)), d);
+  EXPECT_EQ(timetable.route_edge(route, 1), bc);
+  EXPECT_EQ(timetable.trip(route, 0).tripid, 1);
+  EXPECT_EQ(timetable.trip(route, 1).tripid, 2);
+  EXPECT_EQ(timetable.stop_time(route, 0, 1).arrival, 660);
+  EXPECT_EQ(timetable.stop_time(route, 0, 1).departure, 690);
+  EXPECT_EQ(timetable.stop_time(route, 1, 3).arrival, 1440);
+
+  // b is served by both routes
+  auto routes = timetable.stop_routes(timetable.stop_index(b));
+  ASSERT_EQ(routes.second - routes.first, 2);
+  EXPECT_EQ(routes.first->first, 0);
+  EXPECT_EQ(routes.first->second, 1);
+  EXPECT_EQ((routes.first + 1)->first, 1);
+  EXPECT_EQ((routes.first + 1)->second, 0);
+  EXPECT_EQ(timetable.stop_index(GraphId(1, 3, 5)), kInvalidTimetableIndex);
+}
+
+TEST(TransitTimetable, EarliestTrip) {
+  TransitTimetable timetable;
+  for (uint32_t i = 0; i < 10; ++i) {
+    timetable.AddTrip(i + 1, 0, trip(600 * i));
+  }
+  timetable.Finalize();
+  const auto& route = timetable.route(0);
+  ASSERT_EQ(route.trip_count, 10);
+
+  EXPECT_EQ(timetable.EarliestTrip(route, 0, 0), 0);
+  EXPECT_EQ(timetable.EarliestTrip(route, 0, 1), 1);
+  EXPECT_EQ(timetable.EarliestTrip(route, 0, 600), 1);
+  EXPECT_EQ(timetable.EarliestTrip(route, 1, 90), 0);
+  EXPECT_EQ(timetable.EarliestTrip(route, 1, 91), 1);
+  EXPECT_EQ(timetable.EarliestTrip(route, 1, 690), 1);
+  EXPECT_EQ(timetable.EarliestTrip(route, 0, 5400), 9);
+  EXPECT_EQ(timetable.EarliestTrip(route, 0, 5401), kInvalidTimetableIndex);
+}
+
+TEST(TransitTimetable, Overtaking) {
+  TransitTimetable timetable;
+  timetable.AddTrip(1, 0, trip(600));
+  // leaves later but arrives at d first
+  timetable.AddTrip(2, 0, {{ab, a, b, 630, 660}, {bc, b, c, 670, 700}, {cd, c, d, 710, 760}});
+  timetable.AddTrip(3, 0, trip(1200));
+  timetable.Finalize();
+
+  // so it gets a route of its own to keep the departures of each route sorted
+  ASSERT_EQ(timetable.route_count(), 2);
+  EXPECT_EQ(timetable.route(0).trip_count, 2);
+  EXPECT_EQ(timetable.route(1).trip_count, 1);
+  EXPECT_EQ(timetable.trip(timetable.route(1), 0).tripid, 2);
+  for (uint32_t r = 0; r < timetable.route_count(); ++r) {
+    const auto& route = timetable.route(r);
+    for (uint32_t t = 1; t < route.trip_count; ++t) {
+      for (uint32_t pos = 0; pos < route.stop_count; ++pos) {
+        EXPECT_LE(timetable.stop_time(route, t - 1, pos).arrival,
+                  timetable.stop_time(route, t, pos).arrival);
+        EXPECT_LE(timetable.stop_time(route, t - 1, pos).departure,
+                  timetable.stop_time(route, t, pos).departure);
+      }
+    }
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -536,6 +536,104 @@ TEST(ViterbiSearch, TestTopKSearch) {
   }
 }
 
+TEST(ViterbiSearch, TestFinalTime) {
+  for (int i = 0; i < 20; ++i) {
+    const auto& columns = generate_columns(
+        // transition costs, some invalid to break the path now and then
+        std::uniform_int_distribution<int>(-5, 100),
+        // emission costs
+        std::uniform_int_distribution<int>(0, 100),
+        generate_column_counts(200,
+                               // column sizes
+                               std::uniform_int_distribution<size_t>(0, 10)));
+    ViterbiSearch vs;
+    vs.set_emission_cost_model(EmissionCostModel(columns));
+    vs.set_transition_cost_model(TransitionCostModel(columns));
+
+    // Add the columns one at a time and collect the path as it becomes final
+    std::vector<StateId> path;
+    for (StateId::Time time = 0; time < columns.size(); ++time) {
+      for (uint32_t id = 0; id < columns[time].size(); ++id) {
+        vs.AddStateId(StateId(time, id));
+      }
+      vs.SearchWinner(time);
+
+      StateId converged;
+      const auto final_time = vs.FinalTime(converged);
+      if (final_time == kInvalidTime) {
+        continue;
+      }
+      ASSERT_GE(final_time + 1, path.size()) << "final path must not shrink";
+      ASSERT_TRUE(!converged.IsValid() || converged.time() == final_time);
+
+      std::vector<StateId> tail;
+      auto stateid = converged.IsValid() ? converged : vs.SearchWinner(final_time);
+      for (auto t = final_time; t + 1 > path.size(); --t) {
+        tail.push_back(stateid);
+        const auto predecessor = stateid.IsValid() ? vs.Predecessor(stateid) : StateId();
+        stateid = predecessor.IsValid() || t == 0 ? predecessor : vs.SearchWinner(t - 1);
+      }
+      path.insert(path.end(), tail.rbegin(), tail.rend());
+    }
+    EXPECT_FALSE(path.empty()) << "the path should have become final somewhere";
+
+    // Once all the columns are there the best path must still be what was final along the way
+    std::vector<StateId> best;
+    while (best.size() < columns.size()) {
+      const StateId::Time time = columns.size() - best.size() - 1;
+      std::copy(vs.SearchPathVS(time, false), vs.PathEnd(), std::back_inserter(best));
+    }
+    std::reverse(best.begin(), best.end());
+    ASSERT_LE(path.size(), best.size());
+    EXPECT_TRUE(std::equal(path.begin(), path.end(), best.begin()))
+        << "the final path must not change when more columns are added";
+  }
+}
+
+TEST(ViterbiSearch, TestFinalTimeAfterBreak) {
+  // Two states per time. Nothing connects time 2 to time 3 so the path breaks there, after that two
+  // separate lanes that only meet again in the single state at time 11
+  std::vector<Column> columns;
+  for (StateId::Time time = 0; time < 13; ++time) {
+    if (time == 11) {
+      columns.push_back({{1.f, {{0, 1.f}, {1, 1.f}}}});
+    } else if (time == 10) {
+      columns.push_back({{1.f, {{0, 1.f}}}, {1.f, {{0, 1.f}}}});
+    } else if (time == 2 || time == 12) {
+      columns.push_back({{1.f, {}}, {1.f, {}}});
+    } else if (time < 2) {
+      columns.push_back({{1.f, {{0, 1.f}, {1, 2.f}}}, {1.f, {{0, 2.f}, {1, 1.f}}}});
+    } else {
+      columns.push_back({{1.f, {{0, 1.f}}}, {1.f, {{1, 2.f}}}});
+    }
+  }
+
+  ViterbiSearch vs;
+  vs.set_emission_cost_model(EmissionCostModel(columns));
+  vs.set_transition_cost_model(TransitionCostModel(columns));
+
+  for (StateId::Time time = 0; time < columns.size(); ++time) {
+    for (uint32_t id = 0; id < columns[time].size(); ++id) {
+      vs.AddStateId(StateId(time, id));
+    }
+    vs.SearchWinner(time);
+
+    StateId converged;
+    const auto final_time = vs.FinalTime(converged);
+    if (time < 3) {
+      EXPECT_TRUE(final_time == kInvalidTime || final_time < 2) << "at time " << time;
+    } else if (time < 11) {
+      // the lanes have not met since the break so the path is final up to the break
+      EXPECT_EQ(final_time, 2) << "at time " << time;
+      EXPECT_FALSE(converged.IsValid()) << "at time " << time;
+    } else {
+      // everything goes through the state at time 11 now
+      EXPECT_EQ(final_time, 11) << "at time " << time;
+      EXPECT_EQ(converged, StateId(11, 0)) << "at time " << time;
+    }
+  }
+}
+
 int main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,138 @@
+#ifndef VALHALLA_BALDR_CONTRACTION_H_
+#define VALHALLA_BALDR_CONTRACTION_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/tilefile.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Marks a missing vertex, eg. the middle of an arc that is not a shortcut
+constexpr uint32_t kInvalidVertex = kInvalidRecord;
+
+// Name of the contraction hierarchy overlay within the tile directory
+constexpr const char* kContractionFile = "contraction.ch";
+
+/**
+ * An arc of the contraction hierarchy overlay. Arcs are either a single directed edge of the graph,
+ * a transition between the levels of a node (no edge and no middle) or a shortcut made of two other
+ * arcs that meet at the middle vertex.
+ */
+struct ContractionArc {
+  uint32_t target; // vertex at the other end of the arc
+  uint32_t middle; // vertex this shortcut was contracted through or kInvalidVertex
+  float cost;      // cost of traversing the arc
+  uint32_t spare;
+  uint64_t edgeid; // directed edge of a non shortcut arc or kInvalidGraphId
+
+  bool is_shortcut() const {
+    return middle != kInvalidVertex;
+  }
+};
+
+/**
+ * Read only contraction hierarchy overlay on top of the tiled graph, built offline by
+ * mjolnir::ContractionBuilder for a single costing. Every node of every hierarchy level is a
+ * vertex. Vertices are numbered by level, then by tile and then by node id so the vertex of a node
+ * is just the first vertex of its tile plus its id. For each vertex the overlay stores the arcs
+ * leaving it towards vertices of higher rank (forward) and the arcs entering it from vertices of
+ * higher rank (backward, targeting the vertex the arc comes from). A forward search along the
+ * former meets a reverse search along the latter at the highest ranked vertex of the shortest path.
+ */
+class ContractionOverlay {
+public:
+  /**
+   * Load the overlay from the tile directory.
+   * @param  tile_dir  directory the tiles are stored in
+   * @return the overlay or nullptr if there is none or it is unreadable
+   */
+  static std::shared_ptr<const ContractionOverlay> Load(const std::string& tile_dir);
+
+  /**
+   * Write an overlay to the tile directory.
+   * @param  tile_dir  directory the tiles are stored in
+   * @param  tiles     the tiles of all levels sorted by GraphId::tile_value and their node counts
+   * @param  forward   arcs to higher ranked vertices, per vertex
+   * @param  backward  arcs from higher ranked vertices, per vertex
+   */
+  static void Write(const std::string& tile_dir,
+                    const std::vector<std::pair<GraphId, uint32_t>>& tiles,
+                    const std::vector<std::vector<ContractionArc>>& forward,
+                    const std::vector<std::vector<ContractionArc>>& backward);
+
+  /**
+   * Get the vertex of a node.
+   * @param  node  the node
+   * @return the vertex or kInvalidVertex if the node's tile is not part of the overlay
+   */
+  uint32_t vertex(const GraphId& node) const {
+    return tiles_.record(node);
+  }
+
+  /**
+   * Get the node of a vertex.
+   * @param  vertex  the vertex
+   * @return the node
+   */
+  GraphId node(const uint32_t vertex) const {
+    return tiles_.graphid(vertex);
+  }
+
+  /**
+   * @return the number of vertices
+   */
+  uint32_t vertex_count() const {
+    return static_cast<uint32_t>(forward_offsets_.size() - 1);
+  }
+
+  // A range of arcs
+  struct arcs_t {
+    const ContractionArc* first;
+    const ContractionArc* last;
+    const ContractionArc* begin() const {
+      return first;
+    }
+    const ContractionArc* end() const {
+      return last;
+    }
+  };
+
+  /**
+   * @param  vertex  the vertex
+   * @return the arcs leaving the vertex towards higher ranked vertices
+   */
+  arcs_t forward(const uint32_t vertex) const {
+    return {forward_arcs_.data() + forward_offsets_[vertex],
+            forward_arcs_.data() + forward_offsets_[vertex + 1]};
+  }
+
+  /**
+   * @param  vertex  the vertex
+   * @return the arcs entering the vertex from higher ranked vertices
+   */
+  arcs_t backward(const uint32_t vertex) const {
+    return {backward_arcs_.data() + backward_offsets_[vertex],
+            backward_arcs_.data() + backward_offsets_[vertex + 1]};
+  }
+
+protected:
+  ContractionOverlay() = default;
+
+  // the first vertex of each tile
+  TileOffsets tiles_;
+  // compressed sparse rows of arcs per vertex
+  std::vector<uint32_t> forward_offsets_;
+  std::vector<ContractionArc> forward_arcs_;
+  std::vector<uint32_t> backward_offsets_;
+  std::vector<ContractionArc> backward_arcs_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_CONTRACTION_H_
@@ -3,14 +3,25 @@
 #include <valhalla/baldr/curler.h>
 #include <valhalla/baldr/tilegetter.h>
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 namespace valhalla {
 namespace baldr {
 
 /**
- * Default implementation which uses libcurl and curler_pool_t.
+ * Default implementation which uses libcurl and curler_pool_t. Background requests are made by a
+ * separate pool of curlers, each with its own thread, so they never hold up synchronous requests.
+ * Background requests that do not fit in the queue are refused, or when a future was asked for
+ * made synchronously once it is waited on.
  */
 class curl_tile_getter_t : public tile_getter_t {
 public:
@@ -18,27 +29,70 @@ public:
    * @param pool_size  the number of curler instances in the pool
    * @param user_agent  user agent to use by curlers for HTTP requests
    * @param gzipped  whether to request for gzip compressed data
+   * @param async_pool_size  the number of background requests in flight at once, 0 for none
+   * @param max_queued  the number of background requests that may wait for a free curler
    */
-  curl_tile_getter_t(const size_t pool_size, const std::string& user_agent, bool gzipped)
-      : curlers_(pool_size, user_agent), gzipped_(gzipped) {
+  curl_tile_getter_t(const size_t pool_size,
+                     const std::string& user_agent,
+                     bool gzipped,
+                     const size_t async_pool_size = 0,
+                     const size_t max_queued = 256)
+      : curlers_(pool_size, user_agent), gzipped_(gzipped),
+        async_curlers_(async_pool_size, user_agent), max_queued_(max_queued) {
+    for (size_t i = 0; i < async_pool_size; ++i) {
+      async_threads_.emplace_back([this]() { work(); });
+    }
+  }
+
+  ~curl_tile_getter_t() override {
+    {
+      std::lock_guard<std::mutex> lock(queue_lock_);
+      shutdown_ = true;
+    }
+    queue_cond_.notify_all();
+    for (auto& thread : async_threads_) {
+      thread.join();
+    }
   }
 
   using response_t = tile_getter_t::response_t;
 
   response_t get(const std::string& url) override {
-    scoped_curler_t curler(curlers_);
-    long http_code = 0;
-    auto tile_data = curler.get()(url, http_code, gzipped_, interrupt_);
-    response_t result;
-    // TODO: Check other codes.
-    if (http_code == 200) {
-      result.bytes_ = std::move(tile_data);
-      result.status_ = tile_getter_t::status_code_t::SUCCESS;
-    }
+    return get(curlers_, url, interrupt_);
+  }
 
+  std::future<response_t> get_async(const std::string& url) override {
+    // whoever is still waiting on a request that never ran gets a broken promise
+    auto promise = std::make_shared<std::promise<response_t>>();
+    auto result = promise->get_future();
+    if (!get_async(url, [promise](response_t&& response) {
+          promise->set_value(std::move(response));
+        })) {
+      return tile_getter_t::get_async(url);
+    }
     return result;
   }
 
+  using callback_t = tile_getter_t::callback_t;
+
+  bool get_async(const std::string& url, const callback_t& callback) override {
+    std::unique_lock<std::mutex> lock(queue_lock_);
+    if (async_threads_.empty() || queue_.size() >= max_queued_) {
+      return false;
+    }
+    queue_.emplace_back([this, url, callback]() {
+      // a failed request is a failed response, there is nobody to throw to on this thread
+      response_t response;
+      try {
+        response = get(async_curlers_, url, nullptr);
+      } catch (...) {}
+      callback(std::move(response));
+    });
+    lock.unlock();
+    queue_cond_.notify_one();
+    return true;
+  }
+
   bool gzipped() const override {
     return gzipped_;
   }
@@ -50,9 +104,49 @@ public:
   }
 
 private:
+  response_t get(curler_pool_t& curlers, const std::string& url, const interrupt_t* interrupt) {
+    scoped_curler_t curler(curlers);
+    long http_code = 0;
+    auto tile_data = curler.get()(url, http_code, gzipped_, interrupt);
+    response_t result;
+    // TODO: Check other codes.
+    if (http_code == 200) {
+      result.bytes_ = std::move(tile_data);
+      result.status_ = tile_getter_t::status_code_t::SUCCESS;
+    }
+
+    return result;
+  }
+
+  // makes the queued background requests until the getter is destroyed
+  void work() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(queue_lock_);
+        queue_cond_.wait(lock, [this]() { return shutdown_ || !queue_.empty(); });
+        if (shutdown_) {
+          // queued requests are dropped without calling back
+          return;
+        }
+        task = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      task();
+    }
+  }
+
   curler_pool_t curlers_;
   const bool gzipped_;
   const interrupt_t* interrupt_ = nullptr;
+
+  curler_pool_t async_curlers_;
+  const size_t max_queued_;
+  std::mutex queue_lock_;
+  std::condition_variable queue_cond_;
+  std::deque<std::function<void()>> queue_;
+  bool shutdown_ = false;
+  std::vector<std::thread> async_threads_;
 };
 
 } // namespace baldr
@@ -1,11 +1,17 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -24,6 +30,11 @@
 namespace valhalla {
 namespace baldr {
 
+// Name of the entry at the front of a tile extract that indexes the tiles within it. It is a
+// sorted array of 16 byte entries: the offset of the tile's data from the start of the archive
+// (uint64), the GraphId value of the tile (uint32) and the size of the tile's data (uint32)
+constexpr const char* kTileExtractIndex = "index.bin";
+
 struct tile_gone_error_t : public std::runtime_error {
   explicit tile_gone_error_t(const std::string& errormessage);
   tile_gone_error_t(std::string prefix, baldr::GraphId edgeid);
@@ -414,6 +425,115 @@ private:
   std::mutex& mutex_ref_;
 };
 
+/**
+ * Tile cache shared by many threads with a single memory limit. Tiles are spread over shards
+ * that each have their own reader/writer lock so lookups never wait on each other and inserts
+ * only block lookups on the same shard. Eviction is a CLOCK (second chance) sweep over the
+ * shards: a hit only sets a flag on the tile instead of reordering a shared list.
+ * Copies of the cache share the same tiles and memory limit.
+ * It is thread-safe, the tiles themselves can only be shared between threads when built with
+ * ENABLE_THREAD_SAFE_TILE_REF_COUNT.
+ */
+class ConcurrentTileCache : public TileCache {
+public:
+  /**
+   * Constructor.
+   * @param max_size  maximum size of the cache, shared by all copies of it
+   */
+  ConcurrentTileCache(size_t max_size);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache. If another thread put the same tile first the
+   * cached one is kept and returned so that all threads share one copy.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   *  Evicts tiles that have not been used since the last sweep until the cache is within its
+   *  memory limit.
+   */
+  void Trim() override;
+
+protected:
+  static constexpr size_t kShardCount = 64;
+
+  struct Entry {
+    Entry(graph_tile_ptr tile_, size_t size_) : tile(std::move(tile_)), size(size_), used(true) {
+    }
+    graph_tile_ptr tile;
+    size_t size;
+    // set on every hit, cleared as the eviction sweep passes over it
+    mutable std::atomic<bool> used;
+  };
+
+  struct Shard {
+    mutable std::shared_timed_mutex mutex;
+    std::unordered_map<uint64_t, Entry> tiles;
+  };
+
+  struct State {
+    explicit State(size_t max_size) : cache_size(0), max_cache_size(max_size), hand(0) {
+    }
+    std::array<Shard, kShardCount> shards;
+    // The current cache size in bytes
+    std::atomic<size_t> cache_size;
+    // The max cache size in bytes
+    size_t max_cache_size;
+    // Only one thread sweeps at a time, the hand is the next shard to sweep
+    std::mutex eviction_mutex;
+    size_t hand;
+  };
+
+  /**
+   * Get the shard holding the given tile.
+   * @param graphid  the graphid of the tile
+   * @return the shard
+   */
+  Shard& GetShard(const GraphId& graphid) const;
+
+  /**
+   * Sweeps the shards evicting unused tiles until the cache is within its limit. Tiles that
+   * were used since the last sweep get a second chance. Must hold the eviction mutex.
+   */
+  void Evict();
+
+  std::shared_ptr<State> state_;
+};
+
 /**
  * Creates tile caches.
  */
@@ -443,9 +563,10 @@ public:
   explicit GraphReader(const boost::property_tree::ptree& pt,
                        std::unique_ptr<tile_getter_t>&& tile_getter = nullptr);
 
-  virtual ~GraphReader() = default;
+  virtual ~GraphReader();
 
   virtual void SetInterrupt(const tile_getter_t::interrupt_t* interrupt) {
+    interrupt_ = interrupt;
     if (tile_getter_) {
       tile_getter_->set_interrupt(interrupt);
     }
@@ -497,6 +618,16 @@ public:
     return GetGraphTile(pointll, TileHierarchy::levels().back().level);
   }
 
+  /**
+   * Starts downloading the tiles of every level around the given locations, and optionally along
+   * the straight lines between them, so that they are already on their way by the time a search
+   * needs them. Tiles that are cached, on disk or already on their way are left alone. Does
+   * nothing unless tiles come from a tile url.
+   * @param locations  the locations of a request in the order they are visited
+   * @param corridor   whether to also prefetch the tiles between consecutive locations
+   */
+  void PrefetchTiles(const std::vector<midgard::PointLL>& locations, const bool corridor = true);
+
   /**
    * Clears the cache
    */
@@ -512,6 +643,41 @@ public:
     cache_->Trim();
   }
 
+  /**
+   * Maps the tile extract (and traffic extract) named in the config as the new generation of the
+   * extract shared by all readers. Readers keep using the generation they have until they call
+   * UpdateTileExtract or UseTileExtract. The previous generation stays mapped so that requests
+   * started on it can finish, older ones are unmapped once the last reader and tile using them
+   * let go.
+   * @param pt  the mjolnir config
+   * @return false if the new extract had no usable tiles in which case the current one is kept
+   */
+  static bool ReloadTileExtract(const boost::property_tree::ptree& pt);
+
+  /**
+   * Switches to the latest generation of the tile extract if it was reloaded since this reader
+   * last looked, clearing the cache of tiles from the old one. Only call this between requests so
+   * that a request never sees tiles from two different extracts.
+   * @return true if the reader switched to a new extract
+   */
+  bool UpdateTileExtract();
+
+  /**
+   * Switches to the given generation of the tile extract, newer or older than the one the reader
+   * has, so that all the stages of a request use the extract it was started on. Only call this
+   * before the request touches any tiles.
+   * @param generation  the generation to use, see TileExtractGeneration
+   * @return false if that generation is no longer mapped in which case the reader is unchanged
+   */
+  bool UseTileExtract(uint64_t generation);
+
+  /**
+   * Returns the generation of the tile extract the reader is using
+   */
+  uint64_t TileExtractGeneration() const {
+    return tile_extract_generation_;
+  }
+
   /**
    * Returns the maximum number of threads that can
    * use the reader concurrently without blocking
@@ -910,15 +1076,107 @@ protected:
   // (Tar) extract of tiles - the contents are empty if not being used
   struct tile_extract_t {
     tile_extract_t(const boost::property_tree::ptree& pt);
+
+    // An entry of an archive's index, which is a flat array of these sorted by tile id
+    struct tile_index_entry_t {
+      uint64_t offset;  // offset of the tile's data from the start of the archive
+      uint32_t tile_id; // GraphId value of the tile's base id
+      uint32_t size;    // size of the tile's data in bytes
+    };
+
+    // The tiles of an archive sorted by tile id. If the archive starts with an index it is used
+    // in place, otherwise the whole archive is scanned to build one
+    class tile_index_t {
+    public:
+      tile_index_t() = default;
+      // the range may point into the scanned index so copying would leave it dangling
+      tile_index_t(const tile_index_t&) = delete;
+      tile_index_t& operator=(const tile_index_t&) = delete;
+
+      /**
+       * Index the tiles of an archive.
+       * @param archive_file  the tar file to load
+       * @param archive       set to the loaded archive
+       */
+      void load(const std::string& archive_file, std::shared_ptr<midgard::tar>& archive);
+
+      // find a tile's entry or nullptr if the archive does not have it
+      const tile_index_entry_t* find(const GraphId& tile_id) const {
+        auto found = std::lower_bound(begin_, end_, static_cast<uint32_t>(tile_id.value),
+                                      [](const tile_index_entry_t& e, const uint32_t id) {
+                                        return e.tile_id < id;
+                                      });
+        return found != end_ && found->tile_id == tile_id.value ? found : nullptr;
+      }
+      const tile_index_entry_t* begin() const {
+        return begin_;
+      }
+      const tile_index_entry_t* end() const {
+        return end_;
+      }
+      size_t size() const {
+        return end_ - begin_;
+      }
+      bool empty() const {
+        return begin_ == end_;
+      }
+
+    private:
+      // only used when the archive has no index of its own
+      std::vector<tile_index_entry_t> scanned_;
+      const tile_index_entry_t* begin_ = nullptr;
+      const tile_index_entry_t* end_ = nullptr;
+    };
+
     // TODO: dont remove constness, and actually make graphtile read only?
-    std::unordered_map<uint64_t, std::pair<char*, size_t>> tiles;
-    std::unordered_map<uint64_t, std::pair<char*, size_t>> traffic_tiles;
+    // get the data of a tile in the archive
+    static std::pair<char*, size_t> data(const midgard::tar& archive,
+                                         const tile_index_entry_t& entry) {
+      return std::make_pair(archive.mm.get() + entry.offset, static_cast<size_t>(entry.size));
+    }
+
+    // whether a tile was loaded from this extract rather than an older generation of it
+    bool contains(const GraphTile& tile) const {
+      const auto* data = reinterpret_cast<const char*>(tile.header());
+      return archive && data >= archive->mm.get() && data < archive->mm.get() + archive->mm.size();
+    }
+
+    tile_index_t tiles;
+    tile_index_t traffic_tiles;
     std::shared_ptr<midgard::tar> archive;
     std::shared_ptr<midgard::tar> traffic_archive;
   };
+  uint64_t tile_extract_generation_;
   std::shared_ptr<const tile_extract_t> tile_extract_;
+  // The generations of the extract that readers can still switch to
+  struct extract_generations_t;
+  static extract_generations_t& extract_generations();
+  /**
+   * Get the current generation of the extract shared by all readers, loading it the first time.
+   * @param pt           the mjolnir config
+   * @param generation   set to the generation of the returned extract
+   * @param replacement  if not null it becomes the new generation of the extract
+   * @return the extract
+   */
+  static std::shared_ptr<const GraphReader::tile_extract_t>
+  get_extract_instance(const boost::property_tree::ptree& pt,
+                       uint64_t& generation,
+                       std::shared_ptr<const tile_extract_t> replacement = nullptr);
+  /**
+   * Get the given generation of the extract shared by all readers.
+   * @param generation  the generation wanted
+   * @return the extract or nullptr if that generation is no longer mapped
+   */
   static std::shared_ptr<const GraphReader::tile_extract_t>
-  get_extract_instance(const boost::property_tree::ptree& pt);
+  get_extract_generation(uint64_t generation);
+  /**
+   * Makes the given extract the one this reader uses and lets go of the tiles cached from the old
+   * one. A cache shared by all readers is only cleared by the first reader to move to a newer
+   * generation, the others skip the tiles of other extracts when they find them in the cache.
+   * @param extract     the extract to use
+   * @param generation  its generation
+   */
+  void SwitchTileExtract(std::shared_ptr<const tile_extract_t> extract, uint64_t generation);
 
   // Information about where the tiles are kept
   const std::string tile_dir_;
@@ -931,7 +1189,27 @@ protected:
   std::mutex _404s_lock;
   std::unordered_set<GraphId> _404s;
 
+  // Tiles being downloaded in the background and the ones that arrived since, the latter are
+  // already on disk and wait to be taken into the cache by the thread using this reader
+  std::mutex prefetch_lock_;
+  std::condition_variable prefetch_cond_;
+  std::unordered_set<GraphId> prefetching_;
+  std::unordered_map<GraphId, graph_tile_ptr> prefetched_;
+  // Checked while waiting for a prefetched tile so that the wait can be interrupted
+  const tile_getter_t::interrupt_t* interrupt_ = nullptr;
+
+  /**
+   * Called from the background once the download of a prefetched tile completes. Writes the tile
+   * to disk right away so that every reader sharing the tile dir can use it.
+   * @param  base      the tile that was prefetched
+   * @param  gzipped   whether the downloaded bytes are compressed
+   * @param  response  the download of the tile
+   */
+  void FinishPrefetch(const GraphId& base, const bool gzipped, tile_getter_t::response_t&& response);
+
   std::unique_ptr<TileCache> cache_;
+  // Whether the cache is shared by all readers of the process
+  const bool shared_cache_;
 
   bool enable_incidents_;
 };
@@ -97,6 +97,27 @@ public:
                                      tile_getter_t* tile_getter,
                                      const std::string& cache_location);
 
+  /**
+   * Constructs a tile from the bytes downloaded from its url, caching them to disk if requested
+   * @param  graphid Tile Id
+   * @param  tile_data raw bytes of the tile as they were downloaded
+   * @param  gzipped whether the bytes are gzip compressed
+   * @param  cache_location directory to cache the tile in, empty to not cache it
+   * @return the tile or nullptr if the bytes are not a tile
+   */
+  static graph_tile_ptr CacheTileBytes(const GraphId& graphid,
+                                       std::vector<char>&& tile_data,
+                                       bool gzipped,
+                                       const std::string& cache_location);
+
+  /**
+   * Gets the url of a tile
+   * @param  tile_url URL pattern of the tiles
+   * @param  graphid Tile Id
+   * @return the url of the tile
+   */
+  static std::string MakeTileURL(const std::string& tile_url, const GraphId& graphid);
+
   /**
    * Construct a tile given a url for the tile using curl
    * @param  tile_data graph tile raw bytes
@@ -433,6 +454,14 @@ public:
    */
   std::unordered_map<uint32_t, TransitDeparture*> GetTransitDepartures() const;
 
+  /**
+   * Get an iterable set of the departures in this tile
+   * @return returns the departures sorted by line Id and then by departure time
+   */
+  midgard::iterable_t<const TransitDeparture> GetDepartures() const {
+    return midgard::iterable_t<const TransitDeparture>{departures_, header_->departurecount()};
+  }
+
   /**
    * Get the stop onestop Ids in this tile.
    * @return  Returns a map of transit stops with onestop Ids as the key and
@@ -1,7 +1,11 @@
 #ifndef VALHALLA_BALDR_PREDICTEDSPEEDS_H_
 #define VALHALLA_BALDR_PREDICTEDSPEEDS_H_
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstring>
+#include <memory>
 #include <valhalla/midgard/util.h>
 
 namespace valhalla {
@@ -14,6 +18,9 @@ constexpr uint32_t kBucketsPerWeek = (7 * 24 * 60) / kSpeedBucketSizeMinutes;
 // Length of transformed speed buckets array.
 constexpr uint32_t kCoefficientCount = 200;
 
+// Maximum number of decoded speeds cached per tile, see PredictedSpeeds::set_cache_size
+constexpr uint32_t kMaxDecodedSpeedCacheSize = 1024;
+
 // Expected size of base64-encoded predicted speeds coefficients. Each int16_t coefficient is
 // encoded by two bytes in an array of uint8_t's.
 constexpr uint32_t kDecodedSpeedSize = 2 * kCoefficientCount;
@@ -49,13 +56,19 @@ std::array<int16_t, kCoefficientCount> decode_compressed_speeds(const std::strin
 
 /**
  * Class to access predicted speed information within a tile.
+ *
+ * Decoding a speed is a 200 term dot product so optionally the most recently decoded speeds are
+ * kept in a small direct mapped cache keyed by edge index and bucket. A search usually expands
+ * the edges of a tile many times within the same 5 minute bucket, those lookups then skip the
+ * transform. Each cache entry is a single 64 bit word holding the key and the speed which is read
+ * and written atomically, so tiles shared between threads can use the cache without locking.
  */
 class PredictedSpeeds {
 public:
   /**
    * Constructor.
    */
-  PredictedSpeeds() : offset_(nullptr), profiles_(nullptr) {
+  PredictedSpeeds() : offset_(nullptr), profiles_(nullptr), cache_mask_(0), cache_shift_(0) {
   }
 
   /**
@@ -75,6 +88,30 @@ public:
     profiles_ = profiles;
   }
 
+  /**
+   * Set the number of decoded speeds to cache. The size is rounded up to a power of 2 and capped
+   * at kMaxDecodedSpeedCacheSize. Any previously cached speeds are dropped. This is not thread
+   * safe and must happen before the speeds are shared between threads.
+   * @param  size  Number of cache entries, 0 disables the cache.
+   */
+  void set_cache_size(uint32_t size) {
+    cache_.reset();
+    cache_mask_ = cache_shift_ = 0;
+    if (size == 0) {
+      return;
+    }
+    size = std::min(size, kMaxDecodedSpeedCacheSize);
+    // at least 2 entries so that the tag (edge index without the slot bits and the bucket) fits
+    // in the upper 32 bits of an entry
+    for (cache_shift_ = 1; (1u << cache_shift_) < size; ++cache_shift_) {
+    }
+    cache_mask_ = (1u << cache_shift_) - 1;
+    cache_.reset(new std::atomic<uint64_t>[cache_mask_ + 1]);
+    for (uint32_t i = 0; i <= cache_mask_; ++i) {
+      cache_[i].store(kEmptyEntry, std::memory_order_relaxed);
+    }
+  }
+
   /**
    * Get the speed given the edge Id and the seconds of the week.
    * @param  idx  Directed edge index.
@@ -85,15 +122,45 @@ public:
     // (otherwise an exception would be thrown when getting the directed edge) and the profile
     // offset is valid. If there is no predicted speed profile this method will not be called due
     // to DirectedEdge::has_predicted_speed being false.
-    const int16_t* coefficients = profiles_ + offset_[idx];
-
-    return decompress_speed_bucket(coefficients, seconds_of_week / kSpeedBucketSizeSeconds);
+    const uint32_t bucket = seconds_of_week / kSpeedBucketSizeSeconds;
+    if (!cache_) {
+      return decompress_speed_bucket(profiles_ + offset_[idx], bucket);
+    }
+
+    // Check the cache, the slot is picked by the low bits of the edge index and the rest of the
+    // edge index along with the bucket make up the tag
+    auto& entry = cache_[idx & cache_mask_];
+    const uint64_t tag = (static_cast<uint64_t>(idx >> cache_shift_) << kBucketBits) | bucket;
+    uint64_t cached = entry.load(std::memory_order_relaxed);
+    float speed;
+    if ((cached >> 32) == tag) {
+      uint32_t bits = static_cast<uint32_t>(cached);
+      std::memcpy(&speed, &bits, sizeof(speed));
+      return speed;
+    }
+
+    // Decode and remember it
+    speed = decompress_speed_bucket(profiles_ + offset_[idx], bucket);
+    uint32_t bits;
+    std::memcpy(&bits, &speed, sizeof(bits));
+    entry.store((tag << 32) | bits, std::memory_order_relaxed);
+    return speed;
   }
 
 protected:
+  // Buckets of the week fit in 11 bits, all ones is never a valid bucket and marks empty entries
+  static constexpr uint32_t kBucketBits = 11;
+  static constexpr uint64_t kEmptyEntry = ~uint64_t(0);
+  static_assert(kBucketsPerWeek < (1u << kBucketBits), "Buckets of the week must fit the tag");
+
   const uint32_t* offset_;  // Offset into the array of compressed speed profiles
                             // for each directed edge
   const int16_t* profiles_; // Compressed speed profiles
+
+  // Optional cache of decoded speeds, entries are (tag << 32 | speed bits)
+  std::unique_ptr<std::atomic<uint64_t>[]> cache_;
+  uint32_t cache_mask_;
+  uint32_t cache_shift_;
 };
 
 } // namespace baldr
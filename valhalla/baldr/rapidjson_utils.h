@@ -1,6 +1,8 @@
 #ifndef VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 #define VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 
+#include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <istream>
 #include <locale>
@@ -313,6 +315,19 @@ public:
     writer.SetMaxDecimalPlaces(precision);
   }
 
+  /**
+   * Writes an already serialized json value (object, array or primitive) as is
+   * @param json  the json text to insert
+   */
+  inline void raw(const std::string& json) {
+    writer.RawValue(json.c_str(), json.size(), rapidjson::kObjectType);
+  }
+
+  inline void raw(const char* key, const std::string& json) {
+    writer.String(key);
+    raw(json);
+  }
+
   inline void operator()(const char* key, const char* value) {
     writer.String(key);
     writer.String(value);
@@ -383,6 +398,16 @@ public:
     writer.Null();
   }
 
+  inline void operator()(const char* key, const double value, const int precision) {
+    writer.String(key);
+    operator()(value, precision);
+  }
+
+  inline void operator()(const std::string& key, const double value, const int precision) {
+    writer.String(key);
+    operator()(value, precision);
+  }
+
   inline void operator()(const char* value) {
     writer.String(value);
   }
@@ -408,6 +433,29 @@ public:
     writer.Bool(value);
   }
 
+  /**
+   * Writes the value with exactly the given number of decimal places, trailing zeros included and
+   * rounded the way printf's %.*f rounds. Unlike set_precision, which truncates and trims trailing
+   * zeros, this matches what baldr::json::fixed_t produces. Non finite values are written as
+   * quoted strings, ie "nan"
+   * @param value      the number to write
+   * @param precision  the number of decimal places
+   */
+  inline void operator()(const double value, const int precision) {
+    const bool finite = std::isfinite(value);
+    const char* format = finite ? "%.*f" : "\"%.*f\"";
+    char stack[64];
+    int length = std::snprintf(stack, sizeof(stack), format, precision, value);
+    if (length < static_cast<int>(sizeof(stack))) {
+      writer.RawValue(stack, length, finite ? rapidjson::kNumberType : rapidjson::kStringType);
+      return;
+    }
+    // only huge magnitudes or precisions need more room
+    std::string heap(length + 1, '\0');
+    std::snprintf(&heap[0], heap.size(), format, precision, value);
+    writer.RawValue(heap.c_str(), length, finite ? rapidjson::kNumberType : rapidjson::kStringType);
+  }
+
   inline void operator()(const std::nullptr_t) {
     writer.Null();
   }
@@ -0,0 +1,85 @@
+#ifndef VALHALLA_BALDR_REACHTABLE_H_
+#define VALHALLA_BALDR_REACHTABLE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/tilefile.h>
+
+namespace valhalla {
+namespace baldr {
+
+// The most reach a table can hold per direction
+constexpr uint32_t kMaxStoredReach = 255;
+
+/**
+ * The inbound and outbound reach of a directed edge, capped at the max reach of its table.
+ */
+struct EdgeReach {
+  uint8_t outbound; // how many nodes can be reached leaving the edge
+  uint8_t inbound;  // how many nodes can reach the edge
+};
+
+/**
+ * Read only reach of every directed edge of the graph for a single costing, built offline by
+ * mjolnir::ReachBuilder with the same expansion loki uses when correlating locations. The reaches
+ * of all tiles are stored in one flat array, tile by tile and then by edge id, so the reach of an
+ * edge is just the first reach of its tile plus its id. The table is stored next to the tiles in
+ * one file per costing.
+ */
+class ReachTable {
+public:
+  /**
+   * Load the table of a costing from the tile directory.
+   * @param  tile_dir  directory the tiles are stored in
+   * @param  costing   name of the costing the table was built for
+   * @return the table or nullptr if there is none or it is unreadable
+   */
+  static std::shared_ptr<const ReachTable> Load(const std::string& tile_dir,
+                                                const std::string& costing);
+
+  /**
+   * Write the table of a costing to the tile directory.
+   * @param  tile_dir   directory the tiles are stored in
+   * @param  costing    name of the costing the table was built for
+   * @param  max_reach  the reach every edge was capped at, at most kMaxStoredReach
+   * @param  tiles      the tiles of all levels sorted by GraphId::tile_value and their edge counts
+   * @param  reaches    the reach of every edge, tile by tile
+   */
+  static void Write(const std::string& tile_dir,
+                    const std::string& costing,
+                    const uint32_t max_reach,
+                    const std::vector<std::pair<GraphId, uint32_t>>& tiles,
+                    const std::vector<EdgeReach>& reaches);
+
+  /**
+   * Get the reach of a directed edge.
+   * @param  edgeid  the directed edge
+   * @return the reach or nullptr if the edge's tile is not part of the table
+   */
+  const EdgeReach* reach(const GraphId& edgeid) const;
+
+  /**
+   * @return the reach every edge was capped at, any more than this has to be searched for
+   */
+  uint32_t max_reach() const {
+    return max_reach_;
+  }
+
+protected:
+  ReachTable() = default;
+
+  uint32_t max_reach_;
+  // the first reach of each tile
+  TileOffsets tiles_;
+  std::vector<EdgeReach> reaches_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_REACHTABLE_H_
@@ -0,0 +1,149 @@
+#ifndef VALHALLA_BALDR_TILEFILE_H_
+#define VALHALLA_BALDR_TILEFILE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Helpers for the files of precomputed data that are stored next to the tiles, such as the reach
+// tables and the contraction hierarchy overlay. Each of these files starts with a header that
+// begins with an 8 character magic, followed by flat arrays of fixed size records.
+
+// Marks a graph id that has no record in a file
+constexpr uint32_t kInvalidRecord = std::numeric_limits<uint32_t>::max();
+
+/**
+ * The first record of each tile in a file that stores one record per node or per edge of all the
+ * tiles, tile by tile and then by id. The record of a node or an edge is the first record of its
+ * tile plus its id.
+ */
+class TileOffsets {
+public:
+  TileOffsets() = default;
+
+  /**
+   * @param  tiles  the tiles of all levels sorted by GraphId::tile_value and their record counts
+   */
+  explicit TileOffsets(const std::vector<std::pair<GraphId, uint32_t>>& tiles);
+
+  /**
+   * Get the record of a node or an edge.
+   * @param  id  the node or edge
+   * @return the index of its record or kInvalidRecord if the tile or the id is not in the file
+   */
+  uint32_t record(const GraphId& id) const;
+
+  /**
+   * Get the node or edge of a record.
+   * @param  record  the index of the record
+   * @return the node or edge
+   */
+  GraphId graphid(const uint32_t record) const;
+
+  /**
+   * @return the number of tiles
+   */
+  uint32_t tile_count() const {
+    return static_cast<uint32_t>(offsets_.size());
+  }
+
+  /**
+   * @return the number of records of all tiles
+   */
+  uint32_t record_count() const {
+    return record_count_;
+  }
+
+  /**
+   * Read the offsets written by write().
+   * @param  file          the file positioned at the offsets
+   * @param  tile_count    the number of tiles
+   * @param  record_count  the number of records of all tiles
+   */
+  void read(std::ifstream& file, const uint32_t tile_count, const uint32_t record_count);
+
+  /**
+   * @param  file  the file to append the offsets to
+   */
+  void write(std::ofstream& file) const;
+
+protected:
+  // the tile value and first record of each tile, sorted by tile
+  std::vector<std::pair<uint32_t, uint32_t>> offsets_;
+  uint32_t record_count_ = 0;
+};
+
+/**
+ * Read the header of a file and check its magic.
+ * @param  file    the file to read from
+ * @param  header  the header to fill, its first member must be char magic[8]
+ * @param  magic   the magic identifying the file and the layout of its contents
+ * @return true if the header was read and has the magic
+ */
+template <typename Header>
+bool read_header(std::ifstream& file, Header& header, const char (&magic)[8]) {
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  return file && std::memcmp(header.magic, magic, sizeof(magic)) == 0;
+}
+
+/**
+ * Stamp the magic on a header and write it.
+ * @param  file    the file to write to
+ * @param  header  the header to write, its first member must be char magic[8]
+ * @param  magic   the magic identifying the file and the layout of its contents
+ */
+template <typename Header>
+void write_header(std::ofstream& file, Header& header, const char (&magic)[8]) {
+  std::memcpy(header.magic, magic, sizeof(magic));
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+template <typename T>
+void read_records(std::ifstream& file, std::vector<T>& records, const size_t count) {
+  records.resize(count);
+  file.read(reinterpret_cast<char*>(records.data()), count * sizeof(T));
+}
+
+template <typename T> void write_records(std::ofstream& file, const std::vector<T>& records) {
+  file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+}
+
+/**
+ * Load a read only file once and share it among all the workers of a process. The file stays in
+ * memory for as long as any worker holds on to it and is loaded again after that.
+ * @param  key   identifies the file, ie its path
+ * @param  load  loads the file, may return nullptr which is not kept
+ * @return what load returned for the key, now or for an earlier call
+ */
+template <typename T>
+std::shared_ptr<const T> load_shared(const std::string& key,
+                                     const std::function<std::shared_ptr<const T>()>& load) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::weak_ptr<const T>> loaded;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& cached = loaded[key];
+  auto shared = cached.lock();
+  if (!shared) {
+    shared = load();
+    cached = shared;
+  }
+  return shared;
+}
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_TILEFILE_H_
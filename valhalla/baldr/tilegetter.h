@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -8,7 +9,7 @@ namespace valhalla {
 namespace baldr {
 
 /**
- * Synchronous interface for getting tiles.
+ * Interface for getting tiles, synchronously or in the background.
  */
 class tile_getter_t {
 public:
@@ -36,6 +37,32 @@ public:
    * */
   virtual response_t get(const std::string& url) = 0;
 
+  /**
+   * Starts a request to the corresponding url in the background, requests running in the
+   * background are never interrupted. By default there is no background and the request is made
+   * synchronously once the result is waited on.
+   */
+  virtual std::future<response_t> get_async(const std::string& url) {
+    return std::async(std::launch::deferred, [this, url]() { return get(url); });
+  }
+
+  /**
+   * Called with the response of a background request, on the background thread that ran it and
+   * not on the thread that made the request. It must not throw and should return quickly as it
+   * holds up the other background requests.
+   */
+  using callback_t = std::function<void(response_t&&)>;
+
+  /**
+   * Starts a request to the corresponding url in the background and hands its response to the
+   * callback as soon as it completes. Requests running in the background are never interrupted.
+   * By default there is no background.
+   * @return false if the request could not be started, the callback is then never called
+   */
+  virtual bool get_async(const std::string& /*url*/, const callback_t& /*callback*/) {
+    return false;
+  }
+
   /**
    * Whether tiles are with .gz extension.
    */
@@ -6,6 +6,7 @@
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
 #include <valhalla/baldr/pathlocation.h>
+#include <valhalla/baldr/reachtable.h>
 #include <valhalla/sif/dynamiccost.h>
 
 #include <functional>
@@ -22,13 +23,16 @@ namespace loki {
  * proper cache
  * @param costing        a costing object by which we can determine which portions of the graph are
  *                       accessable and therefor potential candidates
+ * @param reach_table    the reach of the edges for this costing computed when the tiles were built,
+ *                       if there is one its used instead of searching for the reach of candidates
  * @return pathLocations the correlated data with in the tile that matches the inputs. If a
  * projection is not found, it will not have any entry in the returned value.
  */
 std::unordered_map<baldr::Location, baldr::PathLocation>
 Search(const std::vector<baldr::Location>& locations,
        baldr::GraphReader& reader,
-       const std::shared_ptr<sif::DynamicCost>& costing);
+       const std::shared_ptr<sif::DynamicCost>& costing,
+       const baldr::ReachTable* reach_table = nullptr);
 
 } // namespace loki
 } // namespace valhalla
@@ -2,6 +2,9 @@
 #define __VALHALLA_LOKI_SERVICE_H__
 
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/property_tree/ptree.hpp>
@@ -10,6 +13,7 @@
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
 #include <valhalla/baldr/pathlocation.h>
+#include <valhalla/baldr/reachtable.h>
 #include <valhalla/baldr/rapidjson_utils.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/proto/options.pb.h>
@@ -101,6 +105,17 @@ protected:
   size_t max_elevation_shape;
   float min_resample;
   unsigned int max_alternates;
+  // Reach computed when the tiles were built, per costing, with the default options of the costing
+  // it is only valid for
+  struct precomputed_reach_t {
+    std::shared_ptr<const baldr::ReachTable> table;
+    std::string costing_options;
+  };
+  std::unordered_map<Costing, precomputed_reach_t> precomputed_reach;
+  // The generation of the tile extract the reach goes with
+  uint64_t reach_generation;
+  // The reach the current request can use instead of searching or nullptr
+  const baldr::ReachTable* reach_table;
 };
 } // namespace loki
 } // namespace valhalla
@@ -66,10 +66,18 @@ struct Config {
     void Read(const boost::property_tree::ptree& params);
   };
 
+  struct Online {
+    // seconds without a new measurement after which an online match is finished
+    float idle_timeout_seconds = 60.f;
+
+    void Read(const boost::property_tree::ptree& params);
+  };
+
   CandidateSearch candidate_search{};
   TransitionCost transition_cost{};
   EmissionCost emission_cost{};
   Routing routing{};
+  Online online{};
 };
 
 } // namespace meili
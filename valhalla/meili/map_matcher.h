@@ -28,7 +28,8 @@ public:
              baldr::GraphReader& graphreader,
              CandidateQuery& candidatequery,
              const sif::mode_costing_t& mode_costing,
-             sif::TravelMode travelmode);
+             sif::TravelMode travelmode,
+             const std::shared_ptr<LabelStatus>& label_status = nullptr);
 
   ~MapMatcher();
 
@@ -69,6 +70,39 @@ public:
   std::vector<MatchResults> OfflineMatch(const std::vector<Measurement>& measurements,
                                          uint32_t k = 1);
 
+  /**
+   * Match the next measurement of a trace that arrives one measurement at a time. The candidates,
+   * the search and the routes between candidates are kept from one call to the next so that each
+   * measurement only extends the search rather than redoing it. Matches are handed back as soon as
+   * they are final, which is when the best paths to all of the newest candidates agree on how they
+   * got there, so they usually trail the newest measurement by a few measurements. A measurement
+   * that comes longer than the idle timeout after the previous one finishes the previous trace
+   * and begins a new one.
+   *
+   * The segments of the results continue the route from the last match handed back before, which a
+   * first_match_idx of -1 refers to. State ids in the results are only meaningful until the next
+   * call since older states are dropped to keep long traces from growing without bound.
+   *
+   * @param measurement  the next measurement of the trace
+   * @return  the matches that became final, which may be none
+   */
+  MatchResults OnlineMatch(const Measurement& measurement);
+
+  /**
+   * Finish the trace that is being matched online and hand back the rest of its matches. The next
+   * call to OnlineMatch begins a new trace.
+   * @return  the matches that were not final yet
+   */
+  MatchResults FinishOnlineMatch();
+
+  /**
+   * Whether the trace being matched online has not had a new measurement for longer than the idle
+   * timeout, in which case it should be finished.
+   * @param epoch_time  the current time in seconds since epoch
+   * @return  true if the trace is idle
+   */
+  bool IsOnlineMatchIdle(double epoch_time) const;
+
   /**
    * Set a callback that will throw when the map-matching should be aborted
    * @param interrupt_callback  the function to periodically call to see if we should abort
@@ -87,6 +121,14 @@ private:
   void RemoveRedundancies(const std::vector<StateId>& result,
                           const std::vector<MatchResult>& results);
 
+  StateId::Time AppendOnlineMeasurement(const Measurement& measurement);
+
+  void ExtendOnlinePath(StateId::Time time, StateId stateid);
+
+  MatchResults EmitOnlineMatches(StateId::Time end);
+
+  void RebaseOnlineMatch();
+
   Config config_;
 
   baldr::GraphReader& graphreader_;
@@ -109,6 +151,19 @@ private:
   EmissionCostModel emission_cost_model_;
 
   TransitionCostModel transition_cost_model_;
+
+  // Online matching state: the final path so far, the first time whose match has not been handed
+  // back yet, the last match that was, the measurements waiting to be interpolated and the time of
+  // the latest measurement
+  std::vector<StateId> online_path_;
+
+  StateId::Time online_emitted_;
+
+  MatchResult online_last_;
+
+  std::unordered_map<StateId::Time, std::vector<Measurement>> online_interpolated_;
+
+  double online_epoch_time_;
 };
 
 /**
@@ -59,6 +59,8 @@ private:
   sif::CostFactory cost_factory_;
 
   std::shared_ptr<CandidateGridQuery> candidatequery_;
+  // Node and destination status shared by the routes of every matcher we create
+  std::shared_ptr<LabelStatus> label_status_;
 };
 
 } // namespace meili
@@ -4,6 +4,8 @@
 #include <cstdint>
 
 #include <algorithm>
+#include <limits>
+#include <memory>
 #include <stdexcept>
 #include <unordered_map>
 #include <vector>
@@ -159,26 +161,189 @@ struct Status {
   uint32_t permanent : 1;
 };
 
+// Default number of statuses (summed over all tiles and destinations) that are kept after clearing
+// so that the next search can reuse the memory rather than allocating it all over again
+constexpr size_t kDefaultReservedLabelStatusCount = 1024 * 1024;
+
+/**
+ * Status of the nodes and destinations reached by a search. Node statuses are kept in an array per
+ * tile indexed by the node id and destination statuses in an array indexed by the destination. The
+ * arrays are pooled and every status is stamped with the generation of the search that set it, so
+ * clearing only bumps the generation and a single pool can serve every search of a trace and every
+ * trace after it without allocating, unless more than the reserved count of statuses was used.
+ */
+class LabelStatus {
+public:
+  /**
+   * Constructor.
+   * @param  max_reserved_count  Number of statuses that may be kept for reuse after clearing.
+   */
+  explicit LabelStatus(const size_t max_reserved_count = kDefaultReservedLabelStatusCount)
+      : max_reserved_count_(max_reserved_count) {
+  }
+
+  LabelStatus(const LabelStatus&) = delete;
+  LabelStatus& operator=(const LabelStatus&) = delete;
+
+  /**
+   * Clear the status of all nodes and destinations. This is O(1) unless more than the reserved
+   * count of statuses was used, in which case the memory is released.
+   */
+  void clear() {
+    if (reserved_count_ > max_reserved_count_) {
+      tiles_.clear();
+      slots_.clear();
+      dests_.clear();
+      reserved_count_ = 0;
+      last_tile_ = kInvalidSlot;
+    }
+    // on wrap around we must make sure that no status looks like it was set in the new generation
+    if (++generation_ == 0) {
+      for (auto& tile : tiles_) {
+        for (auto& entry : tile) {
+          entry.generation = 0;
+        }
+      }
+      for (auto& entry : dests_) {
+        entry.generation = 0;
+      }
+      generation_ = 1;
+    }
+  }
+
+  /**
+   * Find the status of a node.
+   * @param  nodeid  the node
+   * @return the status or nullptr if the node was not reached since the last clear
+   */
+  Status* find(const baldr::GraphId& nodeid) {
+    auto slot = find_tile(nodeid.tile_value());
+    if (slot == kInvalidSlot || nodeid.id() >= tiles_[slot].size()) {
+      return nullptr;
+    }
+    auto& entry = tiles_[slot][nodeid.id()];
+    return entry.generation == generation_ ? &entry.status : nullptr;
+  }
+
+  /**
+   * Find the status of a destination.
+   * @param  dest  the destination index
+   * @return the status or nullptr if the destination was not reached since the last clear
+   */
+  Status* find(const uint16_t dest) {
+    if (dest >= dests_.size() || dests_[dest].generation != generation_) {
+      return nullptr;
+    }
+    return &dests_[dest].status;
+  }
+
+  /**
+   * Set the status of a node to a new temporary label.
+   * @param  nodeid     the node
+   * @param  label_idx  index of the node's label
+   */
+  void emplace(const baldr::GraphId& nodeid, const uint32_t label_idx) {
+    auto slot = find_tile(nodeid.tile_value());
+    if (slot == kInvalidSlot) {
+      slot = static_cast<uint32_t>(tiles_.size());
+      slots_.emplace(nodeid.tile_value(), slot);
+      tiles_.emplace_back();
+      last_key_ = nodeid.tile_value();
+      last_tile_ = slot;
+    }
+    set(tiles_[slot], nodeid.id(), label_idx);
+  }
+
+  /**
+   * Set the status of a destination to a new temporary label.
+   * @param  dest       the destination index
+   * @param  label_idx  index of the destination's label
+   */
+  void emplace(const uint16_t dest, const uint32_t label_idx) {
+    set(dests_, dest, label_idx);
+  }
+
+private:
+  static constexpr uint32_t kInvalidSlot = std::numeric_limits<uint32_t>::max();
+
+  // A status and the generation it was set in
+  struct entry_t {
+    uint32_t generation;
+    Status status;
+    entry_t() : generation(0), status(0) {
+    }
+  };
+
+  // Find the slot of a tile's statuses, consecutive lookups are almost always for the same tile
+  uint32_t find_tile(const uint32_t key) {
+    if (last_tile_ != kInvalidSlot && last_key_ == key) {
+      return last_tile_;
+    }
+    auto found = slots_.find(key);
+    if (found == slots_.end()) {
+      return kInvalidSlot;
+    }
+    last_key_ = key;
+    last_tile_ = found->second;
+    return last_tile_;
+  }
+
+  // Set a status, growing the array to fit it. We do not know the tile's node count here but the
+  // array only ever grows to the highest id reached so it is bounded by it
+  void set(std::vector<entry_t>& entries, const uint32_t idx, const uint32_t label_idx) {
+    if (idx >= entries.size()) {
+      auto capacity = entries.capacity();
+      entries.resize(idx + 1);
+      reserved_count_ += entries.capacity() - capacity;
+    }
+    entries[idx].generation = generation_;
+    entries[idx].status = Status(label_idx);
+  }
+
+  // Pooled node statuses, one array per tile ever seen since memory was last released
+  std::vector<std::vector<entry_t>> tiles_;
+  // From the tile value of a node to the slot of its statuses in tiles_
+  std::unordered_map<uint32_t, uint32_t> slots_;
+  // Pooled destination statuses
+  std::vector<entry_t> dests_;
+  // Memo of the most recently used tile and its slot
+  uint32_t last_key_ = 0;
+  uint32_t last_tile_ = kInvalidSlot;
+  // Generation of the current search, statuses stamped with any other generation are unreached
+  uint32_t generation_ = 1;
+  // How many statuses are allocated and how many we keep when clearing
+  size_t reserved_count_ = 0;
+  size_t max_reserved_count_;
+};
+
 /**
  * LabelSet used during shortest path construction and recovery. Includes a
- * priority queue (sorted by sortdist) and maps that contain status (is the
- * element "permanently" labeled) of nodes and edges.
+ * priority queue (sorted by sortdist) and the status (is the element
+ * "permanently" labeled) of nodes and destinations.
  */
 class LabelSet {
 public:
-  LabelSet(const float max_cost, const float bucket_size = 1.0f);
+  /**
+   * Constructor. Starts a new search in the status pool.
+   * @param  max_cost     maximum cost of the search
+   * @param  bucket_size  cost range of each bucket of the priority queue
+   * @param  status       pool to keep the status in, if null the label set gets its own
+   */
+  LabelSet(const float max_cost,
+           const float bucket_size = 1.0f,
+           std::shared_ptr<LabelStatus> status = nullptr);
 
   /**
    * Add an origin label using a destination index.
    */
   void put(const uint16_t dest, const sif::TravelMode mode, const Label* edgelabel) {
     // Do not add a duplicate label for the same destination index
-    if (dest_status_.find(dest) == dest_status_.end()) {
+    if (!status_->find(dest)) {
       // If edgelabel is not null, append it to the label set otherwise append
       // a dummy. In both cases add the label to the priority queue, set its
       // predecessor to kInvalidLabel, and initialize costs to 0.
       const uint32_t idx = labels_.size();
-      dest_status_.emplace(dest, idx);
+      status_->emplace(dest, idx);
       labels_.emplace_back(edgelabel ? *edgelabel : Label());
       labels_.back().InitAsOrigin(mode, dest, {});
       queue_.add(idx);
@@ -190,12 +355,12 @@ public:
    */
   void put(const baldr::GraphId& nodeid, const sif::TravelMode mode, const Label* edgelabel) {
     // Do not add a duplicate origin label for the same node
-    if (node_status_.find(nodeid) == node_status_.end()) {
+    if (!status_->find(nodeid)) {
       // If edgelabel is not null, append it to the label set otherwise append
       // a dummy. In both cases add the label to the priority queue and set its
       // predecessor to kInvalidLabel
       const uint32_t idx = labels_.size();
-      node_status_.emplace(nodeid, idx);
+      status_->emplace(nodeid, idx);
       labels_.emplace_back(edgelabel ? *edgelabel : Label());
       labels_.back().InitAsOrigin(mode, kInvalidDestination, nodeid);
       queue_.add(idx);
@@ -256,18 +421,16 @@ public:
   }
 
   /**
-   * Clear the status maps.
+   * Clear the status of nodes and destinations.
    */
   void clear_status() {
-    node_status_.clear();
-    dest_status_.clear();
+    status_->clear();
   }
 
 private:
-  baldr::DoubleBucketQueue<Label> queue_;                  // Priority queue
-  std::unordered_map<baldr::GraphId, Status> node_status_; // Node status
-  std::unordered_map<uint16_t, Status> dest_status_;       // Destination status
-  std::vector<Label> labels_;                              // Label list.
+  baldr::DoubleBucketQueue<Label> queue_; // Priority queue
+  std::shared_ptr<LabelStatus> status_;   // Node and destination status
+  std::vector<Label> labels_;             // Label list.
 };
 
 using labelset_ptr_t = std::shared_ptr<LabelSet>;
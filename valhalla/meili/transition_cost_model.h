@@ -2,10 +2,12 @@
 #define MMP_TRANSITION_COST_MODEL_H_
 
 #include <functional>
+#include <memory>
 
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/meili/config.h>
 #include <valhalla/meili/measurement.h>
+#include <valhalla/meili/routing.h>
 #include <valhalla/meili/state.h>
 #include <valhalla/meili/topk_search.h>
 #include <valhalla/meili/viterbi_search.h>
@@ -26,7 +28,8 @@ public:
                       float breakage_distance,
                       float max_route_distance_factor,
                       float max_route_time_factor,
-                      float turn_penalty_factor);
+                      float turn_penalty_factor,
+                      std::shared_ptr<LabelStatus> label_status = nullptr);
 
   TransitionCostModel(baldr::GraphReader& graphreader,
                       const IViterbiSearch& vs,
@@ -34,7 +37,8 @@ public:
                       const StateContainer& container,
                       const sif::mode_costing_t& mode_costing,
                       const sif::TravelMode travelmode,
-                      const Config::TransitionCost& config);
+                      const Config::TransitionCost& config,
+                      std::shared_ptr<LabelStatus> label_status = nullptr);
 
   // we use the difference between the original two measurements and the distance along the route
   // network to compute a transition cost of a given candidate, transition_time may be added if
@@ -92,6 +96,9 @@ private:
   // Cost for each degree in [0, 180]
   float turn_cost_table_[181];
 
+  // Node and destination status reused by every route between states
+  std::shared_ptr<LabelStatus> label_status_;
+
   bool match_on_restrictions_{false};
 };
 
@@ -165,6 +165,18 @@ public:
   StateId Predecessor(const StateId& stateid) const override;
   double AccumulatedCost(const StateId& stateid) const override;
 
+  /**
+   * Find how much of the best path can no longer change, no matter which states are added later.
+   * That is the case up to the latest state that every path still being searched passes through,
+   * or up to where the search had to start over because the states could not be connected.
+   *
+   * @param converged  set to the state at the returned time that all of those paths pass through,
+   *                   or to an invalid id if the path breaks after that time instead, in which case
+   *                   the winner at that time ends the path
+   * @return  the time up to which the best path is final, kInvalidTime if no part of it is yet
+   */
+  StateId::Time FinalTime(StateId& converged) const;
+
 private:
   // Initialize labels from a column and push them into priority queue
   void InitQueue(const std::vector<StateId>& column);
@@ -176,6 +188,9 @@ private:
   std::unordered_map<StateId, StateLabel> scanned_labels_;
   SPQueue<StateLabel> queue_;
   StateId::Time earliest_time_{0};
+  // where the paths met or broke when FinalTime was last asked, no path goes back past it
+  mutable StateId::Time final_time_{kInvalidTime};
+  mutable StateId final_state_;
 };
 } // namespace meili
 } // namespace valhalla
@@ -3,10 +3,12 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <functional>
 #include <limits>
 #include <list>
-#include <map>
+#include <thread>
+#include <unordered_map>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/polyline2.h>
 #include <valhalla/midgard/tiles.h>
@@ -83,16 +85,88 @@ public:
    * @param generalize           Generalization factor in meters. A special value
    *                             kOptimalGeneralization will let the method choose
    *                             an optimal generalization factor based on grid size.
+   * @param threads              number of threads to use, each metric is traced on its own and
+   *                             each interval is cleaned up on its own
    *
    * @return contour line geometries with the larger intervals first (for rendering purposes)
    */
   contours_t GenerateContours(std::vector<contour_interval_t>& intervals,
                               const bool rings_only = false,
                               const float denoise = 1.f,
-                              const float generalize = 200.f) const {
+                              const float generalize = 200.f,
+                              const uint32_t threads = 1) const {
     // sort the contours first on the metric index then on the values with the bigger contours first
     std::sort(intervals.begin(), intervals.end(), std::greater<>());
 
+    // If the generalization value equals kOptimalGeneralization then set
+    // the generalization factor to 1/4 of the grid size
+    float gen_factor = generalize;
+    if (generalize == kOptimalGeneralization) {
+      gen_factor = this->tilesize_ * 0.25f * kMetersPerDegreeLat;
+    }
+
+    // which metrics do we need contours for
+    std::vector<std::pair<size_t, size_t>> metrics;
+    for (size_t i = 0; i < intervals.size(); ++i) {
+      if (i == 0 || std::get<0>(intervals[i]) != std::get<0>(intervals[i - 1])) {
+        metrics.emplace_back(i, i);
+      }
+      metrics.back().second = i + 1;
+    }
+
+    // we need something to hold each iso-line
+    contours_t contours(intervals.size(), std::list<feature_t>{feature_t{}});
+
+    // one pass over the grid per metric finds the lines of all of its intervals
+    ParallelFor(metrics.size(), threads, [&](size_t m) {
+      TraceContours(intervals, metrics[m].first, metrics[m].second, contours);
+    });
+
+    // the lines of each interval are cleaned up on their own
+    ParallelFor(contours.size(), threads, [&](size_t i) {
+      CleanContour(contours[i], rings_only, denoise, gen_factor);
+    });
+
+    return contours;
+  }
+
+protected:
+  /**
+   * Call a function for every index below count, handing the indices out to threads. What the
+   * function does for one index must not depend on what it does for the others.
+   * @param count    the number of indices
+   * @param threads  the number of threads to use, the calling thread is one of them
+   * @param func     the function to call with each index
+   */
+  static void
+  ParallelFor(const size_t count, const uint32_t threads, const std::function<void(size_t)>& func) {
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+      for (size_t i = next++; i < count; i = next++) {
+        func(i);
+      }
+    };
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < std::min(static_cast<size_t>(threads), count); ++t) {
+      workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  /**
+   * Trace the lines of all the intervals of one metric in a single pass over the grid.
+   * @param intervals  the intervals sorted by metric and then by value, biggest first
+   * @param first      the first interval of the metric
+   * @param last       one past the last interval of the metric
+   * @param contours   the features of each interval, the lines are added to the first one
+   */
+  void TraceContours(const std::vector<contour_interval_t>& intervals,
+                     const size_t first,
+                     const size_t last,
+                     contours_t& contours) const {
     // Values at tile corners and center (0 element is center)
     int sh[5];
     typename PointLL::first_type s[5]; // Values at the tile corners and center
@@ -189,227 +263,205 @@ public:
         },
     };
 
-    // which metrics do we need contours for
-    auto _ = std::make_pair(intervals.cbegin(), intervals.cend());
-    std::vector<decltype(_)> metrics{std::move(_)};
-    for (auto interval = intervals.cbegin(); interval != intervals.cend(); ++interval) {
-      if (std::get<0>(*interval) != std::get<0>(*metrics.back().first)) {
-        metrics.back().second = interval;
-        metrics.emplace_back(interval, intervals.cend());
-      }
-    }
-
-    // we need something to hold each iso-line
-    contours_t contours(intervals.size(), std::list<feature_t>{feature_t{}});
-
     // and something to find them quickly
-    using contour_lookup_t = std::map<PointLL, typename feature_t::iterator>;
+    using contour_lookup_t = std::unordered_map<PointLL, typename feature_t::iterator>;
     // store begins and ends of the segments separately not to loose segment orientation
-    std::vector<contour_lookup_t> begin_lookups(intervals.size());
-    std::vector<contour_lookup_t> end_lookups(intervals.size());
-    // TODO: preallocate the lookups for each interval
-
-    // For each metric we tracked
-    for (const auto& metric : metrics) {
-      size_t metric_index = std::get<0>(*metric.first);
-
-      // For each cell, skipping the outer rim since its out of bounds
-      for (int row = 1; row < this->nrows_ - 1; ++row) {
-        for (int col = 1; col < this->ncolumns_ - 1; ++col) {
-          int tileid = this->TileId(col, row);
-          auto cell1 = data_[tileid][metric_index];
-          auto cell2 = data_[tileid + this->ncolumns_][metric_index];     // TileId(col,   row+1)];
-          auto cell3 = data_[tileid + 1][metric_index];                   // TileId(col+1, row)];
-          auto cell4 = data_[tileid + this->ncolumns_ + 1][metric_index]; // TileId(col+1, row+1)];
-          auto dmin = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
-          auto dmax = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
-
-          // Continue if outside the range of contour values for this metric_index
-          if (dmax < std::get<1>(*std::prev(metric.second)) || dmin > std::get<1>(*metric.first)) {
+    std::vector<contour_lookup_t> begin_lookups(last - first);
+    std::vector<contour_lookup_t> end_lookups(last - first);
+    const size_t metric_index = std::get<0>(intervals[first]);
+
+    // For each cell, skipping the outer rim since its out of bounds
+    for (int row = 1; row < this->nrows_ - 1; ++row) {
+      for (int col = 1; col < this->ncolumns_ - 1; ++col) {
+        int tileid = this->TileId(col, row);
+        auto cell1 = data_[tileid][metric_index];
+        auto cell2 = data_[tileid + this->ncolumns_][metric_index];     // TileId(col,   row+1)];
+        auto cell3 = data_[tileid + 1][metric_index];                   // TileId(col+1, row)];
+        auto cell4 = data_[tileid + this->ncolumns_ + 1][metric_index]; // TileId(col+1, row+1)];
+        auto dmin = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
+        auto dmax = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
+
+        // Continue if outside the range of contour values for this metric_index
+        if (dmax < std::get<1>(intervals[last - 1]) || dmin > std::get<1>(intervals[first])) {
+          continue;
+        }
+
+        // For each requested contour value of this metric
+        for (size_t i = first; i < last; ++i) {
+          // some setup to process this contour
+          auto& begin_lookup = begin_lookups[i - first];
+          auto& end_lookup = end_lookups[i - first];
+          auto& contour = contours[i].front();
+          auto contour_value = std::get<1>(intervals[i]);
+
+          // we skip this contour if its value would not intersect this cell
+          if (contour_value < dmin || contour_value > dmax) {
             continue;
           }
 
-          // For each requested contour value
-          for (size_t i = 0; i < intervals.size(); ++i) {
-            // some setup to process this contour
-            auto& begin_lookup = begin_lookups[i];
-            auto& end_lookup = end_lookups[i];
-            auto& contour = contours[i];
-            auto contour_value = std::get<1>(intervals[i]);
-
-            // we skip this contour if its interested in a different metric_index or its value
-            // would not intersect this cell
-            if (std::get<0>(intervals[i]) != metric_index || contour_value < dmin ||
-                contour_value > dmax) {
+          for (int m = 4; m > 0; m--) {
+            int newtileid = tileid + tile_inc[m - 1];
+            // Make sure the tile corner value is not set to the max_value
+            // (messes up the intersect method). Set a value slightly above
+            // the contour (e.g. 1 minute higher).
+            // TODO - the value 1 is a bit of a hack.
+            float nd = data_[newtileid][metric_index];
+            s[m] = nd < max_value_[metric_index] ? nd - contour_value : 1.0f;
+            tile_corners[m] = this->Base(newtileid);
+            sh[m] = (s[m] > 0.0f) - (s[m] < 0.0f); // pos = 1, neg = -1, 0 = 0
+          }
+          s[0] = 0.25 * (s[1] + s[2] + s[3] + s[4]);
+          tile_corners[0] = this->Center(tileid);
+          sh[0] = (s[0] > 0.0f) - (s[0] < 0.0f); // pos = 1, neg = -1, 0 = 0
+
+          /*
+           Note: at this stage the relative heights of the corners and the
+           centre are in the h array, and the corresponding coordinates are
+           in the xh and yh arrays. The centre of the box is indexed by 0
+           and the 4 corners by 1 to 4 as shown below.
+           Each triangle is then indexed by the parameter m, and the 3
+           vertices of each triangle are indexed by parameters m1,m2,and m3.
+           It is assumed that the centre of the box is always vertex 2
+           though this is important only when all 3 vertices lie exactly on
+           the same contour level, in which case only the side of the box
+           is drawn.
+              vertex 4 +-------------------+ vertex 3
+                       | \               / |
+                       |   \    m-3    /   |
+                       |     \       /     |
+                       |       \   /       |
+                       |  m=2    X   m=2   |       the centre is vertex 0
+                       |       /   \       |
+                       |     /       \     |
+                       |   /    m=1    \   |
+                       | /               \ |
+              vertex 1 +-------------------+ vertex 2
+          */
+
+          // Scan each triangle in the box
+          for (int m = 1; m <= 4; m++) {
+            // figure out which intersection we need to do
+            m1 = m;
+            m2 = 0;
+            m3 = (m != 4) ? m + 1 : 1;
+            int case_index = case_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1];
+            bool swap_points = swap_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1];
+
+            // there is no intersection of this triangle
+            if (case_index == 0) {
               continue;
             }
 
-            for (int m = 4; m > 0; m--) {
-              int newtileid = tileid + tile_inc[m - 1];
-              // Make sure the tile corner value is not set to the max_value
-              // (messes up the intersect method). Set a value slightly above
-              // the contour (e.g. 1 minute higher).
-              // TODO - the value 1 is a bit of a hack.
-              float nd = data_[newtileid][metric_index];
-              s[m] = nd < max_value_[metric_index] ? nd - contour_value : 1.0f;
-              tile_corners[m] = this->Base(newtileid);
-              sh[m] = (s[m] > 0.0f) - (s[m] < 0.0f); // pos = 1, neg = -1, 0 = 0
-            }
-            s[0] = 0.25 * (s[1] + s[2] + s[3] + s[4]);
-            tile_corners[0] = this->Center(tileid);
-            sh[0] = (s[0] > 0.0f) - (s[0] < 0.0f); // pos = 1, neg = -1, 0 = 0
-
-            /*
-             Note: at this stage the relative heights of the corners and the
-             centre are in the h array, and the corresponding coordinates are
-             in the xh and yh arrays. The centre of the box is indexed by 0
-             and the 4 corners by 1 to 4 as shown below.
-             Each triangle is then indexed by the parameter m, and the 3
-             vertices of each triangle are indexed by parameters m1,m2,and m3.
-             It is assumed that the centre of the box is always vertex 2
-             though this is important only when all 3 vertices lie exactly on
-             the same contour level, in which case only the side of the box
-             is drawn.
-                vertex 4 +-------------------+ vertex 3
-                         | \               / |
-                         |   \    m-3    /   |
-                         |     \       /     |
-                         |       \   /       |
-                         |  m=2    X   m=2   |       the centre is vertex 0
-                         |       /   \       |
-                         |     /       \     |
-                         |   /    m=1    \   |
-                         | /               \ |
-                vertex 1 +-------------------+ vertex 2
-            */
-
-            // Scan each triangle in the box
-            for (int m = 1; m <= 4; m++) {
-              // figure out which intersection we need to do
-              m1 = m;
-              m2 = 0;
-              m3 = (m != 4) ? m + 1 : 1;
-              int case_index = case_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1];
-              bool swap_points = swap_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1];
-
-              // there is no intersection of this triangle
-              if (case_index == 0) {
-                continue;
-              }
+            // do the intersection, assigns to pt1 and pt2 inside lambdas defined above
+            cases[case_index]();
 
-              // do the intersection, assigns to pt1 and pt2 inside lambdas defined above
-              cases[case_index]();
+            // this isnt a segment..
+            if (from_pt == to_pt) {
+              continue;
+            }
+            if (swap_points) {
+              std::swap(from_pt, to_pt);
+            }
 
-              // this isnt a segment..
-              if (from_pt == to_pt) {
+            // see if we have anything to connect this segment to
+            typename contour_lookup_t::iterator end_lookup_it = end_lookup.find(from_pt);
+            typename contour_lookup_t::iterator begin_lookup_it = begin_lookup.find(to_pt);
+
+            if (end_lookup_it != end_lookup.end() && begin_lookup_it != begin_lookup.end()) {
+              // we want to merge two records
+              //   first_segment                               second_segment
+              // (... ------> from_pt) + (from_pt, to_pt) + (to_pt ------> ...)
+              auto first_segment = end_lookup_it->second;
+              auto second_segment = begin_lookup_it->second;
+              end_lookup.erase(end_lookup_it);
+              begin_lookup.erase(begin_lookup_it);
+
+              // this segment is now a ring
+              if (first_segment == second_segment) {
+                first_segment->push_back(first_segment->front());
                 continue;
               }
-              if (swap_points) {
-                std::swap(from_pt, to_pt);
-              }
 
-              // see if we have anything to connect this segment to
-              typename contour_lookup_t::iterator end_lookup_it = end_lookup.find(from_pt);
-              typename contour_lookup_t::iterator begin_lookup_it = begin_lookup.find(to_pt);
-
-              if (end_lookup_it != end_lookup.end() && begin_lookup_it != begin_lookup.end()) {
-                // we want to merge two records
-                //   first_segment                               second_segment
-                // (... ------> from_pt) + (from_pt, to_pt) + (to_pt ------> ...)
-                auto first_segment = end_lookup_it->second;
-                auto second_segment = begin_lookup_it->second;
-                end_lookup.erase(end_lookup_it);
-                begin_lookup.erase(begin_lookup_it);
-
-                // this segment is now a ring
-                if (first_segment == second_segment) {
-                  first_segment->push_back(first_segment->front());
-                  continue;
-                }
-
-                end_lookup[second_segment->back()] = first_segment;
-                first_segment->splice(first_segment->end(), *second_segment);
-                contour.front().erase(second_segment);
-              } else if (end_lookup_it != end_lookup.end()) {
-                // (... ------> from_pt) + (from_pt, to_pt)
-                end_lookup_it->second->push_back(to_pt);
-                end_lookup.emplace(to_pt, end_lookup_it->second);
-                end_lookup.erase(end_lookup_it);
-              } else if (begin_lookup_it != begin_lookup.end()) {
-                // (from_pt, to_pt) + (to_pt ------> ...)
-                begin_lookup_it->second->push_front(from_pt);
-                begin_lookup.emplace(from_pt, begin_lookup_it->second);
-                begin_lookup.erase(begin_lookup_it);
-              } else {
-                // this is an orphan segment for now
-                contour.front().push_front(contour_t{from_pt, to_pt});
-                begin_lookup.emplace(from_pt, contour.front().begin());
-                end_lookup.emplace(to_pt, contour.front().begin());
-              }
+              end_lookup[second_segment->back()] = first_segment;
+              first_segment->splice(first_segment->end(), *second_segment);
+              contour.erase(second_segment);
+            } else if (end_lookup_it != end_lookup.end()) {
+              // (... ------> from_pt) + (from_pt, to_pt)
+              end_lookup_it->second->push_back(to_pt);
+              end_lookup.emplace(to_pt, end_lookup_it->second);
+              end_lookup.erase(end_lookup_it);
+            } else if (begin_lookup_it != begin_lookup.end()) {
+              // (from_pt, to_pt) + (to_pt ------> ...)
+              begin_lookup_it->second->push_front(from_pt);
+              begin_lookup.emplace(from_pt, begin_lookup_it->second);
+              begin_lookup.erase(begin_lookup_it);
+            } else {
+              // this is an orphan segment for now
+              contour.push_front(contour_t{from_pt, to_pt});
+              begin_lookup.emplace(from_pt, contour.begin());
+              end_lookup.emplace(to_pt, contour.begin());
             }
-          } // Each contour
-        }   // Each tile col
-      }     // Each tile row
-    }       // Each dimension of the grid
-
-    // If the generalization value equals kOptimalGeneralization then set
-    // the generalization factor to 1/4 of the grid size
-    float gen_factor = generalize;
-    if (generalize == kOptimalGeneralization) {
-      gen_factor = this->tilesize_ * 0.25f * kMetersPerDegreeLat;
-    }
+          }
+        } // Each contour
+      }   // Each tile col
+    }     // Each tile row
+  }
 
+  /**
+   * Clean up the traced lines of a single interval.
+   * @param collection  the features of the interval, the lines are in the first one
+   * @param rings_only  only include geometry of contours that are polygonal
+   * @param denoise     remove any contours whose size ratio to the largest one is less than this
+   * @param gen_factor  generalization factor in meters
+   */
+  void CleanContour(std::list<feature_t>& collection,
+                    const bool rings_only,
+                    const float denoise,
+                    const float gen_factor) const {
+    auto& contour = collection.front();
     // some info about the area the image covers
-    auto c = this->TileBounds().Center();
     auto h = this->tilesize_ / 2;
-    // for each contour
-    for (auto& collection : contours) {
-      auto& contour = collection.front();
-      // they only wanted rings
-      if (rings_only) {
-        contour.remove_if([](const contour_t& line) { return line.front() != line.back(); });
-      }
-      // sort them by area (maybe length would be sufficient?) biggest first
-      std::unordered_map<const contour_t*, typename PointLL::first_type> cache(contour.size());
-      std::for_each(contour.cbegin(), contour.cend(),
-                    [&cache](const contour_t& c) { cache[&c] = polygon_area(c); });
-      contour.sort([&cache](const contour_t& a, const contour_t& b) {
-        return std::abs(cache[&a]) > std::abs(cache[&b]);
+    // they only wanted rings
+    if (rings_only) {
+      contour.remove_if([](const contour_t& line) { return line.front() != line.back(); });
+    }
+    // sort them by area (maybe length would be sufficient?) biggest first
+    std::unordered_map<const contour_t*, typename PointLL::first_type> cache(contour.size());
+    std::for_each(contour.cbegin(), contour.cend(),
+                  [&cache](const contour_t& c) { cache[&c] = polygon_area(c); });
+    contour.sort([&cache](const contour_t& a, const contour_t& b) {
+      return std::abs(cache[&a]) > std::abs(cache[&b]);
+    });
+
+    // they only want the most significant ones!
+    if (denoise > 0.f) {
+      contour.remove_if([&cache, &contour, denoise](const contour_t& c) {
+        return std::abs(cache[&c] / cache[&contour.front()]) < denoise;
       });
-
-      // they only want the most significant ones!
-      if (denoise > 0.f) {
-        contour.remove_if([&cache, &contour, denoise](const contour_t& c) {
-          return std::abs(cache[&c] / cache[&contour.front()]) < denoise;
-        });
+    }
+    // clean up the lines
+    for (auto& line : contour) {
+      if (gen_factor > 0.f) {
+        Polyline2<PointLL>::Generalize(line, gen_factor, {}, /* avoid_self_intersections */ true);
       }
-      // clean up the lines
-      for (auto& line : contour) {
-        if (gen_factor > 0.f) {
-          Polyline2<PointLL>::Generalize(line, gen_factor, {}, /* avoid_self_intersections */ true);
-        }
-        // sampling the bottom left corner means everything is skewed, so unskew it
-        for (auto& coord : line) {
-          coord.first += h;
-          coord.second += h;
-        }
+      // sampling the bottom left corner means everything is skewed, so unskew it
+      for (auto& coord : line) {
+        coord.first += h;
+        coord.second += h;
       }
-      // remove points and lines
-      contour.remove_if([](const contour_t& line) { return line.size() < 4; });
+    }
+    // remove points and lines
+    contour.remove_if([](const contour_t& line) { return line.size() < 4; });
 
-      // if they just wanted linestrings we need only one per feature
-      if (!rings_only) {
-        for (auto& linestring : contour) {
-          collection.push_back({std::move(linestring)});
-        }
-        collection.pop_front();
+    // if they just wanted linestrings we need only one per feature
+    if (!rings_only) {
+      for (auto& linestring : contour) {
+        collection.push_back({std::move(linestring)});
       }
+      collection.pop_front();
     }
-
-    return contours;
   }
 
-protected:
   value_type max_value_;         // Maximum value stored in the tile
   std::vector<value_type> data_; // Data value within each tile
 };
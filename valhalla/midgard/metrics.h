@@ -0,0 +1,102 @@
+#ifndef VALHALLA_MIDGARD_METRICS_H_
+#define VALHALLA_MIDGARD_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace valhalla {
+namespace midgard {
+
+// Process wide metrics rendered in the prometheus text format. Every thread registers its series
+// in a shard of its own so recording never waits on another thread, the shards are only summed up
+// when the metrics are rendered. When a thread finishes its counts are folded into the totals of
+// the finished threads and its shard goes away.
+namespace metrics {
+
+// name, value pairs that tell series of the same metric apart
+using labels_t = std::vector<std::pair<std::string, std::string>>;
+
+// A count that only goes up
+class Counter {
+public:
+  void add(const uint64_t value = 1) {
+    value_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  uint64_t value() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+protected:
+  std::atomic<uint64_t> value_{0};
+};
+
+// A distribution of durations in fixed buckets
+class Histogram {
+public:
+  // upper bounds of the buckets in seconds, one more bucket takes everything above the last
+  static constexpr size_t kBoundCount = 13;
+  static const std::array<double, kBoundCount> kBounds;
+
+  /**
+   * Record one duration.
+   * @param seconds  the duration in seconds
+   */
+  void observe(const double seconds);
+
+  /**
+   * @param bucket  the index of the bucket, kBoundCount for the one above the last bound
+   * @return how many durations fell into the bucket, not including the buckets below
+   */
+  uint64_t bucket(const size_t bucket) const {
+    return buckets_[bucket].load(std::memory_order_relaxed);
+  }
+
+  uint64_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  double sum() const {
+    return sum_micros_.load(std::memory_order_relaxed) * 1e-6;
+  }
+
+protected:
+  std::array<std::atomic<uint64_t>, kBoundCount + 1> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_micros_{0};
+};
+
+/**
+ * Get the series of a counter for the calling thread, registering it the first time. The returned
+ * reference stays valid until the thread finishes so hot paths can keep it in a thread_local.
+ * @param name    name of the metric, by convention ending in _total
+ * @param labels  labels of the series
+ * @return the counter
+ */
+Counter& counter(const std::string& name, const labels_t& labels = {});
+
+/**
+ * Get the series of a histogram for the calling thread, registering it the first time. The
+ * returned reference stays valid until the thread finishes so hot paths can keep it in a
+ * thread_local.
+ * @param name    name of the metric, by convention ending in the unit
+ * @param labels  labels of the series
+ * @return the histogram
+ */
+Histogram& histogram(const std::string& name, const labels_t& labels = {});
+
+/**
+ * Sum every series over all threads.
+ * @return the metrics in the prometheus text exposition format
+ */
+std::string render();
+
+} // namespace metrics
+} // namespace midgard
+} // namespace valhalla
+
+#endif // VALHALLA_MIDGARD_METRICS_H_
@@ -1,21 +1,25 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <list>
 #include <map>
 #include <memory>
-#include <queue>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -259,6 +263,85 @@ protected:
   std::string file_name;
 };
 
+// A tournament tree of losers used to merge k sorted runs. Popping the smallest element replays a
+// single leaf to root path comparing only against the losers stored along it, so each output
+// element costs log(k) comparisons. Ties are broken by run index to keep the merge deterministic.
+template <class T> class loser_tree {
+public:
+  using run_t = std::pair<const T*, const T*>;
+
+  loser_tree(std::vector<run_t> runs, const std::function<bool(const T&, const T&)>& predicate)
+      : runs(std::move(runs)), predicate(predicate), tree(this->runs.size(), none()) {
+    for (size_t i = 0; i < this->runs.size(); ++i) {
+      replay(i);
+    }
+  }
+
+  // whether or not all of the runs have been consumed
+  bool empty() const {
+    return runs.empty() || exhausted(tree[0]);
+  }
+
+  // the smallest element across all runs
+  const T& top() const {
+    return *runs[tree[0]].first;
+  }
+
+  // move past the smallest element
+  void pop() {
+    auto winner = tree[0];
+    ++runs[winner].first;
+    replay(winner);
+  }
+
+protected:
+  static constexpr size_t none() {
+    return std::numeric_limits<size_t>::max();
+  }
+
+  bool exhausted(size_t run) const {
+    return runs[run].first == runs[run].second;
+  }
+
+  // whether run a's current element should come before run b's
+  bool beats(size_t a, size_t b) const {
+    if (exhausted(a)) {
+      return false;
+    }
+    if (exhausted(b)) {
+      return true;
+    }
+    if (predicate(*runs[a].first, *runs[b].first)) {
+      return true;
+    }
+    if (predicate(*runs[b].first, *runs[a].first)) {
+      return false;
+    }
+    return a < b;
+  }
+
+  // play the run's current element up the tree leaving losers behind, the leaves are implicitly
+  // at [k, 2k) so the parent of leaf i is (i + k) / 2 and the overall winner ends up at 0
+  void replay(size_t run) {
+    auto winner = run;
+    for (auto node = (run + runs.size()) / 2; node > 0; node /= 2) {
+      // when building the tree the first element to reach a node just waits there
+      if (tree[node] == none()) {
+        tree[node] = winner;
+        return;
+      }
+      if (beats(tree[node], winner)) {
+        std::swap(tree[node], winner);
+      }
+    }
+    tree[0] = winner;
+  }
+
+  std::vector<run_t> runs;
+  const std::function<bool(const T&, const T&)>& predicate;
+  std::vector<size_t> tree;
+};
+
 template <class T> class sequence {
 public:
   // static_assert(std::is_pod<T>::value, "sequence requires POD types for now");
@@ -325,54 +408,55 @@ public:
     return npos;
   }
 
-  // sort the file based on the predicate, and outputs to output_seq
+  // sort the file based on the predicate
   //
-  // Strategy is to first sort sub-ranges of length buffer_size in place.
-  // These should all fit in memory. Then, merge the sub-ranges into the
-  // output sequence via priority queue.
+  // Strategy is to first sort sub-ranges of length buffer_size in place, up to threads of them at
+  // a time. These should all fit in memory. Then, merge the sub-ranges into a temporary sequence
+  // via a loser tree and swap it into place.
   void sort(const std::function<bool(const T&, const T&)>& predicate,
-            size_t buffer_size = 1024 * 1024 * 512 / sizeof(T)) {
+            size_t buffer_size = 1024 * 1024 * 512 / sizeof(T),
+            unsigned int threads = 1) {
     flush();
     // if no elements we are done
     if (memmap.size() == 0) {
       return;
     }
+    buffer_size = std::max(buffer_size, static_cast<size_t>(1));
+    threads = std::max(threads, 1u);
+    T* data = static_cast<T*>(memmap);
 
     // If there wont be any merging we may as well take the simple approach
-    if (buffer_size > memmap.size() + write_buffer.size()) {
-      std::sort(static_cast<T*>(memmap), static_cast<T*>(memmap) + memmap.size(), predicate);
+    if (buffer_size >= memmap.size()) {
+      sort_in_place(data, memmap.size(), predicate, threads);
       return;
     }
 
+    // Sort the subsections
+    std::vector<std::pair<T*, T*>> chunks;
+    for (size_t i = 0; i < memmap.size(); i += buffer_size) {
+      chunks.emplace_back(data + i, data + std::min(memmap.size(), i + buffer_size));
+    }
+    parallel_for(chunks.size(), threads, [&chunks, &predicate](size_t i) {
+      std::sort(chunks[i].first, chunks[i].second, predicate);
+    });
+
     auto tmp_path = filesystem::path(file_name).replace_filename(
         filesystem::path(file_name).filename().string() + ".tmp");
     {
-      // we need a temporary sequence to merge the sorted subsections into
-      sequence<T> output_seq(tmp_path.string(), true);
-
-      // Comparator needs to be inverted for pq to provide constant time *smallest* lookup
-      // Pq keeps track of element and its index.
-      auto cmp = [&predicate](const std::pair<T, int>& a, std::pair<T, int>& b) {
-        return predicate(b.first, a.first);
-      };
-      std::priority_queue<std::pair<T, int>, std::vector<std::pair<T, int>>, decltype(cmp)> pq(cmp);
-
-      // Sort the subsections
-      for (size_t i = 0; i < memmap.size(); i += buffer_size) {
-        std::sort(static_cast<T*>(memmap) + i,
-                  static_cast<T*>(memmap) + std::min(memmap.size(), i + buffer_size), predicate);
-        pq.emplace(*at(i), i);
-      }
+      // we need a temporary sequence to merge the sorted subsections into, we give it a large
+      // write buffer so the output goes to disk in big sequential writes. the buffer comes on top
+      // of the memory used for sorting and bigger writes stop paying off at some point, so cap it
+      constexpr size_t kMaxMergeBufferBytes = 1024 * 1024 * 64;
+      auto merge_buffer_size = std::min(buffer_size / 4, kMaxMergeBufferBytes / sizeof(T));
+      sequence<T> output_seq(tmp_path.string(), true,
+                             std::max(merge_buffer_size, write_buffer.capacity()));
 
       // Perform the merge
-      while (!pq.empty()) {
-        auto tmp = pq.top();
-        pq.pop();
-        output_seq.push_back(tmp.first);
-        size_t new_idx = tmp.second + 1;
-        if (new_idx % buffer_size != 0 && new_idx < memmap.size()) {
-          pq.emplace(*at(new_idx), new_idx);
-        }
+      std::vector<typename loser_tree<T>::run_t> runs(chunks.begin(), chunks.end());
+      loser_tree<T> tree(std::move(runs), predicate);
+      while (!tree.empty()) {
+        output_seq.push_back(tree.top());
+        tree.pop();
       }
       output_seq.flush();
     }
@@ -586,6 +670,77 @@ public:
   }
 
 protected:
+  // run work for each index in [0, count) spread over up to threads threads, the calling thread
+  // included. the first exception thrown by any of them is rethrown once they have all finished
+  static void
+  parallel_for(size_t count, unsigned int threads, const std::function<void(size_t)>& work) {
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_lock;
+    auto worker = [count, &work, &next, &error, &error_lock]() {
+      try {
+        for (size_t i = next++; i < count; i = next++) {
+          work(i);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_lock);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = count;
+      }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < std::min(count, static_cast<size_t>(threads)); ++i) {
+      pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+      thread.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // sort a range that fits in memory, with more than one thread we sort a piece per thread and
+  // then merge neighbouring pieces pairwise until there is only one left. both the sort and the
+  // merge are stable so equal elements end up in the same order whatever the number of threads
+  static void sort_in_place(T* data,
+                            size_t count,
+                            const std::function<bool(const T&, const T&)>& predicate,
+                            unsigned int threads) {
+    if (threads < 2 || count < threads * 1024) {
+      std::stable_sort(data, data + count, predicate);
+      return;
+    }
+
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i < threads; ++i) {
+      bounds.push_back(count * i / threads);
+    }
+    bounds.push_back(count);
+    parallel_for(threads, threads, [data, &bounds, &predicate](size_t i) {
+      std::stable_sort(data + bounds[i], data + bounds[i + 1], predicate);
+    });
+
+    while (bounds.size() > 2) {
+      parallel_for((bounds.size() - 1) / 2, threads, [data, &bounds, &predicate](size_t i) {
+        std::inplace_merge(data + bounds[i * 2], data + bounds[i * 2 + 1], data + bounds[i * 2 + 2],
+                           predicate);
+      });
+      std::vector<size_t> merged;
+      for (size_t i = 0; i < bounds.size(); i += 2) {
+        merged.push_back(bounds[i]);
+      }
+      if (merged.back() != count) {
+        merged.push_back(count);
+      }
+      bounds.swap(merged);
+    }
+  }
+
   std::shared_ptr<std::fstream> file;
   std::string file_name;
   std::vector<T> write_buffer;
@@ -657,7 +812,9 @@ struct tar {
     }
   };
 
-  tar(const std::string& tar_file, bool regular_files_only = true)
+  // when traverse_all is false only the first entry of the archive is read, which is enough to find
+  // an index of the archive stored at its front without touching the rest of it
+  tar(const std::string& tar_file, bool regular_files_only = true, bool traverse_all = true)
       : tar_file(tar_file), corrupt_blocks(0) {
     // get the file size
     struct stat s;
@@ -698,6 +855,9 @@ struct tar {
         contents.emplace(std::piecewise_construct, std::forward_as_tuple(name),
                          std::forward_as_tuple(position, size));
       }
+      if (!traverse_all) {
+        break;
+      }
       // every entry's data is rounded to the nearst header_t sized "block"
       auto blocks = static_cast<size_t>(std::ceil(static_cast<double>(size) / sizeof(header_t)));
       position += blocks * sizeof(header_t);
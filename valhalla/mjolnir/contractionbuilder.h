@@ -0,0 +1,27 @@
+#ifndef VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+#define VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build the contraction hierarchy overlay (see baldr::ContractionOverlay) of the
+ * graph for the default auto costing. The nodes of all levels are contracted one at a time in
+ * order of their importance, adding a shortcut arc between each pair of neighbours whose shortest
+ * path went through the contracted node. The result is written next to the tiles.
+ */
+class ContractionBuilder {
+public:
+  /**
+   * Build the contraction hierarchy overlay.
+   * @param pt  the valhalla config
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
@@ -0,0 +1,29 @@
+#ifndef VALHALLA_MJOLNIR_CONVERTTRANSIT_H
+#define VALHALLA_MJOLNIR_CONVERTTRANSIT_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <unordered_set>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to convert the fetched transit data into transit level graph tiles.
+ */
+class ConvertTransit {
+public:
+  /**
+   * Build the transit level graph tiles from the transit pbf tiles.
+   * @param pt   Property tree containing the hierarchy configuration. The pbf tiles are read
+   *             from mjolnir.transit_dir and the graph tiles are written to mjolnir.tile_dir.
+   * @return the tiles that had transit pbf data
+   */
+  static std::unordered_set<baldr::GraphId> Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_CONVERTTRANSIT_H
@@ -81,10 +81,21 @@ struct Callback {
 class Parser {
 public:
   Parser() = delete;
-  // parse the pbf file for the things you are interested in
-  static void parse(std::ifstream& file, const Interest interest, Callback& callback);
+  // parse the pbf file for the things you are interested in. when threads is more than 1 the
+  // blocks are inflated and decoded on that many threads but the callback is still only ever called
+  // from the calling thread and in exactly the same order as it would be when parsing serially
+  static void parse(std::ifstream& file,
+                    const Interest interest,
+                    Callback& callback,
+                    const unsigned int threads = 1);
   // clean up protobuf library level memory, this will make protobuf unusable after its called
   static void free();
+
+private:
+  static void parse_parallel(std::ifstream& file,
+                             const Interest interest,
+                             Callback& callback,
+                             const unsigned int threads);
 };
 
 } // namespace OSMPBF
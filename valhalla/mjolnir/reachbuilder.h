@@ -0,0 +1,27 @@
+#ifndef VALHALLA_MJOLNIR_REACHBUILDER_H
+#define VALHALLA_MJOLNIR_REACHBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build the reach tables (see baldr::ReachTable) of the graph for the default auto,
+ * bicycle and pedestrian costings. Every directed edge gets the inbound and outbound reach that
+ * loki would otherwise search for each time the edge is a candidate for a location, capped at the
+ * service limit on reachability. The tables are written next to the tiles.
+ */
+class ReachBuilder {
+public:
+  /**
+   * Build the reach tables.
+   * @param pt  the valhalla config
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_REACHBUILDER_H
@@ -67,7 +67,7 @@ struct StopEdges {
   std::vector<TransitLine> lines;    // Set of unique route/stop pairs
 };
 
-Transit read_pbf(const std::string& file_name, std::mutex& lock) {
+inline Transit read_pbf(const std::string& file_name, std::mutex& lock) {
   lock.lock();
   std::fstream file(file_name, std::ios::in | std::ios::binary);
   if (!file) {
@@ -88,7 +88,7 @@ Transit read_pbf(const std::string& file_name, std::mutex& lock) {
   return transit;
 }
 
-Transit read_pbf(const std::string& file_name) {
+inline Transit read_pbf(const std::string& file_name) {
   std::fstream file(file_name, std::ios::in | std::ios::binary);
   if (!file) {
     throw std::runtime_error("Couldn't load " + file_name);
@@ -107,7 +107,8 @@ Transit read_pbf(const std::string& file_name) {
 }
 
 // Get PBF transit data given a GraphId / tile
-Transit read_pbf(const GraphId& id, const std::string& transit_dir, std::string& file_name) {
+inline Transit
+read_pbf(const GraphId& id, const std::string& transit_dir, std::string& file_name) {
   std::string fname = GraphTile::FileSuffix(id);
   fname = fname.substr(0, fname.size() - 3) + "pbf";
   file_name = transit_dir + '/' + fname;
@@ -116,7 +117,7 @@ Transit read_pbf(const GraphId& id, const std::string& transit_dir, std::string&
   return transit;
 }
 
-void write_pbf(const Transit& tile, const filesystem::path& transit_tile) {
+inline void write_pbf(const Transit& tile, const filesystem::path& transit_tile) {
   // check for empty stop pairs and routes.
   if (tile.stop_pairs_size() == 0 && tile.routes_size() == 0 && tile.shapes_size() == 0) {
     LOG_WARN(transit_tile.string() + " had no data and will not be stored");
@@ -148,7 +149,7 @@ void write_pbf(const Transit& tile, const filesystem::path& transit_tile) {
 // Converts a stop's pbf graph Id to a Valhalla graph Id by adding the
 // tile's node count. Returns an Invalid GraphId if the tile is not found
 // in the list of Valhalla tiles
-GraphId GetGraphId(const GraphId& nodeid, const std::unordered_set<GraphId>& all_tiles) {
+inline GraphId GetGraphId(const GraphId& nodeid, const std::unordered_set<GraphId>& all_tiles) {
   auto t = all_tiles.find(nodeid.Tile_Base());
   if (t == all_tiles.end()) {
     return GraphId(); // Invalid graph Id
@@ -324,6 +324,90 @@ public:
                                      const bool has_measured_speed = false,
                                      const InternalTurn internal_turn = InternalTurn::kNoTurn) const;
 
+  /**
+   * Checks if access is allowed for an edge on the forward path and gets the cost of the
+   * transition onto it and of the edge itself. This is what a search asks of the costing for every
+   * edge it expands, the default makes the separate virtual calls while costing models deriving
+   * from DynamicCostKernel answer with a single virtual call into their own, inlined, methods.
+   * @param  edge           Pointer to a directed edge.
+   * @param  is_dest        Is a directed edge the destination?
+   * @param  pred           Predecessor edge information.
+   * @param  tile           Current tile.
+   * @param  edgeid         GraphId of the directed edge.
+   * @param  node           Node (intersection) where transition occurs.
+   * @param  current_time   Current time (seconds since epoch), 0 if not time dependent.
+   * @param  tz_index       timezone index for the node
+   * @param  seconds        Seconds of week for historical speed lookup
+   * @param  restriction_idx      Set to the index of a conditional restriction that applies
+   * @param  transition_cost      Set to the cost of the transition if access is allowed
+   * @param  edge_cost            Set to the cost of the edge if access is allowed
+   * @param  flow_sources         Set to the speed sources of the edge if access is allowed
+   * @return Returns true if access is allowed, false if not.
+   */
+  virtual bool AllowedEdgeCost(const baldr::DirectedEdge* edge,
+                               const bool is_dest,
+                               const EdgeLabel& pred,
+                               const graph_tile_ptr& tile,
+                               const baldr::GraphId& edgeid,
+                               const baldr::NodeInfo* node,
+                               const uint64_t current_time,
+                               const uint32_t tz_index,
+                               const uint32_t seconds,
+                               uint8_t& restriction_idx,
+                               Cost& transition_cost,
+                               Cost& edge_cost,
+                               uint8_t& flow_sources) const {
+    if (!Allowed(edge, is_dest, pred, tile, edgeid, current_time, tz_index, restriction_idx)) {
+      return false;
+    }
+    transition_cost = TransitionCost(edge, node, pred);
+    edge_cost = EdgeCost(edge, tile, seconds, flow_sources);
+    return true;
+  }
+
+  /**
+   * Checks if access is allowed for an edge on the reverse path and gets the cost of the
+   * transition onto it and of its opposing edge, see AllowedEdgeCost.
+   * @param  edge           Pointer to a directed edge.
+   * @param  pred           Predecessor edge information.
+   * @param  opp_edge       Pointer to the opposing directed edge.
+   * @param  opp_tile       Tile of the opposing edge.
+   * @param  opp_edgeid     GraphId of the opposing edge.
+   * @param  node           Node (intersection) where transition occurs.
+   * @param  opp_pred_edge  Pointer to the opposing directed edge to the predecessor.
+   * @param  current_time   Current time (seconds since epoch), 0 if not time dependent.
+   * @param  tz_index       timezone index for the node
+   * @param  seconds        Seconds of week for historical speed lookup
+   * @param  restriction_idx      Set to the index of a conditional restriction that applies
+   * @param  transition_cost      Set to the cost of the transition if access is allowed
+   * @param  edge_cost            Set to the cost of the opposing edge if access is allowed
+   * @param  flow_sources         Set to the speed sources of the edge if access is allowed
+   * @return Returns true if access is allowed, false if not.
+   */
+  virtual bool AllowedEdgeCostReverse(const baldr::DirectedEdge* edge,
+                                      const EdgeLabel& pred,
+                                      const baldr::DirectedEdge* opp_edge,
+                                      const graph_tile_ptr& opp_tile,
+                                      const baldr::GraphId& opp_edgeid,
+                                      const baldr::NodeInfo* node,
+                                      const baldr::DirectedEdge* opp_pred_edge,
+                                      const uint64_t current_time,
+                                      const uint32_t tz_index,
+                                      const uint32_t seconds,
+                                      uint8_t& restriction_idx,
+                                      Cost& transition_cost,
+                                      Cost& edge_cost,
+                                      uint8_t& flow_sources) const {
+    if (!AllowedReverse(edge, pred, opp_edge, opp_tile, opp_edgeid, current_time, tz_index,
+                        restriction_idx)) {
+      return false;
+    }
+    transition_cost = TransitionCostReverse(edge->localedgeidx(), node, opp_edge, opp_pred_edge,
+                                            pred.has_measured_speed(), pred.internal_turn());
+    edge_cost = EdgeCost(opp_edge, opp_tile, seconds, flow_sources);
+    return true;
+  }
+
   /**
    * Test if an edge should be restricted due to a complex restriction.
    * @param  edge  Directed edge.
@@ -1029,6 +1113,69 @@ protected:
   }
 };
 
+/**
+ * Base for costing models to derive from (instead of from DynamicCost or from the costing they
+ * extend) so that AllowedEdgeCost and AllowedEdgeCostReverse call their own Allowed,
+ * TransitionCost and EdgeCost methods directly. Those calls are bound at compile time and can be
+ * inlined, so a search pays for one virtual call per edge rather than one per method. A costing
+ * deriving from a costing model that uses the kernel and overriding any of those methods has to
+ * derive from the kernel again, otherwise the methods of its base are the ones that get called.
+ */
+template <class Costing, class Base = DynamicCost> class DynamicCostKernel : public Base {
+public:
+  using Base::Base;
+
+  virtual bool AllowedEdgeCost(const baldr::DirectedEdge* edge,
+                               const bool is_dest,
+                               const EdgeLabel& pred,
+                               const graph_tile_ptr& tile,
+                               const baldr::GraphId& edgeid,
+                               const baldr::NodeInfo* node,
+                               const uint64_t current_time,
+                               const uint32_t tz_index,
+                               const uint32_t seconds,
+                               uint8_t& restriction_idx,
+                               Cost& transition_cost,
+                               Cost& edge_cost,
+                               uint8_t& flow_sources) const override {
+    const auto* costing = static_cast<const Costing*>(this);
+    if (!costing->Costing::Allowed(edge, is_dest, pred, tile, edgeid, current_time, tz_index,
+                                   restriction_idx)) {
+      return false;
+    }
+    transition_cost = costing->Costing::TransitionCost(edge, node, pred);
+    edge_cost = costing->Costing::EdgeCost(edge, tile, seconds, flow_sources);
+    return true;
+  }
+
+  virtual bool AllowedEdgeCostReverse(const baldr::DirectedEdge* edge,
+                                      const EdgeLabel& pred,
+                                      const baldr::DirectedEdge* opp_edge,
+                                      const graph_tile_ptr& opp_tile,
+                                      const baldr::GraphId& opp_edgeid,
+                                      const baldr::NodeInfo* node,
+                                      const baldr::DirectedEdge* opp_pred_edge,
+                                      const uint64_t current_time,
+                                      const uint32_t tz_index,
+                                      const uint32_t seconds,
+                                      uint8_t& restriction_idx,
+                                      Cost& transition_cost,
+                                      Cost& edge_cost,
+                                      uint8_t& flow_sources) const override {
+    const auto* costing = static_cast<const Costing*>(this);
+    if (!costing->Costing::AllowedReverse(edge, pred, opp_edge, opp_tile, opp_edgeid, current_time,
+                                          tz_index, restriction_idx)) {
+      return false;
+    }
+    transition_cost =
+        costing->Costing::TransitionCostReverse(edge->localedgeidx(), node, opp_edge,
+                                                opp_pred_edge, pred.has_measured_speed(),
+                                                pred.internal_turn());
+    edge_cost = costing->Costing::EdgeCost(opp_edge, opp_tile, seconds, flow_sources);
+    return true;
+  }
+};
+
 using cost_ptr_t = std::shared_ptr<DynamicCost>;
 using mode_costing_t = std::array<cost_ptr_t, static_cast<size_t>(TravelMode::kMaxTravelMode)>;
 
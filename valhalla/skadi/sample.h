@@ -13,20 +13,25 @@
 namespace valhalla {
 namespace skadi {
 
+// how many decompressed tiles are kept in memory by default, each one is about 25MB
+constexpr size_t kDefaultUnzippedCacheSize = 4;
+
 class sample {
 public:
   // non-default-constructable and non-copyable
   sample() = delete;
-  sample(sample&&) = default;
-  sample& operator=(sample&&) = default;
+  sample(sample&&);
+  sample& operator=(sample&&);
   sample(const sample&) = delete;
   sample& operator=(const sample&) = delete;
 
   /**
    * Constructor
-   * @param data_source  directory name of the datasource from which to sample
+   * @param data_source   directory name of the datasource from which to sample
+   * @param cache_size    how many decompressed (gzipped) tiles to keep in memory
    */
-  sample(const std::string& data_source);
+  sample(const std::string& data_source, size_t cache_size = kDefaultUnzippedCacheSize);
+  ~sample();
 
   /**
    * Get a single sample from the datasource
@@ -35,7 +40,8 @@ public:
   template <class coord_t> double get(const coord_t& coord) const;
 
   /**
-   * Get multiple samples from the datasource
+   * Get multiple samples from the datasource. The postings are grouped by tile
+   * so that each tile is looked up (and decompressed) at most once per call.
    * @param coords  the list of postings at which to sample the datasource
    */
   template <class coords_t> std::vector<double> get_all(const coords_t& coords) const;
@@ -58,9 +64,10 @@ protected:
 
   /**
    * @param  index  the index of the data tile being requested
-   * @return the array of data or nullptr if there was none
+   * @return the array of data or nullptr if there was none, the array stays valid for as
+   *         long as the returned pointer is held even if the tile is evicted from the cache
    */
-  const int16_t* source(uint16_t index) const;
+  std::shared_ptr<const int16_t> source(uint16_t index) const;
 
   enum class format_t { UNKNOWN = 0, GZIP = 1, RAW = 3 };
   /**
@@ -76,9 +83,10 @@ protected:
   // using memory maps
   mutable std::vector<std::pair<format_t, midgard::mem_map<char>>> mapped_cache;
 
-  // TODO: make an LRU
-  using unzipped_t = std::pair<int16_t, std::vector<int16_t>>;
-  mutable unzipped_t unzipped_cache;
+  // LRU of decompressed tiles, its lock also guards lazily mapping tiles so that a sample can
+  // be shared by many threads
+  struct unzipped_cache_t;
+  std::unique_ptr<unzipped_cache_t> unzipped_cache;
 
   std::string data_source;
 };
@@ -104,6 +104,9 @@ protected:
   EdgeStatus pedestrian_edgestatus_;
   EdgeStatus bicycle_edgestatus_;
 
+  // Tally of the settled edges for the metrics
+  SearchMetrics search_metrics_;
+
   // Destinations, id and cost
   std::map<uint64_t, sif::Cost> destinations_;
 
@@ -119,6 +119,9 @@ protected:
   EdgeStatus edgestatus_forward_;
   EdgeStatus edgestatus_reverse_;
 
+  // Tally of the settled edges for the metrics
+  SearchMetrics search_metrics_;
+
   // Best candidate connection and threshold to extend search.
   float cost_threshold_;
   uint32_t iterations_threshold_;
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/contraction.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/pathinfo.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Shortest path query on the contraction hierarchy overlay built by mjolnir::ContractionBuilder.
+ * A forward search from the origin and a reverse search from the destination only ever move up in
+ * rank and meet at the most important vertex of the path, so they settle a tiny fraction of what
+ * A* does. The shortcuts of the path are unpacked to their edges, which are then replayed through
+ * the costing to get the elapsed cost and to check the restrictions the overlay does not model.
+ *
+ * The overlay is only valid for the costing it was built for (the default auto costing) and it
+ * knows nothing of turn costs, restrictions or closures. If the path it finds is not allowed by the
+ * costing an empty result is returned so the caller can fall back to A*.
+ */
+class ContractionHierarchy : public PathAlgorithm {
+public:
+  /**
+   * Constructor.
+   * @param overlay  the contraction hierarchy overlay of the graph
+   */
+  explicit ContractionHierarchy(std::shared_ptr<const baldr::ContractionOverlay> overlay);
+
+  /**
+   * Destructor
+   */
+  virtual ~ContractionHierarchy() {
+  }
+
+  /**
+   * Form path between and origin and destination location using the supplied
+   * costing method.
+   * @param  origin       Origin location
+   * @param  dest         Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing Costing methods.
+   * @param  mode         Travel mode to use.
+   * @return Returns the path edges (and elapsed time/modes at end of each edge) or nothing if
+   *         the overlay found no path that the costing allows.
+   */
+  virtual std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Returns the name of the algorithm
+   * @return the name of the algorithm
+   */
+  virtual const char* name() const override {
+    return "contraction_hierarchy";
+  }
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  virtual void Clear() override;
+
+protected:
+  // The best known way to reach a vertex in one direction of the search
+  struct label_t {
+    float cost;
+    uint32_t parent;                  // the vertex we came from
+    const baldr::ContractionArc* arc; // the arc we came along, nullptr at a seed
+    int seed;                         // index of the location's edge the search started on
+  };
+  using labels_t = std::unordered_map<uint32_t, label_t>;
+  using queue_entry_t = std::pair<float, uint32_t>;
+  using queue_t =
+      std::priority_queue<queue_entry_t, std::vector<queue_entry_t>, std::greater<queue_entry_t>>;
+
+  /**
+   * Add the vertex at one end of a location's edge to one direction of the search.
+   * @param  vertex  the vertex
+   * @param  cost    cost of going between the location and the vertex
+   * @param  seed    index of the location's edge
+   * @param  labels  labels of the search direction
+   * @param  queue   queue of the search direction
+   */
+  void
+  Seed(const uint32_t vertex, const float cost, const int seed, labels_t& labels, queue_t& queue);
+
+  /**
+   * Unpack an arc to the directed edges it is made of.
+   * @param  from   the vertex the arc leaves
+   * @param  to     the vertex the arc enters
+   * @param  arc    the arc
+   * @param  edges  where to add the edges
+   * @return false if the arcs of a shortcut could not be found
+   */
+  bool Unpack(const uint32_t from,
+              const uint32_t to,
+              const baldr::ContractionArc& arc,
+              std::vector<baldr::GraphId>& edges) const;
+
+  /**
+   * Walk the edges of a path with the costing to form the path infos.
+   * @param  origin       the origin location
+   * @param  dest         the destination location
+   * @param  edges        the edges from the origin's edge to the destination's edge
+   * @param  graphreader  the graph reader
+   * @return the path or nothing if the costing does not allow it
+   */
+  std::vector<PathInfo> FormPath(const valhalla::Location::PathEdge& origin,
+                                 const valhalla::Location::PathEdge& dest,
+                                 const std::vector<baldr::GraphId>& edges,
+                                 baldr::GraphReader& graphreader);
+
+  std::shared_ptr<const baldr::ContractionOverlay> overlay_;
+  sif::TravelMode mode_;
+  std::shared_ptr<sif::DynamicCost> costing_;
+
+  labels_t forward_labels_;
+  labels_t backward_labels_;
+  queue_t forward_queue_;
+  queue_t backward_queue_;
+  std::vector<sif::EdgeLabel> edgelabels_;
+};
+
+} // namespace thor
+} // namespace valhalla
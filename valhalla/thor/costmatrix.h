@@ -2,12 +2,15 @@
 #define VALHALLA_THOR_COSTMATRIX_H_
 
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
 #include <utility>
 #include <vector>
 
+#include <boost/property_tree/ptree.hpp>
+
 #include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
@@ -15,6 +18,7 @@
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/pathalgorithm.h>
 
 namespace valhalla {
 namespace thor {
@@ -88,10 +92,12 @@ struct BestCandidate {
 class CostMatrix {
 public:
   /**
-   * Default constructor. Most internal values are set when a query is made so
-   * the constructor mainly just sets some internals to a default empty value.
+   * Constructor. Most internal values are set when a query is made so the
+   * constructor mainly just sets some internals to a default empty value.
+   * @param  config  Thor configuration, costmatrix_threads sets how many threads
+   *                 expand the source and target searches (defaults to 1).
    */
-  CostMatrix();
+  explicit CostMatrix(const boost::property_tree::ptree& config = {});
   ~CostMatrix();
 
   /**
@@ -156,9 +162,24 @@ protected:
   std::vector<std::vector<sif::BDEdgeLabel>> target_edgelabel_;
   std::vector<EdgeStatus> target_edgestatus_;
 
+  // Number of edge statuses each location keeps for reuse after clearing
+  uint32_t max_reserved_edge_status_count_;
+
+  // Tally of the settled edges for the metrics
+  SearchMetrics search_metrics_;
+
   // List of best connections found so far
   std::vector<BestCandidate> best_connection_;
 
+  // Status updates to the opposite side found by each location during the current phase of the
+  // search (index of the opposite location and its new threshold). These are applied in location
+  // order once all locations have been expanded so results do not depend on thread scheduling
+  std::vector<std::vector<std::pair<uint32_t, int>>> source_status_updates_;
+  std::vector<std::vector<std::pair<uint32_t, int>>> target_status_updates_;
+
+  // Edges reached by each target during the current phase of the backward search
+  std::vector<std::vector<baldr::GraphId>> target_reached_edges_;
+
   /**
    * Get the cost threshold based on the current mode and the max arc-length distance
    * for that mode.
@@ -193,11 +214,31 @@ protected:
   void CheckForwardConnections(const uint32_t source, const sif::BDEdgeLabel& pred, const uint32_t n);
 
   /**
-   * Update status when a connection is found.
-   * @param  source  Source index
-   * @param  target  Target index
+   * Update status when a connection is found. The status of the location being
+   * expanded is updated immediately, the update to the opposite location is
+   * deferred until the end of the current phase.
+   * @param  source   Source index
+   * @param  target   Target index
+   * @param  forward  True if found by the forward search from the source.
    */
-  void UpdateStatus(const uint32_t source, const uint32_t target);
+  void UpdateStatus(const uint32_t source, const uint32_t target, const bool forward);
+
+  /**
+   * Run the search for each of the locations, in parallel if more than one
+   * thread is configured.
+   * @param  locations  Indexes of the locations to expand.
+   * @param  search     Expands the location with the given index.
+   */
+  void Expand(const std::vector<uint32_t>& locations, const std::function<void(uint32_t)>& search);
+
+  /**
+   * Get a graph tile. Serializes access to the graph reader when the searches
+   * are run on multiple threads.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  id           Graph id within the tile.
+   * @return Returns the tile or nullptr if not found.
+   */
+  graph_tile_ptr GetGraphTile(baldr::GraphReader& graphreader, const baldr::GraphId& id);
 
   /**
    * Iterate the backward search from the target/destination location.
@@ -250,9 +291,13 @@ protected:
 
 private:
   class TargetMap;
+  class ThreadPool;
 
   // Mark each target edge with a list of target indexes that have reached it
   std::unique_ptr<TargetMap> targets_;
+
+  // Threads used to expand the searches, null when running single threaded
+  std::unique_ptr<ThreadPool> pool_;
 };
 
 } // namespace thor
@@ -1,6 +1,12 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
 
@@ -42,43 +48,56 @@ struct EdgeStatusInfo {
   }
 };
 
+// Default number of edge statuses (summed over all tiles) that are kept after clearing so that the
+// next search can reuse the memory rather than allocating it all over again. The path algorithms
+// read it from the max_reserved_edge_status_count key of the thor config
+constexpr size_t kDefaultReservedEdgeStatusCount = 4 * 1024 * 1024;
+
 /**
  * Class to define / lookup the status and index of an edge in the edge label
  * list during shortest path algorithms. This method stores status info for
  * edges within arrays for each tile. This allows the path algorithms to get
  * a pointer to the first edge status and iterate that pointer over sequential
- * edges. This reduces the number of map lookups.
+ * edges. This reduces the number of lookups by tile.
+ *
+ * The per tile arrays are pooled. Clearing only bumps a generation counter and
+ * an array is lazily reset the first time its tile is touched in the new
+ * generation, so repeated searches neither allocate nor free unless they go
+ * beyond the reserved count. Tiles are found through a flat open addressed
+ * slot table and the most recently used slot is remembered, since consecutive
+ * lookups are almost always for the same tile.
  */
 class EdgeStatus {
 public:
   /**
-   * Default constructor.
+   * Constructor.
+   * @param  max_reserved_count  Number of edge statuses that may be kept for reuse after clearing.
    */
-  EdgeStatus() = default;
+  explicit EdgeStatus(const size_t max_reserved_count = kDefaultReservedEdgeStatusCount)
+      : max_reserved_count_(max_reserved_count) {
+  }
 
-  // in order no to delete objects twice in destructor we should explicitly
-  // forbid copying
   EdgeStatus(const EdgeStatus&) = delete;
   EdgeStatus& operator=(const EdgeStatus&) = delete;
   EdgeStatus(EdgeStatus&&) = default;
   EdgeStatus& operator=(EdgeStatus&&) = default;
 
   /**
-   * Destructor. Delete any allocated EdgeStatusInfo arrays.
-   */
-  ~EdgeStatus() {
-    clear();
-  }
-
-  /**
-   * Clear the EdgeStatusInfo arrays and the edge status map.
+   * Clear the status of all edges. This is O(1) unless more than the
+   * reserved count of edge statuses was used, in which case the pool is
+   * trimmed back to the reserved count.
    */
   void clear() {
-    // Delete any allocated arrays for tiles within the map.
-    for (auto& iter : edgestatus_) {
-      delete[] iter.second;
+    if (reserved_count_ > max_reserved_count_) {
+      trim();
+    }
+    // on wrap around we must make sure that no tile looks like it was set in the new generation
+    if (++generation_ == 0) {
+      for (auto& tile : tiles_) {
+        tile.generation = 0;
+      }
+      generation_ = 1;
     }
-    edgestatus_.clear();
   }
 
   /**
@@ -95,17 +114,7 @@ public:
            const uint32_t index,
            const graph_tile_ptr& tile,
            const uint8_t path_id = 0) {
-    assert(path_id <= baldr::kMaxMultiPathId);
-    auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()] = {set, index};
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      inserted.first->second[edgeid.id()] = {set, index};
-    }
+    *GetPtr(edgeid, tile, path_id) = {set, index};
   }
 
   /**
@@ -118,12 +127,11 @@ public:
    */
   void Update(const baldr::GraphId& edgeid, const EdgeSet set, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()].set_ = static_cast<uint32_t>(set);
-    } else {
+    auto slot = find(edgeid.tile_value() | SHIFT_path_id(path_id));
+    if (slot == kInvalidSlot || tiles_[slot].generation != generation_) {
       throw std::runtime_error("EdgeStatus Update on edge not previously set");
     }
+    tiles_[slot].statuses[edgeid.id()].set_ = static_cast<uint32_t>(set);
   }
 
   /**
@@ -135,8 +143,17 @@ public:
    */
   EdgeStatusInfo Get(const baldr::GraphId& edgeid, const uint8_t path_id = 0) const {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second[edgeid.id()];
+    auto slot = find(edgeid.tile_value() | SHIFT_path_id(path_id));
+    return (slot == kInvalidSlot || tiles_[slot].generation != generation_)
+               ? EdgeStatusInfo()
+               : tiles_[slot].statuses[edgeid.id()];
+  }
+
+  /**
+   * @return the number of edge statuses that may be kept for reuse after clearing
+   */
+  size_t max_reserved_count() const {
+    return max_reserved_count_;
   }
 
   /**
@@ -152,23 +169,143 @@ public:
   EdgeStatusInfo*
   GetPtr(const baldr::GraphId& edgeid, const graph_tile_ptr& tile, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      return &p->second[edgeid.id()];
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      return &(inserted.first->second)[edgeid.id()];
+    const uint32_t key = edgeid.tile_value() | SHIFT_path_id(path_id);
+    auto slot = find(key);
+    if (slot == kInvalidSlot) {
+      slot = insert(key);
     }
+    last_key_ = key;
+    last_slot_ = slot;
+
+    // First time this tile is touched since the last clear, (re)size and reset its statuses.
+    // The array is sized to the number of directed edges in the specified tile.
+    auto& status = tiles_[slot];
+    if (status.generation != generation_) {
+      const uint32_t count = tile->header()->directededgecount();
+      if (count > status.capacity) {
+        reserved_count_ += count - status.capacity;
+        status.statuses.reset(new EdgeStatusInfo[count]);
+        status.capacity = count;
+      } else {
+        std::fill_n(status.statuses.get(), count, EdgeStatusInfo());
+      }
+      status.generation = generation_;
+    }
+    return &status.statuses[edgeid.id()];
   }
 
 private:
-  // Edge status - keys are the tile Ids (level and tile Id) and the
-  // values are dynamically allocated arrays of EdgeStatusInfo (sized
-  // based on the directed edge count within the tile).
-  std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+  static constexpr uint32_t kInvalidSlot = std::numeric_limits<uint32_t>::max();
+
+  // The statuses for the edges of one tile (and path id)
+  struct tile_status_t {
+    uint32_t generation = 0; // generation the statuses were last reset in
+    uint32_t capacity = 0;   // how many statuses are allocated
+    std::unique_ptr<EdgeStatusInfo[]> statuses;
+  };
+
+  // Maps a tile key to the slot of its statuses in tiles_
+  struct slot_t {
+    uint32_t key;
+    uint32_t slot;
+  };
+
+  // spread the bits of the key (level, tile id and path id) over the table. The high bits of a
+  // multiplicative hash depend on all bits of the key, the low ones only on the key's low bits
+  size_t bucket(const uint32_t key) const {
+    return static_cast<uint32_t>(key * 2654435769u) >> bucket_shift_;
+  }
+
+  // find the slot for the given tile key or kInvalidSlot if it has never been seen
+  uint32_t find(const uint32_t key) const {
+    if (last_slot_ != kInvalidSlot && last_key_ == key) {
+      return last_slot_;
+    }
+    if (slots_.empty()) {
+      return kInvalidSlot;
+    }
+    for (auto i = bucket(key);; i = (i + 1) & (slots_.size() - 1)) {
+      if (slots_[i].slot == kInvalidSlot) {
+        return kInvalidSlot;
+      }
+      if (slots_[i].key == key) {
+        return slots_[i].slot;
+      }
+    }
+  }
+
+  // put a slot into the first free place of its probe sequence
+  void place(const slot_t& s) {
+    auto i = bucket(s.key);
+    while (slots_[i].slot != kInvalidSlot) {
+      i = (i + 1) & (slots_.size() - 1);
+    }
+    slots_[i] = s;
+  }
+
+  // rebuild the slot table with room for at least the given number of tiles, keeping only the
+  // slots of the tiles below that number
+  void rehash(const size_t count) {
+    size_t size = 64;
+    uint32_t bits = 6;
+    while (count * 2 > size) {
+      size *= 2;
+      ++bits;
+    }
+    bucket_shift_ = 32 - bits;
+    std::vector<slot_t> slots(size, {0, kInvalidSlot});
+    slots_.swap(slots);
+    for (const auto& s : slots) {
+      if (s.slot != kInvalidSlot && s.slot < count) {
+        place(s);
+      }
+    }
+  }
+
+  // add a new tile key and return its slot
+  uint32_t insert(const uint32_t key) {
+    // keep the table at most half full so probe sequences stay short
+    if ((tiles_.size() + 1) * 2 > slots_.size()) {
+      rehash(std::max(slots_.size(), tiles_.size() + 1));
+    }
+    const slot_t s{key, static_cast<uint32_t>(tiles_.size())};
+    place(s);
+    tiles_.emplace_back();
+    return s.slot;
+  }
+
+  // release the statuses of the tiles beyond the reserved count. The tiles seen first are kept
+  // since the next search usually starts out in the same area as the last one
+  void trim() {
+    size_t kept = 0;
+    reserved_count_ = 0;
+    while (kept < tiles_.size() && reserved_count_ + tiles_[kept].capacity <= max_reserved_count_) {
+      reserved_count_ += tiles_[kept++].capacity;
+    }
+    tiles_.resize(kept);
+    last_slot_ = kInvalidSlot;
+    if (kept == 0) {
+      slots_.clear();
+    } else {
+      rehash(kept);
+    }
+  }
+
+  // Pooled statuses, one entry per tile (and path id) ever seen since memory was last released
+  std::vector<tile_status_t> tiles_;
+  // Open addressed table from tile key to the slot in tiles_, a power of 2 in size
+  std::vector<slot_t> slots_;
+  // 32 minus the log2 of the size of slots_, shifts the top bits of a hash down to a bucket
+  uint32_t bucket_shift_ = 32;
+  // Memo of the tile key and slot most recently expanded through GetPtr. Only written by the
+  // non-const methods so that concurrent readers of a settled search (Get) do not race
+  uint32_t last_key_ = 0;
+  uint32_t last_slot_ = kInvalidSlot;
+  // Generation of the current search, statuses stamped with any other generation are unreached
+  uint32_t generation_ = 1;
+  // How many statuses are allocated across all tiles and how many we keep when clearing
+  size_t reserved_count_ = 0;
+  size_t max_reserved_count_;
 };
 
 } // namespace thor
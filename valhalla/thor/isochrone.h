@@ -60,6 +60,13 @@ public:
                                                         const sif::mode_costing_t& costings,
                                                         const sif::TravelMode mode);
 
+  /**
+   * @return the number of threads the grid is marked and contoured on
+   */
+  uint32_t threads() const {
+    return threads_;
+  }
+
 protected:
   // when we expand up to a node we color the cells of the grid that the edge that ends at the
   // node touches
@@ -83,6 +90,16 @@ protected:
   float max_meters_;
   std::shared_ptr<midgard::GriddedData<2>> isotile_;
 
+  // A segment of a settled edge waiting to be marked in the isotile
+  struct iso_segment_t {
+    midgard::PointLL from;
+    midgard::PointLL to;
+    float minutes;
+    float km;
+  };
+  std::vector<iso_segment_t> segments_;
+  uint32_t threads_;
+
   /**
    * Constructs the isotile - 2-D gridded data containing the time
    * to get to each lat,lng tile.
@@ -108,7 +125,7 @@ protected:
                      const float dist0);
 
   /**
-   * Updates the isotile along short segment
+   * Queues a short segment to be marked in the isotile, the queue is marked in batches
    * @param from Segment begin
    * @param to Segment end
    * @param seconds Time contour level in seconds
@@ -118,6 +135,19 @@ protected:
                                  const midgard::PointLL& to,
                                  float seconds,
                                  float meters);
+
+  /**
+   * Marks the queued segments in the isotile and clears the queue. The rows of the isotile are
+   * split into one band per thread so that no two threads ever mark the same cell.
+   */
+  void MarkSegments();
+
+  /**
+   * Marks the cells of the queued segments that lie within a band of rows of the isotile.
+   * @param begin_row  First row of the band
+   * @param end_row    One past the last row of the band
+   */
+  void MarkSegments(const int32_t begin_row, const int32_t end_row);
 };
 
 } // namespace thor
@@ -109,6 +109,9 @@ protected:
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
 
+  // Tally of the settled edges for the metrics
+  SearchMetrics search_metrics_;
+
   // Destinations, id and cost
   std::map<uint64_t, sif::Cost> destinations_;
 
@@ -2,10 +2,13 @@
 #define VALHALLA_THOR_OPTIMIZER_H_
 
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <random>
 #include <vector>
 
+#include <boost/property_tree/ptree.hpp>
+
 namespace valhalla {
 namespace thor {
 
@@ -34,10 +37,22 @@ struct TourAlteration {
 /**
  * Optimization method using simulated annealing. Optimizes the order of
  * locations - keeping the first location (origin) and last location
- * (destination) fixed.
+ * (destination) fixed. The best tour of each annealing run is then improved
+ * with 2-opt and Or-opt moves until neither finds a better tour. With more
+ * than one thread every thread anneals from a random tour of its own and the
+ * best tour of all of them wins. With a time budget the threads keep starting
+ * over from new random tours until the budget is spent.
  */
 class Optimizer {
 public:
+  /**
+   * Constructor.
+   * @param  config  Thor configuration, optimizer_threads sets how many
+   *                 annealing runs are done at once and optimizer_time_budget
+   *                 how many seconds to spend on a tour (0 for no limit)
+   */
+  explicit Optimizer(const boost::property_tree::ptree& config = {});
+
   /**
    * Optimize the tour through a set of locations given the cost matrix
    * among all locations. The first location (origin) and last location
@@ -50,16 +65,21 @@ public:
   std::vector<uint32_t> Solve(const uint32_t count, const std::vector<float>& costs);
 
   /**
-   * Seed the random number generator. This is used by tests to create a
-   * repeatable sequence.
+   * Seed the random number generator. Every call to Solve starts from this
+   * seed so the same locations always get the same tour.
    * @param  seed  Seed to use for the random number generator.
    */
   void Seed(const uint32_t seed) {
+    seed_ = seed;
     random_generator_.seed(seed);
   }
 
 protected:
+  uint32_t threads_;  // # of annealing runs done at once
+  float time_budget_; // seconds to spend on a tour, 0 for no limit
+
   // Random number generation: 0 <= r < 1
+  std::mt19937_64::result_type seed_ = std::mt19937_64::default_seed;
   std::mt19937_64 random_generator_;
   std::uniform_real_distribution<float> uniform_distribution_{0.0, 1.0};
 
@@ -71,6 +91,45 @@ protected:
   std::vector<uint32_t> tour_;      // Current tour (order of locations)
   std::vector<uint32_t> best_tour_; // Best tour so far
 
+  /**
+   * Anneal from a random tour and improve the best tour found with local
+   * search. The best tour and its cost are kept if better than the ones of
+   * previous runs.
+   * @param  costs     2-D cost matrix.
+   * @param  deadline  When to stop annealing.
+   */
+  void Run(const std::vector<float>& costs, const std::chrono::steady_clock::time_point& deadline);
+
+  /**
+   * Improve the tour with 2-opt and Or-opt moves until neither finds a
+   * better tour or the deadline passes.
+   * @param  costs     2-D cost matrix.
+   * @param  tour      Order of locations, updated in place.
+   * @param  deadline  When to stop looking for improvements.
+   */
+  void LocalSearch(const std::vector<float>& costs,
+                   std::vector<uint32_t>& tour,
+                   const std::chrono::steady_clock::time_point& deadline) const;
+
+  /**
+   * Reverse each part of the tour whose reversal lowers the tour cost. As the
+   * costs need not be symmetric the cost of the reversed part is taken into
+   * account as well.
+   * @param  costs  2-D cost matrix.
+   * @param  tour   Order of locations, updated in place.
+   * @return Returns true if the tour was improved.
+   */
+  bool TwoOpt(const std::vector<float>& costs, std::vector<uint32_t>& tour) const;
+
+  /**
+   * Move each run of 1 to 3 locations to wherever in the tour lowers the tour
+   * cost, keeping the order of the run.
+   * @param  costs  2-D cost matrix.
+   * @param  tour   Order of locations, updated in place.
+   * @return Returns true if the tour was improved.
+   */
+  bool OrOpt(const std::vector<float>& costs, std::vector<uint32_t>& tour) const;
+
   /*
    * Perform the annealing process.
    * @param  costs        2-D cost matrix.
@@ -9,6 +9,7 @@
 
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/midgard/metrics.h>
 #include <valhalla/proto/api.pb.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
@@ -23,6 +24,36 @@ constexpr size_t kInterruptIterationsInterval = 5000;
 
 enum class ExpansionType { forward = 0, reverse = 1, multimodal = 2 };
 
+/**
+ * Tallies the edges a search settles in a plain member so the expansion loop never touches an
+ * atomic, the tally is handed to the process metrics once the algorithm is cleared.
+ */
+class SearchMetrics {
+public:
+  void Settle() {
+    ++edges_settled_;
+  }
+
+  /**
+   * Add the edges settled since the last call and the labels of the search to the metrics.
+   * @param algorithm  name of the algorithm
+   * @param labels     how many edge labels the search allocated
+   */
+  void Record(const char* algorithm, const size_t labels) {
+    if (edges_settled_ == 0 && labels == 0) {
+      return;
+    }
+    const midgard::metrics::labels_t metric_labels{{"algorithm", algorithm}};
+    midgard::metrics::counter("valhalla_search_edges_settled_total", metric_labels)
+        .add(edges_settled_);
+    midgard::metrics::counter("valhalla_search_labels_total", metric_labels).add(labels);
+    edges_settled_ = 0;
+  }
+
+protected:
+  uint64_t edges_settled_ = 0;
+};
+
 /**
  * Pure virtual class defining the interface for PathAlgorithm - the algorithm
  * to create shortest path.
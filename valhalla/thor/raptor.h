@@ -0,0 +1,271 @@
+#ifndef VALHALLA_THOR_RAPTOR_H_
+#define VALHALLA_THOR_RAPTOR_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/time_info.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/transittimetable.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Round based (RAPTOR) multi-modal pathfinding algorithm for walking and transit. Rather than
+ * expanding the transit graph edge by edge, every round scans the routes of a flat timetable that
+ * is built from the transit tiles once per service day and kept between requests. Round k finds
+ * the earliest arrival at every stop with k transit legs, footpaths between the stops, the walk
+ * from the origin and the walk to the destination are searched with the pedestrian costing.
+ *
+ * With a departure window the search is run for every departure from the stops around the origin
+ * within the window, latest first, reusing the arrivals of the later runs (rRAPTOR). Each run that
+ * arrives earlier than all the later ones adds a journey, the journey arriving first is the best
+ * path and the ones that leave later are returned as alternates.
+ */
+class RaptorPathAlgorithm : public PathAlgorithm {
+public:
+  /**
+   * Constructor.
+   * @param config A config object of key, value pairs
+   */
+  explicit RaptorPathAlgorithm(const boost::property_tree::ptree& config = {});
+
+  /**
+   * Form multi-modal paths between an origin and destination location using the supplied
+   * costing methods.
+   * @param  origin  Origin location
+   * @param  dest    Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode     Travel mode from the origin.
+   * @param  options  The request options, its alternates limit how many journeys are returned
+   * @return  Returns the path edges (and elapsed time/modes at end of each edge) of the journey
+   *          arriving first followed by any journeys leaving later within the departure window.
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Returns the name of the algorithm
+   * @return the name of the algorithm
+   */
+  virtual const char* name() const override {
+    return "Raptor";
+  }
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override;
+
+protected:
+  // How a stop was reached in a round
+  enum class Reached : uint8_t { kNot, kAccess, kRide, kTransfer };
+
+  // The earliest arrival at a stop within a round and how it got there
+  struct StopLabel {
+    uint32_t arrival; // seconds from midnight
+    Reached reached;
+    uint32_t route;   // the route ridden to the stop
+    uint32_t trip;    // the trip ridden to the stop
+    uint32_t from;    // position the trip was boarded at or the stop a transfer started at
+    uint32_t alight;  // position the trip was left at
+  };
+
+  // A journey found by one run, from the stop it walks to the destination from back to the origin
+  struct Journey {
+    uint32_t departure;
+    uint32_t arrival;
+    std::vector<std::pair<uint32_t, StopLabel>> legs;
+  };
+
+  uint32_t departure_window_;
+  uint32_t max_transfer_distance_;
+  uint32_t start_time_;
+  uint32_t access_slack_;   // time to board after walking from the origin
+  uint32_t transfer_slack_; // time to board after walking from another stop
+  uint32_t max_reserved_labels_count_;
+
+  // The timetable and what it was built for, kept between requests
+  std::shared_ptr<const TransitTimetable> timetable_;
+  std::vector<baldr::GraphId> timetable_tiles_;
+  uint64_t timetable_key_;
+  uint64_t timetable_generation_;
+
+  // Per request state of the rounds
+  std::vector<StopLabel> labels_; // round major
+  std::vector<uint32_t> best_;    // earliest arrival at each stop in any round
+  std::vector<uint32_t> access_;  // walking time from the origin to each stop
+  std::vector<uint32_t> egress_;  // walking time from each stop to the destination
+  std::vector<uint32_t> marked_;
+  std::vector<uint8_t> is_marked_;
+  std::vector<uint32_t> route_queue_;
+  std::vector<uint32_t> route_from_;     // the first position to scan each queued route from
+  std::vector<uint8_t> route_allowed_;   // whether transit costing allows a route, lazily filled
+  std::vector<uint8_t> stop_allowed_;    // whether transit costing allows a stop, lazily filled
+  uint32_t dest_arrival_;
+  uint32_t dest_round_;
+  uint32_t dest_stop_;
+
+  // Per search state of the walks
+  std::vector<sif::EdgeLabel> walk_labels_;
+  baldr::DoubleBucketQueue<sif::EdgeLabel> walk_queue_;
+  EdgeStatus walk_status_;
+  SearchMetrics search_metrics_; // tally of the settled edges for the metrics
+  std::vector<std::pair<uint32_t, uint32_t>> walk_stops_; // stop, label of each stop reached
+  uint32_t walk_dest_label_;
+  uint32_t walk_dest_arrival_;
+  std::map<uint64_t, sif::Cost> destinations_; // destination edges and their remainder cost
+
+  /**
+   * Get the timetable for the service day of the request covering the origin and the destination,
+   * reusing the last one if it already does.
+   */
+  void LoadTimetable(baldr::GraphReader& graphreader,
+                     const valhalla::Location& origin,
+                     const valhalla::Location& dest,
+                     const std::shared_ptr<sif::DynamicCost>& tc);
+
+  /**
+   * @return whether the transit costing allows the route
+   */
+  bool RouteAllowed(baldr::GraphReader& graphreader,
+                    const uint32_t route,
+                    const std::shared_ptr<sif::DynamicCost>& tc);
+
+  /**
+   * @return whether the transit costing allows the stop
+   */
+  bool StopAllowed(baldr::GraphReader& graphreader,
+                   const uint32_t stop,
+                   const std::shared_ptr<sif::DynamicCost>& tc);
+
+  /**
+   * Run the rounds for a departure from the origin, reusing the arrivals of the later departures.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  departure    departure from the origin in seconds from midnight
+   * @param  pc           pedestrian costing
+   * @param  tc           transit costing
+   */
+  void Run(baldr::GraphReader& graphreader,
+           const uint32_t departure,
+           const std::shared_ptr<sif::DynamicCost>& pc,
+           const std::shared_ptr<sif::DynamicCost>& tc);
+
+  /**
+   * Ride the routes from the stops marked in the previous round.
+   */
+  void ScanRoutes(baldr::GraphReader& graphreader,
+                  const uint32_t round,
+                  const std::shared_ptr<sif::DynamicCost>& tc);
+
+  /**
+   * Walk from the stops reached by transit in a round to the stops around them.
+   */
+  void Transfer(baldr::GraphReader& graphreader,
+                const uint32_t round,
+                const std::shared_ptr<sif::DynamicCost>& pc);
+
+  /**
+   * Set the arrival at a stop in a round if it is earlier than any so far.
+   * @return whether the arrival was set
+   */
+  bool Improve(const uint32_t round, const uint32_t stop, const StopLabel& label);
+
+  /**
+   * Set the destination edges and the cost from the destination to the end of each of them. Also
+   * seeds a walk leaving the destination along their opposing edges, which finds how long it takes
+   * to walk from the stops around it to the destination as long as walking is the same both ways.
+   */
+  void SetDestination(baldr::GraphReader& graphreader,
+                      const valhalla::Location& dest,
+                      const std::shared_ptr<sif::DynamicCost>& pc);
+
+  /**
+   * Forget the last walk.
+   */
+  void ResetWalk();
+
+  /**
+   * Start a walk from the origin edges.
+   * @param  time  when to leave the origin in seconds from midnight
+   */
+  void SeedOrigin(baldr::GraphReader& graphreader,
+                  const valhalla::Location& origin,
+                  const uint32_t time,
+                  const std::shared_ptr<sif::DynamicCost>& pc);
+
+  /**
+   * Start a walk from the end of an edge.
+   * @param  edgeid  the edge that arrives where to walk from
+   * @param  time    when the edge is left in seconds from midnight
+   */
+  void SeedEdge(baldr::GraphReader& graphreader, const baldr::GraphId& edgeid, const uint32_t time);
+
+  /**
+   * Walk from the seeds in order of arrival, recording the first arrival at every stop and at the
+   * destination. Stops are walked to but not through, unless the walk starts there.
+   * @param  graphreader   Graph reader for accessing routing graph.
+   * @param  pc            pedestrian costing
+   * @param  max_distance  how far to walk from any seed in meters
+   * @param  target        the stop to stop walking at, kInvalidTimetableIndex to walk to the
+   *                       destination or kAllStops to walk as far as possible
+   * @return the label reaching the target or kInvalidLabel
+   */
+  uint32_t Walk(baldr::GraphReader& graphreader,
+                const std::shared_ptr<sif::DynamicCost>& pc,
+                const uint32_t max_distance,
+                const uint32_t target);
+
+  /**
+   * Expand the walk from a node.
+   */
+  void ExpandWalk(baldr::GraphReader& graphreader,
+                  const baldr::GraphId& node,
+                  const sif::EdgeLabel& pred,
+                  const uint32_t pred_idx,
+                  const std::shared_ptr<sif::DynamicCost>& pc,
+                  const uint32_t max_distance,
+                  const bool from_transition);
+
+  /**
+   * Follow the labels of the current run back from the destination to the origin.
+   */
+  Journey Trace(const uint32_t departure) const;
+
+  /**
+   * Turn a journey into path edges by walking its walks again.
+   * @return the path or nothing if a walk can not be repeated
+   */
+  std::vector<PathInfo> FormPath(baldr::GraphReader& graphreader,
+                                 const valhalla::Location& origin,
+                                 const Journey& journey,
+                                 const std::shared_ptr<sif::DynamicCost>& pc);
+
+  /**
+   * Append the edges of the last walk to the path.
+   * @param  label          the label the walk reached its target with
+   * @param  path_distance  distance along the path so far, updated with the walk
+   */
+  void AppendWalk(uint32_t label, std::vector<PathInfo>& path, float& path_distance);
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_RAPTOR_H_
@@ -142,6 +142,9 @@ protected:
   EdgeStatus pedestrian_edgestatus_;
   EdgeStatus bicycle_edgestatus_;
 
+  // Tally of the settled edges for the metrics
+  SearchMetrics search_metrics_;
+
   // List of destinations
   std::vector<Destination> destinations_;
 
@@ -4,13 +4,18 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <boost/property_tree/ptree.hpp>
+
 #include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/astarheuristic.h>
@@ -26,10 +31,15 @@ namespace thor {
 class TimeDistanceMatrix {
 public:
   /**
-   * Default constructor. Most internal values are set when a query is made so
-   * the constructor mainly just sets some internals to a default empty value.
+   * Constructor. Most internal values are set when a query is made so the
+   * constructor mainly just sets some internals to a default empty value.
+   * @param  config  Thor configuration, timedistancematrix_threads sets how many
+   *                 one to many searches run at once (defaults to 1) and
+   *                 timedistancematrix_target_pruning whether the searches stop
+   *                 expanding nodes that can not reach any location in time
+   *                 (defaults to false).
    */
-  TimeDistanceMatrix();
+  explicit TimeDistanceMatrix(const boost::property_tree::ptree& config = {});
 
   /**
    * One to many time and distance cost matrix. Computes time and distance
@@ -138,10 +148,66 @@ protected:
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
 
+  // Tally of the settled edges for the metrics
+  SearchMetrics search_metrics_;
+
   AStarHeuristic astarheuristic_;
 
   sif::TravelMode mode_;
 
+  // Number of one to many searches run at once
+  uint32_t threads_;
+
+  // Searches run by each thread, they are kept so their labels and edge status are reused
+  std::vector<std::unique_ptr<TimeDistanceMatrix>> workers_;
+
+  // Serializes access to the graph reader when this is one of the searches run at once
+  std::mutex* tile_mutex_;
+
+  // Whether to stop expanding nodes that can not reach any of the locations being searched for
+  // within the cost threshold. The bounding box of those locations and the least cost per meter
+  // of the costing give a lower bound on the cost from a node to any of them
+  bool target_pruning_;
+  midgard::AABB2<midgard::PointLL> target_box_;
+  float target_cost_factor_;
+
+  /**
+   * Get a graph tile. Serializes access to the graph reader when the searches
+   * are run on multiple threads.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  id           Graph id within the tile.
+   * @return Returns the tile or nullptr if not found.
+   */
+  graph_tile_ptr GetGraphTile(baldr::GraphReader& graphreader, const baldr::GraphId& id);
+
+  /**
+   * Get the opposing edge of a directed edge. Serializes access to the graph
+   * reader when the searches are run on multiple threads.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  edgeid       Directed edge Id.
+   * @param  opp_edge     Set to the opposing directed edge.
+   * @return Returns the opposing edge Id, invalid if there is none.
+   */
+  baldr::GraphId GetOpposingEdgeId(baldr::GraphReader& graphreader,
+                                   const baldr::GraphId& edgeid,
+                                   const baldr::DirectedEdge*& opp_edge);
+
+  /**
+   * Set the region of the locations being searched for, used to prune the
+   * expansion when target pruning is enabled.
+   * @param  locations  List of locations.
+   */
+  void SetTargetRegion(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations);
+
+  /**
+   * Can the search still reach any of the locations being searched for from
+   * a node within the current cost threshold.
+   * @param  ll    Lat,lng of the node.
+   * @param  cost  Cost of the path to the node.
+   * @return Returns false if the node does not need to be expanded.
+   */
+  bool CanReachTargets(const midgard::PointLL& ll, const float cost) const;
+
   /**
    * Expand from the node along the forward search path. Immediately expands
    * from the end node of any transition edge (so no transition edges are added
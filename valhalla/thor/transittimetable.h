@@ -0,0 +1,221 @@
+#ifndef VALHALLA_THOR_TRANSITTIMETABLE_H_
+#define VALHALLA_THOR_TRANSITTIMETABLE_H_
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+
+namespace valhalla {
+namespace thor {
+
+// Index of a stop, route or trip that is not in the timetable
+constexpr uint32_t kInvalidTimetableIndex = std::numeric_limits<uint32_t>::max();
+
+/**
+ * When a trip arrives at and departs from a stop in seconds from midnight.
+ */
+struct StopTime {
+  uint32_t arrival;
+  uint32_t departure;
+};
+
+/**
+ * The schedule of some transit tiles for a single service day, laid out for round based searches
+ * like RAPTOR. Trips that run along the same transit line edges are grouped into routes and sorted
+ * by departure so that no trip of a route overtakes another one, trips that would are split off
+ * into a route of their own. Everything is stored in flat arrays: the stops of a route are a range
+ * of its stops, its trips a range of trips and their stop times a trip major range of stop times,
+ * so scanning a route only ever walks forward through memory.
+ */
+class TransitTimetable {
+public:
+  /**
+   * A scheduled hop of a trip from one stop to the next along a transit line edge.
+   */
+  struct Hop {
+    baldr::GraphId edgeid;    // the transit line edge
+    baldr::GraphId stop;      // the platform the edge leaves from
+    baldr::GraphId next_stop; // the platform the edge ends at
+    uint32_t departure;       // departure from the stop in seconds from midnight
+    uint32_t arrival;         // arrival at the next stop in seconds from midnight
+  };
+
+  /**
+   * A trip of a route.
+   */
+  struct Trip {
+    uint32_t tripid;
+    uint32_t blockid;
+  };
+
+  /**
+   * A sequence of stops and the trips that serve all of them in the same order.
+   */
+  struct Route {
+    uint32_t first_stop; // index of the first stop (and edge) of the route
+    uint32_t stop_count;
+    uint32_t first_trip; // index of the first trip of the route
+    uint32_t trip_count;
+    uint32_t first_time; // index of the first stop time of the first trip of the route
+  };
+
+  /**
+   * Build the timetable of transit tiles for a service day.
+   * @param  reader      graph reader to get the tiles from
+   * @param  tiles       the transit tiles to build the timetable of
+   * @param  date        the service day in days from the pivot date
+   * @param  dow         the day of week mask of the service day
+   * @param  wheelchair  only keep departures that are wheelchair accessible
+   * @param  bicycle     only keep departures that allow bicycles
+   * @return the timetable
+   */
+  static std::shared_ptr<TransitTimetable> Build(baldr::GraphReader& reader,
+                                                 const std::vector<baldr::GraphId>& tiles,
+                                                 const uint32_t date,
+                                                 const uint32_t dow,
+                                                 const bool wheelchair,
+                                                 const bool bicycle);
+
+  /**
+   * Add a trip. The timetable is only usable once all the trips are added and it is finalized.
+   * @param  tripid   id of the trip
+   * @param  blockid  id of the block the trip belongs to
+   * @param  hops     the consecutive hops of the trip, each one leaving from where the last ended
+   */
+  void AddTrip(const uint32_t tripid, const uint32_t blockid, const std::vector<Hop>& hops);
+
+  /**
+   * Group the added trips into routes and lay out the flat arrays.
+   */
+  void Finalize();
+
+  /**
+   * @return the number of stops
+   */
+  uint32_t stop_count() const {
+    return stops_.size();
+  }
+
+  /**
+   * @param  idx  index of a stop
+   * @return the platform node of the stop
+   */
+  const baldr::GraphId& stop(const uint32_t idx) const {
+    return stops_[idx];
+  }
+
+  /**
+   * @param  node  a platform node
+   * @return the index of its stop or kInvalidTimetableIndex if no trip serves it
+   */
+  uint32_t stop_index(const baldr::GraphId& node) const {
+    auto found = stop_indices_.find(node);
+    return found == stop_indices_.end() ? kInvalidTimetableIndex : found->second;
+  }
+
+  /**
+   * @return the number of routes
+   */
+  uint32_t route_count() const {
+    return routes_.size();
+  }
+
+  /**
+   * @param  idx  index of a route
+   * @return the route
+   */
+  const Route& route(const uint32_t idx) const {
+    return routes_[idx];
+  }
+
+  /**
+   * @param  route  the route
+   * @param  pos    position along the route
+   * @return index of the stop at the position
+   */
+  uint32_t route_stop(const Route& route, const uint32_t pos) const {
+    return route_stops_[route.first_stop + pos];
+  }
+
+  /**
+   * @param  route  the route
+   * @param  pos    position along the route, any but the last
+   * @return the transit line edge from the stop at the position to the next one
+   */
+  const baldr::GraphId& route_edge(const Route& route, const uint32_t pos) const {
+    return route_edges_[route.first_stop + pos];
+  }
+
+  /**
+   * @param  route  the route
+   * @param  trip   index of the trip within the route
+   * @return the trip
+   */
+  const Trip& trip(const Route& route, const uint32_t trip) const {
+    return trips_[route.first_trip + trip];
+  }
+
+  /**
+   * @param  route  the route
+   * @param  trip   index of the trip within the route
+   * @param  pos    position along the route
+   * @return when the trip arrives at and departs from the stop at the position
+   */
+  const StopTime& stop_time(const Route& route, const uint32_t trip, const uint32_t pos) const {
+    return stop_times_[route.first_time + trip * route.stop_count + pos];
+  }
+
+  /**
+   * @param  stop  index of a stop
+   * @return the routes serving the stop and the position of the stop along each of them
+   */
+  std::pair<const std::pair<uint32_t, uint32_t>*, const std::pair<uint32_t, uint32_t>*>
+  stop_routes(const uint32_t stop) const {
+    return {stop_routes_.data() + stop_route_offsets_[stop],
+            stop_routes_.data() + stop_route_offsets_[stop + 1]};
+  }
+
+  /**
+   * Find the first trip of a route that departs a stop at or after a time.
+   * @param  route  the route
+   * @param  pos    position of the stop along the route
+   * @param  time   the earliest departure in seconds from midnight
+   * @return index of the trip within the route or kInvalidTimetableIndex if none departs that late
+   */
+  uint32_t EarliestTrip(const Route& route, const uint32_t pos, const uint32_t time) const;
+
+protected:
+  // trips that were added but not yet laid out
+  struct PendingTrip {
+    Trip trip;
+    std::vector<Hop> hops;
+  };
+  std::vector<PendingTrip> pending_;
+
+  std::vector<baldr::GraphId> stops_;
+  std::unordered_map<baldr::GraphId, uint32_t> stop_indices_;
+  std::vector<Route> routes_;
+  std::vector<uint32_t> route_stops_;
+  std::vector<baldr::GraphId> route_edges_;
+  std::vector<Trip> trips_;
+  std::vector<StopTime> stop_times_;
+  std::vector<std::pair<uint32_t, uint32_t>> stop_routes_;
+  std::vector<uint32_t> stop_route_offsets_;
+
+  /**
+   * @param  node  a platform node
+   * @return the index of its stop, adding it if it is not there yet
+   */
+  uint32_t AddStop(const baldr::GraphId& node);
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_TRANSITTIMETABLE_H_
@@ -186,6 +186,9 @@ protected:
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
 
+  // Tally of the settled edges for the metrics
+  SearchMetrics search_metrics_;
+
   // Destinations, id and percent used along the edge
   std::unordered_map<uint64_t, float> destinations_percent_along_;
 
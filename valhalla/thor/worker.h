@@ -22,8 +22,13 @@
 #include <valhalla/thor/attributes_controller.h>
 #include <valhalla/thor/bidirectional_astar.h>
 #include <valhalla/thor/centroid.h>
+#include <valhalla/thor/contraction_hierarchy.h>
+#include <valhalla/thor/costmatrix.h>
 #include <valhalla/thor/isochrone.h>
 #include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/optimizer.h>
+#include <valhalla/thor/raptor.h>
+#include <valhalla/thor/timedistancematrix.h>
 #include <valhalla/thor/triplegbuilder.h>
 #include <valhalla/thor/unidirectional_astar.h>
 #include <valhalla/tyr/actor.h>
@@ -119,10 +124,24 @@ protected:
   BidirectionalAStar bidir_astar;
   AStarBSSAlgorithm bss_astar;
   MultiModalPathAlgorithm multi_modal_astar;
+  // Round based transit engine used instead of multi_modal_astar when configured
+  RaptorPathAlgorithm multi_modal_raptor;
+  bool use_raptor;
   TimeDepForward timedep_forward;
   TimeDepReverse timedep_reverse;
+  // Only there if the tiles have a contraction hierarchy overlay
+  std::unique_ptr<ContractionHierarchy> contraction_hierarchy;
+  // The auto costing options the overlay was built for
+  std::string contraction_costing_options;
+  // The generation of the tile extract the overlay goes with
+  uint64_t contraction_generation;
+
+  // Matrix algorithms, kept around so their edge status and labels are reused between requests
+  CostMatrix cost_matrix;
+  TimeDistanceMatrix time_distance_matrix;
 
   Isochrone isochrone_gen;
+  Optimizer optimizer;
   std::shared_ptr<meili::MapMatcher> matcher;
   float max_timedep_distance;
   std::unordered_map<std::string, float> max_matrix_distance;
@@ -18,6 +18,14 @@ public:
           baldr::GraphReader& reader,
           bool auto_cleanup = false);
   void cleanup();
+  /**
+   * Answers a request that was already parsed by running each of the stages it needs, one after the
+   * other on the same request object, so nothing is serialized but the response.
+   * @param request    the request, its options say which action to take
+   * @param interrupt  called periodically to stop processing if the request should be abandoned
+   * @return the serialized response
+   */
+  std::string act(Api& request, const std::function<void()>* interrupt = nullptr);
   std::string route(const std::string& request_str,
                     const std::function<void()>* interrupt = nullptr,
                     Api* api = nullptr);
@@ -61,6 +69,16 @@ protected:
   bool auto_cleanup;
 };
 
+#ifdef HAVE_HTTP
+/**
+ * Runs a service worker that takes requests straight from the http server and answers them by
+ * running loki, thor and odin in process, instead of passing the request through each of their
+ * workers in turn. Saves serializing and parsing the request between stages and the proxy hops.
+ * @param config  the service config
+ */
+void run_service(const boost::property_tree::ptree& config);
+#endif
+
 } // namespace tyr
 } // namespace valhalla
 
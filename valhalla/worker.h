@@ -4,8 +4,10 @@
 
 #include <valhalla/baldr/json.h>
 #include <valhalla/baldr/rapidjson_utils.h>
+#include <valhalla/midgard/metrics.h>
 #include <valhalla/midgard/util.h>
 #include <valhalla/proto/api.pb.h>
+#include <valhalla/proto_conversions.h>
 #include <valhalla/valhalla.h>
 
 #ifdef HAVE_HTTP
@@ -114,6 +116,7 @@ const std::unordered_map<unsigned, std::string> error_codes{
     {400, "Unknown action"},
     {401, "Failed to parse intermediate request format"},
     {402, "The service is shutting down"},
+    {403, "The tile extract the request was started on is no longer available"},
 
     {420, "Failed to parse correlated location"},
     {421, "Failed to parse location"},
@@ -166,6 +169,15 @@ inline midgard::scoped_timer<> measure_scope_time(Api& api, const std::string& s
     auto* stat = api.mutable_info()->mutable_statistics()->Add();
     stat->set_name(statistic_name);
     stat->set_value(e);
+    // also keep a distribution of the stage across requests for the metrics action
+    const auto& options = api.options();
+    midgard::metrics::histogram("valhalla_stage_duration_seconds",
+                                {{"stage", statistic_name},
+                                 {"action", Options_Action_Enum_Name(options.action())},
+                                 {"costing", options.has_costing()
+                                                 ? Costing_Enum_Name(options.costing())
+                                                 : std::string()}})
+        .observe(e / 1000.);
   });
 }
 
@@ -186,6 +198,7 @@ const content_type JSON_MIME{"Content-type", "application/json;charset=utf-8"};
 const content_type JS_MIME{"Content-type", "application/javascript;charset=utf-8"};
 const content_type XML_MIME{"Content-type", "text/xml;charset=utf-8"};
 const content_type GPX_MIME{"Content-type", "application/gpx+xml;charset=utf-8"};
+const content_type TEXT_MIME{"Content-type", "text/plain;version=0.0.4;charset=utf-8"};
 } // namespace worker
 
 prime_server::worker_t::result_t